@@ -118,7 +118,7 @@ if [[ $nobuild == 0 ]]; then
     fi
 
     ./bootstrap.sh > /dev/null
-    ./b2 -a -d+2 cxxflags="-std=gnu++11 -fPIC" -j6 install --prefix=$install --build-type=complete address-model=64 architecture=x86 link=static threading=multi --with-filesystem --with-program_options --with-system --with-thread --with-serialization --layout=tagged 
+    ./b2 -a -d+2 cxxflags="-std=gnu++11 -fPIC" -j6 install --prefix=$install --build-type=complete address-model=64 architecture=x86 link=static threading=multi --with-filesystem --with-program_options --with-system --with-thread --layout=tagged 
 
     cd $here
     echo "Boost installed in $prefix"
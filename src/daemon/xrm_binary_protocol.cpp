@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xrm_binary_protocol.hpp"
+#include "xrm_system.hpp"
+#include "xrm_metrics.hpp"
+
+/* encodes the allocated cu resource into the response payload */
+static void putAllocatedCuResource(xrm::binaryEncoder& enc, xrm::cuResource* cuRes) {
+    enc.putString(cuRes->xclbinFileName);
+    enc.putString(cuRes->uuidStr);
+    enc.putString(cuRes->kernelPluginFileName);
+    enc.putString(cuRes->kernelName);
+    enc.putString(cuRes->kernelAlias);
+    enc.putString(cuRes->instanceName);
+    enc.putString(cuRes->cuName);
+    enc.putInt32(cuRes->deviceId);
+    enc.putInt32(cuRes->cuId);
+    enc.putInt32(cuRes->channelId);
+    enc.putInt32((int32_t)cuRes->cuType);
+    enc.putUint64(cuRes->baseAddr);
+    enc.putUint32(cuRes->membankId);
+    enc.putUint32(cuRes->membankType);
+    enc.putUint64(cuRes->membankSize);
+    enc.putUint64(cuRes->membankBaseAddr);
+    enc.putUint64(cuRes->allocServiceId);
+    enc.putInt32(cuRes->channelLoadOriginal);
+    enc.putUint64(cuRes->poolId);
+}
+
+/* decodes the cu resource to be released from the request payload */
+static void getReleasingCuResource(xrm::binaryDecoder& dec, uint64_t clientId, xrm::cuResource* cuRes) {
+    cuRes->deviceId = dec.getInt32();
+    cuRes->cuId = dec.getInt32();
+    cuRes->channelId = dec.getInt32();
+    cuRes->cuType = (xrm::cuTypes)dec.getInt32();
+    cuRes->allocServiceId = dec.getUint64();
+    cuRes->clientId = clientId;
+    cuRes->channelLoadUnified = dec.getInt32();
+    cuRes->channelLoadOriginal = dec.getInt32();
+    cuRes->poolId = dec.getUint64();
+}
+
+static int32_t binaryCuAlloc(xrm::system* sys, xrm::binaryDecoder& dec, pid_t peerPid, xrm::binaryEncoder& enc) {
+    xrm::cuProperty cuProp;
+    xrm::cuResource cuRes;
+
+    memset(&cuProp, 0, sizeof(xrm::cuProperty));
+    cuProp.clientId = dec.getUint64();
+    cuProp.clientProcessId = dec.getInt32();
+    dec.getString(cuProp.kernelName, XRM_MAX_NAME_LEN);
+    dec.getString(cuProp.kernelAlias, XRM_MAX_NAME_LEN);
+    cuProp.devExcl = (dec.getUint8() != 0);
+    cuProp.requestLoadUnified = dec.getInt32();
+    cuProp.requestLoadOriginal = dec.getInt32();
+    cuProp.poolId = dec.getUint64();
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+    if (peerPid) cuProp.clientProcessId = peerPid;
+
+    memset(&cuRes, 0, sizeof(xrm::cuResource));
+    bool update_id = true;
+    sys->enterSharedLock();
+    int32_t ret = sys->resAllocCu(&cuProp, &cuRes, update_id);
+    sys->exitSharedLock();
+    if (ret == XRM_SUCCESS) putAllocatedCuResource(enc, &cuRes);
+    return (ret);
+}
+
+static int32_t binaryCuAllocV2(xrm::system* sys, xrm::binaryDecoder& dec, pid_t peerPid, xrm::binaryEncoder& enc) {
+    xrm::cuPropertyV2 cuProp;
+    xrm::cuResource cuRes;
+
+    memset(&cuProp, 0, sizeof(xrm::cuPropertyV2));
+    cuProp.clientId = dec.getUint64();
+    cuProp.clientProcessId = dec.getInt32();
+    dec.getString(cuProp.kernelName, XRM_MAX_NAME_LEN);
+    dec.getString(cuProp.kernelAlias, XRM_MAX_NAME_LEN);
+    cuProp.devExcl = (dec.getUint8() != 0);
+    cuProp.deviceInfo = dec.getUint64();
+    cuProp.memoryInfo = dec.getUint64();
+    cuProp.policyInfo = dec.getUint64();
+    cuProp.requestLoadUnified = dec.getInt32();
+    cuProp.requestLoadOriginal = dec.getInt32();
+    cuProp.poolId = dec.getUint64();
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+    if (peerPid) cuProp.clientProcessId = peerPid;
+
+    memset(&cuRes, 0, sizeof(xrm::cuResource));
+    bool update_id = true;
+    sys->enterSharedLock();
+    int32_t ret = sys->resAllocCuV2(&cuProp, &cuRes, update_id);
+    sys->exitSharedLock();
+    if (ret == XRM_SUCCESS) putAllocatedCuResource(enc, &cuRes);
+    return (ret);
+}
+
+static int32_t binaryCuListAlloc(xrm::system* sys, xrm::binaryDecoder& dec, pid_t peerPid, xrm::binaryEncoder& enc) {
+    xrm::cuListProperty cuListProp;
+    xrm::cuListResource cuListRes;
+    int32_t i;
+
+    memset(&cuListProp, 0, sizeof(xrm::cuListProperty));
+    uint64_t clientId = dec.getUint64();
+    pid_t clientProcessId = dec.getInt32();
+    if (peerPid) clientProcessId = peerPid;
+    cuListProp.cuNum = dec.getInt32();
+    cuListProp.sameDevice = (dec.getUint8() != 0);
+    if (cuListProp.cuNum <= 0 || cuListProp.cuNum > XRM_MAX_LIST_CU_NUM) return (XRM_ERROR_INVALID);
+    for (i = 0; i < cuListProp.cuNum; i++) {
+        xrm::cuProperty* cuProp = &cuListProp.cuProps[i];
+        dec.getString(cuProp->kernelName, XRM_MAX_NAME_LEN);
+        dec.getString(cuProp->kernelAlias, XRM_MAX_NAME_LEN);
+        cuProp->devExcl = (dec.getUint8() != 0);
+        cuProp->requestLoadUnified = dec.getInt32();
+        cuProp->requestLoadOriginal = dec.getInt32();
+        cuProp->poolId = dec.getUint64();
+        cuProp->clientId = clientId;
+        cuProp->clientProcessId = clientProcessId;
+    }
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+
+    memset(&cuListRes, 0, sizeof(xrm::cuListResource));
+    sys->enterSharedLock();
+    int32_t ret = sys->resAllocCuList(&cuListProp, &cuListRes);
+    sys->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
+        enc.putInt32(cuListRes.cuNum);
+        for (i = 0; i < cuListRes.cuNum; i++) putAllocatedCuResource(enc, &cuListRes.cuResources[i]);
+    }
+    return (ret);
+}
+
+static int32_t binaryCuListAllocV2(xrm::system* sys,
+                                   xrm::binaryDecoder& dec,
+                                   pid_t peerPid,
+                                   xrm::binaryEncoder& enc) {
+    xrm::cuListPropertyV2* cuListProp;
+    xrm::cuListResourceV2* cuListRes;
+    int32_t i;
+
+    uint64_t clientId = dec.getUint64();
+    pid_t clientProcessId = dec.getInt32();
+    if (peerPid) clientProcessId = peerPid;
+    int32_t cuNum = dec.getInt32();
+    if (cuNum <= 0 || cuNum > XRM_MAX_LIST_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    cuListProp = (xrm::cuListPropertyV2*)malloc(sizeof(xrm::cuListPropertyV2));
+    memset(cuListProp, 0, sizeof(xrm::cuListPropertyV2));
+    cuListProp->cuNum = cuNum;
+    for (i = 0; i < cuListProp->cuNum; i++) {
+        xrm::cuPropertyV2* cuProp = &cuListProp->cuProps[i];
+        dec.getString(cuProp->kernelName, XRM_MAX_NAME_LEN);
+        dec.getString(cuProp->kernelAlias, XRM_MAX_NAME_LEN);
+        cuProp->devExcl = (dec.getUint8() != 0);
+        cuProp->deviceInfo = dec.getUint64();
+        cuProp->memoryInfo = dec.getUint64();
+        cuProp->policyInfo = dec.getUint64();
+        cuProp->requestLoadUnified = dec.getInt32();
+        cuProp->requestLoadOriginal = dec.getInt32();
+        cuProp->poolId = dec.getUint64();
+        cuProp->clientId = clientId;
+        cuProp->clientProcessId = clientProcessId;
+    }
+    if (!dec.ok()) {
+        free(cuListProp);
+        return (XRM_ERROR_INVALID);
+    }
+
+    cuListRes = (xrm::cuListResourceV2*)malloc(sizeof(xrm::cuListResourceV2));
+    memset(cuListRes, 0, sizeof(xrm::cuListResourceV2));
+    sys->enterSharedLock();
+    int32_t ret = sys->resAllocCuListV2(cuListProp, cuListRes);
+    sys->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
+        enc.putInt32(cuListRes->cuNum);
+        for (i = 0; i < cuListRes->cuNum; i++) putAllocatedCuResource(enc, &cuListRes->cuResources[i]);
+    }
+    free(cuListProp);
+    free(cuListRes);
+    return (ret);
+}
+
+static int32_t binaryCuRelease(xrm::system* sys, xrm::binaryDecoder& dec, bool isV2) {
+    xrm::cuResource cuRes;
+
+    memset(&cuRes, 0, sizeof(xrm::cuResource));
+    uint64_t clientId = dec.getUint64();
+    getReleasingCuResource(dec, clientId, &cuRes);
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+
+    int32_t ret;
+    sys->enterSharedLock();
+    if (isV2)
+        ret = sys->resReleaseCuV2(&cuRes);
+    else
+        ret = sys->resReleaseCu(&cuRes);
+    sys->exitSharedLock();
+    return (ret);
+}
+
+static int32_t binaryCuListRelease(xrm::system* sys, xrm::binaryDecoder& dec) {
+    xrm::cuListResource cuListRes;
+    int32_t i;
+
+    memset(&cuListRes, 0, sizeof(xrm::cuListResource));
+    uint64_t clientId = dec.getUint64();
+    cuListRes.cuNum = dec.getInt32();
+    if (cuListRes.cuNum <= 0 || cuListRes.cuNum > XRM_MAX_LIST_CU_NUM) return (XRM_ERROR_INVALID);
+    for (i = 0; i < cuListRes.cuNum; i++) getReleasingCuResource(dec, clientId, &cuListRes.cuResources[i]);
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+
+    sys->enterSharedLock();
+    int32_t ret = sys->resReleaseCuList(&cuListRes);
+    sys->exitSharedLock();
+    return (ret);
+}
+
+static int32_t binaryCuListReleaseV2(xrm::system* sys, xrm::binaryDecoder& dec) {
+    xrm::cuListResourceV2* cuListRes;
+    int32_t i;
+
+    uint64_t clientId = dec.getUint64();
+    int32_t cuNum = dec.getInt32();
+    if (cuNum <= 0 || cuNum > XRM_MAX_LIST_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    cuListRes = (xrm::cuListResourceV2*)malloc(sizeof(xrm::cuListResourceV2));
+    memset(cuListRes, 0, sizeof(xrm::cuListResourceV2));
+    cuListRes->cuNum = cuNum;
+    for (i = 0; i < cuListRes->cuNum; i++) getReleasingCuResource(dec, clientId, &cuListRes->cuResources[i]);
+    if (!dec.ok()) {
+        free(cuListRes);
+        return (XRM_ERROR_INVALID);
+    }
+
+    sys->enterSharedLock();
+    int32_t ret = sys->resReleaseCuListV2(cuListRes);
+    sys->exitSharedLock();
+    free(cuListRes);
+    return (ret);
+}
+
+static int32_t binaryCuBatchAllocV2(xrm::system* sys,
+                                    xrm::binaryDecoder& dec,
+                                    pid_t peerPid,
+                                    xrm::binaryEncoder& enc) {
+    xrm::cuBatchPropertyV2* cuBatchProp;
+    xrm::cuBatchResourceV2* cuBatchRes;
+    int32_t i;
+
+    uint64_t clientId = dec.getUint64();
+    pid_t clientProcessId = dec.getInt32();
+    if (peerPid) clientProcessId = peerPid;
+    bool allOrNothing = (dec.getUint8() != 0);
+    int32_t cuNum = dec.getInt32();
+    if (cuNum <= 0 || cuNum > XRM_MAX_BATCH_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    cuBatchProp = (xrm::cuBatchPropertyV2*)malloc(sizeof(xrm::cuBatchPropertyV2));
+    memset(cuBatchProp, 0, sizeof(xrm::cuBatchPropertyV2));
+    cuBatchProp->cuNum = cuNum;
+    cuBatchProp->allOrNothing = allOrNothing;
+    for (i = 0; i < cuBatchProp->cuNum; i++) {
+        xrm::cuPropertyV2* cuProp = &cuBatchProp->cuProps[i];
+        dec.getString(cuProp->kernelName, XRM_MAX_NAME_LEN);
+        dec.getString(cuProp->kernelAlias, XRM_MAX_NAME_LEN);
+        cuProp->devExcl = (dec.getUint8() != 0);
+        cuProp->deviceInfo = dec.getUint64();
+        cuProp->memoryInfo = dec.getUint64();
+        cuProp->policyInfo = dec.getUint64();
+        cuProp->requestLoadUnified = dec.getInt32();
+        cuProp->requestLoadOriginal = dec.getInt32();
+        cuProp->poolId = dec.getUint64();
+        cuProp->clientId = clientId;
+        cuProp->clientProcessId = clientProcessId;
+    }
+    if (!dec.ok()) {
+        free(cuBatchProp);
+        return (XRM_ERROR_INVALID);
+    }
+
+    cuBatchRes = (xrm::cuBatchResourceV2*)malloc(sizeof(xrm::cuBatchResourceV2));
+    memset(cuBatchRes, 0, sizeof(xrm::cuBatchResourceV2));
+    /* the whole batch is done within one lock */
+    sys->enterSharedLock();
+    int32_t batchResult = sys->resAllocCuBatchV2(cuBatchProp, cuBatchRes);
+    sys->exitSharedLock();
+    enc.putInt32(batchResult);
+    enc.putInt32(cuBatchRes->cuNum);
+    for (i = 0; i < cuBatchRes->cuNum; i++) {
+        enc.putInt32(cuBatchRes->cuResults[i]);
+        if (cuBatchRes->cuResults[i] == XRM_SUCCESS) putAllocatedCuResource(enc, &cuBatchRes->cuResources[i]);
+    }
+    free(cuBatchProp);
+    free(cuBatchRes);
+    return (XRM_SUCCESS);
+}
+
+static int32_t binaryCuBatchReleaseV2(xrm::system* sys, xrm::binaryDecoder& dec, xrm::binaryEncoder& enc) {
+    xrm::cuBatchResourceV2* cuBatchRes;
+    int32_t i;
+
+    uint64_t clientId = dec.getUint64();
+    int32_t cuNum = dec.getInt32();
+    if (cuNum <= 0 || cuNum > XRM_MAX_BATCH_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    cuBatchRes = (xrm::cuBatchResourceV2*)malloc(sizeof(xrm::cuBatchResourceV2));
+    memset(cuBatchRes, 0, sizeof(xrm::cuBatchResourceV2));
+    cuBatchRes->cuNum = cuNum;
+    for (i = 0; i < cuBatchRes->cuNum; i++) getReleasingCuResource(dec, clientId, &cuBatchRes->cuResources[i]);
+    if (!dec.ok()) {
+        free(cuBatchRes);
+        return (XRM_ERROR_INVALID);
+    }
+
+    sys->enterSharedLock();
+    sys->resReleaseCuBatchV2(cuBatchRes);
+    sys->exitSharedLock();
+    enc.putInt32(cuBatchRes->cuNum);
+    for (i = 0; i < cuBatchRes->cuNum; i++) enc.putInt32(cuBatchRes->cuResults[i]);
+    free(cuBatchRes);
+    return (XRM_SUCCESS);
+}
+
+static int32_t binaryCuCheckStatus(xrm::system* sys, xrm::binaryDecoder& dec, xrm::binaryEncoder& enc) {
+    xrm::cuResource cuRes;
+    xrm::cuStatus cuStat;
+
+    memset(&cuRes, 0, sizeof(xrm::cuResource));
+    cuRes.deviceId = dec.getInt32();
+    cuRes.cuId = dec.getInt32();
+    cuRes.channelId = dec.getInt32();
+    cuRes.cuType = (xrm::cuTypes)dec.getInt32();
+    cuRes.allocServiceId = dec.getUint64();
+    if (!dec.ok()) return (XRM_ERROR_INVALID);
+
+    memset(&cuStat, 0, sizeof(xrm::cuStatus));
+    sys->enterSharedLock();
+    int32_t ret = sys->checkCuStat(&cuRes, &cuStat);
+    sys->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
+        enc.putUint8(cuStat.isBusy ? 1 : 0);
+        enc.putInt32(cuStat.usedLoadOriginal);
+    }
+    return (ret);
+}
+
+int32_t xrm::processBinaryCmd(
+    xrm::system* sys, const binaryHeader& reqHeader, const char* payload, pid_t peerPid, std::string& rsp) {
+    std::string rspPayload;
+    xrm::binaryEncoder enc(rspPayload);
+    xrm::binaryDecoder dec(payload, reqHeader.payloadSize);
+    int32_t ret;
+
+    uint64_t startTime = xrm::metricsNowUs();
+
+    if (reqHeader.version == 0 || reqHeader.version > XRM_BINARY_PROTOCOL_VERSION) {
+        sys->logMsg(XRM_LOG_ERROR, "%s: unsupported binary protocol version %d", __func__, reqHeader.version);
+        xrm::binaryEncodeMessage(rsp, reqHeader.opcode, XRM_ERROR_INVALID, reqHeader.requestId, rspPayload);
+        return (XRM_ERROR_INVALID);
+    }
+
+    switch (reqHeader.opcode) {
+        case BINARY_OP_CU_ALLOC:
+            ret = binaryCuAlloc(sys, dec, peerPid, enc);
+            break;
+        case BINARY_OP_CU_ALLOC_V2:
+            ret = binaryCuAllocV2(sys, dec, peerPid, enc);
+            break;
+        case BINARY_OP_CU_RELEASE:
+            ret = binaryCuRelease(sys, dec, false);
+            break;
+        case BINARY_OP_CU_RELEASE_V2:
+            ret = binaryCuRelease(sys, dec, true);
+            break;
+        case BINARY_OP_CU_LIST_ALLOC:
+            ret = binaryCuListAlloc(sys, dec, peerPid, enc);
+            break;
+        case BINARY_OP_CU_LIST_ALLOC_V2:
+            ret = binaryCuListAllocV2(sys, dec, peerPid, enc);
+            break;
+        case BINARY_OP_CU_LIST_RELEASE:
+            ret = binaryCuListRelease(sys, dec);
+            break;
+        case BINARY_OP_CU_LIST_RELEASE_V2:
+            ret = binaryCuListReleaseV2(sys, dec);
+            break;
+        case BINARY_OP_CU_CHECK_STATUS:
+            ret = binaryCuCheckStatus(sys, dec, enc);
+            break;
+        case BINARY_OP_CU_BATCH_ALLOC_V2:
+            ret = binaryCuBatchAllocV2(sys, dec, peerPid, enc);
+            break;
+        case BINARY_OP_CU_BATCH_RELEASE_V2:
+            ret = binaryCuBatchReleaseV2(sys, dec, enc);
+            break;
+        default:
+            sys->logMsg(XRM_LOG_ERROR, "%s: unknown binary opcode %d", __func__, reqHeader.opcode);
+            ret = XRM_ERROR_INVALID;
+            break;
+    }
+    if (sys->getMetrics() != NULL)
+        sys->getMetrics()->getBinaryCommand(reqHeader.opcode)->record(ret, xrm::metricsNowUs() - startTime);
+    if (ret != XRM_SUCCESS) rspPayload.clear();
+    xrm::binaryEncodeMessage(rsp, reqHeader.opcode, ret, reqHeader.requestId, rspPayload, reqHeader.version);
+    return (ret);
+}
+
+const char* xrm::binaryOpcodeName(uint16_t opcode) {
+    switch (opcode) {
+        case BINARY_OP_CU_ALLOC:
+            return ("cuAlloc");
+        case BINARY_OP_CU_ALLOC_V2:
+            return ("cuAllocV2");
+        case BINARY_OP_CU_RELEASE:
+            return ("cuRelease");
+        case BINARY_OP_CU_RELEASE_V2:
+            return ("cuReleaseV2");
+        case BINARY_OP_CU_LIST_ALLOC:
+            return ("cuListAlloc");
+        case BINARY_OP_CU_LIST_ALLOC_V2:
+            return ("cuListAllocV2");
+        case BINARY_OP_CU_LIST_RELEASE:
+            return ("cuListRelease");
+        case BINARY_OP_CU_LIST_RELEASE_V2:
+            return ("cuListReleaseV2");
+        case BINARY_OP_CU_CHECK_STATUS:
+            return ("cuCheckStatus");
+        case BINARY_OP_CU_BATCH_ALLOC_V2:
+            return ("cuBatchAllocV2");
+        case BINARY_OP_CU_BATCH_RELEASE_V2:
+            return ("cuBatchReleaseV2");
+        default:
+            return (NULL);
+    }
+}
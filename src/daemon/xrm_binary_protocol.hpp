@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_BINARY_PROTOCOL_HPP_
+#define _XRM_BINARY_PROTOCOL_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+
+/*
+ * Binary protocol for the hot allocation path between libxrm and the daemon.
+ *
+ * The binary protocol is negotiated during context creating: the library puts its
+ * version into createContext request as "binaryProtocolVersion", the daemon answers
+ * with the version it will speak. If the daemon does not answer, the library keeps
+ * using JSON. xrmadm and other tools always talk JSON. The createContext request is
+ * always unframed JSON; it's also used to re-establish the session of a context after
+ * the daemon is restarted.
+ *
+ * Every binary message starts with a fixed size header (all fields little endian):
+ *
+ *   uint32_t magic;       // XRM_BINARY_PROTOCOL_MAGIC
+ *   uint16_t version;     // protocol version
+ *   uint16_t opcode;      // xrm::binaryOpcode
+ *   uint32_t payloadSize; // size of payload following the header
+ *   int32_t  status;      // request: wait time, see below, response: return value of the command
+ *   uint64_t requestId;   // echoed back in response
+ *
+ * The magic never starts with '{', so daemon can tell binary message from JSON one.
+ *
+ * Since version 2, any JSON request can be framed by the header with opcode JSON, the
+ * payload is the JSON text and the response is framed the same way. Framed requests
+ * can be pipelined: client may send several requests without waiting for responses,
+ * daemon answers them in the order received with the requestId of each request echoed.
+ * Unframed JSON (legacy) is still accepted, one read is taken as one request and the
+ * response is prefixed with 4 bytes length.
+ *
+ * Since version 3, the status field of an allocation request (CU_ALLOC, CU_ALLOC_V2,
+ * CU_LIST_ALLOC, CU_LIST_ALLOC_V2, and JSON cuAlloc, cuListAlloc, cuGroupAlloc and their
+ * V2 commands) is the time in milliseconds the daemon may hold the request when there is
+ * no free resource: 0 to answer at once, XRM_BINARY_WAIT_FOREVER to wait without limit.
+ * The request is answered as soon as it's satisfied by released resource, or with the
+ * failure when the time is out. The status field is 0 in any other request.
+ *
+ * Payload layout (string is uint16_t length followed by the characters, no terminator):
+ *
+ *   cu resource (response):
+ *     string xclbinFileName, uuidStr, kernelPluginFileName, kernelName, kernelAlias, instanceName, cuName;
+ *     int32 deviceId, cuId, channelId, cuType; uint64 baseAddr; uint32 membankId, membankType;
+ *     uint64 membankSize, membankBaseAddr, allocServiceId; int32 channelLoadOriginal; uint64 poolId
+ *   cu resource (release):
+ *     int32 deviceId, cuId, channelId, cuType; uint64 allocServiceId;
+ *     int32 channelLoadUnified, channelLoadOriginal; uint64 poolId
+ *
+ *   CU_ALLOC         request:  uint64 clientId; int32 clientProcessId; string kernelName, kernelAlias;
+ *                              uint8 devExcl; int32 requestLoadUnified, requestLoadOriginal; uint64 poolId
+ *                    response: cu resource
+ *   CU_ALLOC_V2      request:  as CU_ALLOC, with uint64 deviceInfo, memoryInfo, policyInfo after devExcl
+ *                    response: cu resource
+ *   CU_LIST_ALLOC    request:  uint64 clientId; int32 clientProcessId; int32 cuNum; uint8 sameDevice;
+ *                              cuNum * (string kernelName, kernelAlias; uint8 devExcl;
+ *                                       int32 requestLoadUnified, requestLoadOriginal; uint64 poolId)
+ *                    response: int32 cuNum; cuNum * cu resource
+ *   CU_LIST_ALLOC_V2 request:  uint64 clientId; int32 clientProcessId; int32 cuNum;
+ *                              cuNum * (string kernelName, kernelAlias; uint8 devExcl;
+ *                                       uint64 deviceInfo, memoryInfo, policyInfo;
+ *                                       int32 requestLoadUnified, requestLoadOriginal; uint64 poolId)
+ *                    response: int32 cuNum; cuNum * cu resource
+ *   CU_RELEASE(_V2)  request:  uint64 clientId; cu resource (release)
+ *                    response: empty
+ *   CU_LIST_RELEASE(_V2)
+ *                    request:  uint64 clientId; int32 cuNum; cuNum * cu resource (release)
+ *                    response: empty
+ *   CU_CHECK_STATUS  request:  int32 deviceId, cuId, channelId, cuType; uint64 allocServiceId
+ *                    response: uint8 isBusy; int32 usedLoadOriginal
+ *   CU_BATCH_ALLOC_V2
+ *                    request:  uint64 clientId; int32 clientProcessId; uint8 allOrNothing; int32 cuNum;
+ *                              cuNum * (as CU_ALLOC_V2 after clientProcessId)
+ *                    response: int32 batchResult; int32 cuNum; cuNum * (int32 result; cu resource if result is 0)
+ *   CU_BATCH_RELEASE_V2
+ *                    request:  uint64 clientId; int32 cuNum; cuNum * cu resource (release)
+ *                    response: int32 cuNum; cuNum * int32 result
+ *                    the status of batch response is 0 unless the request is malformed, the
+ *                    result of each cu is in the payload (since version 4)
+ *   JSON             request:  JSON request text
+ *                    response: JSON response text
+ */
+#define XRM_BINARY_PROTOCOL_MAGIC 0x424D5258 // "XRMB"
+#define XRM_BINARY_PROTOCOL_VERSION_1 1
+#define XRM_BINARY_PROTOCOL_VERSION_2 2 // framed JSON and pipelining
+#define XRM_BINARY_PROTOCOL_VERSION_3 3 // allocation waits in daemon
+#define XRM_BINARY_PROTOCOL_VERSION_4 4 // batch allocation and release
+#define XRM_BINARY_PROTOCOL_VERSION XRM_BINARY_PROTOCOL_VERSION_4
+#define XRM_BINARY_HEADER_SIZE 24
+#define XRM_BINARY_MAX_PAYLOAD_SIZE (1024 * 1024)
+#define XRM_BINARY_WAIT_FOREVER (-1)
+
+namespace xrm {
+
+enum binaryOpcode : uint16_t {
+    BINARY_OP_JSON = 0,
+    BINARY_OP_CU_ALLOC = 1,
+    BINARY_OP_CU_ALLOC_V2 = 2,
+    BINARY_OP_CU_RELEASE = 3,
+    BINARY_OP_CU_RELEASE_V2 = 4,
+    BINARY_OP_CU_LIST_ALLOC = 5,
+    BINARY_OP_CU_LIST_ALLOC_V2 = 6,
+    BINARY_OP_CU_LIST_RELEASE = 7,
+    BINARY_OP_CU_LIST_RELEASE_V2 = 8,
+    BINARY_OP_CU_CHECK_STATUS = 9,
+    BINARY_OP_CU_BATCH_ALLOC_V2 = 10,
+    BINARY_OP_CU_BATCH_RELEASE_V2 = 11,
+};
+
+typedef struct binaryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t opcode;
+    uint32_t payloadSize;
+    int32_t status;
+    uint64_t requestId;
+} binaryHeader;
+
+/*
+ * Appends little endian fields to the buffer.
+ */
+class binaryEncoder {
+   public:
+    binaryEncoder(std::string& buf) : m_buf(buf) {}
+
+    void putUint8(uint8_t value) { m_buf.push_back((char)value); }
+    void putUint16(uint16_t value) { putLE(value, sizeof(value)); }
+    void putUint32(uint32_t value) { putLE(value, sizeof(value)); }
+    void putInt32(int32_t value) { putLE((uint32_t)value, sizeof(value)); }
+    void putUint64(uint64_t value) { putLE(value, sizeof(value)); }
+    void putString(const char* str) {
+        size_t len = strnlen(str, UINT16_MAX);
+        putUint16((uint16_t)len);
+        m_buf.append(str, len);
+    }
+
+   private:
+    void putLE(uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; i++) m_buf.push_back((char)((value >> (8 * i)) & 0xff));
+    }
+
+    std::string& m_buf;
+};
+
+/*
+ * Reads little endian fields from the buffer. Reading beyond the end of the buffer
+ * returns 0 / empty string and marks the decoder as failed, so caller only needs to
+ * check ok() once after all fields are read.
+ */
+class binaryDecoder {
+   public:
+    binaryDecoder(const char* data, size_t size) : m_data((const unsigned char*)data), m_size(size) {}
+
+    bool ok() const { return m_ok; }
+
+    uint8_t getUint8() { return (uint8_t)getLE(sizeof(uint8_t)); }
+    uint16_t getUint16() { return (uint16_t)getLE(sizeof(uint16_t)); }
+    uint32_t getUint32() { return (uint32_t)getLE(sizeof(uint32_t)); }
+    int32_t getInt32() { return (int32_t)getLE(sizeof(int32_t)); }
+    uint64_t getUint64() { return getLE(sizeof(uint64_t)); }
+    /* copies at most outSize - 1 characters, out is always null terminated */
+    void getString(char* out, size_t outSize) {
+        size_t len = getUint16();
+        if (!reserve(len)) len = 0;
+        size_t copyLen = (len < outSize - 1) ? len : outSize - 1;
+        memcpy(out, m_data + m_pos, copyLen);
+        out[copyLen] = '\0';
+        m_pos += len;
+    }
+
+   private:
+    bool reserve(size_t size) {
+        if (!m_ok || m_size - m_pos < size) {
+            m_ok = false;
+            return (false);
+        }
+        return (true);
+    }
+    uint64_t getLE(size_t size) {
+        uint64_t value = 0;
+        if (!reserve(size)) return (0);
+        for (size_t i = 0; i < size; i++) value |= (uint64_t)m_data[m_pos + i] << (8 * i);
+        m_pos += size;
+        return (value);
+    }
+
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+/*
+ * Builds one complete binary message: header followed by payload. The version is the
+ * negotiated one, so that the peer of an older version still accepts the message.
+ */
+inline void binaryEncodeMessage(std::string& msg,
+                                uint16_t opcode,
+                                int32_t status,
+                                uint64_t requestId,
+                                const std::string& payload,
+                                uint16_t version = XRM_BINARY_PROTOCOL_VERSION) {
+    binaryEncoder enc(msg);
+    enc.putUint32(XRM_BINARY_PROTOCOL_MAGIC);
+    enc.putUint16(version);
+    enc.putUint16(opcode);
+    enc.putUint32((uint32_t)payload.size());
+    enc.putInt32(status);
+    enc.putUint64(requestId);
+    msg.append(payload);
+}
+
+/*
+ * Decodes the message header, return false if it's not a binary message.
+ */
+inline bool binaryDecodeHeader(const char* data, size_t size, binaryHeader& header) {
+    if (size < XRM_BINARY_HEADER_SIZE) return (false);
+    binaryDecoder dec(data, XRM_BINARY_HEADER_SIZE);
+    header.magic = dec.getUint32();
+    header.version = dec.getUint16();
+    header.opcode = dec.getUint16();
+    header.payloadSize = dec.getUint32();
+    header.status = dec.getInt32();
+    header.requestId = dec.getUint64();
+    return (header.magic == XRM_BINARY_PROTOCOL_MAGIC);
+}
+
+/*
+ * Checks whether the data, maybe shorter than the header, is the beginning of a binary message.
+ */
+inline bool binaryIsMessagePrefix(const char* data, size_t size) {
+    std::string magic;
+    binaryEncoder enc(magic);
+    enc.putUint32(XRM_BINARY_PROTOCOL_MAGIC);
+    return (memcmp(data, magic.data(), (size < magic.size()) ? size : magic.size()) == 0);
+}
+
+class system;
+
+/*
+ * Daemon side handler of one binary request, the response message (header and payload)
+ * is appended to rsp and the return value of the command is returned. peerPid is the
+ * process id from peer credential, 0 if unknown.
+ */
+int32_t processBinaryCmd(
+    xrm::system* sys, const binaryHeader& reqHeader, const char* payload, pid_t peerPid, std::string& rsp);
+
+/* name of the request of the opcode, the name of its JSON request if it has one, NULL if unknown */
+const char* binaryOpcodeName(uint16_t opcode);
+
+} // namespace xrm
+
+#endif // _XRM_BINARY_PROTOCOL_HPP_
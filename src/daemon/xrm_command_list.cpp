@@ -100,11 +100,13 @@ void xrm::listCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
                     outrsp.add(cuNode + ".maxCapacity  ", cuData->maxCapacity);
                 else
                     outrsp.add(cuNode + ".maxCapacity  ", "");
-                outrsp.add(cuNode + ".numChanInuse ", cuData->numChanInuse);
-                outrsp.add(cuNode + ".usedLoad     ", std::to_string(cuData->totalUsedLoadUnified) + " of 1000000");
-                outrsp.add(cuNode + ".reservedLoad ", std::to_string(cuData->totalReservedLoadUnified) + " of 1000000");
+                outrsp.add(cuNode + ".numChanInuse ", cuData->hot->numChanInuse);
+                outrsp.add(cuNode + ".usedLoad     ",
+                           std::to_string(cuData->hot->totalUsedLoadUnified) + " of 1000000");
+                outrsp.add(cuNode + ".reservedLoad ",
+                           std::to_string(cuData->hot->totalReservedLoadUnified) + " of 1000000");
                 outrsp.add(cuNode + ".resrvUsedLoad",
-                           std::to_string(cuData->totalReservedUsedLoadUnified) + " of 1000000");
+                           std::to_string(cuData->hot->totalReservedUsedLoadUnified) + " of 1000000");
             }
         } else {
             if (devData->isDisabled)
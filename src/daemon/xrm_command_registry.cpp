@@ -23,18 +23,33 @@
 #include "xrm_command_unload.hpp"
 #include "xrm_command_resource.hpp"
 #include "xrm_command_plugin.hpp"
+#include "xrm_metrics.hpp"
 
+/*
+ * The request is counted by its command and the return value in the response. The commands
+ * which only answer "ok" or "failed" are counted as XRM_SUCCESS or XRM_ERROR.
+ */
 void xrm::commandRegistry::dispatch(std::string& name, pt::ptree& incmd, pt::ptree& outrsp) {
+    uint64_t startTime = xrm::metricsNowUs();
+    xrm::metricsCommand* cmdMetrics = NULL;
     auto iter = m_registry.find(name);
     if (iter != m_registry.end()) {
         iter->second->processCmd(incmd, outrsp);
+        if (m_metrics != NULL) cmdMetrics = m_metrics->getCommand(name);
     } else {
         outrsp.put("response.status", "failed");
         outrsp.put("response.data.failed", "unsupported cmd name: " + name);
+        if (m_metrics != NULL) cmdMetrics = m_metrics->getUnknownCommand();
+    }
+    if (cmdMetrics != NULL) {
+        int32_t ret = (outrsp.get<std::string>("response.status", "") == "ok") ? XRM_SUCCESS : XRM_ERROR;
+        cmdMetrics->record(outrsp.get<int32_t>("response.status.value", ret), xrm::metricsNowUs() - startTime);
     }
 }
 
 void xrm::commandRegistry::registerAll(system& sys) {
+    m_metrics = sys.getMetrics();
+
     auto list = new xrm::listCommand(sys);
     registerCmd(*list);
 
@@ -68,6 +83,9 @@ void xrm::commandRegistry::registerAll(system& sys) {
     auto echoContext = new xrm::echoContextCommand(sys);
     registerCmd(*echoContext);
 
+    auto reclaimContext = new xrm::reclaimContextCommand(sys);
+    registerCmd(*reclaimContext);
+
     auto destroyContext = new xrm::destroyContextCommand(sys);
     registerCmd(*destroyContext);
 
@@ -212,4 +230,5 @@ void xrm::commandRegistry::registerAll(system& sys) {
 
 void xrm::commandRegistry::registerCmd(xrm::command& cmd) {
     m_registry.insert(std::make_pair(cmd.getName(), &cmd));
+    if (m_metrics != NULL) m_metrics->addCommand(cmd.getName());
 }
@@ -27,6 +27,7 @@ namespace xrm {
 // Forward declare
 class command;
 class system;
+class metrics;
 
 class commandRegistry {
    public:
@@ -38,6 +39,7 @@ class commandRegistry {
    private:
     void registerCmd(xrm::command& cmd);
     std::map<std::string, xrm::command*> m_registry;
+    xrm::metrics* m_metrics = NULL;
 };
 } // namespace xrm
 
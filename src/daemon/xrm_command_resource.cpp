@@ -16,19 +16,31 @@
  */
 
 #include "xrm_command_resource.hpp"
+#include "xrm_binary_protocol.hpp"
 
 void xrm::createContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     auto context = incmd.get<std::string>("request.parameters.context");
     int32_t logLevel = m_system->getLogLevel();
     uint64_t clientId;
-    m_system->enterLock();
-    if (m_system->incNumConcurrentClient())
-        clientId = m_system->getNewClientId();
-    else
+    /* the context reconnecting after daemon restart asks for its client id */
+    auto requestClientId = incmd.get<uint64_t>("request.parameters.clientId", 0);
+    m_system->enterSharedLock();
+    if (!m_system->incNumConcurrentClient())
         clientId = 0; // reach the limit of concurrent client, fail to create new context
-    m_system->exitLock();
+    else if (m_system->isEarlierClientId(requestClientId))
+        clientId = requestClientId;
+    else
+        clientId = m_system->getNewClientId();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", logLevel);
     outrsp.put("response.data.clientId", clientId);
+    /* the daemon answering the generation records the client id in this request, see session::handleCmd() */
+    outrsp.put("response.data.generation", m_system->getGeneration());
+    /* only answer the binary protocol version to the client which asks for it */
+    auto binaryProtocolVersion = incmd.get<uint32_t>("request.parameters.binaryProtocolVersion", 0);
+    if (binaryProtocolVersion)
+        outrsp.put("response.data.binaryProtocolVersion",
+                   std::min(binaryProtocolVersion, (uint32_t)XRM_BINARY_PROTOCOL_VERSION));
 }
 
 void xrm::echoContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
@@ -36,9 +48,44 @@ void xrm::echoContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     outrsp.put("response.status.value", XRM_SUCCESS);
 }
 
+/*
+ * The context reconnecting after daemon restart presents the allocations and the reserve
+ * pools it still holds, the ones of the restored state not presented are recycled. The
+ * response lists the presented ones kept, the others are gone, e.g. released just before
+ * the restart.
+ */
+void xrm::reclaimContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
+    std::set<uint64_t> allocServiceIds, poolIds, keptAllocServiceIds, keptPoolIds;
+    int32_t numDropped = 0;
+
+    auto clientId = incmd.get<uint64_t>("request.parameters.clientId");
+    auto clientProcessId = incmd.get<pid_t>("request.parameters.clientProcessId");
+    auto allocServiceIdNum = incmd.get<int32_t>("request.parameters.allocServiceIdNum", 0);
+    for (int32_t i = 0; i < allocServiceIdNum; i++)
+        allocServiceIds.insert(incmd.get<uint64_t>("request.parameters.allocServiceId" + std::to_string(i)));
+    auto poolIdNum = incmd.get<int32_t>("request.parameters.poolIdNum", 0);
+    for (int32_t i = 0; i < poolIdNum; i++)
+        poolIds.insert(incmd.get<uint64_t>("request.parameters.poolId" + std::to_string(i)));
+
+    m_system->enterLock();
+    int32_t ret = m_system->reclaimClient(clientId, clientProcessId, allocServiceIds, poolIds, &keptAllocServiceIds,
+                                          &keptPoolIds, &numDropped);
+    m_system->exitLock();
+    outrsp.put("response.status.value", ret);
+    if (ret != XRM_SUCCESS) return;
+    outrsp.put("response.data.numDropped", numDropped);
+    int32_t i = 0;
+    outrsp.put("response.data.allocServiceIdNum", keptAllocServiceIds.size());
+    for (uint64_t allocServiceId : keptAllocServiceIds)
+        outrsp.put("response.data.allocServiceId" + std::to_string(i++), allocServiceId);
+    i = 0;
+    outrsp.put("response.data.poolIdNum", keptPoolIds.size());
+    for (uint64_t poolId : keptPoolIds) outrsp.put("response.data.poolId" + std::to_string(i++), poolId);
+}
+
 void xrm::destroyContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     auto context = incmd.get<std::string>("request.parameters.context");
-    m_system->enterLock();
+    m_system->enterSharedLock();
 #if 0
     m_system->decNumConcurrentClient();
     /* the save() function is time cost operation, so not do it here */
@@ -52,7 +99,7 @@ void xrm::destroyContextCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
     auto clientId = incmd.get<uint64_t>("request.parameters.clientId");
     if (clientId) m_system->recycleResource(clientId);
 #endif
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", XRM_SUCCESS);
 }
 
@@ -92,9 +139,9 @@ void xrm::cuAllocCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuProp.poolId = poolId;
 
     bool update_id = true;
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCu(&cuProp, &cuRes, update_id);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.xclbinFileName", cuRes.xclbinFileName);
@@ -267,9 +314,9 @@ void xrm::cuListAllocCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     }
 
     memset(&cuListRes, 0, sizeof(cuListResource));
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCuList(&cuListProp, &cuListRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.cuNum", cuListRes.cuNum);
@@ -315,9 +362,9 @@ void xrm::cuGroupAllocCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuGroupProp.poolId = poolId;
 
     memset(&cuGroupRes, 0, sizeof(cuGroupResource));
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCuGroup(&cuGroupProp, &cuGroupRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.cuNum", cuGroupRes.cuNum);
@@ -370,9 +417,9 @@ void xrm::cuReleaseCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuRes.channelLoadOriginal = channelLoadOriginal;
     cuRes.poolId = poolId;
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCu(&cuRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
 }
 
@@ -405,9 +452,9 @@ void xrm::cuListReleaseCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
         cuListRes.cuResources[i].poolId = poolId;
     }
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCuList(&cuListRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
 }
 
@@ -440,9 +487,9 @@ void xrm::cuGroupReleaseCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
         cuGroupRes.cuResources[i].poolId = poolId;
     }
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCuGroup(&cuGroupRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
 }
 
@@ -540,9 +587,9 @@ void xrm::cuCheckStatusCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
     cuRes.cuType = (cuTypes)cuType;
     cuRes.allocServiceId = allocServiceId;
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->checkCuStat(&cuRes, &cuStat);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         if (cuStat.isBusy)
@@ -680,10 +727,8 @@ void xrm::isCuGroupExistingCommand::processCmd(pt::ptree& incmd, pt::ptree& outr
 
 void xrm::checkCuAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuProperty cuProp;
-    std::vector<cuResource*> cuRes;
     std::string errmsg;
-    cuResource* tmpCuRes;
-    int32_t i, ret;
+    int32_t ret;
     int32_t availableCuNum = 0;
 
     auto kernelName = incmd.get<std::string>("request.parameters.kernelName");
@@ -707,50 +752,21 @@ void xrm::checkCuAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree& ou
     cuProp.clientProcessId = clientProcessId;
     cuProp.poolId = poolId;
 
-    bool update_id = true;
-    m_system->enterLock();
-    do {
-        tmpCuRes = (cuResource*)malloc(sizeof(cuResource));
-        memset(tmpCuRes, 0, sizeof(cuResource));
-        ret = m_system->resAllocCu(&cuProp, tmpCuRes, update_id);
-        if (ret == XRM_SUCCESS) {
-            cuRes.push_back(tmpCuRes);
-            availableCuNum++;
-        } else {
-            free(tmpCuRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableCuNum > 0) {
-        /* get the available cu number */
-        for (i = 0; i < availableCuNum; i++) {
-            m_system->resReleaseCu(cuRes[i]);
-            free(cuRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuAvailableNum(&cuProp, &availableCuNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableCuNum", availableCuNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu list num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableCuNum", availableCuNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu number");
     }
-    m_system->exitLock();
 }
 
 void xrm::checkCuListAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuListProperty cuListProp;
-    std::vector<cuListResource*> cuListRes;
-    cuListResource* tmpCuListRes;
     std::string errmsg;
     int32_t i, ret;
     int32_t availableListNum = 0;
@@ -786,51 +802,23 @@ void xrm::checkCuListAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree
         cuListProp.cuProps[i].poolId = poolId;
     }
 
-    m_system->enterLock();
-    do {
-        tmpCuListRes = (cuListResource*)malloc(sizeof(cuListResource));
-        memset(tmpCuListRes, 0, sizeof(cuListResource));
-        ret = m_system->resAllocCuList(&cuListProp, tmpCuListRes);
-        if (ret == XRM_SUCCESS) {
-            cuListRes.push_back(tmpCuListRes);
-            availableListNum++;
-        } else {
-            free(tmpCuListRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableListNum > 0) {
-        /* get the available cu list number */
-        for (i = 0; i < availableListNum; i++) {
-            m_system->resReleaseCuList(cuListRes[i]);
-            free(cuListRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuListAvailableNum(&cuListProp, &availableListNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableListNum", availableListNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu list num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu list number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableListNum", availableListNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu list number");
     }
-    m_system->exitLock();
 }
 
 void xrm::checkCuGroupAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuGroupProperty cuGroupProp;
-    std::vector<cuGroupResource*> cuGroupRes;
-    cuGroupResource* tmpCuGroupRes;
     std::string errmsg;
-    int32_t i, ret;
+    int32_t ret;
     int32_t availableGroupNum = 0;
 
     auto udfCuGroupName = incmd.get<std::string>("request.parameters.udfCuGroupName");
@@ -842,52 +830,24 @@ void xrm::checkCuGroupAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptre
     cuGroupProp.clientProcessId = clientProcessId;
     cuGroupProp.poolId = poolId;
 
-    m_system->enterLock();
-    do {
-        tmpCuGroupRes = (cuGroupResource*)malloc(sizeof(cuGroupResource));
-        memset(tmpCuGroupRes, 0, sizeof(cuGroupResource));
-        ret = m_system->resAllocCuGroup(&cuGroupProp, tmpCuGroupRes);
-        if (ret == XRM_SUCCESS) {
-            cuGroupRes.push_back(tmpCuGroupRes);
-            availableGroupNum++;
-        } else {
-            free(tmpCuGroupRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableGroupNum > 0) {
-        /* get the available cu group number */
-        for (i = 0; i < availableGroupNum; i++) {
-            m_system->resReleaseCuGroup(cuGroupRes[i]);
-            free(cuGroupRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuGroupAvailableNum(&cuGroupProp, &availableGroupNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableGroupNum", availableGroupNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu group num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu group number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableGroupNum", availableGroupNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu group number");
     }
-    m_system->exitLock();
 }
 
 void xrm::checkCuPoolAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuPoolProperty cuPoolProp;
     cuListProperty* cuListProp = NULL;
-    std::vector<uint64_t> cuPoolId;
     std::string errmsg;
-    int32_t i;
-    uint64_t poolId;
+    int32_t i, ret;
     int32_t availablePoolNum = 0;
 
     memset(&cuPoolProp, 0, sizeof(cuPoolProperty));
@@ -927,29 +887,12 @@ void xrm::checkCuPoolAvailableNumCommand::processCmd(pt::ptree& incmd, pt::ptree
     auto xclbinNum = incmd.get<int32_t>("request.parameters.xclbinNum");
     cuPoolProp.xclbinNum = xclbinNum;
 
-    m_system->enterLock();
-    do {
-        poolId = m_system->resReserveCuPool(&cuPoolProp);
-        if (poolId != 0) {
-            cuPoolId.push_back(poolId);
-            availablePoolNum++;
-        } else {
-            break;
-        }
-    } while (poolId != 0);
-    if (availablePoolNum > 0) {
-        /* get the available cu pool id */
-        for (i = 0; i < availablePoolNum; i++) m_system->resRelinquishCuPool(cuPoolId[i]);
-        outrsp.put("response.status.value", XRM_SUCCESS);
-        outrsp.put("response.data.availablePoolNum", availablePoolNum);
-    } else {
-        /*
-         * Available cu pool num is 0.
-         */
-        outrsp.put("response.status.value", XRM_SUCCESS);
-        outrsp.put("response.data.availablePoolNum", 0);
-    }
-    m_system->exitLock();
+    /* any failure is reported as no pool available */
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuPoolAvailableNum(&cuPoolProp, &availablePoolNum);
+    m_system->exitSharedLock();
+    outrsp.put("response.status.value", XRM_SUCCESS);
+    outrsp.put("response.data.availablePoolNum", (ret == XRM_SUCCESS) ? availablePoolNum : 0);
 }
 
 void xrm::cuPoolReserveCommand::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
@@ -1245,9 +1188,9 @@ void xrm::cuAllocV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuProp.poolId = poolId;
 
     bool update_id = true;
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCuV2(&cuProp, &cuRes, update_id);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.xclbinFileName", cuRes.xclbinFileName);
@@ -1313,9 +1256,9 @@ void xrm::cuListAllocV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
 
     cuListRes = (cuListResourceV2*)malloc(sizeof(cuListResourceV2));
     memset(cuListRes, 0, sizeof(cuListResourceV2));
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCuListV2(cuListProp, cuListRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.cuNum", cuListRes->cuNum);
@@ -1365,9 +1308,9 @@ void xrm::cuGroupAllocV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp)
 
     cuGroupRes = (cuGroupResourceV2*)malloc(sizeof(cuGroupResourceV2));
     memset(cuGroupRes, 0, sizeof(cuGroupResourceV2));
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resAllocCuGroupV2(cuGroupProp, cuGroupRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
     if (ret == XRM_SUCCESS) {
         outrsp.put("response.data.cuNum", cuGroupRes->cuNum);
@@ -1422,9 +1365,9 @@ void xrm::cuReleaseV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuRes.channelLoadOriginal = channelLoadOriginal;
     cuRes.poolId = poolId;
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCuV2(&cuRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     outrsp.put("response.status.value", ret);
 }
 
@@ -1458,9 +1401,9 @@ void xrm::cuListReleaseV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp
         cuListRes->cuResources[i].poolId = poolId;
     }
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCuListV2(cuListRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     free(cuListRes);
     outrsp.put("response.status.value", ret);
 }
@@ -1495,9 +1438,9 @@ void xrm::cuGroupReleaseV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrs
         cuGroupRes->cuResources[i].poolId = poolId;
     }
 
-    m_system->enterLock();
+    m_system->enterSharedLock();
     int32_t ret = m_system->resReleaseCuGroupV2(cuGroupRes);
-    m_system->exitLock();
+    m_system->exitSharedLock();
     free(cuGroupRes);
     outrsp.put("response.status.value", ret);
 }
@@ -1618,10 +1561,8 @@ void xrm::allocationQueryV2Command::processCmd(pt::ptree& incmd, pt::ptree& outr
 
 void xrm::checkCuAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuPropertyV2 cuProp;
-    std::vector<cuResource*> cuRes;
     std::string errmsg;
-    cuResource* tmpCuRes;
-    int32_t i, ret;
+    int32_t ret;
     int32_t availableCuNum = 0;
 
     auto kernelName = incmd.get<std::string>("request.parameters.kernelName");
@@ -1651,50 +1592,21 @@ void xrm::checkCuAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptree&
     cuProp.clientProcessId = clientProcessId;
     cuProp.poolId = poolId;
 
-    bool update_id = true;
-    m_system->enterLock();
-    do {
-        tmpCuRes = (cuResource*)malloc(sizeof(cuResource));
-        memset(tmpCuRes, 0, sizeof(cuResource));
-        ret = m_system->resAllocCuV2(&cuProp, tmpCuRes, update_id);
-        if (ret == XRM_SUCCESS) {
-            cuRes.push_back(tmpCuRes);
-            availableCuNum++;
-        } else {
-            free(tmpCuRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableCuNum > 0) {
-        /* get the available cu number */
-        for (i = 0; i < availableCuNum; i++) {
-            m_system->resReleaseCuV2(cuRes[i]);
-            free(cuRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuAvailableNumV2(&cuProp, &availableCuNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableCuNum", availableCuNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu list num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableCuNum", availableCuNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu number");
     }
-    m_system->exitLock();
 }
 
 void xrm::checkCuListAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuListPropertyV2* cuListProp;
-    std::vector<cuListResourceV2*> cuListRes;
-    cuListResourceV2* tmpCuListRes;
     std::string errmsg;
     int32_t i, ret;
     int32_t availableListNum = 0;
@@ -1732,52 +1644,24 @@ void xrm::checkCuListAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptr
         cuListProp->cuProps[i].poolId = poolId;
     }
 
-    m_system->enterLock();
-    do {
-        tmpCuListRes = (cuListResourceV2*)malloc(sizeof(cuListResourceV2));
-        memset(tmpCuListRes, 0, sizeof(cuListResourceV2));
-        ret = m_system->resAllocCuListV2(cuListProp, tmpCuListRes);
-        if (ret == XRM_SUCCESS) {
-            cuListRes.push_back(tmpCuListRes);
-            availableListNum++;
-        } else {
-            free(tmpCuListRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableListNum > 0) {
-        /* get the available cu list number */
-        for (i = 0; i < availableListNum; i++) {
-            m_system->resReleaseCuListV2(cuListRes[i]);
-            free(cuListRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuListAvailableNumV2(cuListProp, &availableListNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableListNum", availableListNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu list num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu list number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableListNum", availableListNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu list number");
     }
-    m_system->exitLock();
     free(cuListProp);
 }
 
 void xrm::checkCuGroupAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuGroupPropertyV2 cuGroupProp;
-    std::vector<cuGroupResourceV2*> cuGroupRes;
-    cuGroupResourceV2* tmpCuGroupRes;
     std::string errmsg;
-    int32_t i, ret;
+    int32_t ret;
     int32_t availableGroupNum = 0;
 
     auto udfCuGroupName = incmd.get<std::string>("request.parameters.udfCuGroupName");
@@ -1789,55 +1673,26 @@ void xrm::checkCuGroupAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::pt
     cuGroupProp.clientProcessId = clientProcessId;
     cuGroupProp.poolId = poolId;
 
-    m_system->enterLock();
-    do {
-        tmpCuGroupRes = (cuGroupResourceV2*)malloc(sizeof(cuGroupResourceV2));
-        memset(tmpCuGroupRes, 0, sizeof(cuGroupResourceV2));
-        ret = m_system->resAllocCuGroupV2(&cuGroupProp, tmpCuGroupRes);
-        if (ret == XRM_SUCCESS) {
-            cuGroupRes.push_back(tmpCuGroupRes);
-            availableGroupNum++;
-        } else {
-            free(tmpCuGroupRes);
-            break;
-        }
-    } while (ret == XRM_SUCCESS);
-    if (availableGroupNum > 0) {
-        /* get the available cu group number */
-        for (i = 0; i < availableGroupNum; i++) {
-            m_system->resReleaseCuGroupV2(cuGroupRes[i]);
-            free(cuGroupRes[i]);
-        }
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuGroupAvailableNumV2(&cuGroupProp, &availableGroupNum);
+    m_system->exitSharedLock();
+    if (ret == XRM_SUCCESS) {
         outrsp.put("response.status.value", XRM_SUCCESS);
         outrsp.put("response.data.availableGroupNum", availableGroupNum);
     } else {
-        /*
-         * There is no available resource or input is invalid.
-         * Available cu group num is 0.
-         */
-        if (ret == XRM_ERROR_INVALID) {
-            /* The input is invalid */
-            outrsp.put("response.status.value", XRM_ERROR_INVALID);
-            outrsp.put("response.data.failed", "failed to check available cu group number");
-        } else {
-            /* there is no available resource */
-            outrsp.put("response.status.value", XRM_SUCCESS);
-            outrsp.put("response.data.availableGroupNum", availableGroupNum);
-        }
+        /* The input is invalid */
+        outrsp.put("response.status.value", XRM_ERROR_INVALID);
+        outrsp.put("response.data.failed", "failed to check available cu group number");
     }
-    m_system->exitLock();
 }
 
 void xrm::checkCuPoolAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
     cuPoolPropertyV2* cuPoolProp;
     cuListPropertyV2* cuListProp = NULL;
     deviceIdListPropertyV2* deviceIdListProp = NULL;
-    std::vector<uint64_t> cuPoolId;
     std::string errmsg;
-    int32_t i;
-    uint64_t poolId;
+    int32_t i, ret;
     int32_t availablePoolNum = 0;
-    cuPoolResInforV2* cuPoolResInfor = NULL;
 
     cuPoolProp = (cuPoolPropertyV2*)malloc(sizeof(cuPoolPropertyV2));
     memset(cuPoolProp, 0, sizeof(cuPoolPropertyV2));
@@ -1885,33 +1740,13 @@ void xrm::checkCuPoolAvailableNumV2Command::processCmd(pt::ptree& incmd, pt::ptr
     auto xclbinNum = incmd.get<int32_t>("request.parameters.xclbinNum");
     cuPoolProp->xclbinNum = xclbinNum;
 
-    cuPoolResInfor = (cuPoolResInforV2*)malloc(sizeof(cuPoolResInforV2));
-    memset(cuPoolResInfor, 0, sizeof(cuPoolResInforV2));
-    m_system->enterLock();
-    do {
-        poolId = m_system->resReserveCuPoolV2(cuPoolProp, cuPoolResInfor);
-        if (poolId != 0) {
-            cuPoolId.push_back(poolId);
-            availablePoolNum++;
-        } else {
-            break;
-        }
-    } while (poolId != 0);
-    if (availablePoolNum > 0) {
-        /* get the available cu pool id */
-        for (i = 0; i < availablePoolNum; i++) m_system->resRelinquishCuPoolV2(cuPoolId[i]);
-        outrsp.put("response.status.value", XRM_SUCCESS);
-        outrsp.put("response.data.availablePoolNum", availablePoolNum);
-    } else {
-        /*
-         * Available cu pool num is 0.
-         */
-        outrsp.put("response.status.value", XRM_SUCCESS);
-        outrsp.put("response.data.availablePoolNum", 0);
-    }
-    m_system->exitLock();
+    /* any failure is reported as no pool available */
+    m_system->enterSharedLock();
+    ret = m_system->resCheckCuPoolAvailableNumV2(cuPoolProp, &availablePoolNum);
+    m_system->exitSharedLock();
+    outrsp.put("response.status.value", XRM_SUCCESS);
+    outrsp.put("response.data.availablePoolNum", (ret == XRM_SUCCESS) ? availablePoolNum : 0);
     free(cuPoolProp);
-    free(cuPoolResInfor);
 }
 
 void xrm::cuPoolReserveV2Command::processCmd(pt::ptree& incmd, pt::ptree& outrsp) {
@@ -35,6 +35,13 @@ class echoContextCommand : public command {
     void processCmd(pt::ptree& incmd, pt::ptree& outrsp);
 };
 
+class reclaimContextCommand : public command {
+   public:
+    reclaimContextCommand(xrm::system& sys) : command("reclaimContext", sys) {}
+
+    void processCmd(pt::ptree& incmd, pt::ptree& outrsp);
+};
+
 class destroyContextCommand : public command {
    public:
     destroyContextCommand(xrm::system& sys) : command("destroyContext", sys) {}
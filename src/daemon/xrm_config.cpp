@@ -142,6 +142,97 @@ std::string getXrtVersionFileFullPathName() {
     return (getStringValue("XRM.xrtVersionFileFullPathName", XRM_DEFAULT_XRT_VERSION_FILE_FULL_PATH_NAME));
 }
 
+/*
+ * Empty path disables the unix domain socket listener, only tcp is served then.
+ */
+std::string getUnixSocketPath() {
+    return (getStringValue("XRM.unixSocketPath", XRM_DEFAULT_UNIX_SOCKET_PATH));
+}
+
+/*
+ * Number of threads serving the client connections in daemon.
+ */
+uint32_t getIoThreadNumber() {
+    return (getUint32Value("XRM.ioThreadNumber", XRM_DEFAULT_IO_THREAD_NUMBER));
+}
+
+/*
+ * Description of the simulated devices, only used by daemon built with XRM_SIM_DEVICE.
+ * The environment XRM_SIM_DEVICE_FILE overrides the ini setting.
+ */
+std::string getSimDeviceFileFullPathName() {
+    if (auto env = getEnvValue("XRM_SIM_DEVICE_FILE")) return (std::string(env));
+    return (getStringValue("XRM.simDeviceFileFullPathName", XRM_DEFAULT_SIM_DEVICE_FILE_FULL_PATH_NAME));
+}
+
+/*
+ * Whether the daemon state is saved to the snapshot file and restored from it when the
+ * daemon is started again.
+ */
+bool getPersistence() {
+    return (getBoolValue("XRM.persistence", false));
+}
+
+std::string getSnapshotFileFullPathName() {
+    return (getStringValue("XRM.snapshotFileFullPathName", XRM_DEFAULT_SNAPSHOT_FILE_FULL_PATH_NAME));
+}
+
+/*
+ * The journal files are named <journalFileFullPathName>.<seq>, they keep the changes made
+ * since the snapshot.
+ */
+std::string getJournalFileFullPathName() {
+    return (getStringValue("XRM.journalFileFullPathName", XRM_DEFAULT_JOURNAL_FILE_FULL_PATH_NAME));
+}
+
+/*
+ * Size (bytes) the journal grows to before a new snapshot is taken, 0 never takes one.
+ */
+uint32_t getJournalCompactSize() {
+    return (getUint32Value("XRM.journalCompactSize", XRM_DEFAULT_JOURNAL_COMPACT_SIZE));
+}
+
+/*
+ * Whether each journal write is synced to the disk, only needed when the journal is not on
+ * tmpfs and the state should survive a host crash.
+ */
+bool getJournalSync() {
+    return (getBoolValue("XRM.journalSync", false));
+}
+
+/*
+ * Time (seconds) the clients of the restored state have to reconnect and reclaim their
+ * resources, the resources of the clients which are gone by then are recycled.
+ */
+uint32_t getReclaimGracePeriod() {
+    return (getUint32Value("XRM.reclaimGracePeriod", XRM_DEFAULT_RECLAIM_GRACE_PERIOD));
+}
+
+/*
+ * Whether the snapshot is put together by a forked child from a copy-on-write image of the
+ * state, so the devices are only locked while forking. Otherwise it's put together while the
+ * devices are locked, which is shorter than the fork unless the state is large.
+ */
+bool getBackgroundSnapshot() {
+    return (getBoolValue("XRM.backgroundSnapshot", false));
+}
+
+/*
+ * Time (seconds) between the snapshots taken when the journal is not empty, 0 only takes one
+ * when the journal has grown beyond journalCompactSize.
+ */
+uint32_t getSnapshotInterval() {
+    return (getUint32Value("XRM.snapshotInterval", XRM_DEFAULT_SNAPSHOT_INTERVAL));
+}
+
+/*
+ * Loopback tcp port the metrics are served on over HTTP at /metrics in prometheus text
+ * format, 0 doesn't serve them.
+ */
+uint32_t getMetricsPort() {
+    return (getUint32Value("XRM.metricsPort", XRM_DEFAULT_METRICS_PORT));
+}
+
 } // namespace config
 
 } // namespace xrm
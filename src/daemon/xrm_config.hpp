@@ -26,6 +26,13 @@
 
 #define XRM_DEFAULT_XRT_VERSION_FILE_FULL_PATH_NAME "/opt/xilinx/xrt/version.json"        // default full path name
 #define XRM_DEFAULT_LIB_XRT_CORE_FILE_FULL_PATH_NAME "/opt/xilinx/xrt/lib/libxrt_core.so" // default full path name
+#define XRM_DEFAULT_SIM_DEVICE_FILE_FULL_PATH_NAME "/etc/xrm/xrm_sim_devices.json"        // default full path name
+#define XRM_DEFAULT_SNAPSHOT_FILE_FULL_PATH_NAME "/dev/shm/xrm.snapshot"                  // default full path name
+#define XRM_DEFAULT_JOURNAL_FILE_FULL_PATH_NAME "/dev/shm/xrm.journal"                    // default full path name
+#define XRM_DEFAULT_JOURNAL_COMPACT_SIZE 4194304 // default journal size (bytes) to take a new snapshot, 4 MB
+#define XRM_DEFAULT_RECLAIM_GRACE_PERIOD 30      // default time (seconds) restored clients have to reclaim
+#define XRM_DEFAULT_SNAPSHOT_INTERVAL 300        // default time (seconds) between snapshots, 5 minutes
+#define XRM_DEFAULT_METRICS_PORT 0               // default metrics port, 0: the metrics are not served
 
 namespace xrm {
 namespace config {
@@ -48,6 +55,18 @@ uint32_t getVerbosity();
 uint32_t getLimitConcurrentClient();
 std::string getXrtVersionFileFullPathName();
 std::string getLibXrtCoreFileFullPathName();
+std::string getUnixSocketPath();
+uint32_t getIoThreadNumber();
+std::string getSimDeviceFileFullPathName();
+bool getPersistence();
+std::string getSnapshotFileFullPathName();
+std::string getJournalFileFullPathName();
+uint32_t getJournalCompactSize();
+bool getJournalSync();
+uint32_t getReclaimGracePeriod();
+bool getBackgroundSnapshot();
+uint32_t getSnapshotInterval();
+uint32_t getMetricsPort();
 
 } // namespace config
 } // namespace xrm
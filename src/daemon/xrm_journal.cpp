@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xrm_journal.hpp"
+#include "xrm_snapshot.hpp"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define XRM_JOURNAL_RECORD_HEADER_SIZE 8 // uint32_t size and uint32_t crc32 of the record
+
+xrm::journal::~journal() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+/*
+ * Sets up the journal and finds the journal files left by the previous run, the replay goes
+ * from the seq named by the snapshot up to getSeq(). No journal file is open until rotate()
+ * is called by the first snapshot, which also removes the files found here.
+ */
+void xrm::journal::init(const std::string& path, bool sync, uint64_t compactSize) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_path = path;
+    m_sync = sync;
+    m_compactSize = compactSize;
+    m_firstSeq = 1;
+    m_seq = 0;
+
+    size_t pos = path.find_last_of('/');
+    std::string dirName = (pos == std::string::npos) ? "." : path.substr(0, pos + 1);
+    std::string prefix = ((pos == std::string::npos) ? path : path.substr(pos + 1)) + ".";
+    DIR* dir = opendir(dirName.c_str());
+    if (dir == NULL) return;
+    uint64_t firstSeq = UINT64_MAX;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (strncmp(name, prefix.c_str(), prefix.size()) != 0) continue;
+        name += prefix.size();
+        if (*name == '\0' || strspn(name, "0123456789") != strlen(name)) continue;
+        uint64_t seq = strtoull(name, NULL, 10);
+        if (seq == 0) continue;
+        if (seq < firstSeq) firstSeq = seq;
+        if (seq > m_seq) m_seq = seq;
+    }
+    closedir(dir);
+    if (m_seq > 0) m_firstSeq = firstSeq;
+}
+
+bool xrm::journal::isOpen() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (m_fd >= 0);
+}
+
+uint64_t xrm::journal::getSeq() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (m_seq);
+}
+
+std::string xrm::journal::fileName(const std::string& path, uint64_t seq) {
+    return (path + "." + std::to_string(seq));
+}
+
+/*
+ * Lock: called while holding the lock of the devices changed by the record, so records of
+ * one device are in the order of the changes.
+ */
+void xrm::journal::append(const std::string& record) {
+    uint32_t header[2] = {(uint32_t)record.size(), snapshotChecksum(record.data(), record.size())};
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_fd < 0) return;
+    m_pending.append((const char*)header, sizeof(header));
+    m_pending.append(record);
+    m_appendedSize += sizeof(header) + record.size();
+}
+
+/*
+ * Returns once all the records appended before the call are written.
+ *
+ * A batch which fails to be written is cut off the journal file and kept pending in front
+ * of the records appended meanwhile, the next commit() writes it again. All the callers
+ * waiting for that batch get false, the change they are about to report is not in the
+ * journal yet.
+ *
+ * return: true written, false failed to write
+ *
+ * Lock: should not hold any system lock, it may wait for the write of another caller.
+ */
+bool xrm::journal::commit() {
+    std::unique_lock<std::mutex> guard(m_lock);
+    uint64_t target = m_appendedSize;
+    uint64_t failures = m_failures;
+
+    while (m_writtenSize < target) {
+        if (m_failures != failures) return (false);
+        if (m_writing) {
+            m_cond.wait(guard);
+            continue;
+        }
+        std::string batch;
+        batch.swap(m_pending);
+        uint64_t batchEnd = m_appendedSize;
+        uint64_t fileSize = m_fileSize;
+        int fd = m_fd;
+        m_writing = true;
+        guard.unlock();
+        bool ret = writeData(fd, batch, fileSize);
+        guard.lock();
+        m_writing = false;
+        if (ret) {
+            m_writtenSize = batchEnd;
+            m_fileSize += batch.size();
+        } else {
+            batch.append(m_pending);
+            m_pending.swap(batch);
+            m_failures++;
+        }
+        m_cond.notify_all();
+    }
+    return (true);
+}
+
+bool xrm::journal::needCompaction() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (m_fd >= 0 && m_compactSize > 0 && m_fileSize >= m_compactSize);
+}
+
+/*
+ * Whether nothing is appended to the current journal file, the snapshot naming it is still
+ * the whole state.
+ */
+bool xrm::journal::isEmpty() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (m_fileSize == 0 && m_pending.empty());
+}
+
+/*
+ * Writes the pending records to the current journal file, then starts journal file seq.
+ * When the pending records fail to be written they are kept and written to the new journal
+ * file instead, the replay goes through both files in order so they are still replayed
+ * after the records before them. When journal file seq can't be created the current one is
+ * kept, the snapshot naming seq should not be written then.
+ *
+ * return: true started, false failed to create the journal file seq
+ *
+ * Lock: called while holding the locks of all devices, so no record is appended meanwhile.
+ */
+bool xrm::journal::rotate(uint64_t seq, std::string& errmsg) {
+    std::unique_lock<std::mutex> guard(m_lock);
+
+    while (m_writing) m_cond.wait(guard);
+    std::string name = fileName(m_path, seq);
+    int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        errmsg = "failed to create " + name + ": " + strerror(errno);
+        return (false);
+    }
+    if (m_fd >= 0) {
+        if (writeData(m_fd, m_pending, m_fileSize)) {
+            m_pending.clear();
+            m_writtenSize = m_appendedSize;
+        }
+        close(m_fd);
+    }
+    m_cond.notify_all();
+    m_fd = fd;
+    m_seq = seq;
+    m_fileSize = 0;
+    return (true);
+}
+
+/*
+ * Removes the journal files older than seq, called once the snapshot naming seq is written.
+ */
+void xrm::journal::removeBefore(uint64_t seq) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (; m_firstSeq < seq; m_firstSeq++) unlink(fileName(m_path, m_firstSeq).c_str());
+}
+
+/*
+ * Appends data to the journal file of fd, which has fileSize bytes written. On failure the
+ * part of data written is cut off, so the journal file never ends with a torn record the
+ * records written after it would be behind.
+ */
+bool xrm::journal::writeData(int fd, const std::string& data, uint64_t fileSize) {
+    const char* buf = data.data();
+    size_t size = data.size();
+
+    if (fd < 0 || size == 0) return (true);
+    while (size > 0) {
+        ssize_t ret = write(fd, buf, size);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            syslog(LOG_ERR, "journal write failed: %s", strerror(errno));
+            if (ftruncate(fd, fileSize) != 0) syslog(LOG_ERR, "journal truncate failed: %s", strerror(errno));
+            return (false);
+        }
+        buf += ret;
+        size -= ret;
+    }
+    if (m_sync && fdatasync(fd) != 0) {
+        syslog(LOG_ERR, "journal sync failed: %s", strerror(errno));
+        if (ftruncate(fd, fileSize) != 0) syslog(LOG_ERR, "journal truncate failed: %s", strerror(errno));
+        return (false);
+    }
+    return (true);
+}
+
+/*
+ * Reads the intact records of one journal file.
+ *
+ * return: 1 read, 0 no such file, -1 failed to read, the records read so far are kept
+ */
+int32_t xrm::journal::readFile(const std::string& fileName, std::vector<std::string>& records, std::string& errmsg) {
+    struct stat buf;
+    std::string data;
+
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return (0);
+        errmsg = "failed to open " + fileName + ": " + strerror(errno);
+        return (-1);
+    }
+    if (fstat(fd, &buf) != 0) {
+        errmsg = "failed to stat " + fileName + ": " + strerror(errno);
+        close(fd);
+        return (-1);
+    }
+    data.resize(buf.st_size);
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t ret = read(fd, &data[done], data.size() - done);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) break;
+        done += ret;
+    }
+    close(fd);
+    data.resize(done);
+
+    size_t offset = 0;
+    while (data.size() - offset >= XRM_JOURNAL_RECORD_HEADER_SIZE) {
+        uint32_t header[2];
+        memcpy(header, data.data() + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header[0] > data.size() - offset ||
+            snapshotChecksum(data.data() + offset, header[0]) != header[1]) {
+            errmsg = fileName + " ends with a torn record";
+            return (1);
+        }
+        records.emplace_back(data, offset, header[0]);
+        offset += header[0];
+    }
+    if (offset != data.size()) errmsg = fileName + " ends with a torn record";
+    return (1);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_JOURNAL_HPP_
+#define _XRM_JOURNAL_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xrm {
+
+/*
+ * Append-only journal of the state changes made since the last snapshot.
+ *
+ * The journal is a sequence of files <path>.<seq>. Each snapshot names the journal file
+ * started right after it was taken, so the state is the snapshot with the records of that
+ * journal file and the following ones replayed on top. Taking a snapshot (compaction)
+ * starts the next journal file, the older files are removed once the snapshot is written.
+ *
+ * Each record is stored as its uint32_t size and the crc32 of the record, followed by the
+ * record. The replay stops at the first record which is not complete or not intact, it's
+ * the tail which was being written when the daemon stopped.
+ *
+ * Group commit: the records are appended to memory while the device locks are held. Before
+ * a response is sent, commit() makes sure all the records appended so far are written; the
+ * first caller writes the records of all the waiting callers with one write, the others
+ * wait for it instead of writing their own. A batch which fails to be written stays pending
+ * and is written again, the callers waiting for it are told about the failure.
+ *
+ * A record is the state of what it names after the change, not the change itself, so the
+ * replay only needs the records in order and a record replayed twice does no harm.
+ */
+typedef enum journalRecordType {
+    JOURNAL_RECORD_CU = 1,            // allocation and reservation state of one cu
+    JOURNAL_RECORD_PROCS = 2,         // client processes of one device
+    JOURNAL_RECORD_DEVICE = 3,        // the whole device, on load, unload, enable and disable
+    JOURNAL_RECORD_UDF_CU_GROUPS = 4, // all the user defined cu groups
+} journalRecordType;
+
+class journal {
+   public:
+    journal() {}
+    ~journal();
+
+    void init(const std::string& path, bool sync, uint64_t compactSize);
+    bool isOpen();
+    uint64_t getSeq();
+
+    void append(const std::string& record);
+    bool commit();
+    bool needCompaction();
+    bool isEmpty();
+    bool rotate(uint64_t seq, std::string& errmsg);
+    void removeBefore(uint64_t seq);
+
+    static std::string fileName(const std::string& path, uint64_t seq);
+    static int32_t readFile(const std::string& fileName, std::vector<std::string>& records, std::string& errmsg);
+
+   private:
+    bool writeData(int fd, const std::string& data, uint64_t fileSize);
+
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::string m_path;
+    bool m_sync = false;          // sync the file after each write, needed when it's not on tmpfs
+    uint64_t m_compactSize = 0;   // size of the journal file to take a new snapshot, 0: never
+    uint64_t m_firstSeq = 0;      // the oldest journal file not removed yet
+    uint64_t m_seq = 0;           // the journal file being written
+    int m_fd = -1;
+    std::string m_pending;        // records appended but not written yet
+    uint64_t m_appendedSize = 0;  // bytes appended since the start
+    uint64_t m_writtenSize = 0;   // bytes written since the start
+    uint64_t m_fileSize = 0;      // bytes written to the current journal file
+    bool m_writing = false;       // one caller is writing outside of the lock
+    uint64_t m_failures = 0;      // writes failed since the start
+};
+} // namespace xrm
+
+#endif // _XRM_JOURNAL_HPP_
@@ -15,6 +15,7 @@
  * under the License.
  */
 
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <memory>
@@ -23,7 +24,9 @@
 #include <boost/thread.hpp>
 #include "xrm_version.h"
 #include "xrm_command_registry.hpp"
+#include "xrm_config.hpp"
 #include "xrm_tcp_server.hpp"
+#include "xrm_metrics_server.hpp"
 #include "xrm_system.hpp"
 
 #include <syslog.h>
@@ -34,10 +37,15 @@ using boost::asio::ip::tcp;
 
 xrm::system* sys = NULL;
 xrm::commandRegistry* registry = NULL;
+xrm::waitQueue* waitQueue = NULL;
 boost::asio::io_service* ioService = NULL;
 xrm::server* serv = NULL;
-const uint16_t xrmPort = 9763;
+xrm::metrics* daemonMetrics = NULL;
+xrm::metricsServer* metricsServ = NULL;
+const uint16_t xrmPort = XRM_DEFAULT_TCP_PORT;
 uint32_t isExit = 0;
+/* set once the system and the wait queue are set up, cleared before they're deleted */
+std::atomic<bool> isInitialized(false);
 volatile uint32_t resetEvent = 0;
 /*
  * need to be protected by lock
@@ -67,17 +75,33 @@ void resetEventFunc()
                 }  
             }
             sys->exitLock();
+            sys->journalCommit();
+        }
+        if (isInitialized) {
+            if (sys->recycleOrphanClients()) waitQueue->notify();
+            /* the scrape of metrics reads the resource state published here */
+            sys->publishMetrics();
         }
         boost::this_thread::sleep(workTime);
     }
 }
 
+void ioThreadFunc()
+{
+    try {
+        ioService->run();
+    } catch (std::exception& e) {
+        syslog(LOG_NOTICE, "Exception: %s", e.what());
+    }
+}
+
 int main(int argc, char* argv[]) {
     std::ignore = argc;
     std::ignore = argv;
     struct sigaction act;
 
     boost::thread workerThread(resetEventFunc); 
+    boost::thread_group ioThreads;
     try {
         setlogmask(LOG_UPTO(LOG_DEBUG));
         openlog("xrmd", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_LOCAL1);
@@ -91,15 +115,33 @@ int main(int argc, char* argv[]) {
         sys->initLock();
         sys->initSystem();
 
+        // Count the requests, the locks and the sessions when the metrics are served
+        uint32_t metricsPort = xrm::config::getMetricsPort();
+        if (metricsPort > 0 && metricsPort <= 65535) {
+            daemonMetrics = new xrm::metrics;
+            sys->setMetrics(daemonMetrics);
+        }
+
         // Create the commands
         registry = new xrm::commandRegistry;
         registry->registerAll(*sys);
 
+        // Create the queue of allocation requests waiting for free resource
+        waitQueue = new xrm::waitQueue;
+
         // Accept connections and process commands
         ioService = new boost::asio::io_service;
         serv = new xrm::server(*ioService, xrmPort);
         serv->setSystem(sys);
         serv->setRegistry(registry);
+        serv->setWaitQueue(waitQueue);
+        isInitialized = true;
+        serv->listenLocal(xrm::config::getUnixSocketPath());
+        if (daemonMetrics != NULL) {
+            sys->publishMetrics();
+            metricsServ = new xrm::metricsServer(*ioService, sys, daemonMetrics, waitQueue);
+            metricsServ->listen(metricsPort);
+        }
 
         memset (&act, 0, sizeof(act));
         act.sa_sigaction = sigbusHandler;
@@ -108,15 +150,28 @@ int main(int argc, char* argv[]) {
         if (sigaction(SIGBUS, &act, 0))
             syslog(LOG_NOTICE, "Failed to setup SIGBUS handler");
 
+        /* requests of different connections are handled by the io threads in parallel */
+        uint32_t ioThreadNumber = xrm::config::getIoThreadNumber();
+        if (ioThreadNumber == 0) ioThreadNumber = 1;
+        if (ioThreadNumber > XRM_MAX_IO_THREAD_NUMBER) ioThreadNumber = XRM_MAX_IO_THREAD_NUMBER;
+        syslog(LOG_NOTICE, "    IO Thread Number = %u", ioThreadNumber);
+        for (uint32_t i = 1; i < ioThreadNumber; i++)
+            ioThreads.create_thread(ioThreadFunc);
         ioService->run();
     } catch (std::exception& e) {
         syslog(LOG_NOTICE, "Exception: %s", e.what());
     }
+    if (ioService != NULL) ioService->stop();
+    ioThreads.join_all();
+    isInitialized = false;
     isExit = 1;
     workerThread.join();
+    if (metricsServ != NULL) delete (metricsServ);
     if (serv != NULL) delete (serv);
+    if (waitQueue != NULL) delete (waitQueue);
     if (ioService != NULL) delete (ioService);
     if (registry != NULL) delete (registry);
     if (sys != NULL) delete (sys);
+    if (daemonMetrics != NULL) delete (daemonMetrics);
     return 0;
 }
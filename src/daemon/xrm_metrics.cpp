@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdio>
+#include "xrm_metrics.hpp"
+#include "xrm_binary_protocol.hpp"
+
+static const char* lockModeNames[xrm::metrics::LOCK_MODE_NUM] = {"exclusive", "shared"};
+static const char* transportNames[xrm::metrics::TRANSPORT_NUM] = {"tcp", "unix"};
+
+xrm::metrics::metrics() {
+    m_binaryCommands.push_back(new metricsCommand("unknown", "binary"));
+    for (uint16_t opcode = 1;; opcode++) {
+        const char* name = binaryOpcodeName(opcode);
+        if (name == NULL) break;
+        m_binaryCommands.push_back(new metricsCommand(name, "binary"));
+    }
+    m_unknownCommand = new metricsCommand("unknown", "json");
+    for (int32_t i = 0; i < TRANSPORT_NUM; i++) {
+        m_sessions[i] = 0;
+        m_sessionsTotal[i] = 0;
+    }
+}
+
+xrm::metrics::~metrics() {
+    for (auto& command : m_commands) delete command.second;
+    for (auto command : m_binaryCommands) delete command;
+    delete m_unknownCommand;
+}
+
+void xrm::metrics::addCommand(const std::string& name) {
+    if (m_commands.find(name) == m_commands.end()) m_commands[name] = new metricsCommand(name, "json");
+}
+
+/*
+ * Text exposition format of prometheus, see
+ * https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+static void putHeader(std::string& text, const char* name, const char* type, const char* help) {
+    text += "# HELP ";
+    text += name;
+    text += " ";
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += " ";
+    text += type;
+    text += "\n";
+}
+
+static void putValue(std::string& text, const char* name, const std::string& labels, double value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), " %.12g\n", value);
+    text += name;
+    if (!labels.empty()) text += "{" + labels + "}";
+    text += buf;
+}
+
+static void putValue(std::string& text, const char* name, const std::string& labels, uint64_t value) {
+    text += name;
+    if (!labels.empty()) text += "{" + labels + "}";
+    text += " " + std::to_string(value) + "\n";
+}
+
+static void putHistogram(std::string& text,
+                         const char* name,
+                         const std::string& labels,
+                         const xrm::metricsHistogram& histogram) {
+    std::string bucketName = std::string(name) + "_bucket";
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    uint64_t count = 0;
+    char le[32];
+
+    for (int32_t i = 0; i < XRM_METRICS_NUM_BUCKET; i++) {
+        count += histogram.getBucket(i);
+        if (i < XRM_METRICS_NUM_BUCKET - 1)
+            snprintf(le, sizeof(le), "%g", xrm::metricsBucketBounds[i] / 1e6);
+        else
+            snprintf(le, sizeof(le), "+Inf");
+        putValue(text, bucketName.c_str(), prefix + "le=\"" + le + "\"", count);
+    }
+    putValue(text, (std::string(name) + "_sum").c_str(), labels, histogram.getSumUs() / 1e6);
+    putValue(text, (std::string(name) + "_count").c_str(), labels, count);
+}
+
+/* the label value is escaped as the format asks */
+static std::string label(const char* name, const std::string& value) {
+    std::string text = std::string(name) + "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            text += '\\';
+        else if (c == '\n') {
+            text += "\\n";
+            continue;
+        }
+        text += c;
+    }
+    return (text + "\"");
+}
+
+static uint64_t histogramCount(const xrm::metricsHistogram& histogram) {
+    uint64_t count = 0;
+    for (int32_t i = 0; i < XRM_METRICS_NUM_BUCKET; i++) count += histogram.getBucket(i);
+    return (count);
+}
+
+/*
+ * Renders all the metrics. Only the counters of this object and the last published resource
+ * state are read, no system lock is taken.
+ */
+void xrm::metrics::render(std::string& text, int32_t numWaiters) {
+    std::shared_ptr<const metricsResource> resource = getResource();
+    std::vector<metricsCommand*> commands;
+
+    for (auto& command : m_commands) commands.push_back(command.second);
+    commands.push_back(m_unknownCommand);
+    commands.insert(commands.end(), m_binaryCommands.begin(), m_binaryCommands.end());
+
+    if (resource) {
+        static const struct {
+            const char* cuName;
+            const char* devName;
+            const char* help;
+            int32_t metricsCuLoad::*field;
+            double scale;
+        } loads[] = {
+            {"xrm_cu_used_load", "xrm_device_used_load", "Load allocated, including the reserved load, 1 is one cu.",
+             &metricsCuLoad::usedLoad, 1e6},
+            {"xrm_cu_reserved_load", "xrm_device_reserved_load", "Load reserved, 1 is one cu.",
+             &metricsCuLoad::reservedLoad, 1e6},
+            {"xrm_cu_reserved_used_load", "xrm_device_reserved_used_load",
+             "Load allocated from the reserved load, 1 is one cu.", &metricsCuLoad::reservedUsedLoad, 1e6},
+            {"xrm_cu_channels", "xrm_device_channels", "Channels in use.", &metricsCuLoad::numChanInuse, 1},
+        };
+        putHeader(text, "xrm_device_loaded", "gauge", "Whether an xclbin is loaded on the device.");
+        for (auto& dev : resource->devices)
+            putValue(text, "xrm_device_loaded", label("device", std::to_string(dev.devId)), (uint64_t)dev.isLoaded);
+        putHeader(text, "xrm_device_disabled", "gauge", "Whether the device is disabled.");
+        for (auto& dev : resource->devices)
+            putValue(text, "xrm_device_disabled", label("device", std::to_string(dev.devId)),
+                     (uint64_t)dev.isDisabled);
+        for (auto& load : loads) {
+            putHeader(text, load.devName, "gauge", load.help);
+            for (auto& dev : resource->devices) {
+                int64_t total = 0;
+                for (auto& cu : dev.cus) total += cu.*load.field;
+                putValue(text, load.devName, label("device", std::to_string(dev.devId)), total / load.scale);
+            }
+            putHeader(text, load.cuName, "gauge", load.help);
+            for (auto& dev : resource->devices) {
+                std::string devLabel = label("device", std::to_string(dev.devId)) + ",";
+                for (auto& cu : dev.cus)
+                    putValue(text, load.cuName, devLabel + label("cu", cu.cuName), cu.*load.field / load.scale);
+            }
+        }
+        putHeader(text, "xrm_concurrent_clients", "gauge", "Clients connected to the daemon.");
+        putValue(text, "xrm_concurrent_clients", "", (uint64_t)resource->numConcurrentClient);
+        if (resource->persistence) {
+            const snapshotStats& stats = resource->snapshot;
+            putHeader(text, "xrm_snapshots_total", "counter", "Snapshots taken by the result.");
+            putValue(text, "xrm_snapshots_total", label("result", "saved"), stats.numSnapshot);
+            putValue(text, "xrm_snapshots_total", label("result", "failed"), stats.numFailed);
+            putHeader(text, "xrm_snapshot_duration_seconds_total", "counter", "Time spent taking snapshots.");
+            putValue(text, "xrm_snapshot_duration_seconds_total", "", stats.totalDurationUs / 1e6);
+            putHeader(text, "xrm_snapshot_stall_seconds_total", "counter",
+                      "Time the devices are locked for snapshots, allocations wait meanwhile.");
+            putValue(text, "xrm_snapshot_stall_seconds_total", "", stats.totalStallUs / 1e6);
+            putHeader(text, "xrm_snapshot_last_duration_seconds", "gauge", "Time taken by the last snapshot.");
+            putValue(text, "xrm_snapshot_last_duration_seconds", "", stats.lastDurationUs / 1e6);
+            putHeader(text, "xrm_snapshot_last_stall_seconds", "gauge",
+                      "Time the devices are locked for the last snapshot.");
+            putValue(text, "xrm_snapshot_last_stall_seconds", "", stats.lastStallUs / 1e6);
+            putHeader(text, "xrm_snapshot_max_stall_seconds", "gauge",
+                      "Longest time the devices are locked for a snapshot.");
+            putValue(text, "xrm_snapshot_max_stall_seconds", "", stats.maxStallUs / 1e6);
+        }
+    }
+
+    putHeader(text, "xrm_requests_total", "counter", "Requests handled by the command and the return value.");
+    for (auto command : commands) {
+        std::string labels = label("command", command->getName()) + "," + label("protocol", command->getProtocol());
+        for (int32_t slot = 0; slot < XRM_METRICS_NUM_STATUS; slot++) {
+            uint64_t count = command->getStatusCount(slot);
+            if (count == 0) continue;
+            std::string status = (slot < XRM_METRICS_NUM_STATUS - 1) ? std::to_string(-slot) : "other";
+            putValue(text, "xrm_requests_total", labels + "," + label("status", status), count);
+        }
+    }
+    static const struct {
+        metricsCommandKind kind;
+        const char* name;
+        const char* help;
+    } latencies[] = {
+        {METRICS_COMMAND_ALLOC, "xrm_alloc_duration_seconds", "Time taken by the allocation requests."},
+        {METRICS_COMMAND_RELEASE, "xrm_release_duration_seconds", "Time taken by the release requests."},
+    };
+    for (auto& latency : latencies) {
+        putHeader(text, latency.name, "histogram", latency.help);
+        for (auto command : commands) {
+            if (command->getKind() != latency.kind || histogramCount(command->getLatency()) == 0) continue;
+            std::string labels =
+                label("command", command->getName()) + "," + label("protocol", command->getProtocol());
+            putHistogram(text, latency.name, labels, command->getLatency());
+        }
+    }
+
+    putHeader(text, "xrm_lock_wait_seconds", "histogram", "Time waited for the system lock.");
+    for (int32_t mode = 0; mode < LOCK_MODE_NUM; mode++)
+        putHistogram(text, "xrm_lock_wait_seconds", label("mode", lockModeNames[mode]), m_lockWait[mode]);
+    putHeader(text, "xrm_lock_hold_seconds", "histogram", "Time the system lock is held.");
+    for (int32_t mode = 0; mode < LOCK_MODE_NUM; mode++)
+        putHistogram(text, "xrm_lock_hold_seconds", label("mode", lockModeNames[mode]), m_lockHold[mode]);
+
+    putHeader(text, "xrm_sessions", "gauge", "Open client connections.");
+    for (int32_t type = 0; type < TRANSPORT_NUM; type++)
+        putValue(text, "xrm_sessions", label("transport", transportNames[type]),
+                 (uint64_t)m_sessions[type].load(std::memory_order_relaxed));
+    putHeader(text, "xrm_sessions_total", "counter", "Client connections accepted.");
+    for (int32_t type = 0; type < TRANSPORT_NUM; type++)
+        putValue(text, "xrm_sessions_total", label("transport", transportNames[type]),
+                 m_sessionsTotal[type].load(std::memory_order_relaxed));
+    putHeader(text, "xrm_waiting_requests", "gauge", "Allocation requests waiting in the daemon for free resource.");
+    putValue(text, "xrm_waiting_requests", "", (uint64_t)(numWaiters > 0 ? numWaiters : 0));
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_METRICS_HPP_
+#define _XRM_METRICS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#include "xrm_system.hpp"
+
+#define XRM_METRICS_NUM_BUCKET 16 // the last bucket is +Inf
+#define XRM_METRICS_NUM_STATUS 64 // status XRM_SUCCESS to -62, the last slot counts the others
+
+namespace xrm {
+
+/* upper bounds (us) of the latency buckets, 10 us to 1 s */
+static const uint64_t metricsBucketBounds[XRM_METRICS_NUM_BUCKET - 1] = {
+    10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+
+inline uint64_t metricsNowUs() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+/*
+ * Latency histogram, observed by the io threads without lock.
+ */
+class metricsHistogram {
+   public:
+    metricsHistogram() {
+        for (int32_t i = 0; i < XRM_METRICS_NUM_BUCKET; i++) m_buckets[i] = 0;
+    }
+
+    void observe(uint64_t us) {
+        int32_t i = 0;
+        while (i < XRM_METRICS_NUM_BUCKET - 1 && us > metricsBucketBounds[i]) i++;
+        m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+        m_sumUs.fetch_add(us, std::memory_order_relaxed);
+    }
+    uint64_t getBucket(int32_t i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t getSumUs() const { return m_sumUs.load(std::memory_order_relaxed); }
+
+   private:
+    std::atomic<uint64_t> m_buckets[XRM_METRICS_NUM_BUCKET];
+    std::atomic<uint64_t> m_sumUs{0};
+};
+
+typedef enum metricsCommandKind {
+    METRICS_COMMAND_OTHER = 0,
+    METRICS_COMMAND_ALLOC = 1,   // cu, cu list and cu group allocation
+    METRICS_COMMAND_RELEASE = 2, // cu, cu list and cu group release
+} metricsCommandKind;
+
+/*
+ * Requests of one command, counted by return value. A positive value is a count or the log
+ * level of some commands, it's counted as XRM_SUCCESS. The latency is only kept for the
+ * allocation and release commands.
+ */
+class metricsCommand {
+   public:
+    metricsCommand(const std::string& name, const std::string& protocol) : m_name(name), m_protocol(protocol) {
+        for (int32_t i = 0; i < XRM_METRICS_NUM_STATUS; i++) m_status[i] = 0;
+        m_kind = METRICS_COMMAND_OTHER;
+        if (name.compare(0, 2, "cu") == 0 && name.find("Alloc") != std::string::npos) m_kind = METRICS_COMMAND_ALLOC;
+        if (name.compare(0, 2, "cu") == 0 && name.find("Release") != std::string::npos)
+            m_kind = METRICS_COMMAND_RELEASE;
+    }
+
+    void record(int32_t status, uint64_t us) {
+        int32_t slot = (status > 0) ? 0 : -status;
+        if (slot >= XRM_METRICS_NUM_STATUS - 1) slot = XRM_METRICS_NUM_STATUS - 1;
+        m_status[slot].fetch_add(1, std::memory_order_relaxed);
+        if (m_kind != METRICS_COMMAND_OTHER) m_latency.observe(us);
+    }
+
+    const std::string& getName() const { return m_name; }
+    const std::string& getProtocol() const { return m_protocol; }
+    metricsCommandKind getKind() const { return m_kind; }
+    uint64_t getStatusCount(int32_t slot) const { return m_status[slot].load(std::memory_order_relaxed); }
+    const metricsHistogram& getLatency() const { return m_latency; }
+
+   private:
+    std::string m_name;
+    std::string m_protocol;
+    metricsCommandKind m_kind;
+    std::atomic<uint64_t> m_status[XRM_METRICS_NUM_STATUS];
+    metricsHistogram m_latency;
+};
+
+/* load of one cu, in the granularity of 1,000,000 of the cu */
+typedef struct metricsCuLoad {
+    std::string cuName;
+    int32_t usedLoad;
+    int32_t reservedLoad;
+    int32_t reservedUsedLoad;
+    int32_t numChanInuse;
+} metricsCuLoad;
+
+typedef struct metricsDevice {
+    int32_t devId;
+    bool isLoaded;
+    bool isDisabled;
+    std::vector<metricsCuLoad> cus;
+} metricsDevice;
+
+/*
+ * The resource state published by system::publishMetrics(), the scrape reads the last
+ * published one instead of taking the system lock.
+ */
+typedef struct metricsResource {
+    std::vector<metricsDevice> devices;
+    uint32_t numConcurrentClient;
+    bool persistence;
+    snapshotStats snapshot;
+} metricsResource;
+
+/*
+ * Counters of the daemon for the metrics endpoint.
+ *
+ * The request and lock counters are updated in place by the io threads with relaxed atomics,
+ * the command table is filled before the daemon serves and not changed after, so it's read
+ * without lock. The resource state is published periodically as a whole.
+ */
+class metrics {
+   public:
+    typedef enum lockMode {
+        LOCK_EXCLUSIVE = 0,
+        LOCK_SHARED = 1,
+        LOCK_MODE_NUM = 2,
+    } lockMode;
+
+    typedef enum transport {
+        TRANSPORT_TCP = 0,
+        TRANSPORT_UNIX = 1,
+        TRANSPORT_NUM = 2,
+    } transport;
+
+    metrics();
+    ~metrics();
+
+    /* only called before the daemon serves */
+    void addCommand(const std::string& name);
+
+    /* NULL if the command is not registered */
+    metricsCommand* getCommand(const std::string& name) {
+        auto iter = m_commands.find(name);
+        return (iter != m_commands.end() ? iter->second : NULL);
+    }
+    /* the unknown opcodes are counted together */
+    metricsCommand* getBinaryCommand(uint16_t opcode) {
+        return (opcode < m_binaryCommands.size() ? m_binaryCommands[opcode] : m_binaryCommands[0]);
+    }
+    metricsCommand* getUnknownCommand() { return (m_unknownCommand); }
+
+    void observeLockWait(lockMode mode, uint64_t us) { m_lockWait[mode].observe(us); }
+    void observeLockHold(lockMode mode, uint64_t us) { m_lockHold[mode].observe(us); }
+
+    void openSession(transport type) {
+        m_sessions[type].fetch_add(1, std::memory_order_relaxed);
+        m_sessionsTotal[type].fetch_add(1, std::memory_order_relaxed);
+    }
+    void closeSession(transport type) { m_sessions[type].fetch_sub(1, std::memory_order_relaxed); }
+
+    void publishResource(std::shared_ptr<const metricsResource> resource) {
+        std::lock_guard<std::mutex> guard(m_resourceLock);
+        m_resource = resource;
+    }
+
+    void render(std::string& text, int32_t numWaiters);
+
+   private:
+    std::shared_ptr<const metricsResource> getResource() {
+        std::lock_guard<std::mutex> guard(m_resourceLock);
+        return (m_resource);
+    }
+
+    std::map<std::string, metricsCommand*> m_commands;
+    std::vector<metricsCommand*> m_binaryCommands; // indexed by opcode, [0] counts the unknown opcodes
+    metricsCommand* m_unknownCommand;              // the json requests of unsupported name
+    metricsHistogram m_lockWait[LOCK_MODE_NUM];
+    metricsHistogram m_lockHold[LOCK_MODE_NUM];
+    std::atomic<int64_t> m_sessions[TRANSPORT_NUM];
+    std::atomic<uint64_t> m_sessionsTotal[TRANSPORT_NUM];
+    std::mutex m_resourceLock;
+    std::shared_ptr<const metricsResource> m_resource;
+};
+} // namespace xrm
+
+#endif // _XRM_METRICS_HPP_
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xrm_metrics_server.hpp"
+
+/*
+ * Listens on the loopback address only, the metrics are not served to other hosts.
+ *
+ * return:
+ *   XRM_SUCCESS: listening on the port
+ *   XRM_ERROR: failed to listen on the port, the metrics are not served
+ */
+int32_t xrm::metricsServer::listen(uint16_t port) {
+    boost::system::error_code ec;
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+
+    m_acceptor.open(endpoint.protocol(), ec);
+    if (!ec) m_acceptor.set_option(tcp::acceptor::reuse_address(true), ec);
+    if (!ec) m_acceptor.bind(endpoint, ec);
+    if (!ec) m_acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+    if (ec) {
+        m_system->logMsg(XRM_LOG_ERROR, "%s: failed to listen on port %u, error %s = %d, %s", __func__, port,
+                         ec.category().name(), ec.value(), ec.message().c_str());
+        boost::system::error_code closeEc;
+        m_acceptor.close(closeEc);
+        return (XRM_ERROR);
+    }
+    m_system->logMsg(XRM_LOG_NOTICE, "%s: serving metrics on 127.0.0.1:%u", __func__, port);
+    doAccept();
+    return (XRM_SUCCESS);
+}
+
+void xrm::metricsServer::doAccept() {
+    m_acceptor.async_accept(m_socket, [this](boost::system::error_code ec) {
+        if (ec) {
+            m_system->logMsg(XRM_LOG_ERROR, "%s: error %s = %d, %s", __func__, ec.category().name(), ec.value(),
+                             ec.message().c_str());
+        } else {
+            std::make_shared<xrm::metricsSession>(this, std::move(m_socket))->start();
+        }
+        doAccept();
+    });
+}
+
+/*
+ * Answers the HTTP request head, only "GET /metrics" and "HEAD /metrics" are served.
+ */
+void xrm::metricsServer::handleRequest(const std::string& request, std::string& rsp) {
+    std::string method, target, status, body;
+    std::string contentType = "text/plain; charset=utf-8";
+
+    size_t methodEnd = request.find(' ');
+    size_t targetEnd = (methodEnd == std::string::npos) ? std::string::npos : request.find(' ', methodEnd + 1);
+    if (targetEnd != std::string::npos) {
+        method = request.substr(0, methodEnd);
+        target = request.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    }
+    /* the query string is ignored */
+    target = target.substr(0, target.find('?'));
+    if (method != "GET" && method != "HEAD") {
+        status = "405 Method Not Allowed";
+        body = "only GET is served\n";
+    } else if (target != "/metrics") {
+        status = "404 Not Found";
+        body = "the metrics are served at /metrics\n";
+    } else {
+        status = "200 OK";
+        contentType = "text/plain; version=0.0.4; charset=utf-8";
+        m_metrics->render(body, m_waitQueue != NULL ? m_waitQueue->getNumWaiters() : 0);
+    }
+    rsp = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType +
+          "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (method != "HEAD") rsp += body;
+}
+
+void xrm::metricsSession::doRead() {
+    auto self(shared_from_this());
+    boost::asio::async_read_until(m_socket, m_inbuf, "\r\n\r\n",
+                                  [this, self](boost::system::error_code const& ec, std::size_t length) {
+                                      /* the head is not complete within max_length, or the peer is gone */
+                                      if (ec) return;
+                                      std::string request(boost::asio::buffers_begin(m_inbuf.data()),
+                                                          boost::asio::buffers_begin(m_inbuf.data()) + length);
+                                      m_server->handleRequest(request, m_outdata);
+                                      doWrite();
+                                  });
+}
+
+void xrm::metricsSession::doWrite() {
+    auto self(shared_from_this());
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_outdata),
+                             [this, self](boost::system::error_code const& ec, std::size_t /*length*/) {
+                                 std::ignore = ec;
+                                 boost::system::error_code closeEc;
+                                 m_socket.shutdown(tcp::socket::shutdown_both, closeEc);
+                                 m_socket.close(closeEc);
+                             });
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_METRICS_SERVER_HPP_
+#define _XRM_METRICS_SERVER_HPP_
+
+#include <memory>
+#include <string>
+#include <boost/asio.hpp>
+#include "xrm_metrics.hpp"
+#include "xrm_system.hpp"
+#include "xrm_wait_queue.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace xrm {
+
+/*
+ * Serves the metrics in prometheus text format to "GET /metrics" over HTTP on the loopback
+ * address. Each connection is answered once and closed. The scrape only reads the counters
+ * and the resource state last published by system::publishMetrics(), it doesn't take the
+ * system lock.
+ */
+class metricsServer {
+   public:
+    metricsServer(boost::asio::io_service& ioService, xrm::system* sys, xrm::metrics* metrics,
+                  xrm::waitQueue* waitQueue)
+        : m_acceptor(ioService), m_socket(ioService), m_system(sys), m_metrics(metrics), m_waitQueue(waitQueue) {}
+
+    int32_t listen(uint16_t port);
+    void handleRequest(const std::string& request, std::string& rsp);
+
+   private:
+    void doAccept();
+
+    tcp::acceptor m_acceptor;
+    tcp::socket m_socket;
+    xrm::system* m_system;
+    xrm::metrics* m_metrics;
+    xrm::waitQueue* m_waitQueue;
+};
+
+/*
+ * One scrape connection, the request head is read up to max_length bytes.
+ */
+class metricsSession : public std::enable_shared_from_this<metricsSession> {
+   public:
+    metricsSession(metricsServer* server, tcp::socket socket) : m_server(server), m_socket(std::move(socket)) {}
+
+    void start() { doRead(); }
+
+   private:
+    void doRead();
+    void doWrite();
+
+    enum { max_length = 8192 };
+
+    metricsServer* m_server;
+    tcp::socket m_socket;
+    boost::asio::streambuf m_inbuf{max_length};
+    std::string m_outdata;
+};
+} // namespace xrm
+
+#endif // _XRM_METRICS_SERVER_HPP_
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifdef XRM_SIM_DEVICE
+
+#include "xrm_sim_device.hpp"
+#include <cstring>
+#include <cerrno>
+#include <functional>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "xrm_limits.h"
+#include "xrm_error.h"
+
+namespace pt = boost::property_tree;
+
+namespace {
+
+struct simDevice {
+    std::string dsaName;
+    int32_t offline;
+    std::string loadedXclbin;
+    int32_t numContext;
+};
+
+struct simDescription {
+    std::vector<simDevice> devices;
+    std::vector<xrm::sim::simXclbin> xclbins;
+    uint32_t loadLatencyMs;
+    uint32_t offlineLatencyMs;
+};
+
+static simDescription localDesc;
+
+static int32_t hexValue(char c) {
+    if (c >= '0' && c <= '9') return (c - '0');
+    if (c >= 'a' && c <= 'f') return (c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return (c - 'A' + 10);
+    return (-1);
+}
+
+/*
+ * The uuid is given as 32 hex chars, otherwise it's derived from the xclbin name so that
+ * different xclbin files in the description always have different uuids.
+ */
+static bool parseUuid(const std::string& uuidStr, const std::string& name, uuid_t uuid) {
+    if (uuidStr.empty()) {
+        uint64_t hash[2];
+        hash[0] = std::hash<std::string>()(name);
+        hash[1] = std::hash<std::string>()(name + ".xclbin");
+        memcpy(uuid, hash, sizeof(uuid_t));
+        return (true);
+    }
+    if (uuidStr.length() != 2 * sizeof(uuid_t)) return (false);
+    for (size_t i = 0; i < sizeof(uuid_t); i++) {
+        int32_t hex0 = hexValue(uuidStr[2 * i]);
+        int32_t hex1 = hexValue(uuidStr[2 * i + 1]);
+        if (hex0 < 0 || hex1 < 0) return (false);
+        uuid[i] = (unsigned char)((hex0 << 4) | hex1);
+    }
+    return (true);
+}
+
+/*
+ * The device handle is the device id plus 1, so that handle of valid device is never 0.
+ */
+static simDevice* getDevice(xclDeviceHandle handle) {
+    uintptr_t devIdx = reinterpret_cast<uintptr_t>(handle);
+    if (devIdx == 0 || devIdx > localDesc.devices.size()) return (NULL);
+    return (&localDesc.devices[devIdx - 1]);
+}
+
+static void injectLatency(uint32_t latencyMs) {
+    if (latencyMs) boost::this_thread::sleep(boost::posix_time::milliseconds(latencyMs));
+}
+
+} // namespace
+
+namespace xrm {
+namespace sim {
+
+int32_t init(const std::string& fileName, std::string& errmsg) {
+    pt::ptree descTree;
+    simDescription desc;
+
+    try {
+        pt::read_json(fileName, descTree);
+    } catch (const pt::json_parser_error& e) {
+        errmsg = "failed to read simulated device file " + fileName + ": " + e.message();
+        return (XRM_ERROR);
+    }
+
+    try {
+        desc.loadLatencyMs = descTree.get<uint32_t>("loadLatencyMs", 0);
+        desc.offlineLatencyMs = descTree.get<uint32_t>("offlineLatencyMs", 0);
+        for (const auto& devIter : descTree.get_child("devices")) {
+            simDevice dev;
+            dev.dsaName = devIter.second.get<std::string>("dsaName", "xilinx_sim_device");
+            dev.offline = devIter.second.get<int32_t>("offline", 0);
+            dev.numContext = 0;
+            uint32_t count = devIter.second.get<uint32_t>("count", 1);
+            for (uint32_t i = 0; i < count; i++) desc.devices.push_back(dev);
+        }
+        if (desc.devices.empty() || desc.devices.size() > XRM_MAX_XILINX_DEVICES) {
+            errmsg = "simulated device number " + std::to_string(desc.devices.size()) + " is out range of 1 - " +
+                     std::to_string(XRM_MAX_XILINX_DEVICES);
+            return (XRM_ERROR);
+        }
+
+        auto xclbinsTree = descTree.get_child_optional("xclbins");
+        if (xclbinsTree) {
+            for (const auto& xclbinIter : *xclbinsTree) {
+                simXclbin xclbin;
+                xclbin.name = xclbinIter.second.get<std::string>("name");
+                if (!parseUuid(xclbinIter.second.get<std::string>("uuid", ""), xclbin.name, xclbin.uuid)) {
+                    errmsg = "uuid of simulated xclbin " + xclbin.name + " is not 32 hex chars";
+                    return (XRM_ERROR);
+                }
+                for (const auto& kernelIter : xclbinIter.second.get_child("kernels")) {
+                    simCu cu;
+                    cu.kernelName = kernelIter.second.get<std::string>("name");
+                    cu.kernelAlias = kernelIter.second.get<std::string>("alias", "");
+                    cu.kernelPluginFileName = kernelIter.second.get<std::string>("plugin", "");
+                    cu.maxCapacity = kernelIter.second.get<uint64_t>("maxCapacity", 0);
+                    cu.isSoftKernel = kernelIter.second.get<bool>("softKernel", false);
+                    uint32_t instances = kernelIter.second.get<uint32_t>("instances", 1);
+                    for (uint32_t i = 0; i < instances; i++) {
+                        cu.instanceName = cu.kernelName + "_" + std::to_string(i);
+                        cu.baseAddr = cu.isSoftKernel ? 0 : 0x10000 * (xclbin.cuList.size() + 1);
+                        xclbin.cuList.push_back(cu);
+                    }
+                }
+                if (xclbin.cuList.size() > XRM_MAX_XILINX_KERNELS) {
+                    errmsg = "cu number of simulated xclbin " + xclbin.name + " is out range of " +
+                             std::to_string(XRM_MAX_XILINX_KERNELS);
+                    return (XRM_ERROR);
+                }
+                desc.xclbins.push_back(xclbin);
+            }
+        }
+    } catch (const pt::ptree_error& e) {
+        errmsg = "simulated device file " + fileName + " is not right: " + e.what();
+        return (XRM_ERROR);
+    }
+
+    localDesc = desc;
+    return (XRM_SUCCESS);
+}
+
+int32_t probe() {
+    return ((int32_t)localDesc.devices.size());
+}
+
+xclDeviceHandle open(int32_t devId, xclDeviceInfo2* deviceInfo) {
+    if (devId < 0 || (size_t)devId >= localDesc.devices.size()) return (NULL);
+
+    memset(deviceInfo, 0, sizeof(xclDeviceInfo2));
+    strncpy(deviceInfo->mName, localDesc.devices[devId].dsaName.c_str(), sizeof(deviceInfo->mName) - 1);
+    deviceInfo->mPciSlot = devId;
+    return (reinterpret_cast<xclDeviceHandle>((uintptr_t)devId + 1));
+}
+
+void close(xclDeviceHandle handle) {
+    simDevice* dev = getDevice(handle);
+    if (dev) dev->numContext = 0;
+}
+
+const simXclbin* findXclbin(const std::string& name) {
+    for (const auto& xclbin : localDesc.xclbins) {
+        if (xclbin.name == name) return (&xclbin);
+    }
+    return (NULL);
+}
+
+/*
+ * Same as xclLoadXclBin(), the loaded xclbin can't be replaced while any context is opened on it.
+ */
+int32_t loadXclbin(xclDeviceHandle handle, const std::string& name) {
+    simDevice* dev = getDevice(handle);
+    if (dev == NULL) return (-EINVAL);
+    if (findXclbin(name) == NULL) return (-ENOENT);
+    injectLatency(localDesc.loadLatencyMs);
+    if (dev->numContext > 0 && dev->loadedXclbin != name) return (-EBUSY);
+    dev->loadedXclbin = name;
+    return (0);
+}
+
+int32_t openContext(xclDeviceHandle handle) {
+    simDevice* dev = getDevice(handle);
+    if (dev == NULL || dev->loadedXclbin.empty()) return (-EINVAL);
+    dev->numContext++;
+    return (0);
+}
+
+int32_t closeContext(xclDeviceHandle handle) {
+    simDevice* dev = getDevice(handle);
+    if (dev == NULL || dev->numContext == 0) return (-EINVAL);
+    dev->numContext--;
+    return (0);
+}
+
+int32_t getOfflineStatus(xclDeviceHandle handle) {
+    simDevice* dev = getDevice(handle);
+    if (dev == NULL) return (XRM_ERROR_INVALID);
+    injectLatency(localDesc.offlineLatencyMs);
+    return (dev->offline);
+}
+
+} // namespace sim
+} // namespace xrm
+
+#endif // XRM_SIM_DEVICE
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019-2020, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_SIM_DEVICE_HPP_
+#define _XRM_SIM_DEVICE_HPP_
+
+#include <string>
+#include <vector>
+#include <uuid/uuid.h>
+#include <xrt.h>
+
+namespace xrm {
+namespace sim {
+
+/**
+ * Simulated device backend of XRM daemon, it's built in with XRM_SIM_DEVICE defined.
+ *
+ * The devices and the xclbin files are described by one json file instead of being probed
+ * from XRT, so that the daemon can run on host without FPGA device. The xclbin file itself
+ * is never read, the loaded xclbin is looked up by the file name in the description:
+ *
+ *  {
+ *      "loadLatencyMs": 100,
+ *      "offlineLatencyMs": 1,
+ *      "devices": [
+ *          { "dsaName": "xilinx_u30_gen3x4_base_2", "count": 4 },
+ *          { "dsaName": "xilinx_u30_gen3x4_base_2", "offline": 1 }
+ *      ],
+ *      "xclbins": [
+ *          {
+ *              "name": "/tmp/transcode.xclbin",
+ *              "uuid": "0123456789abcdef0123456789abcdef",
+ *              "kernels": [
+ *                  { "name": "encoder", "instances": 2, "maxCapacity": 497664000 },
+ *                  { "name": "kernel_vcu_decoder", "instances": 1, "softKernel": true }
+ *              ]
+ *          }
+ *      ]
+ *  }
+ *
+ * count: number of same devices, default 1
+ * offline: value of dev_offline of the device, default 0
+ * uuid: 32 hex chars, default is derived from the name
+ * instances: number of cu of the kernel, named "<name>_<index>", default 1
+ * alias, plugin, maxCapacity: same as the key values metadata of the xclbin file
+ * loadLatencyMs, offlineLatencyMs: injected delay of the xclbin load and offline status read
+ */
+
+typedef struct simCu {
+    std::string kernelName;
+    std::string instanceName;
+    std::string kernelAlias;
+    std::string kernelPluginFileName;
+    uint64_t maxCapacity;
+    uint64_t baseAddr;
+    bool isSoftKernel;
+} simCu;
+
+typedef struct simXclbin {
+    std::string name;
+    uuid_t uuid;
+    std::vector<simCu> cuList;
+} simXclbin;
+
+int32_t init(const std::string& fileName, std::string& errmsg);
+int32_t probe();
+xclDeviceHandle open(int32_t devId, xclDeviceInfo2* deviceInfo);
+void close(xclDeviceHandle handle);
+const simXclbin* findXclbin(const std::string& name);
+int32_t loadXclbin(xclDeviceHandle handle, const std::string& name);
+int32_t openContext(xclDeviceHandle handle);
+int32_t closeContext(xclDeviceHandle handle);
+int32_t getOfflineStatus(xclDeviceHandle handle);
+
+} // namespace sim
+} // namespace xrm
+
+#endif // _XRM_SIM_DEVICE_HPP_
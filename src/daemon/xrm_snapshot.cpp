@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xrm_snapshot.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/* table of the reflected crc32 polynomial 0xEDB88320, built on first use */
+struct crcTable {
+    uint32_t entries[256];
+
+    crcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int32_t bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            entries[i] = crc;
+        }
+    }
+};
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t ret = write(fd, data, size);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+/* syncs the directory holding fileName, so a file renamed into it stays after a crash */
+static bool syncDir(const std::string& fileName) {
+    size_t pos = fileName.find_last_of('/');
+    std::string dirName = (pos == std::string::npos) ? "." : (pos == 0 ? "/" : fileName.substr(0, pos));
+    int fd = open(dirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ret = (fsync(fd) == 0);
+    close(fd);
+    return ret;
+}
+
+} // namespace
+
+uint32_t xrm::snapshotChecksum(const char* data, size_t size) {
+    static const crcTable table;
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < size; i++) crc = table.entries[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    return (crc ^ 0xFFFFFFFF);
+}
+
+/*
+ * The temporary file is synced before the rename, so after a crash the snapshot file holds
+ * either the complete old snapshot or the complete new one. The directory is synced after
+ * the rename, the new snapshot is only reported written once the rename itself is durable.
+ */
+bool xrm::snapshotWriter::writeFile(const std::string& fileName, std::string& errmsg) {
+    snapshotHeader header;
+    std::string tmpFileName = fileName + ".tmp";
+
+    header.magic = XRM_SNAPSHOT_MAGIC;
+    header.version = XRM_SNAPSHOT_VERSION;
+    header.payloadSize = m_payload.size();
+    header.checksum = snapshotChecksum(m_payload.data(), m_payload.size());
+    header.reserved = 0;
+
+    int fd = open(tmpFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        errmsg = "failed to create " + tmpFileName + ": " + strerror(errno);
+        return false;
+    }
+    if (!writeAll(fd, (const char*)&header, sizeof(header)) || !writeAll(fd, m_payload.data(), m_payload.size()) ||
+        fsync(fd) != 0) {
+        errmsg = "failed to write " + tmpFileName + ": " + strerror(errno);
+        close(fd);
+        unlink(tmpFileName.c_str());
+        return false;
+    }
+    close(fd);
+    if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        errmsg = "failed to rename " + tmpFileName + " to " + fileName + ": " + strerror(errno);
+        unlink(tmpFileName.c_str());
+        return false;
+    }
+    if (!syncDir(fileName)) {
+        errmsg = "failed to sync the directory of " + fileName + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+int32_t xrm::snapshotReader::readFile(const std::string& fileName, std::string& errmsg) {
+    snapshotHeader header;
+    struct stat buf;
+
+    m_good = false;
+    m_offset = 0;
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return (0);
+        errmsg = "failed to open " + fileName + ": " + strerror(errno);
+        return (-1);
+    }
+    if (fstat(fd, &buf) != 0 || (size_t)buf.st_size < sizeof(header) ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        errmsg = fileName + " is too short for a snapshot";
+        close(fd);
+        return (-1);
+    }
+    if (header.magic != XRM_SNAPSHOT_MAGIC || header.version != XRM_SNAPSHOT_VERSION ||
+        header.payloadSize != (uint64_t)buf.st_size - sizeof(header)) {
+        errmsg = fileName + " is not a snapshot of version " + std::to_string(XRM_SNAPSHOT_VERSION);
+        close(fd);
+        return (-1);
+    }
+    m_payload.resize(header.payloadSize);
+    size_t done = 0;
+    while (done < m_payload.size()) {
+        ssize_t ret = read(fd, &m_payload[done], m_payload.size() - done);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) break;
+        done += ret;
+    }
+    close(fd);
+    if (done != m_payload.size()) {
+        errmsg = "failed to read " + fileName;
+        return (-1);
+    }
+    if (snapshotChecksum(m_payload.data(), m_payload.size()) != header.checksum) {
+        errmsg = "checksum mismatch of " + fileName;
+        return (-1);
+    }
+    m_good = true;
+    return (1);
+}
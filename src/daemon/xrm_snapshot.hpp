@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_SNAPSHOT_HPP_
+#define _XRM_SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/*
+ * Snapshot file layout, all values in host byte order:
+ *
+ *   snapshotHeader
+ *   payload of payloadSize bytes, its crc32 is the header checksum
+ *
+ * The payload is the sequence of values put by the writer, a string is put as its uint32_t
+ * length followed by the characters. The version is raised whenever the payload changes,
+ * a snapshot of other version is not restored.
+ */
+#define XRM_SNAPSHOT_MAGIC 0x534d5258 // "XRMS"
+#define XRM_SNAPSHOT_VERSION 3
+
+namespace xrm {
+
+typedef struct snapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t payloadSize;
+    uint32_t checksum; // crc32 of the payload
+    uint32_t reserved;
+} snapshotHeader;
+
+uint32_t snapshotChecksum(const char* data, size_t size);
+
+/*
+ * Collects the payload in memory, then writes the whole snapshot to a temporary file and
+ * renames it over the snapshot file, so the snapshot file is always either the old one or
+ * the new one, never a partly written one.
+ */
+class snapshotWriter {
+   public:
+    snapshotWriter() {}
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are put as is");
+        m_payload.append((const char*)&value, sizeof(T));
+    }
+    void putString(const std::string& str) {
+        put((uint32_t)str.size());
+        m_payload.append(str);
+    }
+    void putBytes(const void* data, size_t size) { m_payload.append((const char*)data, size); }
+
+    size_t getPayloadSize() const { return m_payload.size(); }
+    const std::string& getPayload() const { return m_payload; }
+    void clear() { m_payload.clear(); }
+    bool writeFile(const std::string& fileName, std::string& errmsg);
+
+   private:
+    std::string m_payload;
+};
+
+/*
+ * Reads the whole snapshot file and checks the header and the checksum before anything is
+ * taken from it. Reading beyond the payload fails the reader instead of the daemon, the
+ * caller checks isGood() once it has taken all the values.
+ */
+class snapshotReader {
+   public:
+    snapshotReader() : m_offset(0), m_good(false) {}
+
+    /* return: 1 loaded, 0 no snapshot file, -1 the file is not a valid snapshot */
+    int32_t readFile(const std::string& fileName, std::string& errmsg);
+    /* takes the payload checked by the caller, a journal record */
+    void assign(const std::string& payload) {
+        m_payload = payload;
+        m_offset = 0;
+        m_good = true;
+    }
+
+    template <typename T>
+    bool get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are got as is");
+        return getBytes(&value, sizeof(T));
+    }
+    bool getString(std::string& str) {
+        uint32_t size = 0;
+        if (!get(size) || !has(size)) return fail();
+        str.assign(m_payload, m_offset, size);
+        m_offset += size;
+        return true;
+    }
+    bool getBytes(void* data, size_t size) {
+        if (!has(size)) return fail();
+        if (size == 0) return true;
+        memcpy(data, m_payload.data() + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+    /* a count read from the payload is checked against the limit before it's used */
+    bool getCount(uint32_t& count, uint32_t limit) {
+        if (!get(count)) return false;
+        if (count > limit) return fail();
+        return true;
+    }
+
+    bool isGood() const { return m_good; }
+    bool isDone() const { return m_good && m_offset == m_payload.size(); }
+
+   private:
+    bool has(size_t size) const { return m_good && size <= m_payload.size() - m_offset; }
+    bool fail() {
+        m_good = false;
+        return false;
+    }
+
+    std::string m_payload;
+    size_t m_offset;
+    bool m_good;
+};
+
+} // namespace xrm
+
+#endif // _XRM_SNAPSHOT_HPP_
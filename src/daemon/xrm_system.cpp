@@ -18,14 +18,20 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <algorithm>
 #include <fstream>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <boost/filesystem.hpp>
 #include <pthread.h>
+#include <time.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 #include "xrm_system.hpp"
 #include "xrm_config.hpp"
+#include "xrm_metrics.hpp"
 
 /*
  * All system / resource related operation should be protected by the system lock.
@@ -62,10 +68,26 @@ void xrm::system::initSystem() {
     /* init the user defined cu groups */
     initUdfCuGroups();
 
-    m_clientId = 0;
+    /*
+     * The client ids of this run start above the ones given by earlier runs, so the client
+     * of earlier run can keep its id when it reconnects after the daemon is restarted.
+     */
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    m_generation = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    m_clientIdBase = m_generation << 4;
+    m_clientId = m_clientIdBase;
     m_numConcurrentClient = 0;
     m_allocServiceId = 0;
     m_reservePoolId = 0;
+    m_orphanClients.clear();
+    m_reclaimDeadline = 0;
+    if (m_persistence) {
+        /* pick up the state left by the earlier run, then start a new journal from it */
+        if (restore()) collectOrphanClients();
+        save();
+        startSnapshotThread();
+    }
     exitLock();
 }
 
@@ -113,6 +135,25 @@ void xrm::system::initConfig() {
     logMsg(XRM_LOG_NOTICE, "%s : xrtVersionFileFullPathName = %s", __func__, m_xrtVersionFileFullPathName.c_str());
     m_libXrtCoreFileFullPathName = xrm::config::getLibXrtCoreFileFullPathName();
     logMsg(XRM_LOG_NOTICE, "%s : libXrtCoreFileFullPathName = %s", __func__, m_libXrtCoreFileFullPathName.c_str());
+    m_persistence = xrm::config::getPersistence();
+    m_snapshotFileFullPathName = xrm::config::getSnapshotFileFullPathName();
+    logMsg(XRM_LOG_NOTICE, "%s : persistence = %d, snapshotFileFullPathName = %s", __func__, m_persistence,
+           m_snapshotFileFullPathName.c_str());
+    m_journalFileFullPathName = xrm::config::getJournalFileFullPathName();
+    m_journalCompactSize = xrm::config::getJournalCompactSize();
+    m_journalSync = xrm::config::getJournalSync();
+    logMsg(XRM_LOG_NOTICE, "%s : journalFileFullPathName = %s, journalCompactSize = %lu, journalSync = %d", __func__,
+           m_journalFileFullPathName.c_str(), m_journalCompactSize, m_journalSync);
+    m_backgroundSnapshot = xrm::config::getBackgroundSnapshot();
+    m_snapshotInterval = xrm::config::getSnapshotInterval();
+    logMsg(XRM_LOG_NOTICE, "%s : backgroundSnapshot = %d, snapshotInterval = %u", __func__, m_backgroundSnapshot,
+           m_snapshotInterval);
+    m_reclaimGracePeriod = xrm::config::getReclaimGracePeriod();
+    logMsg(XRM_LOG_NOTICE, "%s : reclaimGracePeriod = %u", __func__, m_reclaimGracePeriod);
+#ifdef XRM_SIM_DEVICE
+    m_simDeviceFileFullPathName = xrm::config::getSimDeviceFileFullPathName();
+    logMsg(XRM_LOG_NOTICE, "%s : simDeviceFileFullPathName = %s", __func__, m_simDeviceFileFullPathName.c_str());
+#endif
 }
 
 /*
@@ -128,6 +169,10 @@ void xrm::system::initLibVersionDepFunctions() {
     m_libVersionDepFuncs.libVersionDepFuncXclIPName2Index25 = NULL;
     m_libVersionDepFuncs.libVersionDepFuncXclIPName2Index26 = NULL;
 
+#ifdef XRM_SIM_DEVICE
+    /* the simulated devices don't use xrt library, the cu id is handled by XRM itself */
+    return;
+#endif
     /* load xrt library file */
     void* libXrtcoreHandle = dlopen(m_libXrtCoreFileFullPathName.c_str(), (RTLD_GLOBAL | RTLD_NOW));
     if (!libXrtcoreHandle) {
@@ -210,7 +255,16 @@ void xrm::system::initDevices() {
     /* init the devices */
     if (m_devicesInited) return;
 
+#ifdef XRM_SIM_DEVICE
+    std::string errmsg;
+    int32_t numDevice = 0;
+    if (xrm::sim::init(m_simDeviceFileFullPathName, errmsg) == XRM_SUCCESS)
+        numDevice = xrm::sim::probe();
+    else
+        logMsg(XRM_LOG_ERROR, "%s : %s", __func__, errmsg.c_str());
+#else
     int32_t numDevice = xclProbe();
+#endif
     m_devicesInited = true;
 
     if (numDevice <= 0 || numDevice > XRM_MAX_XILINX_DEVICES) {
@@ -218,15 +272,40 @@ void xrm::system::initDevices() {
         return;
     }
     m_numDevice = numDevice;
+    pthread_mutex_lock(&m_counterLock);
+    m_devLoadOrder.clear();
+    pthread_mutex_unlock(&m_counterLock);
     for (int32_t devId = 0; devId < numDevice; devId++) {
         flushDevData(devId);
         m_devList[devId].devId = devId;
         m_devList[devId].isDisabled = false;
         m_devList[devId].devLoadInfo.init(devId);
+        pthread_mutex_lock(&m_counterLock);
+        m_devLoadOrder.insert(std::make_pair(m_devList[devId].devLoadInfo.devLoadRate, devId));
+        pthread_mutex_unlock(&m_counterLock);
         openDevice(devId);
     }
 }
 
+/*
+ * Updates the load of the device and moves the device to its new place in the device
+ * load order, so the allocation by device load policy needn't sort the devices.
+ *
+ * Lock: should hold the device lock or the exclusive system lock, the device load order
+ * is protected by counter lock since loads of different devices are updated in parallel.
+ */
+void xrm::system::updateDeviceLoad(int32_t devId, int64_t loadIncreased, int64_t setLoadVal) {
+    deviceLoadInfo* loadInfo = &m_devList[devId].devLoadInfo;
+    int32_t oldLoadRate = loadInfo->devLoadRate;
+
+    m_devList[devId].updateDeviceLoad(loadIncreased, setLoadVal);
+    if (loadInfo->devLoadRate == oldLoadRate) return;
+    pthread_mutex_lock(&m_counterLock);
+    m_devLoadOrder.erase(std::make_pair(oldLoadRate, devId));
+    m_devLoadOrder.insert(std::make_pair(loadInfo->devLoadRate, devId));
+    pthread_mutex_unlock(&m_counterLock);
+}
+
 /*
  * call while holding lock
  */
@@ -257,18 +336,35 @@ void xrm::system::initUdfCuGroups() {
 /*
  * It's used to assign new client id for new connection during context creating.
  *
- * Need to be proected by lock.
+ * Lock: protected by counter lock, can be called while holding shared system lock.
  */
 uint64_t xrm::system::getNewClientId() {
     uint64_t clientId;
+    pthread_mutex_lock(&m_counterLock);
     if (m_clientId == 0xFFFFFFFFFFFFFFFF)
         m_clientId = 1;
     else
         m_clientId++;
     clientId = m_clientId;
+    pthread_mutex_unlock(&m_counterLock);
     return (clientId);
 }
 
+/*
+ * Whether the client id was given by earlier daemon run, such client re-establishing its
+ * session after the daemon is restarted keeps its id.
+ */
+bool xrm::system::isEarlierClientId(uint64_t clientId) {
+    return (clientId != 0 && clientId < m_clientIdBase);
+}
+
+/*
+ * The generation of daemon run, it changes when the daemon is restarted.
+ */
+uint64_t xrm::system::getGeneration() {
+    return (m_generation);
+}
+
 void* xrm::system::listDevice(int32_t devId) {
     /* if the device is not opened yet, then need to open it at first */
     if (m_devList[devId].deviceHandle == 0) openDevice(devId);
@@ -301,8 +397,13 @@ int32_t xrm::system::openDevice(int32_t devId) {
     }
     deviceData* dev = &m_devList[devId];
 
+#ifdef XRM_SIM_DEVICE
+    dev->deviceHandle = xrm::sim::open(devId, &dev->deviceInfo);
+    ret = (dev->deviceHandle != NULL) ? 0 : XRM_ERROR;
+#else
     dev->deviceHandle = xclOpen(devId, NULL, XCL_INFO);
     ret = xclGetDeviceInfo2(dev->deviceHandle, &dev->deviceInfo);
+#endif
     if (ret != 0) {
         logMsg(XRM_LOG_ERROR, "%s : Could not get device %d info", __func__, devId);
         return (ret);
@@ -335,6 +436,11 @@ int32_t xrm::system::isDeviceOffline(int32_t devId) {
         return (status);
     }
 
+#ifdef XRM_SIM_DEVICE
+    status = xrm::sim::getOfflineStatus(dev->deviceHandle);
+    logMsg(XRM_LOG_DEBUG, "%s : simulated device [%d] offline status is %d\n", __func__, devId, status);
+    return (status);
+#endif
     /* mPciSlot is "(mDev->domain<<16) + (mDev->bus<<8) + (mDev->dev<<3) + mDev->func" */
     int32_t pciSlot = dev->deviceInfo.mPciSlot;
     int32_t domain, bus, device, func;
@@ -379,7 +485,11 @@ int32_t xrm::system::closeDevice(int32_t devId) {
     int32_t ret = XRM_SUCCESS;
     if (m_devList[devId].deviceHandle) {
         logMsg(XRM_LOG_DEBUG, "%s : close device %d\n", __func__, devId);
+#ifdef XRM_SIM_DEVICE
+        xrm::sim::close(m_devList[devId].deviceHandle);
+#else
         xclClose(m_devList[devId].deviceHandle);
+#endif
         memset(&(m_devList[devId].deviceHandle), 0, sizeof(xclDeviceHandle));
         memset(&(m_devList[devId].deviceInfo), 0, sizeof(xclDeviceInfo2));
     } else {
@@ -412,7 +522,7 @@ int32_t xrm::system::resetDevice(int32_t devId) {
                 clientProcessIdVect.push_back(m_devList[devId].clientProcs[0].clientProcessId);
             }
         } else {
-            for (i = 0; i < XRM_MAX_DEV_CLIENTS; i++) {
+            for (i = 0; i < m_devList[devId].clientProcs.size(); i++) {
                 if (m_devList[devId].clientProcs[i].clientId != 0) {
                     clientIdVect.push_back(m_devList[devId].clientProcs[i].clientId);
                     clientProcessIdVect.push_back(m_devList[devId].clientProcs[i].clientProcessId);
@@ -605,6 +715,15 @@ load_exit:
 }
 
 int32_t xrm::system::xclbinFileReadUuid(std::string& name, std::string& uuidStr, std::string& errmsg) {
+#ifdef XRM_SIM_DEVICE
+    const xrm::sim::simXclbin* simXclbin = xrm::sim::findXclbin(name);
+    if (simXclbin == NULL) {
+        errmsg = "xclbin file " + name + " is not described for simulated devices";
+        return (XRM_ERROR);
+    }
+    binToHexstr((unsigned char*)&simXclbin->uuid, sizeof(uuid_t), uuidStr);
+    return (XRM_SUCCESS);
+#endif
     std::ifstream file(name.c_str(), std::ios::binary | std::ios::ate);
     if (!file.good()) {
         errmsg = "Failed to open xclbin file " + name;
@@ -708,6 +827,8 @@ int32_t xrm::system::deviceLoadXclbin(int32_t devId, std::string& xclbin, std::s
     /* Update state */
     m_devList[devId].xclbinName = xclbin;
     m_devList[devId].isLoaded = true;
+    cuIndexAddDevice(devId);
+    journalDevice(devId);
 
 #if 0
     /* For testing only */
@@ -718,12 +839,11 @@ int32_t xrm::system::deviceLoadXclbin(int32_t devId, std::string& xclbin, std::s
 }
 
 void xrm::system::flushDevData(int32_t devId) {
-    int i;
-
     if (devId >= 0 && devId < m_numDevice) {
         deviceData* dev = &m_devList[devId];
         xclbinInformation* xclbinInfo = &dev->xclbinInfo;
-        cuData* cu;
+
+        cuIndexRemoveDevice(devId);
 
         // fresh the dev struct
         dev->dsaName = "";
@@ -735,7 +855,10 @@ void xrm::system::flushDevData(int32_t devId) {
         dev->memBuffer = NULL;
         memset(&dev->deviceHandle, 0, sizeof(xclDeviceHandle));
         memset(&dev->deviceInfo, 0, sizeof(xclDeviceInfo2));
-        memset(dev->clientProcs, 0, sizeof(clientData) * XRM_MAX_DEV_CLIENTS);
+        std::vector<clientData>().swap(dev->clientProcs);
+        dev->clientIndex.clear();
+        dev->allocIndex.clear();
+        dev->reserveIndex.clear();
 
         // fresh the xclbin info
         memset(&xclbinInfo->uuid, 0, sizeof(uuid_t));
@@ -746,35 +869,11 @@ void xrm::system::flushDevData(int32_t devId) {
         xclbinInfo->numMemBank = 0;
         xclbinInfo->numConnect = 0;
         memset(xclbinInfo->memTopologyList, 0, sizeof(memTopologyData) * XRM_MAX_DDR_MAP);
-        memset(xclbinInfo->connectList, 0, sizeof(connectData) * XRM_MAX_CONNECTION_ENTRIES);
-
-        // fresh the cuList
-        for (i = 0; i < XRM_MAX_XILINX_KERNELS; i++) {
-            cu = &xclbinInfo->cuList[i];
-            cu->cuType = CU_NULL;
-            cu->ipLayoutIndex = 0;
-            cu->kernelName = "";
-            cu->kernelAlias = "";
-            cu->cuName = "";
-            cu->instanceName = "";
-            cu->kernelPluginFileName = "";
-            cu->maxCapacity = 0;
-            cu->baseAddr = 0;
-            cu->membankId = 0;
-            cu->membankType = 0;
-            cu->membankSize = 0;
-            cu->membankBaseAddr = 0;
-            memset(cu->channels, 0, sizeof(channelData) * XRM_MAX_KERNEL_CHANNELS);
-            cu->numChanInuse = 0;
-            memset(cu->clients, 0, sizeof(uint64_t) * XRM_MAX_KERNEL_CHANNELS);
-            cu->numClient = 0;
-            cu->totalUsedLoadUnified = 0; // will set dev load when numCu is set
-            cu->totalReservedLoadUnified = 0;
-            cu->totalReservedUsedLoadUnified = 0;
-            memset(cu->reserves, 0, sizeof(reserveData) * XRM_MAX_KERNEL_RESERVES);
-            cu->numReserve = 0;
-            cu->deviceId = devId;
-        }
+        std::vector<connectData>().swap(xclbinInfo->connectList);
+
+        // fresh the cuList, the cu with all the channels and reserves are freed
+        std::vector<cuData>().swap(xclbinInfo->cuList);
+        std::vector<cuHotData>().swap(xclbinInfo->cuHot);
     }
 }
 
@@ -831,6 +930,19 @@ int32_t xrm::system::xclbinReadFile(int32_t devId, std::string& name, std::strin
         errmsg = "device id " + std::to_string(devId) + " is not found";
         return (XRM_ERROR_INVALID);
     }
+#ifdef XRM_SIM_DEVICE
+    /* the simulated xclbin file is not read, the buffer keeps the name to look up the description */
+    if (xrm::sim::findXclbin(name) == NULL) {
+        errmsg = "xclbin file " + name + " is not described for simulated devices";
+        return (XRM_ERROR);
+    }
+    m_devList[devId].memBuffer = strdup(name.c_str());
+    if (m_devList[devId].memBuffer == NULL) {
+        errmsg = "Failed to alloce buffer for xclbin file " + name;
+        return (XRM_ERROR);
+    }
+    return (XRM_SUCCESS);
+#endif
     std::ifstream file(name.c_str(), std::ios::binary | std::ios::ate);
     if (!file.good()) {
         errmsg = "Failed to open xclbin file " + name;
@@ -859,11 +971,15 @@ int32_t xrm::system::xclbinGetInfo(int32_t devId, std::string& errmsg) {
         return (XRM_ERROR_INVALID);
     }
 
+#ifdef XRM_SIM_DEVICE
+    if (xclbinGetSimLayout(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
+#else
     if (xclbinGetLayout(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
     if (xclbinGetUuid(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
     if (xclbinGetMemTopology(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
     if (xclbinGetConnectivity(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
     if (xclbinGetKeyvalues(devId, errmsg) != XRM_SUCCESS) return (XRM_ERROR);
+#endif
     xclbinInformation* xclbinInfo = &m_devList[devId].xclbinInfo;
     for (int32_t cuIdx = 0; cuIdx < xclbinInfo->numCu; cuIdx++) {
         for (int32_t connectIdx = 0; connectIdx < xclbinInfo->numConnect; connectIdx++) {
@@ -912,6 +1028,7 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
                 errmsg = "cu number in xclbin is out range of " + std::to_string(XRM_MAX_XILINX_KERNELS);
                 return (XRM_ERROR);
             }
+            if (xclbinInfo->cuList.size() < (size_t)xclbinInfo->numCu) cuListResize(xclbinInfo, xclbinInfo->numCu);
             /* For hardware kernel, here should use the XRT interface to retrive cuId. */
             cuName = std::string((char*)ipl->m_ip_data[i].m_name);
             logMsg(XRM_LOG_NOTICE, "%s : cuName is %s\n", __func__, cuName.c_str());
@@ -930,6 +1047,11 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
                 }
             } else {
                 // the function in XRT lib is implemented, return result is good
+                if (cuId >= XRM_MAX_XILINX_KERNELS) {
+                    errmsg = "cu id of " + cuName + " is out range of " + std::to_string(XRM_MAX_XILINX_KERNELS);
+                    return (XRM_ERROR);
+                }
+                if (xclbinInfo->cuList.size() <= (size_t)cuId) cuListResize(xclbinInfo, cuId + 1);
                 cu = &xclbinInfo->cuList[cuId];
                 logMsg(XRM_LOG_NOTICE, "%s : cu id of %s is %d\n", __func__, cuName.c_str(), cuId);
                 cu->cuId = cuId;
@@ -947,12 +1069,13 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
             cu->instanceName = instanceName;
             cu->baseAddr = ipl->m_ip_data[i].m_base_address;
             cuInitChannels(cu);
-            cu->numClient = 0;
-            cu->totalUsedLoadUnified = 0; // update dev load at end of loop
-            cu->totalReservedLoadUnified = 0;
-            cu->totalReservedUsedLoadUnified = 0;
-            memset(cu->reserves, 0, sizeof(reserveData) * XRM_MAX_KERNEL_RESERVES);
-            cu->numReserve = 0;
+            cu->clients.clear();
+            cu->hot->numClient = 0;
+            cu->hot->totalUsedLoadUnified = 0; // update dev load at end of loop
+            cu->hot->totalReservedLoadUnified = 0;
+            cu->hot->totalReservedUsedLoadUnified = 0;
+            cu->reserves.clear();
+            cu->hot->numReserve = 0;
             cu->deviceId = devId;
             hardwareKernelExisting = true;
         } // end of hardware kernel handling
@@ -971,6 +1094,8 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
                 return (XRM_ERROR);
             }
 
+            if (xclbinInfo->cuList.size() < (size_t)(xclbinInfo->numCu + sk->m_num_instances))
+                cuListResize(xclbinInfo, xclbinInfo->numCu + sk->m_num_instances);
             for (uint32_t i = 0; i < sk->m_num_instances; i++) {
                 xclbinInfo->numCu++;
                 xclbinInfo->numSoftwareCu++;
@@ -986,12 +1111,13 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
                 cu->cuName = cu->kernelName;
                 logMsg(XRM_LOG_NOTICE, "%s soft kernel name: %s\n", __func__, cu->kernelName.c_str());
                 cuInitChannels(cu);
-                cu->numClient = 0;
-                cu->totalUsedLoadUnified = 0;
-                cu->totalReservedLoadUnified = 0;
-                cu->totalReservedUsedLoadUnified = 0;
-                memset(cu->reserves, 0, sizeof(reserveData) * XRM_MAX_KERNEL_RESERVES);
-                cu->numReserve = 0;
+                cu->clients.clear();
+                cu->hot->numClient = 0;
+                cu->hot->totalUsedLoadUnified = 0;
+                cu->hot->totalReservedLoadUnified = 0;
+                cu->hot->totalReservedUsedLoadUnified = 0;
+                cu->reserves.clear();
+                cu->hot->numReserve = 0;
                 cu->deviceId = devId;
             }
         } // end of soft kernel handling
@@ -1006,24 +1132,103 @@ int32_t xrm::system::xclbinGetLayout(int32_t devId, std::string& errmsg) {
     }
 }
 
+#ifdef XRM_SIM_DEVICE
+/*
+ * Gets the cu list and uuid of the simulated xclbin from the device description, the key
+ * values are given with the kernel. There is no memory topology or connectivity.
+ */
+int32_t xrm::system::xclbinGetSimLayout(int32_t devId, std::string& errmsg) {
+    if (devId < 0 || devId >= m_numDevice) {
+        errmsg = "device id " + std::to_string(devId) + " is not found";
+        return (XRM_ERROR_INVALID);
+    }
+
+    bool hardwareKernelExisting = false;
+    deviceData* dev = &m_devList[devId];
+    xclbinInformation* xclbinInfo = &dev->xclbinInfo;
+    const xrm::sim::simXclbin* simXclbin = xrm::sim::findXclbin(dev->memBuffer);
+    if (simXclbin == NULL) {
+        errmsg = "xclbin is not described for simulated devices";
+        return (XRM_ERROR);
+    }
+    xclbinInfo->numCu = 0;
+    xclbinInfo->numHardwareCu = 0;
+    xclbinInfo->numSoftwareCu = 0;
+    cuListResize(xclbinInfo, simXclbin->cuList.size());
+    for (const auto& simCu : simXclbin->cuList) {
+        cuData* cu = &xclbinInfo->cuList[xclbinInfo->numCu];
+        cu->cuId = xclbinInfo->numCu;
+        cu->ipLayoutIndex = xclbinInfo->numCu;
+        cu->kernelName = simCu.kernelName;
+        if (simCu.isSoftKernel) {
+            cu->cuType = CU_SOFTKERNEL;
+            cu->cuName = cu->kernelName;
+            xclbinInfo->numSoftwareCu++;
+        } else {
+            cu->cuType = CU_IPKERNEL;
+            cu->cuName = simCu.kernelName + ":" + simCu.instanceName;
+            cu->instanceName = simCu.instanceName;
+            xclbinInfo->numHardwareCu++;
+            hardwareKernelExisting = true;
+        }
+        cu->kernelAlias = simCu.kernelAlias;
+        cu->kernelPluginFileName = simCu.kernelPluginFileName;
+        cu->maxCapacity = simCu.maxCapacity;
+        cu->baseAddr = simCu.baseAddr;
+        cuInitChannels(cu);
+        cu->clients.clear();
+        cu->hot->numClient = 0;
+        cu->hot->totalUsedLoadUnified = 0;
+        cu->hot->totalReservedLoadUnified = 0;
+        cu->hot->totalReservedUsedLoadUnified = 0;
+        cu->reserves.clear();
+        cu->hot->numReserve = 0;
+        cu->deviceId = devId;
+        xclbinInfo->numCu++;
+        logMsg(XRM_LOG_NOTICE, "%s : simulated cu %d is %s\n", __func__, cu->cuId, cu->cuName.c_str());
+    }
+    uuid_copy(xclbinInfo->uuid, simXclbin->uuid);
+    binToHexstr((unsigned char*)&xclbinInfo->uuid, sizeof(uuid_t), xclbinInfo->uuidStr);
+    updateDeviceLoad(devId, 0, 0);
+    /* the xclbin should contain at least one hardware kernel */
+    if (hardwareKernelExisting) {
+        return (XRM_SUCCESS);
+    } else {
+        errmsg = "No hardware kernel existing in xclbin";
+        return (XRM_ERROR);
+    }
+}
+#endif
+
+/*
+ * Resizes the cu list and the hot data of the cu together, then points each cu at its hot
+ * data since the hot data may be moved.
+ */
+void xrm::system::cuListResize(xclbinInformation* xclbinInfo, size_t numCu) {
+    xclbinInfo->cuList.resize(numCu);
+    xclbinInfo->cuHot.resize(numCu);
+    for (size_t i = 0; i < numCu; i++) xclbinInfo->cuList[i].hot = &xclbinInfo->cuHot[i];
+}
+
+/*
+ * Frees all the channels of the cu. The channel not in use is always cleared, so only the
+ * channels in use are touched.
+ */
 void xrm::system::cuInitChannels(cuData* cu) {
-    int32_t i;
+    int32_t w;
 
     if (cu == NULL) {
         logMsg(XRM_LOG_ERROR, "%s : init channels, the cu is NULL\n", __func__);
         return;
     }
 
-    for (i = 0; i < XRM_MAX_KERNEL_CHANNELS; i++) {
-        cu->channels[i].channelId = i;
-        cu->channels[i].allocServiceId = 0;
-        cu->channels[i].poolId = 0;
-        cu->channels[i].clientId = 0;
-        cu->channels[i].clientProcessId = 0;
-        cu->channels[i].channelLoadUnified = 0;
-        cu->channels[i].channelLoadOriginal = 0;
+    for (w = 0; w < XRM_CHAN_BITMAP_WORDS; w++) {
+        while (cu->chanInuseMap[w]) cuFreeChannel(cu, w * 64 + __builtin_ctzll(cu->chanInuseMap[w]));
     }
-    cu->numChanInuse = 0;
+    cu->chanFullMap = 0;
+    cu->hot->numChanInuse = 0;
+    cu->channels.clear();
+    cu->clientChanNum.clear();
 }
 
 /*
@@ -1031,21 +1236,254 @@ void xrm::system::cuInitChannels(cuData* cu) {
  *    : -1, no free channel
  */
 int32_t xrm::system::cuFindFreeChannelId(cuData* cu) {
-    int32_t i;
-    int32_t ret = -1;
+    int32_t w, chanId;
 
-    if (cu == NULL) return (ret);
+    if (cu == NULL) return (-1);
 
-    if (cu->numChanInuse >= XRM_MAX_KERNEL_CHANNELS) return (ret);
+    if (cu->hot->numChanInuse >= XRM_MAX_KERNEL_CHANNELS) return (-1);
 
-    for (i = 0; i < XRM_MAX_KERNEL_CHANNELS; i++) {
-        /* channelLoadUnified is 0, clientId are also 0 */
-        if (cu->channels[i].channelLoadUnified == 0) {
-            ret = i;
-            break;
+    /* first word with free channel, then first free channel in the word */
+    uint64_t notFullMap = ~cu->chanFullMap;
+    if (XRM_CHAN_BITMAP_WORDS < 64) notFullMap &= ((uint64_t)1 << (XRM_CHAN_BITMAP_WORDS % 64)) - 1;
+    if (notFullMap == 0) return (-1);
+    w = __builtin_ctzll(notFullMap);
+    chanId = w * 64 + __builtin_ctzll(~cu->chanInuseMap[w]);
+    if (chanId >= XRM_MAX_KERNEL_CHANNELS) return (-1);
+    return (chanId);
+}
+
+/*
+ * Marks the free channel as in use by the client with the alloc service id, the caller
+ * fills in the other channel data.
+ */
+void xrm::system::cuSetChannelInuse(cuData* cu, int32_t chanId, uint64_t clientId, uint64_t allocServiceId) {
+    int32_t w = chanId / 64;
+
+    /* the last word may be partly used by the channels */
+    uint64_t fullMask = ~(uint64_t)0;
+    if (w == XRM_CHAN_BITMAP_WORDS - 1 && XRM_MAX_KERNEL_CHANNELS % 64)
+        fullMask = ((uint64_t)1 << (XRM_MAX_KERNEL_CHANNELS % 64)) - 1;
+
+    cu->chanInuseMap[w] |= (uint64_t)1 << (chanId % 64);
+    if (cu->chanInuseMap[w] == fullMask) cu->chanFullMap |= (uint64_t)1 << w;
+    if (cu->channels.size() <= (size_t)chanId) cu->channels.resize(chanId + 1);
+    cu->channels[chanId].channelId = chanId;
+    cu->channels[chanId].clientId = clientId;
+    cu->channels[chanId].allocServiceId = allocServiceId;
+    cu->hot->numChanInuse++;
+    m_devList[cu->deviceId].clientIndex[clientId].cuChans[cu->cuId].insert(chanId);
+    m_devList[cu->deviceId].allocIndex[allocServiceId].insert(std::make_pair(cu->cuId, chanId));
+    journalMarkChannel(cu, chanId);
+}
+
+/*
+ * Clears the channel data and marks the channel as free. The load accounting and the
+ * client of the channel are updated by caller.
+ */
+void xrm::system::cuFreeChannel(cuData* cu, int32_t chanId) {
+    int32_t w = chanId / 64;
+    uint64_t clientId = cu->channels[chanId].clientId;
+    deviceData* dev = &m_devList[cu->deviceId];
+
+    journalMarkChannel(cu, chanId);
+    auto allocIt = dev->allocIndex.find(cu->channels[chanId].allocServiceId);
+    if (allocIt != dev->allocIndex.end()) {
+        allocIt->second.erase(std::make_pair(cu->cuId, chanId));
+        if (allocIt->second.empty()) dev->allocIndex.erase(allocIt);
+    }
+    auto it = dev->clientIndex.find(clientId);
+    if (it != dev->clientIndex.end()) {
+        auto cuIt = it->second.cuChans.find(cu->cuId);
+        if (cuIt != it->second.cuChans.end()) {
+            cuIt->second.erase(chanId);
+            if (cuIt->second.empty()) it->second.cuChans.erase(cuIt);
         }
+        clientIndexTidy(cu->deviceId, clientId);
     }
-    return (ret);
+
+    cu->channels[chanId].allocServiceId = 0;
+    cu->channels[chanId].poolId = 0;
+    cu->channels[chanId].clientId = 0;
+    cu->channels[chanId].clientProcessId = 0;
+    cu->channels[chanId].channelLoadUnified = 0;
+    cu->channels[chanId].channelLoadOriginal = 0;
+    cu->chanInuseMap[w] &= ~((uint64_t)1 << (chanId % 64));
+    cu->chanFullMap &= ~((uint64_t)1 << w);
+    cu->hot->numChanInuse--;
+
+    /* drop the free channels at the end, the channel storage only covers the highest channel in use */
+    while (!cu->channels.empty()) {
+        chanId = cu->channels.size() - 1;
+        if (cu->chanInuseMap[chanId / 64] & ((uint64_t)1 << (chanId % 64))) break;
+        cu->channels.pop_back();
+    }
+}
+
+/*
+ * The channel bitmap and the channel number of the clients are not saved, rebuild them
+ * from the channel data after restore. The channel with load is in use.
+ */
+void xrm::system::cuRebuildChannelIndex(cuData* cu) {
+    int32_t chanId, i;
+
+    memset(cu->chanInuseMap, 0, sizeof(cu->chanInuseMap));
+    cu->chanFullMap = 0;
+    cu->clientChanNum.assign(cu->hot->numClient, 0);
+    cu->hot->numChanInuse = 0;
+    for (chanId = 0; chanId < (int32_t)cu->channels.size(); chanId++) {
+        if (cu->channels[chanId].channelLoadUnified == 0) continue;
+        cuSetChannelInuse(cu, chanId, cu->channels[chanId].clientId, cu->channels[chanId].allocServiceId);
+        i = isClientUsingCu(cu, cu->channels[chanId].clientId);
+        if (i >= 0) cu->clientChanNum[i]++;
+    }
+}
+
+/*
+ * Records the cu reserved by the client in the client index of the device.
+ */
+void xrm::system::clientIndexAddReserve(cuData* cu, uint64_t clientId) {
+    m_devList[cu->deviceId].clientIndex[clientId].reserveCus.insert(cu->cuId);
+}
+
+/*
+ * Removes the client from the client index of the device if it holds nothing on the device.
+ */
+void xrm::system::clientIndexTidy(int32_t devId, uint64_t clientId) {
+    deviceData* dev = &m_devList[devId];
+    auto it = dev->clientIndex.find(clientId);
+
+    if (it == dev->clientIndex.end()) return;
+    if (it->second.procIdx < 0 && it->second.cuChans.empty() && it->second.reserveCus.empty())
+        dev->clientIndex.erase(it);
+}
+
+/*
+ * The client index, the alloc index and the reserve index are not saved, rebuild them with
+ * the channel bitmap of the cu from the device data after restore.
+ */
+void xrm::system::rebuildDeviceIndex(int32_t devId) {
+    deviceData* dev = &m_devList[devId];
+    int32_t cuId, reserveIdx, pidIdx;
+
+    dev->clientIndex.clear();
+    dev->allocIndex.clear();
+    dev->reserveIndex.clear();
+    /* the hot data pointers are not saved */
+    cuListResize(&dev->xclbinInfo, dev->xclbinInfo.cuList.size());
+    for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        cuData* cu = &dev->xclbinInfo.cuList[cuId];
+        cu->deviceId = devId;
+        cuRebuildChannelIndex(cu);
+        for (reserveIdx = 0; reserveIdx < cu->hot->numReserve; reserveIdx++) {
+            dev->reserveIndex[cu->reserves[reserveIdx].reservePoolId][cuId] = reserveIdx;
+            if (cu->reserves[reserveIdx].clientIsActive) clientIndexAddReserve(cu, cu->reserves[reserveIdx].clientId);
+        }
+    }
+    for (pidIdx = 0; pidIdx < (int32_t)dev->clientProcs.size(); pidIdx++) {
+        if (dev->clientProcs[pidIdx].clientId) dev->clientIndex[dev->clientProcs[pidIdx].clientId].procIdx = pidIdx;
+    }
+}
+
+/*
+ * Adds the cu of the loaded device to the cu index, so the allocation only needs to go
+ * through the cu with requested name instead of all the cu on all the devices.
+ *
+ * call while holding lock
+ */
+void xrm::system::cuIndexAddDevice(int32_t devId) {
+    if (devId < 0 || devId >= m_numDevice) return;
+
+    cuIndexRemoveDevice(devId);
+    xclbinInformation* xclbinInfo = &m_devList[devId].xclbinInfo;
+    for (int32_t cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < xclbinInfo->numCu; cuId++) {
+        cuData* cu = &xclbinInfo->cuList[cuId];
+        cuIndexMap* indexes[] = {&m_kernelNameIndex, &m_kernelAliasIndex, &m_cuNameIndex};
+        std::string* names[] = {&cu->kernelName, &cu->kernelAlias, &cu->cuName};
+        for (int32_t i = 0; i < 3; i++) {
+            if (names[i]->empty()) continue;
+            cuIndexEntry& entry = (*indexes[i])[*names[i]];
+            entry.cuIds[devId].push_back(cuId);
+            entry.numCu++;
+        }
+    }
+}
+
+/*
+ * Removes the cu of the device from the cu index, called when device is unloaded.
+ *
+ * call while holding lock
+ */
+void xrm::system::cuIndexRemoveDevice(int32_t devId) {
+    if (devId < 0 || devId >= XRM_MAX_XILINX_DEVICES) return;
+
+    cuIndexMap* indexes[] = {&m_kernelNameIndex, &m_kernelAliasIndex, &m_cuNameIndex};
+    for (int32_t i = 0; i < 3; i++) {
+        for (auto it = indexes[i]->begin(); it != indexes[i]->end();) {
+            it->second.numCu -= it->second.cuIds[devId].size();
+            it->second.cuIds[devId].clear();
+            if (it->second.numCu <= 0)
+                it = indexes[i]->erase(it);
+            else
+                it++;
+        }
+    }
+}
+
+/*
+ * Finds the cu index entry of the requested cu. The cu name is the most selective one,
+ * then the kernel name and the kernel alias. The cu in the entry may still differ in the
+ * other names, check them with isCuMatching().
+ *
+ * return: the entry, NULL if there is no such cu on any device
+ */
+const xrm::cuIndexEntry* xrm::system::cuIndexFind(cuProperty* cuProp) {
+    cuIndexMap* index;
+    const char* name;
+
+    if (cuProp->cuName[0] != '\0') {
+        index = &m_cuNameIndex;
+        name = cuProp->cuName;
+    } else if (cuProp->kernelName[0] != '\0') {
+        index = &m_kernelNameIndex;
+        name = cuProp->kernelName;
+    } else if (cuProp->kernelAlias[0] != '\0') {
+        index = &m_kernelAliasIndex;
+        name = cuProp->kernelAlias;
+    } else {
+        return (NULL);
+    }
+    auto it = index->find(name);
+    if (it == index->end()) return (NULL);
+    return (&it->second);
+}
+
+/*
+ * return: the first cu of the entry in order of device id and cu id, NULL if entry is empty
+ */
+xrm::cuData* xrm::system::cuIndexFirstCu(const cuIndexEntry* entry) {
+    if (entry == NULL) return (NULL);
+    for (int32_t devId = 0; devId < m_numDevice; devId++) {
+        if (!entry->cuIds[devId].empty()) return (&m_devList[devId].xclbinInfo.cuList[entry->cuIds[devId][0]]);
+    }
+    return (NULL);
+}
+
+/*
+ * Checks the cu against the requested kernel name, kernel alias and cu name, the one
+ * not presented in request is not compared.
+ */
+bool xrm::system::isCuMatching(cuData* cu, cuProperty* cuProp) {
+    /* compare, 0: equal */
+    if (cuProp->kernelName[0] != '\0') {
+        if (cu->kernelName.compare(cuProp->kernelName)) return (false);
+    }
+    if (cuProp->kernelAlias[0] != '\0') {
+        if (cu->kernelAlias.compare(cuProp->kernelAlias)) return (false);
+    }
+    if (cuProp->cuName[0] != '\0') {
+        if (cu->cuName.compare(cuProp->cuName)) return (false);
+    }
+    return (true);
 }
 
 /*
@@ -1211,7 +1649,12 @@ int32_t xrm::system::xclbinGetConnectivity(int32_t devId, std::string& errmsg) {
     if (ipHdr) {
         char* data = &buffer[ipHdr->m_sectionOffset];
         const connectivity* axlfConn = reinterpret_cast<connectivity*>(data);
+        if (axlfConn->m_count > XRM_MAX_CONNECTION_ENTRIES) {
+            errmsg = "connection number in xclbin is out range of " + std::to_string(XRM_MAX_CONNECTION_ENTRIES);
+            return (XRM_ERROR);
+        }
         dev->xclbinInfo.numConnect = axlfConn->m_count;
+        dev->xclbinInfo.connectList.resize(dev->xclbinInfo.numConnect);
         logMsg(XRM_LOG_NOTICE, "CONNECTIVITY - %d connections\n", dev->xclbinInfo.numConnect);
         for (int i = 0; i < axlfConn->m_count; i++) {
             connectData* conn = &dev->xclbinInfo.connectList[i];
@@ -1245,8 +1688,13 @@ int32_t xrm::system::xclbinLoadToDevice(int32_t devId, std::string& errmsg) {
         errmsg = "Failed to lock device " + std::to_string(devId);
         return (rc);
     }
+#ifdef XRM_SIM_DEVICE
+    rc = xrm::sim::loadXclbin(deviceHandle, buffer);
+    if (rc != 0) errmsg = "simulated xclbin load failed, rc = " + std::to_string(rc);
+#else
     rc = xclLoadXclBin(deviceHandle, (const xclBin*)buffer);
     if (rc != 0) errmsg = "xclLoadXclBin failed, rc = " + std::to_string(rc);
+#endif
     wrapUnlockDevice(deviceHandle);
     return (rc);
 }
@@ -1263,7 +1711,12 @@ int32_t xrm::system::deviceLockXclbin(int32_t devId) {
     /* To use xclOpenContext() with ipIndex as -1 to ocupie the resouce so that xclLoadXclBin()
      * can NOT load new xclbin to replace current loaded xclbin.
      */
+#ifdef XRM_SIM_DEVICE
+    std::ignore = xclbinInfo;
+    ret = xrm::sim::openContext(dev->deviceHandle);
+#else
     ret = xclOpenContext(dev->deviceHandle, xclbinInfo->uuid, -1, true);
+#endif
     if (ret != 0) {
         logMsg(XRM_LOG_ERROR, "%s Failed to lock down xclbin to device %d", __func__, devId);
         return (ret);
@@ -1285,7 +1738,12 @@ int32_t xrm::system::deviceUnlockXclbin(int32_t devId) {
     /* To use xclCloseContext() with ipIndex as -1 to release the resouce so that xclLoadXclBin()
      * can load new xclbin to replace current loaded xclbin.
      */
+#ifdef XRM_SIM_DEVICE
+    std::ignore = xclbinInfo;
+    ret = xrm::sim::closeContext(dev->deviceHandle);
+#else
     ret = xclCloseContext(dev->deviceHandle, xclbinInfo->uuid, -1);
+#endif
     if (ret != 0) {
         logMsg(XRM_LOG_ERROR, "%s Failed to unlock xclbin from device %d", __func__, devId);
         return (ret);
@@ -1306,7 +1764,7 @@ void xrm::system::deviceDumpResource(int32_t devId) {
     if (!dev->isLoaded) return;
     logMsg(XRM_LOG_NOTICE, "%s(): uuid : %s", __func__, xclbinInfo->uuidStr.c_str());
 #if 0
-    for (i = 0; i < XRM_MAX_DEV_CLIENTS; i++)
+    for (i = 0; i < dev->clientProcs.size(); i++)
     {
         logMsg(XRM_LOG_NOTICE, "%s() dev[%d] clientProcs[%d] : clientId: %lu, ref: %d",
                __func__, devId, i, dev->clientProcs[i].clientId,
@@ -1332,13 +1790,14 @@ void xrm::system::deviceDumpResource(int32_t devId) {
         logMsg(XRM_LOG_NOTICE, "%s() cu : membankBaseAddr :%lu", __func__, cu->membankBaseAddr);
         logMsg(XRM_LOG_NOTICE, "%s() cu : kernelPluginFileName :%s", __func__, cu->kernelPluginFileName.c_str());
         logMsg(XRM_LOG_NOTICE, "%s() cu : maxCapacity :%lu", __func__, cu->maxCapacity);
-        logMsg(XRM_LOG_NOTICE, "%s() cu : numChanInuse :%d", __func__, cu->numChanInuse);
-        logMsg(XRM_LOG_NOTICE, "%s() cu : numReserve :%d", __func__, cu->numReserve);
-        logMsg(XRM_LOG_NOTICE, "%s() cu : totalUsedLoadUnified :%d", __func__, cu->totalUsedLoadUnified);
-        logMsg(XRM_LOG_NOTICE, "%s() cu : totalReservedLoadUnified :%d", __func__, cu->totalReservedLoadUnified);
-        for (j = 0; j < XRM_MAX_KERNEL_CHANNELS; j++) {
+        logMsg(XRM_LOG_NOTICE, "%s() cu : numChanInuse :%d", __func__, cu->hot->numChanInuse);
+        logMsg(XRM_LOG_NOTICE, "%s() cu : numReserve :%d", __func__, cu->hot->numReserve);
+        logMsg(XRM_LOG_NOTICE, "%s() cu : totalUsedLoadUnified :%d", __func__, cu->hot->totalUsedLoadUnified);
+        logMsg(XRM_LOG_NOTICE, "%s() cu : totalReservedLoadUnified :%d", __func__, cu->hot->totalReservedLoadUnified);
+        for (j = 0; j < cu->hot->numClient; j++)
+            logMsg(XRM_LOG_NOTICE, "%s() cu : clients[%d] : %lu", __func__, j, cu->clients[j]);
+        for (j = 0; j < (int32_t)cu->channels.size(); j++) {
             channelData* chan = &cu->channels[j];
-            logMsg(XRM_LOG_NOTICE, "%s() cu : clients[%d] : %d", __func__, j, cu->clients[j]);
             logMsg(XRM_LOG_NOTICE, "%s() cu : channels[%d] channelId: %d", __func__, j, chan->channelId);
             logMsg(XRM_LOG_NOTICE, "%s() cu : channels[%d] allocServiceId: %lu", __func__, j, chan->allocServiceId);
             logMsg(XRM_LOG_NOTICE, "%s() cu : channels[%d] poolId: %lu", __func__, j, chan->poolId);
@@ -1349,22 +1808,22 @@ void xrm::system::deviceDumpResource(int32_t devId) {
             logMsg(XRM_LOG_NOTICE, "%s() cu : channels[%d] channelLoadOriginal: %d", __func__, j,
                    chan->channelLoadOriginal);
         }
-        cu->totalReservedUsedLoadUnified = 0;
-        for (j = 0; j < XRM_MAX_KERNEL_RESERVES; j++) {
+        cu->hot->totalReservedUsedLoadUnified = 0;
+        for (j = 0; j < cu->hot->numReserve; j++) {
             reserveData* reserve = &cu->reserves[j];
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] reservePoolId: %lu", __func__, j, reserve->reservePoolId);
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] reserveLoadUnified: %d", __func__, j,
                    reserve->reserveLoadUnified);
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] reserveUsedLoadUnified: %d", __func__, j,
                    reserve->reserveUsedLoadUnified);
-            cu->totalReservedUsedLoadUnified += reserve->reserveUsedLoadUnified;
+            cu->hot->totalReservedUsedLoadUnified += reserve->reserveUsedLoadUnified;
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] clientIsActive: %d", __func__, j, reserve->clientIsActive);
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] clientId: %lu", __func__, j, reserve->clientId);
             logMsg(XRM_LOG_NOTICE, "%s() cu : reserves[%d] clientProcessId: %lu", __func__, j,
                    reserve->clientProcessId);
         }
         logMsg(XRM_LOG_NOTICE, "%s() cu : totalReservedUsedLoadUnified :%d", __func__,
-               cu->totalReservedUsedLoadUnified);
+               cu->hot->totalReservedUsedLoadUnified);
     }
 }
 
@@ -1382,10 +1841,7 @@ uint64_t xrm::system::getCuMaxCapacity(cuProperty* cuProp) {
     uint64_t maxCapacityWithAlias = 0;
     std::string name = cuProp->kernelName;
     std::string alias = cuProp->kernelAlias;
-    deviceData* dev;
     cuData* cu;
-    int32_t devId, cuId;
-    bool found;
 
     if ((name[0] == '\0') && (alias[0] == '\0')) {
         logMsg(XRM_LOG_ERROR, "%s : neither name nor alias are presented", __func__);
@@ -1394,22 +1850,10 @@ uint64_t xrm::system::getCuMaxCapacity(cuProperty* cuProp) {
 
     if (name[0] != '\0') {
         /* kernel name is presented */
-        found = false;
-        for (devId = 0; devId < m_numDevice; devId++) {
-            dev = &m_devList[devId];
-            if (dev->isLoaded) {
-                for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
-                    cu = &dev->xclbinInfo.cuList[cuId];
-                    if (name.compare(cu->kernelName.c_str()) == 0) {
-                        found = true;
-                        maxCapacity = cu->maxCapacity;
-                        break;
-                    }
-                }
-            }
-            if (found) break;
-        }
-        if (found) {
+        auto it = m_kernelNameIndex.find(name);
+        cu = (it == m_kernelNameIndex.end()) ? NULL : cuIndexFirstCu(&it->second);
+        if (cu != NULL) {
+            maxCapacity = cu->maxCapacity;
             logMsg(XRM_LOG_NOTICE, "%s : maxCapacity with name is %lu", __func__, maxCapacity);
         } else {
             logMsg(XRM_LOG_NOTICE, "%s : cu name%s not found", __func__, name.c_str());
@@ -1417,22 +1861,10 @@ uint64_t xrm::system::getCuMaxCapacity(cuProperty* cuProp) {
 
         /* kernel alias is also presented */
         if (alias[0] != '\0') {
-            found = false;
-            for (devId = 0; devId < m_numDevice; devId++) {
-                dev = &m_devList[devId];
-                if (dev->isLoaded) {
-                    for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
-                        cu = &dev->xclbinInfo.cuList[cuId];
-                        if (alias.compare(cu->kernelAlias.c_str()) == 0) {
-                            found = true;
-                            maxCapacityWithAlias = cu->maxCapacity;
-                            break;
-                        }
-                    }
-                }
-                if (found) break;
-            }
-            if (found) {
+            it = m_kernelAliasIndex.find(alias);
+            cu = (it == m_kernelAliasIndex.end()) ? NULL : cuIndexFirstCu(&it->second);
+            if (cu != NULL) {
+                maxCapacityWithAlias = cu->maxCapacity;
                 logMsg(XRM_LOG_NOTICE, "%s : maxCapacity with alias is %lu", __func__, maxCapacityWithAlias);
             } else {
                 logMsg(XRM_LOG_NOTICE, "%s : cu alias%s not found", __func__, alias.c_str());
@@ -1446,22 +1878,10 @@ uint64_t xrm::system::getCuMaxCapacity(cuProperty* cuProp) {
     } else // alias[0] != '\0'
     {
         /* kernel alias is presented */
-        found = false;
-        for (devId = 0; devId < m_numDevice; devId++) {
-            dev = &m_devList[devId];
-            if (dev->isLoaded) {
-                for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
-                    cu = &dev->xclbinInfo.cuList[cuId];
-                    if (alias.compare(cu->kernelAlias.c_str()) == 0) {
-                        found = true;
-                        maxCapacityWithAlias = cu->maxCapacity;
-                        break;
-                    }
-                }
-            }
-            if (found) break;
-        }
-        if (found) {
+        auto it = m_kernelAliasIndex.find(alias);
+        cu = (it == m_kernelAliasIndex.end()) ? NULL : cuIndexFirstCu(&it->second);
+        if (cu != NULL) {
+            maxCapacityWithAlias = cu->maxCapacity;
             logMsg(XRM_LOG_NOTICE, "%s : maxCapacity with alias is %lu", __func__, maxCapacityWithAlias);
         } else {
             logMsg(XRM_LOG_NOTICE, "%s : cu alias%s not found", __func__, alias.c_str());
@@ -1473,111 +1893,1022 @@ uint64_t xrm::system::getCuMaxCapacity(cuProperty* cuProp) {
 }
 
 void xrm::system::initLock() {
-    pthread_mutex_init(&m_lock, NULL);
+    pthread_mutexattr_t attr;
+    pthread_rwlockattr_t rwAttr;
+
+    /*
+     * the default rwlock prefers readers, the steady allocation traffic would starve the
+     * exclusive operations; the shared lock is never taken recursively, see below
+     */
+    pthread_rwlockattr_init(&rwAttr);
+    pthread_rwlockattr_setkind_np(&rwAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&m_lock, &rwAttr);
+    pthread_rwlockattr_destroy(&rwAttr);
+    /* device lock is recursive, so list allocation can call single cu allocation while holding it */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    for (int32_t devId = 0; devId < XRM_MAX_XILINX_DEVICES; devId++) pthread_mutex_init(&m_devLocks[devId], &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&m_counterLock, NULL);
+    pthread_mutex_init(&m_snapshotLock, NULL);
 }
 
 /*
- * Considering the xrmadm cli and xrm lib are using asio to do the IPC with xrmd deamon,
- * So the daemon is running as a single process there is no need to use lock in xrmd
- * daemon to protect the resource pool data.
+ * The daemon serves requests from several io threads, the resource pool is protected by:
+ *
+ * 1) system lock: enterLock() takes it exclusively, for the operations which change the
+ *    device list (load, unload, enable, disable, reset), the udf cu groups, the plugins or
+ *    the reserve pools, and for the operations walking through all the data (list, query).
+ *    enterSharedLock() takes it shared, for cu allocation, release, status check and
+ *    resource recycle, which only change the cu data of the devices. A waiting exclusive
+ *    taker blocks new shared takers, so the shared lock must not be taken recursively.
+ * 2) device lock: while holding the shared system lock, the cu data of one device is only
+ *    changed under the lock of that device. Single cu allocation holds at most one device
+ *    lock at any time; list allocation and allocation by policy compare devices, so they
+ *    take the locks of all devices in ascending device id order. So allocations on
+ *    different devices run in parallel and there is no lock order inversion.
+ * 3) counter lock: the client id, concurrent client number, allocation service id and the
+ *    device load order, it's the innermost lock.
+ * 4) snapshot lock: held while taking a snapshot, after the system lock and before the
+ *    device locks. The background snapshot keeps it after the system lock is released,
+ *    until the child writing the snapshot exits.
+ *
+ * The changes made under a device lock are appended to the journal when the device is
+ * unlocked, the changes made under the exclusive system lock when it's released.
  */
 void xrm::system::enterLock() {
-#if 1
-    pthread_mutex_lock(&m_lock);
-#endif
+    if (m_metrics == NULL) {
+        pthread_rwlock_wrlock(&m_lock);
+        return;
+    }
+    uint64_t startTime = metricsNowUs();
+    pthread_rwlock_wrlock(&m_lock);
+    m_lockHeldSince = metricsNowUs();
+    m_metrics->observeLockWait(metrics::LOCK_EXCLUSIVE, m_lockHeldSince - startTime);
 }
 
 void xrm::system::exitLock() {
-#if 1
-    pthread_mutex_unlock(&m_lock);
-#endif
+    for (int32_t devId = 0; devId < m_numDevice; devId++) journalFlushDevice(devId);
+    if (m_metrics != NULL) m_metrics->observeLockHold(metrics::LOCK_EXCLUSIVE, metricsNowUs() - m_lockHeldSince);
+    pthread_rwlock_unlock(&m_lock);
+}
+
+/* time the calling thread took the shared system lock */
+static thread_local uint64_t sharedLockHeldSince = 0;
+
+void xrm::system::enterSharedLock() {
+    if (m_metrics == NULL) {
+        pthread_rwlock_rdlock(&m_lock);
+        return;
+    }
+    uint64_t startTime = metricsNowUs();
+    pthread_rwlock_rdlock(&m_lock);
+    sharedLockHeldSince = metricsNowUs();
+    m_metrics->observeLockWait(metrics::LOCK_SHARED, sharedLockHeldSince - startTime);
+}
+
+void xrm::system::exitSharedLock() {
+    if (m_metrics != NULL) m_metrics->observeLockHold(metrics::LOCK_SHARED, metricsNowUs() - sharedLockHeldSince);
+    pthread_rwlock_unlock(&m_lock);
 }
 
-inline void xrm::system::save() {
-    std::string fname = "/dev/shm/xrm.data";
-    /* create and open the character archive for output */
-    std::ofstream ofs(fname.c_str());
-    /* write class instance to archive */
-    boost::archive::text_oarchive ar(ofs);
-    ar&* this;
+void xrm::system::lockDevice(int32_t devId) {
+    if (devId < 0 || devId >= XRM_MAX_XILINX_DEVICES) return;
+    pthread_mutex_lock(&m_devLocks[devId]);
+}
+
+void xrm::system::unlockDevice(int32_t devId) {
+    if (devId < 0 || devId >= XRM_MAX_XILINX_DEVICES) return;
+    journalFlushDevice(devId);
+    pthread_mutex_unlock(&m_devLocks[devId]);
 }
 
 /*
- * call while holding lock
+ * Locks all devices in ascending device id order, unlock in reverse order.
  */
-bool xrm::system::restore() {
-    bool rc = false;
-
-    std::string fname = "/dev/shm/xrm.data";
-    /* create and open the archive for input */
-    std::ifstream ifs(fname.c_str());
-    if (ifs.is_open()) {
-        logMsg(XRM_LOG_NOTICE, "Database found, reloading daemon");
-        /* read class from archive */
-        boost::archive::text_iarchive ar(ifs);
-        ar&* this;
-        initConfig();
-        initLibVersionDepFunctions();
-        for (int32_t devId = 0; devId < m_numDevice; devId++) {
-            if (!m_devList[devId].isDisabled) openDevice(devId);
-        }
-        rc = true;
-    } else
-        logMsg(XRM_LOG_NOTICE, "No database found, starting from fresh state");
-
-    return (rc);
+void xrm::system::lockAllDevices() {
+    for (int32_t devId = 0; devId < XRM_MAX_XILINX_DEVICES; devId++) pthread_mutex_lock(&m_devLocks[devId]);
 }
 
-/* input parameters valid check need to be done before the calling */
-bool xrm::system::isDeviceLoaded(int32_t devId) {
-    if (devId >= 0 && devId < m_numDevice) {
-        deviceData* dev = &m_devList[devId];
-        return (dev->isLoaded);
-    } else {
-        return (false);
+void xrm::system::unlockAllDevices() {
+    for (int32_t devId = XRM_MAX_XILINX_DEVICES - 1; devId >= 0; devId--) {
+        journalFlushDevice(devId);
+        pthread_mutex_unlock(&m_devLocks[devId]);
     }
 }
 
-/* input parameters valid check need to be done before the calling */
-bool xrm::system::isDeviceLoadedXclbinWithUuid(int32_t devId, uuid_t uuid) {
-    if (devId >= 0 && devId < m_numDevice) {
-        deviceData* dev = &m_devList[devId];
-        bool sameUuid = true;
-        size_t size = sizeof(uuid_t);
-        unsigned char* uuidOfDev = dev->xclbinInfo.uuid;
+static uint64_t monotonicUs() {
+    struct timespec now;
 
-        for (size_t i = 0; i < size; i++) {
-            if ((uint8_t)(uuidOfDev[i]) != (uint8_t)(uuid[i])) {
-                sameUuid = false;
-                break;
-            }
-        }
-        return (sameUuid);
-    } else {
-        return (false);
-    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
 }
 
-/* input parameters valid check need to be done before the calling */
-bool xrm::system::isDeviceBusy(int32_t devId) {
-    if (devId >= 0 && devId < m_numDevice) {
-        deviceData* dev = &m_devList[devId];
+/*
+ * Saves the state to the snapshot file when persistence is enabled. Only the state which
+ * can't be rebuilt is saved: the id counters, the loaded devices with the channels in use
+ * and the reserves of their cu, and the user defined cu groups. The changes made after the
+ * snapshot go to the journal, so the snapshot is only taken at start, and then by the
+ * snapshot thread when the journal has grown beyond journalCompactSize or every
+ * snapshotInterval seconds.
+ *
+ * Lock: should hold the system lock, shared or exclusive, and no device lock
+ */
+void xrm::system::save() {
+    if (!m_persistence) return;
 
-        for (int32_t cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
-            if (dev->xclbinInfo.cuList[cuId].totalUsedLoadUnified) return (true);
-        }
-        return (false);
-    } else {
+    pthread_mutex_lock(&m_snapshotLock);
+    saveSnapshot();
+    pthread_mutex_unlock(&m_snapshotLock);
+}
+
+/*
+ * The devices are only locked while the snapshot is put together in memory and the next
+ * journal file is started, so the snapshot and the journal file it names meet exactly. The
+ * file is written after the devices are unlocked, the journal files before the new one are
+ * removed once it's written. The snapshot is not written when the next journal file can't be
+ * started, the changes keep going to the current one.
+ *
+ * return: true written, false failed
+ *
+ * Lock: should hold the system lock and the snapshot lock, and no device lock
+ */
+bool xrm::system::saveSnapshot() {
+    snapshotWriter writer;
+    std::string errmsg;
+    uint64_t seq;
+    bool rotated;
+    uint64_t startTime = monotonicUs();
+    uint64_t stallTime;
+    {
+        deviceLockGuard devLock(this);
+        seq = m_journal.getSeq() + 1;
+        pthread_mutex_lock(&m_counterLock);
+        writer.put(m_clientId);
+        writer.put(m_allocServiceId);
+        writer.put(m_reservePoolId);
+        pthread_mutex_unlock(&m_counterLock);
+        writer.put(seq);
+        writer.put(m_numDevice);
+        for (int32_t devId = 0; devId < m_numDevice; devId++) snapshotPutDevice(writer, &m_devList[devId]);
+        snapshotPutUdfCuGroups(writer);
+        rotated = m_journal.rotate(seq, errmsg);
+    }
+    stallTime = monotonicUs() - startTime;
+    if (!rotated || !writer.writeFile(m_snapshotFileFullPathName, errmsg)) {
+        logMsg(XRM_LOG_ERROR, "%s : %s", __func__, errmsg.c_str());
+        updateSnapshotStats(false, monotonicUs() - startTime, stallTime);
         return (false);
     }
+    m_journal.removeBefore(seq);
+    updateSnapshotStats(true, monotonicUs() - startTime, stallTime);
+    return (true);
 }
 
 /*
- * the unload process should be protected by system lock
+ * Closes the fds the forked child inherits from the daemon, but keepFd and the standard ones.
+ * Otherwise the client sockets stay open in the child, a session closed by the daemon is not
+ * seen as closed by its client until the child exits; the listening sockets would also be
+ * kept. close_range() is used when the kernel has it, it doesn't allocate.
  */
-int32_t xrm::system::unloadOneDevice(const int32_t& devId, std::string& errmsg) {
-    /*
-     * XRM daemon may start before FPGA device ready during boot,
+static void closeInheritedFds(int keepFd) {
+#ifdef SYS_close_range
+    if ((keepFd == 3 || syscall(SYS_close_range, 3, keepFd - 1, 0) == 0) &&
+        syscall(SYS_close_range, keepFd + 1, ~0U, 0) == 0)
+        return;
+#endif
+    struct rlimit limit;
+    int maxFd = 1024;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) maxFd = (int)limit.rlim_cur;
+    for (int fd = 3; fd < maxFd; fd++)
+        if (fd != keepFd) close(fd);
+}
+
+/*
+ * Takes the snapshot in a forked child. The devices are only locked while the next journal
+ * file is started and the child is forked, the child has a copy-on-write image of the state
+ * at that moment, puts the snapshot together from it and writes the file while the daemon
+ * goes on with the allocations. The child only uses its own copy of the state and reports a
+ * failure through the pipe, it doesn't log as the syslog lock may be held by another thread
+ * at the fork. The child closes the fds inherited from the daemon first, see closeInheritedFds().
+ * When the child can't be forked the snapshot is taken by saveSnapshot(); when the next
+ * journal file can't be started no snapshot is taken.
+ *
+ * Lock: should hold no lock, the system lock is taken shared until the child is forked
+ */
+void xrm::system::saveSnapshotInChild() {
+    snapshotWriter writer;
+    std::string errmsg;
+    uint64_t seq;
+    uint64_t startTime;
+    uint64_t stallTime;
+    int pipeFds[2];
+    pid_t pid = -1;
+    bool rotated;
+
+    enterSharedLock();
+    pthread_mutex_lock(&m_snapshotLock);
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+        logMsg(XRM_LOG_ERROR, "%s : failed to create pipe: %s", __func__, strerror(errno));
+        saveSnapshot();
+        pthread_mutex_unlock(&m_snapshotLock);
+        exitSharedLock();
+        return;
+    }
+    startTime = monotonicUs();
+    {
+        deviceLockGuard devLock(this);
+        seq = m_journal.getSeq() + 1;
+        pthread_mutex_lock(&m_counterLock);
+        writer.put(m_clientId);
+        writer.put(m_allocServiceId);
+        writer.put(m_reservePoolId);
+        pthread_mutex_unlock(&m_counterLock);
+        rotated = m_journal.rotate(seq, errmsg);
+        if (rotated) pid = fork();
+        if (pid == 0) {
+            closeInheritedFds(pipeFds[1]);
+            writer.put(seq);
+            writer.put(m_numDevice);
+            for (int32_t devId = 0; devId < m_numDevice; devId++) snapshotPutDevice(writer, &m_devList[devId]);
+            snapshotPutUdfCuGroups(writer);
+            if (writer.writeFile(m_snapshotFileFullPathName, errmsg)) _exit(0);
+            ssize_t ret = write(pipeFds[1], errmsg.data(), errmsg.size());
+            std::ignore = ret;
+            _exit(1);
+        }
+    }
+    stallTime = monotonicUs() - startTime;
+    close(pipeFds[1]);
+    if (!rotated) {
+        logMsg(XRM_LOG_ERROR, "%s : %s", __func__, errmsg.c_str());
+        close(pipeFds[0]);
+        updateSnapshotStats(false, monotonicUs() - startTime, stallTime);
+        pthread_mutex_unlock(&m_snapshotLock);
+        exitSharedLock();
+        return;
+    }
+    if (pid < 0) {
+        logMsg(XRM_LOG_ERROR, "%s : failed to fork: %s", __func__, strerror(errno));
+        close(pipeFds[0]);
+        saveSnapshot();
+        pthread_mutex_unlock(&m_snapshotLock);
+        exitSharedLock();
+        return;
+    }
+    exitSharedLock();
+
+    char buf[512];
+    ssize_t len;
+    int status = 0;
+    errmsg.clear();
+    while ((len = read(pipeFds[0], buf, sizeof(buf))) != 0) {
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        errmsg.append(buf, len);
+    }
+    close(pipeFds[0]);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        m_journal.removeBefore(seq);
+        updateSnapshotStats(true, monotonicUs() - startTime, stallTime);
+    } else {
+        if (errmsg.empty()) errmsg = "snapshot child exited abnormally";
+        logMsg(XRM_LOG_ERROR, "%s : %s", __func__, errmsg.c_str());
+        updateSnapshotStats(false, monotonicUs() - startTime, stallTime);
+    }
+    pthread_mutex_unlock(&m_snapshotLock);
+}
+
+/*
+ * Lock: should not hold m_snapshotThreadLock
+ */
+void xrm::system::updateSnapshotStats(bool saved, uint64_t durationUs, uint64_t stallUs) {
+    std::lock_guard<std::mutex> guard(m_snapshotThreadLock);
+    snapshotStats* stats = &m_snapshotStats;
+    if (saved)
+        stats->numSnapshot++;
+    else
+        stats->numFailed++;
+    stats->lastDurationUs = durationUs;
+    stats->totalDurationUs += durationUs;
+    if (durationUs > stats->maxDurationUs) stats->maxDurationUs = durationUs;
+    stats->lastStallUs = stallUs;
+    stats->totalStallUs += stallUs;
+    if (stallUs > stats->maxStallUs) stats->maxStallUs = stallUs;
+    logMsg(XRM_LOG_INFO, "%s : snapshot %s in %lu us, devices locked for %lu us", __func__,
+           saved ? "saved" : "failed", durationUs, stallUs);
+}
+
+xrm::snapshotStats xrm::system::getSnapshotStats() {
+    std::lock_guard<std::mutex> guard(m_snapshotThreadLock);
+    return (m_snapshotStats);
+}
+
+/*
+ * Publishes the resource state for the metrics endpoint. The system lock is only taken
+ * shared and one device is locked at a time while its cu load is copied, the scrape reads
+ * the copy.
+ *
+ * Lock: should not hold any lock
+ */
+void xrm::system::publishMetrics() {
+    if (m_metrics == NULL) return;
+
+    std::shared_ptr<metricsResource> resource = std::make_shared<metricsResource>();
+    enterSharedLock();
+    resource->devices.resize(m_numDevice);
+    for (int32_t devId = 0; devId < m_numDevice; devId++) {
+        deviceLockGuard devLock(this, devId);
+        deviceData* dev = &m_devList[devId];
+        metricsDevice* devMetrics = &resource->devices[devId];
+        devMetrics->devId = devId;
+        devMetrics->isLoaded = dev->isLoaded;
+        devMetrics->isDisabled = dev->isDisabled;
+        if (!dev->isLoaded) continue;
+        devMetrics->cus.resize(dev->xclbinInfo.numCu);
+        for (int32_t cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+            cuData* cu = &dev->xclbinInfo.cuList[cuId];
+            metricsCuLoad* cuLoad = &devMetrics->cus[cuId];
+            cuLoad->cuName = cu->cuName;
+            cuLoad->usedLoad = cu->hot->totalUsedLoadUnified;
+            cuLoad->reservedLoad = cu->hot->totalReservedLoadUnified;
+            cuLoad->reservedUsedLoad = cu->hot->totalReservedUsedLoadUnified;
+            cuLoad->numChanInuse = cu->hot->numChanInuse;
+        }
+    }
+    exitSharedLock();
+    resource->numConcurrentClient = getNumConcurrentClient();
+    resource->persistence = m_persistence;
+    resource->snapshot = getSnapshotStats();
+    m_metrics->publishResource(resource);
+}
+
+/*
+ * The snapshot thread takes the snapshots after the one taken at start, so neither the
+ * responses nor the allocations wait for a snapshot to be written.
+ */
+void xrm::system::startSnapshotThread() {
+    if (!m_persistence || m_snapshotThread.joinable()) return;
+    m_snapshotThreadExit = false;
+    m_snapshotThread = std::thread(&xrm::system::snapshotThreadFunc, this);
+}
+
+void xrm::system::stopSnapshotThread() {
+    if (!m_snapshotThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(m_snapshotThreadLock);
+        m_snapshotThreadExit = true;
+    }
+    m_snapshotCond.notify_all();
+    m_snapshotThread.join();
+}
+
+/*
+ * Takes a snapshot when journalCommit() asks for one, or when snapshotInterval seconds have
+ * passed since the last one and the journal is not empty.
+ */
+void xrm::system::snapshotThreadFunc() {
+    std::unique_lock<std::mutex> guard(m_snapshotThreadLock);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(m_snapshotInterval);
+
+    while (!m_snapshotThreadExit) {
+        if (!m_snapshotRequested) {
+            if (m_snapshotInterval == 0)
+                m_snapshotCond.wait(guard);
+            else
+                m_snapshotCond.wait_until(guard, deadline);
+            if (m_snapshotThreadExit) break;
+            if (!m_snapshotRequested &&
+                (m_snapshotInterval == 0 || std::chrono::steady_clock::now() < deadline))
+                continue;
+        }
+        m_snapshotRequested = false;
+        guard.unlock();
+        if (!m_journal.isEmpty()) {
+            if (m_backgroundSnapshot) {
+                saveSnapshotInChild();
+            } else {
+                enterSharedLock();
+                save();
+                exitSharedLock();
+            }
+        }
+        guard.lock();
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(m_snapshotInterval);
+    }
+}
+
+/*
+ * Restores the state saved by save() with the journal replayed on top of it. Nothing is
+ * changed unless the whole snapshot is valid and it's taken on the same number of devices;
+ * the replay stops at the first record which can't be taken, the state is the one before
+ * that record.
+ *
+ * call while holding lock
+ */
+bool xrm::system::restore() {
+    snapshotReader reader;
+    std::string errmsg;
+    uint64_t clientId = 0, allocServiceId = 0, reservePoolId = 0, seq = 0;
+    int32_t numDevice = 0;
+
+    m_journal.init(m_journalFileFullPathName, m_journalSync, m_journalCompactSize);
+    int32_t ret = reader.readFile(m_snapshotFileFullPathName, errmsg);
+    if (ret == 0) {
+        logMsg(XRM_LOG_NOTICE, "No database found, starting from fresh state");
+        return (false);
+    }
+    if (ret < 0) {
+        logMsg(XRM_LOG_ERROR, "%s : %s, starting from fresh state", __func__, errmsg.c_str());
+        return (false);
+    }
+    logMsg(XRM_LOG_NOTICE, "Database found, reloading daemon");
+
+    reader.get(clientId);
+    reader.get(allocServiceId);
+    reader.get(reservePoolId);
+    reader.get(seq);
+    reader.get(numDevice);
+    if (reader.isGood() && numDevice > 0 && !m_devicesInited) initDevices();
+    if (!reader.isGood() || (numDevice > 0 && numDevice != m_numDevice)) {
+        logMsg(XRM_LOG_ERROR, "%s : snapshot of %d devices, %d devices found, starting from fresh state", __func__,
+               numDevice, m_numDevice);
+        return (false);
+    }
+    std::vector<deviceData> devices(numDevice);
+    for (int32_t devId = 0; devId < numDevice; devId++) {
+        if (!snapshotGetDevice(reader, &devices[devId])) break;
+    }
+    /* the udf cu groups are taken last, they are the only state changed before the check */
+    if (!reader.isGood() || !snapshotGetUdfCuGroups(reader) || !reader.isDone()) {
+        logMsg(XRM_LOG_ERROR, "%s : snapshot is corrupted, starting from fresh state", __func__);
+        initUdfCuGroups();
+        return (false);
+    }
+    int32_t numRecord = journalReplay(seq, devices);
+
+    /* the ids of this run are still above the ones of earlier runs */
+    m_clientId = std::max(clientId, m_clientIdBase);
+    m_allocServiceId = allocServiceId;
+    m_reservePoolId = reservePoolId;
+    for (int32_t devId = 0; devId < (int32_t)devices.size(); devId++) {
+        deviceData* dev = &m_devList[devId];
+        dev->isDisabled = devices[devId].isDisabled;
+        if (!devices[devId].isLoaded) continue;
+        dev->isLoaded = true;
+        dev->isExcl = devices[devId].isExcl;
+        dev->xclbinName = devices[devId].xclbinName;
+        dev->xclbinInfo = std::move(devices[devId].xclbinInfo);
+        dev->clientProcs = std::move(devices[devId].clientProcs);
+        cuIndexAddDevice(devId);
+        rebuildDeviceIndex(devId);
+        int64_t devLoad = 0;
+        for (int32_t cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+            cuData* cu = &dev->xclbinInfo.cuList[cuId];
+            devLoad += cu->hot->totalUsedLoadUnified;
+            /* the journal doesn't keep the id counters, the ids in use are given out again */
+            for (channelData& chan : cu->channels)
+                m_allocServiceId = std::max(m_allocServiceId, chan.allocServiceId);
+            for (int32_t i = 0; i < cu->hot->numReserve; i++)
+                m_reservePoolId = std::max(m_reservePoolId, cu->reserves[i].reservePoolId);
+        }
+        updateDeviceLoad(devId, 0, devLoad);
+        /* the restored state is already in the snapshot and the journal */
+        journalDiscardDevice(devId);
+        logMsg(XRM_LOG_NOTICE, "%s : device %d restored with %s", __func__, devId, dev->xclbinName.c_str());
+    }
+    logMsg(XRM_LOG_NOTICE, "%s : %d journal records replayed", __func__, numRecord);
+    return (true);
+}
+
+/*
+ * Replays the journal files from seq on top of the state taken from the snapshot, until a
+ * journal file is missing or a record can't be taken.
+ *
+ * ret: number of records replayed
+ */
+int32_t xrm::system::journalReplay(uint64_t seq, std::vector<deviceData>& devices) {
+    snapshotReader reader;
+    std::string errmsg;
+    int32_t numRecord = 0;
+
+    for (; seq <= m_journal.getSeq(); seq++) {
+        std::vector<std::string> records;
+        std::string fileName = journal::fileName(m_journalFileFullPathName, seq);
+        errmsg.clear();
+        int32_t ret = journal::readFile(fileName, records, errmsg);
+        if (ret == 0) {
+            logMsg(XRM_LOG_ERROR, "%s : %s is missing, the later journal files are not replayed", __func__,
+                   fileName.c_str());
+            break;
+        }
+        for (std::string& record : records) {
+            reader.assign(record);
+            if (!journalApply(reader, devices)) {
+                logMsg(XRM_LOG_ERROR, "%s : record %d of %s is corrupted", __func__, numRecord, fileName.c_str());
+                return (numRecord);
+            }
+            numRecord++;
+        }
+        if (!errmsg.empty()) {
+            /* the torn record is the last one written, nothing after it is valid */
+            logMsg(XRM_LOG_ERROR, "%s : %s", __func__, errmsg.c_str());
+            break;
+        }
+    }
+    return (numRecord);
+}
+
+/*
+ * Takes one journal record into the device data not in use yet. The cu record of a device
+ * which is not loaded any more is skipped, the device record which unloaded it follows.
+ */
+bool xrm::system::journalApply(snapshotReader& reader, std::vector<deviceData>& devices) {
+    uint8_t type = 0;
+    int32_t devId = -1, cuId = -1;
+    uint32_t num;
+
+    if (!reader.get(type)) return (false);
+    if (type == JOURNAL_RECORD_UDF_CU_GROUPS) return (snapshotGetUdfCuGroups(reader) && reader.isDone());
+    if (!reader.get(devId) || devId < 0 || devId >= XRM_MAX_XILINX_DEVICES) return (false);
+    /* the devices are probed by the first load after the snapshot of no device */
+    if (devices.empty()) {
+        if (!m_devicesInited) initDevices();
+        devices.resize(m_numDevice);
+    }
+    if (devId >= (int32_t)devices.size()) return (false);
+    deviceData* dev = &devices[devId];
+
+    switch (type) {
+        case JOURNAL_RECORD_DEVICE:
+            return (snapshotGetDevice(reader, dev) && reader.isDone());
+        case JOURNAL_RECORD_PROCS:
+            reader.get(dev->isExcl);
+            if (!reader.getCount(num, XRM_MAX_DEV_CLIENTS)) return (false);
+            dev->clientProcs.resize(num);
+            reader.getBytes(dev->clientProcs.data(), sizeof(clientData) * num);
+            return (reader.isDone());
+        case JOURNAL_RECORD_CU:
+            if (!reader.get(cuId)) return (false);
+            if (!dev->isLoaded || cuId < 0 || cuId >= dev->xclbinInfo.numCu) return (true);
+            return (snapshotGetCuState(reader, &dev->xclbinInfo.cuList[cuId]) &&
+                    snapshotGetCuChannels(reader, &dev->xclbinInfo.cuList[cuId]) && reader.isDone());
+        default:
+            return (false);
+    }
+}
+
+/*
+ * Waits until the changes made so far are in the journal. It's called before the response
+ * is sent, so what the client is told is never lost with the daemon. When the journal has
+ * grown beyond journalCompactSize, the snapshot thread is asked to take a new snapshot.
+ * When the journal fails to be written, a snapshot is taken right away instead, it has the
+ * changes the journal is missing; the failed records stay pending in the journal.
+ *
+ * Lock: should not hold any lock
+ */
+void xrm::system::journalCommit() {
+    if (!m_persistence) return;
+
+    if (!m_journal.commit()) {
+        enterSharedLock();
+        pthread_mutex_lock(&m_snapshotLock);
+        /* another caller may have written the journal meanwhile */
+        bool saved = m_journal.commit() || saveSnapshot();
+        pthread_mutex_unlock(&m_snapshotLock);
+        exitSharedLock();
+        if (!saved) logMsg(XRM_LOG_ERROR, "%s : failed to write the journal and the snapshot", __func__);
+        return;
+    }
+    if (!m_journal.needCompaction()) return;
+    {
+        std::lock_guard<std::mutex> guard(m_snapshotThreadLock);
+        if (m_snapshotRequested) return;
+        m_snapshotRequested = true;
+    }
+    m_snapshotCond.notify_one();
+}
+
+/*
+ * The channel, the client and the reserve changes of the cu are recorded by marking the cu,
+ * the marked cu of the device are journaled once when the device is unlocked.
+ *
+ * Lock: should hold the lock of the device of the cu
+ */
+void xrm::system::journalMarkCu(cuData* cu) {
+    if (!m_persistence || cu->journalDirty) return;
+    cu->journalDirty = true;
+    m_devList[cu->deviceId].journalDirtyCus.push_back(cu->cuId);
+}
+
+void xrm::system::journalMarkChannel(cuData* cu, int32_t chanId) {
+    if (!m_persistence) return;
+    journalMarkCu(cu);
+    cu->journalDirtyChans.push_back(chanId);
+}
+
+void xrm::system::journalMarkProcs(int32_t devId) {
+    if (!m_persistence) return;
+    m_devList[devId].journalProcsDirty = true;
+}
+
+/*
+ * Appends the state of the marked cu and channels, and the client processes if marked, of
+ * the device to the journal. Only the channels changed are journaled, a freed channel is
+ * journaled with no load.
+ *
+ * Lock: should hold the lock of the device, or the system lock exclusively
+ */
+void xrm::system::journalFlushDevice(int32_t devId) {
+    deviceData* dev = &m_devList[devId];
+
+    if (dev->journalDirtyCus.empty() && !dev->journalProcsDirty) return;
+    /* the device record of the unload has the state of the device */
+    if (!dev->isLoaded) {
+        journalDiscardDevice(devId);
+        return;
+    }
+    snapshotWriter writer;
+    for (int32_t cuId : dev->journalDirtyCus) {
+        if (cuId >= dev->xclbinInfo.numCu) continue;
+        cuData* cu = &dev->xclbinInfo.cuList[cuId];
+        std::vector<int32_t>& chans = cu->journalDirtyChans;
+        std::sort(chans.begin(), chans.end());
+        chans.erase(std::unique(chans.begin(), chans.end()), chans.end());
+        writer.clear();
+        writer.put((uint8_t)JOURNAL_RECORD_CU);
+        writer.put(devId);
+        writer.put(cuId);
+        snapshotPutCuState(writer, cu);
+        writer.put((uint32_t)chans.size());
+        for (int32_t chanId : chans) {
+            channelData chan;
+            if (chanId < (int32_t)cu->channels.size())
+                chan = cu->channels[chanId];
+            else
+                memset(&chan, 0, sizeof(chan));
+            chan.channelId = chanId;
+            writer.put(chan);
+        }
+        m_journal.append(writer.getPayload());
+        cu->journalDirty = false;
+        chans.clear();
+    }
+    dev->journalDirtyCus.clear();
+    if (dev->journalProcsDirty) {
+        writer.clear();
+        writer.put((uint8_t)JOURNAL_RECORD_PROCS);
+        writer.put(devId);
+        writer.put(dev->isExcl);
+        writer.put((uint32_t)dev->clientProcs.size());
+        writer.putBytes(dev->clientProcs.data(), sizeof(clientData) * dev->clientProcs.size());
+        m_journal.append(writer.getPayload());
+        dev->journalProcsDirty = false;
+    }
+}
+
+void xrm::system::journalDiscardDevice(int32_t devId) {
+    deviceData* dev = &m_devList[devId];
+
+    for (int32_t cuId : dev->journalDirtyCus) {
+        if (cuId >= (int32_t)dev->xclbinInfo.cuList.size()) continue;
+        dev->xclbinInfo.cuList[cuId].journalDirty = false;
+        dev->xclbinInfo.cuList[cuId].journalDirtyChans.clear();
+    }
+    dev->journalDirtyCus.clear();
+    dev->journalProcsDirty = false;
+}
+
+/*
+ * Journals the whole device after load, unload, enable and disable, the marked changes of
+ * the device are part of it.
+ *
+ * call while holding lock
+ */
+void xrm::system::journalDevice(int32_t devId) {
+    if (!m_persistence) return;
+
+    snapshotWriter writer;
+    journalDiscardDevice(devId);
+    writer.put((uint8_t)JOURNAL_RECORD_DEVICE);
+    writer.put(devId);
+    snapshotPutDevice(writer, &m_devList[devId]);
+    m_journal.append(writer.getPayload());
+}
+
+/*
+ * call while holding lock
+ */
+void xrm::system::journalUdfCuGroups() {
+    if (!m_persistence) return;
+
+    snapshotWriter writer;
+    writer.put((uint8_t)JOURNAL_RECORD_UDF_CU_GROUPS);
+    snapshotPutUdfCuGroups(writer);
+    m_journal.append(writer.getPayload());
+}
+
+void xrm::system::snapshotPutDevice(snapshotWriter& writer, deviceData* dev) {
+    xclbinInformation* xclbinInfo = &dev->xclbinInfo;
+
+    writer.put(dev->isDisabled);
+    writer.put(dev->isLoaded);
+    if (!dev->isLoaded) return;
+    writer.put(dev->isExcl);
+    writer.putString(dev->xclbinName);
+    writer.putBytes(xclbinInfo->uuid, sizeof(uuid_t));
+    writer.putString(xclbinInfo->uuidStr);
+    writer.put(xclbinInfo->numHardwareCu);
+    writer.put(xclbinInfo->numSoftwareCu);
+    writer.put(xclbinInfo->numMemBank);
+    writer.putBytes(xclbinInfo->memTopologyList, sizeof(memTopologyData) * xclbinInfo->numMemBank);
+    writer.put((uint32_t)xclbinInfo->connectList.size());
+    writer.putBytes(xclbinInfo->connectList.data(), sizeof(connectData) * xclbinInfo->connectList.size());
+    writer.put(xclbinInfo->numConnect);
+    writer.put(xclbinInfo->numCu);
+    for (int32_t cuId = 0; cuId < xclbinInfo->numCu; cuId++) {
+        cuData* cu = &xclbinInfo->cuList[cuId];
+        writer.put(cu->ipLayoutIndex);
+        writer.put(cu->cuType);
+        writer.putString(cu->kernelName);
+        writer.putString(cu->kernelAlias);
+        writer.putString(cu->cuName);
+        writer.putString(cu->instanceName);
+        writer.putString(cu->kernelPluginFileName);
+        writer.put(cu->maxCapacity);
+        writer.put(cu->baseAddr);
+        writer.put(cu->membankId);
+        writer.put(cu->membankType);
+        writer.put(cu->membankSize);
+        writer.put(cu->membankBaseAddr);
+        snapshotPutCuState(writer, cu);
+        /* only the channels in use */
+        writer.put((uint32_t)cu->hot->numChanInuse);
+        for (int32_t w = 0; w < XRM_CHAN_BITMAP_WORDS; w++) {
+            for (uint64_t bits = cu->chanInuseMap[w]; bits; bits &= bits - 1)
+                writer.put(cu->channels[w * 64 + __builtin_ctzll(bits)]);
+        }
+    }
+    writer.put((uint32_t)dev->clientProcs.size());
+    writer.putBytes(dev->clientProcs.data(), sizeof(clientData) * dev->clientProcs.size());
+}
+
+/*
+ * Takes one device from the snapshot into the device data not in use yet, the counts are
+ * checked against the limits before anything is allocated for them.
+ */
+bool xrm::system::snapshotGetDevice(snapshotReader& reader, deviceData* dev) {
+    xclbinInformation* xclbinInfo = &dev->xclbinInfo;
+    uint32_t num;
+
+    dev->isLoaded = false;
+    reader.get(dev->isDisabled);
+    reader.get(dev->isLoaded);
+    if (!dev->isLoaded) return (reader.isGood());
+    reader.get(dev->isExcl);
+    reader.getString(dev->xclbinName);
+    reader.getBytes(xclbinInfo->uuid, sizeof(uuid_t));
+    reader.getString(xclbinInfo->uuidStr);
+    reader.get(xclbinInfo->numHardwareCu);
+    reader.get(xclbinInfo->numSoftwareCu);
+    reader.get(xclbinInfo->numMemBank);
+    if (xclbinInfo->numMemBank < 0 || xclbinInfo->numMemBank > XRM_MAX_DDR_MAP) return (false);
+    memset(xclbinInfo->memTopologyList, 0, sizeof(xclbinInfo->memTopologyList));
+    reader.getBytes(xclbinInfo->memTopologyList, sizeof(memTopologyData) * xclbinInfo->numMemBank);
+    if (!reader.getCount(num, XRM_MAX_CONNECTION_ENTRIES)) return (false);
+    xclbinInfo->connectList.resize(num);
+    reader.getBytes(xclbinInfo->connectList.data(), sizeof(connectData) * num);
+    reader.get(xclbinInfo->numConnect);
+    reader.get(xclbinInfo->numCu);
+    if (!reader.isGood() || xclbinInfo->numCu < 0 || xclbinInfo->numCu > XRM_MAX_XILINX_KERNELS) return (false);
+    /* the journal may load the device again, nothing of the earlier xclbin is kept */
+    xclbinInfo->cuList.clear();
+    xclbinInfo->cuHot.clear();
+    cuListResize(xclbinInfo, xclbinInfo->numCu);
+    for (int32_t cuId = 0; cuId < xclbinInfo->numCu; cuId++) {
+        cuData* cu = &xclbinInfo->cuList[cuId];
+        cu->cuId = cuId;
+        reader.get(cu->ipLayoutIndex);
+        reader.get(cu->cuType);
+        reader.getString(cu->kernelName);
+        reader.getString(cu->kernelAlias);
+        reader.getString(cu->cuName);
+        reader.getString(cu->instanceName);
+        reader.getString(cu->kernelPluginFileName);
+        reader.get(cu->maxCapacity);
+        reader.get(cu->baseAddr);
+        reader.get(cu->membankId);
+        reader.get(cu->membankType);
+        reader.get(cu->membankSize);
+        reader.get(cu->membankBaseAddr);
+        if (!snapshotGetCuState(reader, cu) || !snapshotGetCuChannels(reader, cu)) return (false);
+    }
+    if (!reader.getCount(num, XRM_MAX_DEV_CLIENTS)) return (false);
+    dev->clientProcs.resize(num);
+    reader.getBytes(dev->clientProcs.data(), sizeof(clientData) * num);
+    return (reader.isGood());
+}
+
+/*
+ * The load totals, the clients and the reserves of the cu, the part of the cu changed by
+ * allocation and reservation.
+ */
+void xrm::system::snapshotPutCuState(snapshotWriter& writer, cuData* cu) {
+    writer.put(cu->hot->totalUsedLoadUnified);
+    writer.put(cu->hot->totalReservedLoadUnified);
+    writer.put(cu->hot->totalReservedUsedLoadUnified);
+    writer.put((uint32_t)cu->hot->numClient);
+    writer.putBytes(cu->clients.data(), sizeof(uint64_t) * cu->hot->numClient);
+    writer.put((uint32_t)cu->hot->numReserve);
+    writer.putBytes(cu->reserves.data(), sizeof(reserveData) * cu->hot->numReserve);
+}
+
+bool xrm::system::snapshotGetCuState(snapshotReader& reader, cuData* cu) {
+    uint32_t num;
+
+    reader.get(cu->hot->totalUsedLoadUnified);
+    reader.get(cu->hot->totalReservedLoadUnified);
+    reader.get(cu->hot->totalReservedUsedLoadUnified);
+    if (!reader.getCount(num, XRM_MAX_KERNEL_CHANNELS)) return (false);
+    cu->hot->numClient = num;
+    cu->clients.resize(num);
+    reader.getBytes(cu->clients.data(), sizeof(uint64_t) * num);
+    if (!reader.getCount(num, XRM_MAX_KERNEL_RESERVES)) return (false);
+    cu->hot->numReserve = num;
+    cu->reserves.resize(num);
+    reader.getBytes(cu->reserves.data(), sizeof(reserveData) * num);
+    return (reader.isGood());
+}
+
+/*
+ * Takes the channels put with their channel id, the channel with no load is free. The
+ * channel bitmap is rebuilt from the channel load by rebuildDeviceIndex().
+ */
+bool xrm::system::snapshotGetCuChannels(snapshotReader& reader, cuData* cu) {
+    uint32_t num;
+
+    if (!reader.getCount(num, XRM_MAX_KERNEL_CHANNELS)) return (false);
+    memset(cu->chanInuseMap, 0, sizeof(cu->chanInuseMap));
+    cu->chanFullMap = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        channelData chan;
+        if (!reader.get(chan) || chan.channelId < 0 || chan.channelId >= XRM_MAX_KERNEL_CHANNELS) return (false);
+        if (cu->channels.size() <= (size_t)chan.channelId) cu->channels.resize(chan.channelId + 1);
+        cu->channels[chan.channelId] = chan;
+    }
+    return (true);
+}
+
+/*
+ * The udf cu groups keep the names, the device and memory constraint and the load of the
+ * cu, nothing else of the cu property is given by the declaration.
+ */
+void xrm::system::snapshotPutUdfCuGroups(snapshotWriter& writer) {
+    writer.put(m_numUdfCuGroup);
+    for (uint32_t groupIdx = 0; groupIdx < m_numUdfCuGroup; groupIdx++) {
+        udfCuGroupInformation* group = &m_udfCuGroups[groupIdx];
+        writer.putString(group->udfCuGroupName);
+        writer.put(group->optionUdfCuListNum);
+        for (int32_t listIdx = 0; listIdx < group->optionUdfCuListNum; listIdx++) {
+            cuListProperty* cuListProp = &group->optionUdfCuListProps[listIdx];
+            writer.put(cuListProp->cuNum);
+            writer.put(cuListProp->sameDevice);
+            for (int32_t i = 0; i < cuListProp->cuNum; i++) {
+                writer.putBytes(cuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN);
+                writer.put(cuListProp->cuProps[i].devExcl);
+                writer.put(cuListProp->cuProps[i].requestLoadUnified);
+                writer.put(cuListProp->cuProps[i].requestLoadOriginal);
+            }
+        }
+    }
+    writer.put(m_numUdfCuGroupV2);
+    for (uint32_t groupIdx = 0; groupIdx < m_numUdfCuGroupV2; groupIdx++) {
+        udfCuGroupInformationV2* group = &m_udfCuGroupsV2[groupIdx];
+        writer.putString(group->udfCuGroupName);
+        writer.put(group->optionUdfCuListNum);
+        for (int32_t listIdx = 0; listIdx < group->optionUdfCuListNum; listIdx++) {
+            cuListPropertyV2* cuListProp = &group->optionUdfCuListProps[listIdx];
+            writer.put(cuListProp->cuNum);
+            for (int32_t i = 0; i < cuListProp->cuNum; i++) {
+                writer.putBytes(cuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN);
+                writer.put(cuListProp->cuProps[i].devExcl);
+                writer.put(cuListProp->cuProps[i].deviceInfo);
+                writer.put(cuListProp->cuProps[i].memoryInfo);
+                writer.put(cuListProp->cuProps[i].requestLoadUnified);
+                writer.put(cuListProp->cuProps[i].requestLoadOriginal);
+            }
+        }
+    }
+}
+
+bool xrm::system::snapshotGetUdfCuGroups(snapshotReader& reader) {
+    uint32_t num;
+
+    initUdfCuGroups();
+    if (!reader.getCount(num, XRM_MAX_UDF_CU_GROUP_NUM)) return (false);
+    for (m_numUdfCuGroup = 0; m_numUdfCuGroup < num; m_numUdfCuGroup++) {
+        udfCuGroupInformation* group = &m_udfCuGroups[m_numUdfCuGroup];
+        reader.getString(group->udfCuGroupName);
+        reader.get(group->optionUdfCuListNum);
+        if (group->optionUdfCuListNum < 0 || group->optionUdfCuListNum > XRM_MAX_UDF_CU_GROUP_OPTION_LIST_NUM)
+            return (false);
+        for (int32_t listIdx = 0; listIdx < group->optionUdfCuListNum; listIdx++) {
+            cuListProperty* cuListProp = &group->optionUdfCuListProps[listIdx];
+            memset(cuListProp, 0, sizeof(cuListProperty));
+            reader.get(cuListProp->cuNum);
+            reader.get(cuListProp->sameDevice);
+            if (cuListProp->cuNum < 0 || cuListProp->cuNum > XRM_MAX_LIST_CU_NUM) return (false);
+            for (int32_t i = 0; i < cuListProp->cuNum; i++) {
+                reader.getBytes(cuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN);
+                cuListProp->cuProps[i].cuName[XRM_MAX_NAME_LEN - 1] = '\0';
+                reader.get(cuListProp->cuProps[i].devExcl);
+                reader.get(cuListProp->cuProps[i].requestLoadUnified);
+                reader.get(cuListProp->cuProps[i].requestLoadOriginal);
+            }
+        }
+        if (!reader.isGood()) return (false);
+    }
+    if (!reader.getCount(num, XRM_MAX_UDF_CU_GROUP_NUM_V2)) return (false);
+    for (m_numUdfCuGroupV2 = 0; m_numUdfCuGroupV2 < num; m_numUdfCuGroupV2++) {
+        udfCuGroupInformationV2* group = &m_udfCuGroupsV2[m_numUdfCuGroupV2];
+        reader.getString(group->udfCuGroupName);
+        reader.get(group->optionUdfCuListNum);
+        if (group->optionUdfCuListNum < 0 || group->optionUdfCuListNum > XRM_MAX_UDF_CU_GROUP_OPTION_LIST_NUM_V2)
+            return (false);
+        for (int32_t listIdx = 0; listIdx < group->optionUdfCuListNum; listIdx++) {
+            cuListPropertyV2* cuListProp = &group->optionUdfCuListProps[listIdx];
+            memset(cuListProp, 0, sizeof(cuListPropertyV2));
+            reader.get(cuListProp->cuNum);
+            if (cuListProp->cuNum < 0 || cuListProp->cuNum > XRM_MAX_LIST_CU_NUM_V2) return (false);
+            for (int32_t i = 0; i < cuListProp->cuNum; i++) {
+                reader.getBytes(cuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN);
+                cuListProp->cuProps[i].cuName[XRM_MAX_NAME_LEN - 1] = '\0';
+                reader.get(cuListProp->cuProps[i].devExcl);
+                reader.get(cuListProp->cuProps[i].deviceInfo);
+                reader.get(cuListProp->cuProps[i].memoryInfo);
+                reader.get(cuListProp->cuProps[i].requestLoadUnified);
+                reader.get(cuListProp->cuProps[i].requestLoadOriginal);
+            }
+        }
+        if (!reader.isGood()) return (false);
+    }
+    return (true);
+}
+
+/* input parameters valid check need to be done before the calling */
+bool xrm::system::isDeviceLoaded(int32_t devId) {
+    if (devId >= 0 && devId < m_numDevice) {
+        deviceData* dev = &m_devList[devId];
+        return (dev->isLoaded);
+    } else {
+        return (false);
+    }
+}
+
+/* input parameters valid check need to be done before the calling */
+bool xrm::system::isDeviceLoadedXclbinWithUuid(int32_t devId, uuid_t uuid) {
+    if (devId >= 0 && devId < m_numDevice) {
+        deviceData* dev = &m_devList[devId];
+        bool sameUuid = true;
+        size_t size = sizeof(uuid_t);
+        unsigned char* uuidOfDev = dev->xclbinInfo.uuid;
+
+        for (size_t i = 0; i < size; i++) {
+            if ((uint8_t)(uuidOfDev[i]) != (uint8_t)(uuid[i])) {
+                sameUuid = false;
+                break;
+            }
+        }
+        return (sameUuid);
+    } else {
+        return (false);
+    }
+}
+
+/* input parameters valid check need to be done before the calling */
+bool xrm::system::isDeviceBusy(int32_t devId) {
+    if (devId >= 0 && devId < m_numDevice) {
+        deviceData* dev = &m_devList[devId];
+
+        for (int32_t cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+            if (dev->xclbinInfo.cuList[cuId].hot->totalUsedLoadUnified) return (true);
+        }
+        return (false);
+    } else {
+        return (false);
+    }
+}
+
+/*
+ * the unload process should be protected by system lock
+ */
+int32_t xrm::system::unloadOneDevice(const int32_t& devId, std::string& errmsg) {
+    /*
+     * XRM daemon may start before FPGA device ready during boot,
      * so try to init devices at the first time using devices.
      */
     if (!m_devicesInited) initDevices();
@@ -1607,6 +2938,7 @@ int32_t xrm::system::unloadOneDevice(const int32_t& devId, std::string& errmsg)
         }
 
         deviceClearInfo(devId);
+        journalDevice(devId);
         return (XRM_SUCCESS);
     }
     errmsg = "Invalid device id [" + std::to_string(devId) + "] passed in";
@@ -1627,6 +2959,7 @@ int32_t xrm::system::enableOneDevice(const int32_t& devId, std::string& errmsg)
         deviceData* dev = &m_devList[devId];
 
         dev->isDisabled = false;
+        journalDevice(devId);
         return (XRM_SUCCESS);
     }
     errmsg = "Invalid device id [" + std::to_string(devId) + "] passed in";
@@ -1651,6 +2984,7 @@ int32_t xrm::system::disableOneDevice(const int32_t& devId, std::string& errmsg)
         }
         if (!dev->isLoaded) {
             dev->isDisabled = true;
+            journalDevice(devId);
             return (XRM_SUCCESS);
         }
 
@@ -1668,6 +3002,7 @@ int32_t xrm::system::disableOneDevice(const int32_t& devId, std::string& errmsg)
 
         deviceClearInfo(devId);
         dev->isDisabled = true;
+        journalDevice(devId);
         return (XRM_SUCCESS);
     }
     errmsg = "Invalid device id [" + std::to_string(devId) + "] passed in";
@@ -1684,48 +3019,23 @@ int32_t xrm::system::disableOneDevice(const int32_t& devId, std::string& errmsg)
  */
 bool xrm::system::resIsCuExistingOnDev(int32_t devId, cuProperty* cuProp) {
     deviceData* dev;
-    cuData* cu;
-    bool kernelNameEqual, kernelAliasEqual, cuNameEqual;
-    int32_t cuId;
     bool cuFound = false;
 
     if ((cuProp->kernelName[0] == '\0') && (cuProp->kernelAlias[0] == '\0') && (cuProp->cuName[0] == '\0')) {
         logMsg(XRM_LOG_ERROR, "None of kernel name, kernel alias and cu name are presented\n");
         return (cuFound);
     }
+    const cuIndexEntry* cuEntry = cuIndexFind(cuProp);
+    if (cuEntry == NULL) return (cuFound);
 
     dev = &m_devList[devId];
-    /*
-     * Now check whether matching cu is on allocated device
-     * if not, free device, increment dev count, re-loop
-     */
-    for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuFound; cuId++) {
-        cu = &dev->xclbinInfo.cuList[cuId];
-
-        /*
-         * compare, 0: equal
-         *
-         * kernel name is presented, compare it; otherwise no need to compare
-         */
-        kernelNameEqual = true;
-        if (cuProp->kernelName[0] != '\0') {
-            if (cu->kernelName.compare(cuProp->kernelName)) kernelNameEqual = false;
-        }
-        /* kernel alias is presented, compare it; otherwise no need to compare */
-        kernelAliasEqual = true;
-        if (cuProp->kernelAlias[0] != '\0') {
-            if (cu->kernelAlias.compare(cuProp->kernelAlias)) kernelAliasEqual = false;
-        }
-        /* cu name is presented, compare it; otherwise no need to compare */
-        cuNameEqual = true;
-        if (cuProp->cuName[0] != '\0') {
-            if (cu->cuName.compare(cuProp->cuName)) cuNameEqual = false;
-        }
-        if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
-        cuFound = true;
-    }
-    return (cuFound);
-}
+    /* only the candidates on the device need to be checked against all the presented names */
+    const std::vector<int32_t>& cuIds = cuEntry->cuIds[devId];
+    for (size_t i = 0; i < cuIds.size() && !cuFound; i++) {
+        if (isCuMatching(&dev->xclbinInfo.cuList[cuIds[i]], cuProp)) cuFound = true;
+    }
+    return (cuFound);
+}
 
 /*
  * Check whether the cu (compute unit) existing in system
@@ -1866,13 +3176,13 @@ bool xrm::system::resIsCuGroupExisting(cuGroupProperty* cuGroupProp) {
  * XRM_SUCCESS: allocated resouce is recorded by cuRes
  * Otherwise: failed to allocate the cu resource
  *
- * Lock: should enter lock during the cu allocation
+ * Lock: should enter lock (shared lock is enough) during the cu allocation, the device
+ *       being tried is locked inside
  */
 int32_t xrm::system::resAllocCu(cuProperty* cuProp, cuResource* cuRes, bool updateId) {
     deviceData* dev;
     cuData* cu;
     int32_t ret = 0;
-    bool kernelNameEqual, kernelAliasEqual, cuNameEqual;
     uint64_t clientId = cuProp->clientId;
     int32_t devId, cuId;
     bool cuAcquired = false;
@@ -1887,6 +3197,9 @@ int32_t xrm::system::resAllocCu(cuProperty* cuProp, cuResource* cuRes, bool upda
         logMsg(XRM_LOG_ERROR, "None of kernel name, kernel alias and cu name are presented\n");
         return (XRM_ERROR_INVALID);
     }
+    /* only the cu with requested name are gone through */
+    const cuIndexEntry* cuEntry = cuIndexFind(cuProp);
+    if (cuEntry == NULL) return (XRM_ERROR_NO_KERNEL);
 
 cu_alloc_loop:
     for (devId = -1; !cuAcquired && (devId < m_numDevice);) {
@@ -1894,9 +3207,14 @@ cu_alloc_loop:
         if (devId < 0) {
             break;
         }
+        const std::vector<int32_t>& cuIds = cuEntry->cuIds[devId];
+        if (cuIds.empty()) continue;
 
+        /* only the device being tried is locked, so allocations on other devices go on */
+        lockDevice(devId);
         ret = allocClientFromDev(devId, cuProp);
         if (ret < 0) {
+            unlockDevice(devId);
             continue;
         }
         dev = &m_devList[devId];
@@ -1904,31 +3222,18 @@ cu_alloc_loop:
          * Now check whether matching cu is on allocated device
          * if not, free device, increment dev count, re-loop
          */
-        for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+        for (size_t i = 0; i < cuIds.size() && !cuAcquired; i++) {
+            cuId = cuIds[i];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
-            /*
-             * compare, 0: equal
-             *
-             * kernel name is presented, compare it; otherwise no need to compare
-             */
-            kernelNameEqual = true;
-            if (cuProp->kernelName[0] != '\0') {
-                if (cu->kernelName.compare(cuProp->kernelName)) kernelNameEqual = false;
-            }
-            /* kernel alias is presented, compare it; otherwise no need to compare */
-            kernelAliasEqual = true;
-            if (cuProp->kernelAlias[0] != '\0') {
-                if (cu->kernelAlias.compare(cuProp->kernelAlias)) kernelAliasEqual = false;
-            }
-            /* cu name is presented, compare it; otherwise no need to compare */
-            cuNameEqual = true;
-            if (cuProp->cuName[0] != '\0') {
-                if (cu->cuName.compare(cuProp->cuName)) cuNameEqual = false;
-            }
-            if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            /* the cu without enough free load is skipped before its cu data is touched */
+            if (!cuProp->poolId &&
+                hot->totalUsedLoadUnified + cuProp->requestLoadUnified > XRM_MAX_CHAN_LOAD_GRANULARITY_1000000)
+                continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
+            if (!isCuMatching(cu, cuProp)) continue;
             /* alloc channel and register client id */
             ret = allocChanClientFromCu(cu, cuProp, cuRes);
             if (ret != XRM_SUCCESS) {
@@ -1945,6 +3250,7 @@ cu_alloc_loop:
         if (!cuAcquired) {
             releaseClientOnDev(devId, clientId);
         }
+        unlockDevice(devId);
     }
 
     if (!cuAcquired && cuAffinityPass) {
@@ -1995,16 +3301,22 @@ int32_t xrm::system::resAllocCuV2(cuPropertyV2* cuPropV2, cuResource* cuRes, boo
     cuProp.poolId = cuPropV2->poolId;
     switch (deviceInfoConstraintType) {
         case XRM_DEVICE_INFO_CONSTRAINT_TYPE_NULL: {
+            /* allocation by policy compares the load of all devices, so lock all of them */
             if (cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_MOST_USED_FIRST ||
-                cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST)
+                cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST) {
+                deviceLockGuard devLock(this);
                 return (resAllocCuByDevLoad(cuPropV2, cuRes, updateId));
+            }
             if (cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_MOST_USED_FIRST ||
-                cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST)
+                cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST) {
+                deviceLockGuard devLock(this);
                 return (resAllocCuByCuLoad(cuPropV2, cuRes, updateId));
+            }
 
             return (resAllocCu(&cuProp, cuRes, updateId));
         }
         case XRM_DEVICE_INFO_CONSTRAINT_TYPE_HARDWARE_DEVICE_INDEX: {
+            deviceLockGuard devLock(this, (int32_t)deviceInfoDeviceIndex);
             return (resAllocCuFromDevByCuLoad((uint32_t)deviceInfoDeviceIndex, cuPropV2, cuRes, updateId));
         }
         default: {
@@ -2065,10 +3377,11 @@ cu_alloc_from_dev_loop:
      * and try to allocate requested cu.
      */
     for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-        cu = &dev->xclbinInfo.cuList[cuId];
+        cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
         /* first attempt to re-use existing kernels; else, use a new kernel */
-        if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+        if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+        cu = &dev->xclbinInfo.cuList[cuId];
         /*
          * compare, 0: equal
          *
@@ -2168,10 +3481,11 @@ int32_t xrm::system::resAllocLeastUsedCuFromDev(int32_t deviceId,
      * and try to allocate requested cu.
      */
     for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-        cu = &dev->xclbinInfo.cuList[cuId];
+        cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
         /* first attempt to use a new kernel */
-        if (cu->numClient > 0) continue;
+        if (hot->numClient > 0) continue;
+        cu = &dev->xclbinInfo.cuList[cuId];
         /*
          * compare, 0: equal
          *
@@ -2242,10 +3556,10 @@ cu_alloc_from_dev_loop:
         }
         if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
 
-        int64_t resultLoad = cuProp->requestLoadUnified + cu->totalUsedLoadUnified;
+        int64_t resultLoad = cuProp->requestLoadUnified + cu->hot->totalUsedLoadUnified;
         if (resultLoad <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
             // We've found a potential CU, lets note down its load, and cuId
-            leastUsedCus.emplace_back(cu->totalUsedLoadUnified, cuId);
+            leastUsedCus.emplace_back(cu->hot->totalUsedLoadUnified, cuId);
         }
     }
 
@@ -2323,10 +3637,11 @@ cu_acquire_loop:
          * if not, free device, increment dev count, re-loop
          */
         for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
             /*
              * compare, 0: equal
              *
@@ -2396,10 +3711,11 @@ cu_acquire_loop:
     dev = &m_devList[devId];
     /* Now check whether matching cu is on allocated device, if not, free device. */
     for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-        cu = &dev->xclbinInfo.cuList[cuId];
+        cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
         /* first attempt to re-use existing kernels; else, use a new kernel */
-        if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+        if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+        cu = &dev->xclbinInfo.cuList[cuId];
         /*
          * compare, 0: equal
          *
@@ -2469,7 +3785,7 @@ int32_t xrm::system::resAllocCuLeastUsedWithLoad(cuProperty* cuProp,
     int32_t devId, cuId;
     bool cuAcquired = false;
 
-    // Vector of tuples (cuData::totalUsedLoadUnified, devId, cuId)
+    // Vector of tuples (cuHotData::totalUsedLoadUnified, devId, cuId)
     std::vector<std::tuple<int32_t, int32_t, int32_t> > leastUsedCus;
 
     if ((cuProp == NULL) || (cuRes == NULL)) {
@@ -2503,10 +3819,11 @@ int32_t xrm::system::resAllocCuLeastUsedWithLoad(cuProperty* cuProp,
          * if not, free device, increment dev count, re-loop
          */
         for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to use a new kernel */
-            if (cu->numClient > 0) continue;
+            if (hot->numClient > 0) continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
             /*
              * compare, 0: equal
              *
@@ -2661,10 +3978,10 @@ cu_acquire_least_used_loop:
             }
             if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
 
-            int64_t resultLoad = cuProp->requestLoadUnified + cu->totalUsedLoadUnified;
+            int64_t resultLoad = cuProp->requestLoadUnified + cu->hot->totalUsedLoadUnified;
             if (resultLoad <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
                 // We've found a potential CU, lets note down its load, devId, and cuId
-                leastUsedCus.emplace_back(cu->totalUsedLoadUnified, devId, cuId);
+                leastUsedCus.emplace_back(cu->hot->totalUsedLoadUnified, devId, cuId);
             }
         }
 
@@ -2727,6 +4044,8 @@ int32_t xrm::system::resAllocCuList(cuListProperty* cuListProp, cuListResource*
         return (XRM_ERROR_INVALID);
     }
 
+    /* the cu list may come from several devices and is released as a whole on failure */
+    deviceLockGuard devLock(this);
     cuListRes->cuNum = 0;
     ret = XRM_ERROR;
     if (cuListProp->sameDevice) {
@@ -2994,6 +4313,9 @@ int32_t xrm::system::resAllocCuListV2(cuListPropertyV2* cuListPropV2, cuListReso
         return (XRM_ERROR_INVALID);
     }
 
+    /* the cu list may come from several devices and is released as a whole on failure */
+    deviceLockGuard devLock(this);
+
     /* use to set the flag to record whether the item is handled */
     itemFlags = (itemFlag*)malloc(sizeof(itemFlag) * XRM_MAX_LIST_CU_NUM_V2);
     memset(itemFlags, 0, sizeof(itemFlag) * XRM_MAX_LIST_CU_NUM_V2);
@@ -3150,9 +4472,7 @@ int32_t xrm::system::resLoadAndAllocAllCu(std::string xclbin,
      * allocate all the cu from this device
      */
     deviceData* dev = &m_devList[devId];
-    dev->clientProcs[0].clientId = clientId;
-    dev->clientProcs[0].clientProcessId = clientProcessId;
-    dev->clientProcs[0].ref = 1;
+    devAddClientProc(devId, clientId, clientProcessId, 1);
     if (dev->xclbinInfo.numCu < XRM_MAX_LIST_CU_NUM)
         cuListRes->cuNum = dev->xclbinInfo.numCu;
     else
@@ -3187,15 +4507,12 @@ int32_t xrm::system::resLoadAndAllocAllCu(std::string xclbin,
         cuRes->membankBaseAddr = cu->membankBaseAddr;
         cuRes->poolId = 0;
 
-        cu->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
-        cu->numChanInuse = 1;
-        cu->clients[0] = clientId;
-        cu->numClient = 1;
+        cu->hot->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
+        cuSetChannelInuse(cu, 0, clientId, allocServiceId);
+        addClientToCu(cu, clientId);
         channel = &cu->channels[0];
         channel->channelLoadUnified = XRM_MAX_CHAN_LOAD_GRANULARITY_1000000;
         channel->channelLoadOriginal = XRM_MAX_CHAN_LOAD_GRANULARITY_100;
-        channel->allocServiceId = allocServiceId;
-        channel->clientId = clientId;
         channel->clientProcessId = clientProcessId;
     }
     updateDeviceLoad(devId, 0, XRM_MAX_CU_LOAD_GRANULARITY_1000000 * cuListRes->cuNum);
@@ -3269,6 +4586,7 @@ int32_t xrm::system::resUdfCuGroupDeclare(udfCuGroupInformation* udfCuGroupInfo)
         }
     }
     m_numUdfCuGroup++;
+    journalUdfCuGroups();
     return (XRM_SUCCESS);
 }
 
@@ -3317,6 +4635,7 @@ int32_t xrm::system::resUdfCuGroupDeclareV2(udfCuGroupInformationV2* udfCuGroupI
         }
     }
     m_numUdfCuGroupV2++;
+    journalUdfCuGroups();
     return (XRM_SUCCESS);
 }
 
@@ -3344,112 +4663,590 @@ int32_t xrm::system::resUdfCuGroupUndeclare(udfCuGroupInformation* udfCuGroupInf
             break;
         }
     }
-    if (!udfCuGroupFound) {
-        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is NOT existing\n", __func__);
-        return (XRM_ERROR_INVALID);
+    if (!udfCuGroupFound) {
+        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is NOT existing\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+
+    /* move slot one step forward */
+    for (; udfCuGroupIdx < (m_numUdfCuGroup - 1); udfCuGroupIdx++) {
+        m_udfCuGroups[udfCuGroupIdx].udfCuGroupName = m_udfCuGroups[udfCuGroupIdx + 1].udfCuGroupName;
+        m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum = m_udfCuGroups[udfCuGroupIdx + 1].optionUdfCuListNum;
+        for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
+            desCuListProp = &m_udfCuGroups[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
+            srcCuListProp = &m_udfCuGroups[udfCuGroupIdx + 1].optionUdfCuListProps[cuListIdx];
+            memset(desCuListProp, 0, sizeof(cuListProperty));
+            desCuListProp->cuNum = srcCuListProp->cuNum;
+            desCuListProp->sameDevice = srcCuListProp->sameDevice;
+            for (int32_t i = 0; i < desCuListProp->cuNum; i++) {
+                strncpy(desCuListProp->cuProps[i].cuName, srcCuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN - 1);
+                desCuListProp->cuProps[i].devExcl = srcCuListProp->cuProps[i].devExcl;
+                desCuListProp->cuProps[i].requestLoadUnified = srcCuListProp->cuProps[i].requestLoadUnified;
+                desCuListProp->cuProps[i].requestLoadOriginal = srcCuListProp->cuProps[i].requestLoadOriginal;
+            }
+        }
+    }
+
+    /* flush the last slot */
+    flushUdfCuGroupInfo(udfCuGroupIdx);
+    m_numUdfCuGroup--;
+    journalUdfCuGroups();
+
+    return (XRM_SUCCESS);
+}
+
+/*
+ * undeclare one user defined cu group type based on the input information.
+ *
+ * XRM_SUCCESS: the user defined cu group is removed from m_udfCuGroupsV2[], no hole
+ * Otherwise: failed to undeclare the user defined cu group
+ *
+ * Lock: should enter lock during the cu group undeclaration
+ */
+int32_t xrm::system::resUdfCuGroupUndeclareV2(udfCuGroupInformationV2* udfCuGroupInfoV2) {
+    cuListPropertyV2* desCuListProp;
+    cuListPropertyV2* srcCuListProp;
+    bool udfCuGroupFound = false;
+    uint32_t udfCuGroupIdx;
+
+    if (udfCuGroupInfoV2 == NULL) {
+        return (XRM_ERROR_INVALID);
+    }
+    for (udfCuGroupIdx = 0; udfCuGroupIdx < m_numUdfCuGroupV2; udfCuGroupIdx++) {
+        /* compare, 0: equal */
+        if (!m_udfCuGroupsV2[udfCuGroupIdx].udfCuGroupName.compare(udfCuGroupInfoV2->udfCuGroupName.c_str())) {
+            udfCuGroupFound = true;
+            break;
+        }
+    }
+    if (!udfCuGroupFound) {
+        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is NOT existing\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+
+    /* move slot one step forward */
+    for (; udfCuGroupIdx < (m_numUdfCuGroupV2 - 1); udfCuGroupIdx++) {
+        m_udfCuGroupsV2[udfCuGroupIdx].udfCuGroupName = m_udfCuGroupsV2[udfCuGroupIdx + 1].udfCuGroupName;
+        m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum = m_udfCuGroupsV2[udfCuGroupIdx + 1].optionUdfCuListNum;
+        for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
+            desCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
+            srcCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx + 1].optionUdfCuListProps[cuListIdx];
+            memset(desCuListProp, 0, sizeof(cuListPropertyV2));
+            desCuListProp->cuNum = srcCuListProp->cuNum;
+            for (int32_t i = 0; i < desCuListProp->cuNum; i++) {
+                strncpy(desCuListProp->cuProps[i].cuName, srcCuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN - 1);
+                desCuListProp->cuProps[i].devExcl = srcCuListProp->cuProps[i].devExcl;
+                desCuListProp->cuProps[i].deviceInfo = srcCuListProp->cuProps[i].deviceInfo;
+                desCuListProp->cuProps[i].memoryInfo = srcCuListProp->cuProps[i].memoryInfo;
+                desCuListProp->cuProps[i].requestLoadUnified = srcCuListProp->cuProps[i].requestLoadUnified;
+                desCuListProp->cuProps[i].requestLoadOriginal = srcCuListProp->cuProps[i].requestLoadOriginal;
+            }
+        }
+    }
+
+    /* flush the last slot */
+    flushUdfCuGroupInfoV2(udfCuGroupIdx);
+    m_numUdfCuGroupV2--;
+    journalUdfCuGroups();
+
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Alloc one cu group based on the request property.
+ *
+ * XRM_SUCCESS: allocated resouce is filled into cuGroupRes
+ * Otherwise: failed to allocate the cu group
+ *
+ * Lock: should enter lock during the cu group allocation
+ */
+int32_t xrm::system::resAllocCuGroup(cuGroupProperty* cuGroupProp, cuGroupResource* cuGroupRes) {
+    int32_t ret = XRM_ERROR;
+    cuListProperty cuListProp;
+    cuListProperty* udfCuListProp;
+    cuProperty* cuProp;
+    cuProperty* udfCuProp;
+    int32_t udfCuGroupIdx = -1;
+
+    if (cuGroupProp == NULL || cuGroupRes == NULL) {
+        return (XRM_ERROR_INVALID);
+    }
+    for (uint32_t cuGroupIdx = 0; cuGroupIdx < m_numUdfCuGroup; cuGroupIdx++) {
+        /* compare, 0: equal */
+        if (!m_udfCuGroups[cuGroupIdx].udfCuGroupName.compare(cuGroupProp->udfCuGroupName.c_str())) {
+            udfCuGroupIdx = cuGroupIdx;
+            break;
+        }
+    }
+    if (udfCuGroupIdx == -1) {
+        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is not declared\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
+        memset(&cuListProp, 0, sizeof(cuListProperty));
+        udfCuListProp = &m_udfCuGroups[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
+        cuListProp.cuNum = udfCuListProp->cuNum;
+        cuListProp.sameDevice = udfCuListProp->sameDevice;
+        for (int32_t i = 0; i < cuListProp.cuNum; i++) {
+            cuProp = &cuListProp.cuProps[i];
+            udfCuProp = &udfCuListProp->cuProps[i];
+            strncpy(cuProp->cuName, udfCuProp->cuName, XRM_MAX_NAME_LEN - 1);
+            cuProp->devExcl = udfCuProp->devExcl;
+            cuProp->requestLoadUnified = udfCuProp->requestLoadUnified;
+            cuProp->requestLoadOriginal = udfCuProp->requestLoadOriginal;
+            cuProp->clientId = cuGroupProp->clientId;
+            cuProp->clientProcessId = cuGroupProp->clientProcessId;
+            cuProp->poolId = cuGroupProp->poolId;
+        }
+        memset(cuGroupRes, 0, sizeof(cuGroupResource));
+        /*
+         * NOTE: here since the cuListResource has same member of cuGroupResource, so it's fine to
+         * use cuGroupRes to call resAllocCuList() directly, otherwise should use cuListResource instead.
+         */
+        ret = resAllocCuList(&cuListProp, (cuListResource*)cuGroupRes);
+        if (ret == XRM_SUCCESS) break;
+    }
+    return (ret);
+}
+
+/*
+ * Alloc one cu group based on the request property.
+ *
+ * XRM_SUCCESS: allocated resouce is filled into cuGroupRes
+ * Otherwise: failed to allocate the cu group
+ *
+ * Lock: should enter lock during the cu group allocation
+ */
+int32_t xrm::system::resAllocCuGroupV2(cuGroupPropertyV2* cuGroupPropV2, cuGroupResourceV2* cuGroupResV2) {
+    int32_t ret = XRM_ERROR;
+    cuListPropertyV2 cuListProp;
+    cuListPropertyV2* udfCuListProp;
+    cuPropertyV2* cuProp;
+    cuPropertyV2* udfCuProp;
+    int32_t udfCuGroupIdx = -1;
+
+    if (cuGroupPropV2 == NULL || cuGroupResV2 == NULL) {
+        return (XRM_ERROR_INVALID);
+    }
+    for (uint32_t cuGroupIdx = 0; cuGroupIdx < m_numUdfCuGroupV2; cuGroupIdx++) {
+        /* compare, 0: equal */
+        if (!m_udfCuGroupsV2[cuGroupIdx].udfCuGroupName.compare(cuGroupPropV2->udfCuGroupName.c_str())) {
+            udfCuGroupIdx = cuGroupIdx;
+            break;
+        }
+    }
+    if (udfCuGroupIdx == -1) {
+        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is not declared\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
+        memset(&cuListProp, 0, sizeof(cuListPropertyV2));
+        udfCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
+        cuListProp.cuNum = udfCuListProp->cuNum;
+        for (int32_t i = 0; i < cuListProp.cuNum; i++) {
+            cuProp = &cuListProp.cuProps[i];
+            udfCuProp = &udfCuListProp->cuProps[i];
+            strncpy(cuProp->cuName, udfCuProp->cuName, XRM_MAX_NAME_LEN - 1);
+            cuProp->devExcl = udfCuProp->devExcl;
+            cuProp->deviceInfo = udfCuProp->deviceInfo;
+            cuProp->memoryInfo = udfCuProp->memoryInfo;
+            cuProp->requestLoadUnified = udfCuProp->requestLoadUnified;
+            cuProp->requestLoadOriginal = udfCuProp->requestLoadOriginal;
+            cuProp->clientId = cuGroupPropV2->clientId;
+            cuProp->clientProcessId = cuGroupPropV2->clientProcessId;
+            cuProp->poolId = cuGroupPropV2->poolId;
+        }
+        memset(cuGroupResV2, 0, sizeof(cuGroupResourceV2));
+        /*
+         * NOTE: here since the cuListResource has same member of cuGroupResource, so it's fine to
+         * use cuGroupResV2 to call resAllocCuList() directly, otherwise should use cuListResource instead.
+         */
+        ret = resAllocCuListV2(&cuListProp, (cuListResourceV2*)cuGroupResV2);
+        if (ret == XRM_SUCCESS) break;
+    }
+    return (ret);
+}
+
+/*
+ * Checks whether the cu on the device could be taken for the request, the same device
+ * checks as allocation (allocClientFromDev) or reservation (allocDevForClient) do, but
+ * nothing is changed.
+ *
+ * Lock: should hold the device lock
+ */
+bool xrm::system::capacityIsDeviceUsable(capacityModel* model, int32_t devId, cuProperty* cuProp) {
+    deviceData* dev = &m_devList[devId];
+    int32_t pidIdx;
+
+    if (!dev->isLoaded || model->devTaken[devId]) return (false);
+    /* only the client having exclusive access can use the device */
+    if (dev->isExcl) return (dev->clientProcs[0].clientId == cuProp->clientId);
+    if (model->isReserve) return (true);
+    if (cuProp->devExcl) {
+        /* is another client already using this as a non-exclusive device? */
+        for (pidIdx = 0; pidIdx < (int32_t)dev->clientProcs.size(); pidIdx++) {
+            if (dev->clientProcs[pidIdx].clientId && dev->clientProcs[pidIdx].clientId != cuProp->clientId)
+                return (false);
+        }
+        return (true);
+    }
+    /* client is already using the device, or there is empty slot in dev->clientProcs */
+    auto it = dev->clientIndex.find(cuProp->clientId);
+    if (it != dev->clientIndex.end() && it->second.procIdx >= 0) return (true);
+    if (dev->clientProcs.size() < XRM_MAX_DEV_CLIENTS) return (true);
+    for (pidIdx = 0; pidIdx < (int32_t)dev->clientProcs.size(); pidIdx++) {
+        if (!dev->clientProcs[pidIdx].clientId) return (true);
+    }
+    return (false);
+}
+
+/*
+ * Adds one cu of the list to the model, the matching cu on the usable devices are the
+ * candidates of it. deviceId is -1 for any device; the items with same sameDevGroup (not -1)
+ * are taken from one device.
+ *
+ * XRM_SUCCESS: the item is added, maybe without any candidate
+ * XRM_ERROR_INVALID: the request property is invalid
+ *
+ * Lock: should hold the device locks of all devices
+ */
+int32_t xrm::system::capacityAddItem(capacityModel* model,
+                                     cuProperty* cuProp,
+                                     int32_t deviceId,
+                                     int32_t sameDevGroup) {
+    capacityItem item;
+    cuCapacity capacity;
+    deviceData* dev;
+    cuData* cu;
+    int32_t devId, reserveIdx;
+
+    if ((cuProp->kernelName[0] == '\0') && (cuProp->kernelAlias[0] == '\0') && (cuProp->cuName[0] == '\0')) {
+        logMsg(XRM_LOG_ERROR, "%s: none of kernel name, kernel alias and cu name are presented\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    if (cuProp->requestLoadUnified <= 0) return (XRM_ERROR_INVALID);
+
+    item.cuProp = *cuProp;
+    item.sameDevGroup = sameDevGroup;
+    /* the reservation is always for a new pool */
+    uint64_t poolId = model->isReserve ? 0 : cuProp->poolId;
+    const cuIndexEntry* cuEntry = cuIndexFind(cuProp);
+    for (devId = 0; cuEntry != NULL && devId < m_numDevice; devId++) {
+        if (deviceId >= 0 && devId != deviceId) continue;
+        if (cuEntry->cuIds[devId].empty()) continue;
+        if (!capacityIsDeviceUsable(model, devId, cuProp)) continue;
+        dev = &m_devList[devId];
+        for (int32_t cuId : cuEntry->cuIds[devId]) {
+            cu = &dev->xclbinInfo.cuList[cuId];
+            if (!isCuMatching(cu, cuProp)) continue;
+            auto key = std::make_tuple(devId, cuId, poolId);
+            auto it = model->cuPos.find(key);
+            if (it != model->cuPos.end()) {
+                item.candidates.push_back(it->second);
+                continue;
+            }
+            capacity.deviceId = devId;
+            capacity.cuId = cuId;
+            if (model->isReserve) {
+                capacity.freeLoadUnified = XRM_MAX_CHAN_LOAD_GRANULARITY_1000000 -
+                                           std::max(cu->hot->totalUsedLoadUnified, cu->hot->totalReservedLoadUnified);
+                capacity.freeSlots = XRM_MAX_KERNEL_RESERVES - cu->hot->numReserve;
+            } else if (poolId) {
+                reserveIdx = isReservePoolUsingCu(cu, poolId);
+                if (reserveIdx == -1 || !cu->reserves[reserveIdx].clientIsActive) continue;
+                capacity.freeLoadUnified =
+                    cu->reserves[reserveIdx].reserveLoadUnified - cu->reserves[reserveIdx].reserveUsedLoadUnified;
+                capacity.freeSlots = XRM_MAX_KERNEL_CHANNELS - cu->hot->numChanInuse;
+            } else {
+                capacity.freeLoadUnified = XRM_MAX_CHAN_LOAD_GRANULARITY_1000000 - cu->hot->totalUsedLoadUnified;
+                capacity.freeSlots = XRM_MAX_KERNEL_CHANNELS - cu->hot->numChanInuse;
+            }
+            model->cuPos[key] = (int32_t)model->cus.size();
+            item.candidates.push_back((int32_t)model->cus.size());
+            model->cus.push_back(capacity);
+        }
+    }
+    model->items.push_back(item);
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Adds the cu list version 2 to the model: the cu with hardware device index is from that
+ * device, the cu with same virtual device index are from one device.
+ *
+ * Lock: should hold the device locks of all devices
+ */
+int32_t xrm::system::capacityAddListV2(capacityModel* model, cuListPropertyV2* cuListPropV2) {
+    cuPropertyV2* cuPropV2;
+    cuProperty cuProp;
+    uint64_t deviceInfoConstraintType, deviceInfoDeviceIndex;
+    int32_t index, ret;
+
+    for (index = 0; index < cuListPropV2->cuNum; index++) {
+        cuPropV2 = &cuListPropV2->cuProps[index];
+        deviceInfoConstraintType =
+            (((cuPropV2->deviceInfo) >> XRM_DEVICE_INFO_CONSTRAINT_TYPE_SHIFT) & XRM_DEVICE_INFO_CONSTRAINT_TYPE_MASK);
+        deviceInfoDeviceIndex =
+            (((cuPropV2->deviceInfo) >> XRM_DEVICE_INFO_DEVICE_INDEX_SHIFT) & XRM_DEVICE_INFO_DEVICE_INDEX_MASK);
+        cuPropertyCopyFromV2(&cuProp, cuPropV2);
+        switch (deviceInfoConstraintType) {
+            case XRM_DEVICE_INFO_CONSTRAINT_TYPE_NULL:
+                ret = capacityAddItem(model, &cuProp, -1, -1);
+                break;
+            case XRM_DEVICE_INFO_CONSTRAINT_TYPE_HARDWARE_DEVICE_INDEX:
+                ret = capacityAddItem(model, &cuProp, (int32_t)deviceInfoDeviceIndex, -1);
+                break;
+            case XRM_DEVICE_INFO_CONSTRAINT_TYPE_VIRTUAL_DEVICE_INDEX:
+                ret = capacityAddItem(model, &cuProp, -1, (int32_t)deviceInfoDeviceIndex);
+                break;
+            default:
+                logMsg(XRM_LOG_ERROR, "invalid device info [%d] constraint type\n", index);
+                ret = XRM_ERROR_INVALID;
+                break;
+        }
+        if (ret != XRM_SUCCESS) return (ret);
+    }
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Takes the request load of the item from the first candidate cu which still has enough
+ * load and slot after the usage of this round. devId is -1 for any device.
+ */
+bool xrm::system::capacityTakeCu(capacityModel* model, capacityItem* item, int32_t devId, capacityUsage& usage) {
+    int64_t requestLoadUnified = item->cuProp.requestLoadUnified;
+
+    for (int32_t idx : item->candidates) {
+        cuCapacity* capacity = &model->cus[idx];
+        if (devId >= 0 && capacity->deviceId != devId) continue;
+        if (model->devTaken[capacity->deviceId]) continue;
+        auto it = usage.find(idx);
+        int64_t usedLoad = (it == usage.end()) ? 0 : it->second.first;
+        int32_t usedSlots = (it == usage.end()) ? 0 : it->second.second;
+        /* reservations of one pool on the cu share one reserve slot */
+        int32_t slots = (model->isReserve && usedSlots > 0) ? 0 : 1;
+        if (capacity->freeLoadUnified - usedLoad < requestLoadUnified || capacity->freeSlots - usedSlots < slots)
+            continue;
+        usage[idx] = std::make_pair(usedLoad + requestLoadUnified, usedSlots + slots);
+        return (true);
+    }
+    return (false);
+}
+
+/*
+ * Takes one cu list of the model into usage. The cu of one device group are taken from
+ * one device, which is not used by other groups of the list.
+ */
+bool xrm::system::capacityTakeList(capacityModel* model, capacityUsage& usage) {
+    std::vector<bool> handled(model->items.size(), false);
+    bool groupDevs[XRM_MAX_XILINX_DEVICES] = {false};
+    size_t i, j;
+
+    for (i = 0; i < model->items.size(); i++) {
+        if (handled[i]) continue;
+        capacityItem* item = &model->items[i];
+        if (item->sameDevGroup < 0) {
+            if (!capacityTakeCu(model, item, -1, usage)) return (false);
+            continue;
+        }
+        bool groupTaken = false;
+        for (int32_t devId = 0; devId < m_numDevice && !groupTaken; devId++) {
+            if (groupDevs[devId]) continue;
+            capacityUsage groupUsage = usage;
+            groupTaken = true;
+            for (j = i; j < model->items.size() && groupTaken; j++) {
+                if (model->items[j].sameDevGroup != item->sameDevGroup) continue;
+                groupTaken = capacityTakeCu(model, &model->items[j], devId, groupUsage);
+            }
+            if (groupTaken) {
+                usage.swap(groupUsage);
+                groupDevs[devId] = true;
+            }
+        }
+        if (!groupTaken) return (false);
+        for (j = i; j < model->items.size(); j++) {
+            if (model->items[j].sameDevGroup == item->sameDevGroup) handled[j] = true;
+        }
+    }
+    return (true);
+}
+
+/*
+ * Takes the whole device for reservation: the device should be loaded (with the xclbin
+ * of uuid if uuid is not NULL), and nobody is using it.
+ */
+bool xrm::system::capacityTakeDevice(capacityModel* model, int32_t devId, unsigned char* uuid) {
+    if (devId < 0 || devId >= m_numDevice) return (false);
+    if (!m_devList[devId].isLoaded || model->devTaken[devId] || model->devUsed[devId]) return (false);
+    if (uuid != NULL && !isDeviceLoadedXclbinWithUuid(devId, uuid)) return (false);
+    if (isDeviceBusy(devId)) return (false);
+    model->devTaken[devId] = true;
+    return (true);
+}
+
+/*
+ * Commits the usage of one round to the model. If repeat is true, the round is repeated as
+ * many times as the cu taken by it allow, since the following rounds would take the same
+ * cu until one of them is used up.
+ *
+ * return: the number of rounds committed
+ */
+int32_t xrm::system::capacityCommit(capacityModel* model, capacityUsage& usage, bool repeat) {
+    int64_t rounds = (repeat && !usage.empty()) ? INT32_MAX : 1;
+
+    for (auto& it : usage) {
+        cuCapacity* capacity = &model->cus[it.first];
+        rounds = std::min(rounds, capacity->freeLoadUnified / it.second.first);
+        if (it.second.second > 0) rounds = std::min(rounds, (int64_t)(capacity->freeSlots / it.second.second));
+    }
+    for (auto& it : usage) {
+        cuCapacity* capacity = &model->cus[it.first];
+        capacity->freeLoadUnified -= rounds * it.second.first;
+        capacity->freeSlots -= (int32_t)(rounds * it.second.second);
+        model->devUsed[capacity->deviceId] = true;
     }
+    return ((int32_t)rounds);
+}
 
-    /* move slot one step forward */
-    for (; udfCuGroupIdx < (m_numUdfCuGroup - 1); udfCuGroupIdx++) {
-        m_udfCuGroups[udfCuGroupIdx].udfCuGroupName = m_udfCuGroups[udfCuGroupIdx + 1].udfCuGroupName;
-        m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum = m_udfCuGroups[udfCuGroupIdx + 1].optionUdfCuListNum;
-        for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
-            desCuListProp = &m_udfCuGroups[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
-            srcCuListProp = &m_udfCuGroups[udfCuGroupIdx + 1].optionUdfCuListProps[cuListIdx];
-            memset(desCuListProp, 0, sizeof(cuListProperty));
-            desCuListProp->cuNum = srcCuListProp->cuNum;
-            desCuListProp->sameDevice = srcCuListProp->sameDevice;
-            for (int32_t i = 0; i < desCuListProp->cuNum; i++) {
-                strncpy(desCuListProp->cuProps[i].cuName, srcCuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN - 1);
-                desCuListProp->cuProps[i].devExcl = srcCuListProp->cuProps[i].devExcl;
-                desCuListProp->cuProps[i].requestLoadUnified = srcCuListProp->cuProps[i].requestLoadUnified;
-                desCuListProp->cuProps[i].requestLoadOriginal = srcCuListProp->cuProps[i].requestLoadOriginal;
-            }
-        }
+/*
+ * Counts how many times the cu list of the model can be taken.
+ */
+int32_t xrm::system::capacityCountLists(capacityModel* model) {
+    capacityUsage usage;
+    int64_t listNum = 0;
+
+    while (listNum < INT32_MAX) {
+        usage.clear();
+        if (!capacityTakeList(model, usage)) break;
+        listNum += capacityCommit(model, usage, true);
     }
+    return ((int32_t)std::min(listNum, (int64_t)INT32_MAX));
+}
 
-    /* flush the last slot */
-    flushUdfCuGroupInfo(udfCuGroupIdx);
-    m_numUdfCuGroup--;
+/*
+ * Counts the cu could be allocated with the request property: the sum of request loads
+ * fitting in the free load (limited by free channels) of each candidate cu. deviceId is
+ * -1 for any device.
+ *
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::capacityCountCu(cuProperty* cuProp, int32_t deviceId, int32_t* availableNum) {
+    capacityModel model(false);
+    int64_t cuNum = 0;
+    int32_t ret;
 
+    deviceLockGuard devLock(this);
+    ret = capacityAddItem(&model, cuProp, deviceId, -1);
+    if (ret != XRM_SUCCESS) return (ret);
+    for (auto& capacity : model.cus) {
+        if (capacity.freeLoadUnified <= 0 || capacity.freeSlots <= 0) continue;
+        cuNum += std::min(capacity.freeLoadUnified / cuProp->requestLoadUnified, (int64_t)capacity.freeSlots);
+    }
+    *availableNum = (int32_t)std::min(cuNum, (int64_t)INT32_MAX);
     return (XRM_SUCCESS);
 }
 
 /*
- * undeclare one user defined cu group type based on the input information.
+ * Checks how many cu could be allocated based on the request property, nothing is
+ * allocated and the alloc service id is not changed.
  *
- * XRM_SUCCESS: the user defined cu group is removed from m_udfCuGroupsV2[], no hole
- * Otherwise: failed to undeclare the user defined cu group
+ * XRM_SUCCESS: the number is filled into availableNum
+ * XRM_ERROR_INVALID: the request property is invalid
  *
- * Lock: should enter lock during the cu group undeclaration
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
  */
-int32_t xrm::system::resUdfCuGroupUndeclareV2(udfCuGroupInformationV2* udfCuGroupInfoV2) {
-    cuListPropertyV2* desCuListProp;
-    cuListPropertyV2* srcCuListProp;
-    bool udfCuGroupFound = false;
-    uint32_t udfCuGroupIdx;
+int32_t xrm::system::resCheckCuAvailableNum(cuProperty* cuProp, int32_t* availableNum) {
+    if ((cuProp == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    return (capacityCountCu(cuProp, -1, availableNum));
+}
 
-    if (udfCuGroupInfoV2 == NULL) {
-        return (XRM_ERROR_INVALID);
-    }
-    for (udfCuGroupIdx = 0; udfCuGroupIdx < m_numUdfCuGroupV2; udfCuGroupIdx++) {
-        /* compare, 0: equal */
-        if (!m_udfCuGroupsV2[udfCuGroupIdx].udfCuGroupName.compare(udfCuGroupInfoV2->udfCuGroupName.c_str())) {
-            udfCuGroupFound = true;
-            break;
-        }
-    }
-    if (!udfCuGroupFound) {
-        logMsg(XRM_LOG_ERROR, "%s : user defined cu group is NOT existing\n", __func__);
-        return (XRM_ERROR_INVALID);
-    }
+/*
+ * Checks how many cu could be allocated based on the request property version 2, the
+ * policy doesn't change the number, only the hardware device index is honored.
+ *
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::resCheckCuAvailableNumV2(cuPropertyV2* cuPropV2, int32_t* availableNum) {
+    cuProperty cuProp;
 
-    /* move slot one step forward */
-    for (; udfCuGroupIdx < (m_numUdfCuGroupV2 - 1); udfCuGroupIdx++) {
-        m_udfCuGroupsV2[udfCuGroupIdx].udfCuGroupName = m_udfCuGroupsV2[udfCuGroupIdx + 1].udfCuGroupName;
-        m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum = m_udfCuGroupsV2[udfCuGroupIdx + 1].optionUdfCuListNum;
-        for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
-            desCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
-            srcCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx + 1].optionUdfCuListProps[cuListIdx];
-            memset(desCuListProp, 0, sizeof(cuListPropertyV2));
-            desCuListProp->cuNum = srcCuListProp->cuNum;
-            for (int32_t i = 0; i < desCuListProp->cuNum; i++) {
-                strncpy(desCuListProp->cuProps[i].cuName, srcCuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN - 1);
-                desCuListProp->cuProps[i].devExcl = srcCuListProp->cuProps[i].devExcl;
-                desCuListProp->cuProps[i].deviceInfo = srcCuListProp->cuProps[i].deviceInfo;
-                desCuListProp->cuProps[i].memoryInfo = srcCuListProp->cuProps[i].memoryInfo;
-                desCuListProp->cuProps[i].requestLoadUnified = srcCuListProp->cuProps[i].requestLoadUnified;
-                desCuListProp->cuProps[i].requestLoadOriginal = srcCuListProp->cuProps[i].requestLoadOriginal;
-            }
-        }
+    if ((cuPropV2 == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    uint64_t deviceInfoConstraintType =
+        (cuPropV2->deviceInfo >> XRM_DEVICE_INFO_CONSTRAINT_TYPE_SHIFT) & XRM_DEVICE_INFO_CONSTRAINT_TYPE_MASK;
+    uint64_t deviceInfoDeviceIndex =
+        (cuPropV2->deviceInfo >> XRM_DEVICE_INFO_DEVICE_INDEX_SHIFT) & XRM_DEVICE_INFO_DEVICE_INDEX_MASK;
+    cuPropertyCopyFromV2(&cuProp, cuPropV2);
+    switch (deviceInfoConstraintType) {
+        case XRM_DEVICE_INFO_CONSTRAINT_TYPE_NULL:
+            return (capacityCountCu(&cuProp, -1, availableNum));
+        case XRM_DEVICE_INFO_CONSTRAINT_TYPE_HARDWARE_DEVICE_INDEX:
+            return (capacityCountCu(&cuProp, (int32_t)deviceInfoDeviceIndex, availableNum));
+        default:
+            logMsg(XRM_LOG_ERROR, "invalid device info constraint type\n");
+            return (XRM_ERROR_INVALID);
     }
+}
 
-    /* flush the last slot */
-    flushUdfCuGroupInfoV2(udfCuGroupIdx);
-    m_numUdfCuGroupV2--;
+/*
+ * Checks how many cu list could be allocated based on the request property.
+ *
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::resCheckCuListAvailableNum(cuListProperty* cuListProp, int32_t* availableNum) {
+    capacityModel model(false);
+    int32_t i, ret;
+
+    if ((cuListProp == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    if (cuListProp->cuNum <= 0 || cuListProp->cuNum > XRM_MAX_LIST_CU_NUM) return (XRM_ERROR_INVALID);
 
+    deviceLockGuard devLock(this);
+    for (i = 0; i < cuListProp->cuNum; i++) {
+        ret = capacityAddItem(&model, &cuListProp->cuProps[i], -1, cuListProp->sameDevice ? 0 : -1);
+        if (ret != XRM_SUCCESS) return (ret);
+    }
+    *availableNum = capacityCountLists(&model);
     return (XRM_SUCCESS);
 }
 
 /*
- * Alloc one cu group based on the request property.
+ * Checks how many cu list could be allocated based on the request property version 2.
  *
- * XRM_SUCCESS: allocated resouce is filled into cuGroupRes
- * Otherwise: failed to allocate the cu group
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::resCheckCuListAvailableNumV2(cuListPropertyV2* cuListPropV2, int32_t* availableNum) {
+    capacityModel model(false);
+    int32_t ret;
+
+    if ((cuListPropV2 == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    if (cuListPropV2->cuNum <= 0 || cuListPropV2->cuNum > XRM_MAX_LIST_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    deviceLockGuard devLock(this);
+    ret = capacityAddListV2(&model, cuListPropV2);
+    if (ret != XRM_SUCCESS) return (ret);
+    *availableNum = capacityCountLists(&model);
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Checks how many cu group could be allocated based on the request property. As the
+ * allocation does, the option lists of the group are taken in order: one option list is
+ * taken until it doesn't fit, then the next one.
  *
- * Lock: should enter lock during the cu group allocation
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
  */
-int32_t xrm::system::resAllocCuGroup(cuGroupProperty* cuGroupProp, cuGroupResource* cuGroupRes) {
-    int32_t ret = XRM_ERROR;
-    cuListProperty cuListProp;
+int32_t xrm::system::resCheckCuGroupAvailableNum(cuGroupProperty* cuGroupProp, int32_t* availableNum) {
+    capacityModel model(false);
     cuListProperty* udfCuListProp;
-    cuProperty* cuProp;
-    cuProperty* udfCuProp;
+    cuProperty cuProp;
     int32_t udfCuGroupIdx = -1;
+    int32_t ret = XRM_ERROR_INVALID;
+    int64_t groupNum = 0;
 
-    if (cuGroupProp == NULL || cuGroupRes == NULL) {
-        return (XRM_ERROR_INVALID);
-    }
+    if ((cuGroupProp == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
     for (uint32_t cuGroupIdx = 0; cuGroupIdx < m_numUdfCuGroup; cuGroupIdx++) {
         /* compare, 0: equal */
         if (!m_udfCuGroups[cuGroupIdx].udfCuGroupName.compare(cuGroupProp->udfCuGroupName.c_str())) {
@@ -3461,52 +5258,49 @@ int32_t xrm::system::resAllocCuGroup(cuGroupProperty* cuGroupProp, cuGroupResour
         logMsg(XRM_LOG_ERROR, "%s : user defined cu group is not declared\n", __func__);
         return (XRM_ERROR_INVALID);
     }
+
+    deviceLockGuard devLock(this);
     for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroups[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
-        memset(&cuListProp, 0, sizeof(cuListProperty));
         udfCuListProp = &m_udfCuGroups[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
-        cuListProp.cuNum = udfCuListProp->cuNum;
-        cuListProp.sameDevice = udfCuListProp->sameDevice;
-        for (int32_t i = 0; i < cuListProp.cuNum; i++) {
-            cuProp = &cuListProp.cuProps[i];
-            udfCuProp = &udfCuListProp->cuProps[i];
-            strncpy(cuProp->cuName, udfCuProp->cuName, XRM_MAX_NAME_LEN - 1);
-            cuProp->devExcl = udfCuProp->devExcl;
-            cuProp->requestLoadUnified = udfCuProp->requestLoadUnified;
-            cuProp->requestLoadOriginal = udfCuProp->requestLoadOriginal;
-            cuProp->clientId = cuGroupProp->clientId;
-            cuProp->clientProcessId = cuGroupProp->clientProcessId;
-            cuProp->poolId = cuGroupProp->poolId;
-        }
-        memset(cuGroupRes, 0, sizeof(cuGroupResource));
-        /*
-         * NOTE: here since the cuListResource has same member of cuGroupResource, so it's fine to
-         * use cuGroupRes to call resAllocCuList() directly, otherwise should use cuListResource instead.
-         */
-        ret = resAllocCuList(&cuListProp, (cuListResource*)cuGroupRes);
-        if (ret == XRM_SUCCESS) break;
+        if (udfCuListProp->cuNum <= 0 || udfCuListProp->cuNum > XRM_MAX_LIST_CU_NUM) continue;
+        model.items.clear();
+        for (int32_t i = 0; i < udfCuListProp->cuNum; i++) {
+            memset(&cuProp, 0, sizeof(cuProperty));
+            strncpy(cuProp.cuName, udfCuListProp->cuProps[i].cuName, XRM_MAX_NAME_LEN - 1);
+            cuProp.devExcl = udfCuListProp->cuProps[i].devExcl;
+            cuProp.requestLoadUnified = udfCuListProp->cuProps[i].requestLoadUnified;
+            cuProp.requestLoadOriginal = udfCuListProp->cuProps[i].requestLoadOriginal;
+            cuProp.clientId = cuGroupProp->clientId;
+            cuProp.clientProcessId = cuGroupProp->clientProcessId;
+            cuProp.poolId = cuGroupProp->poolId;
+            if (capacityAddItem(&model, &cuProp, -1, udfCuListProp->sameDevice ? 0 : -1) != XRM_SUCCESS) break;
+        }
+        /* the option list with invalid cu is skipped, as the allocation does */
+        if ((int32_t)model.items.size() != udfCuListProp->cuNum) continue;
+        ret = XRM_SUCCESS;
+        groupNum += capacityCountLists(&model);
     }
+    *availableNum = (int32_t)std::min(groupNum, (int64_t)INT32_MAX);
     return (ret);
 }
 
 /*
- * Alloc one cu group based on the request property.
- *
- * XRM_SUCCESS: allocated resouce is filled into cuGroupRes
- * Otherwise: failed to allocate the cu group
+ * Checks how many cu group could be allocated based on the request property version 2.
  *
- * Lock: should enter lock during the cu group allocation
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
  */
-int32_t xrm::system::resAllocCuGroupV2(cuGroupPropertyV2* cuGroupPropV2, cuGroupResourceV2* cuGroupResV2) {
-    int32_t ret = XRM_ERROR;
+int32_t xrm::system::resCheckCuGroupAvailableNumV2(cuGroupPropertyV2* cuGroupPropV2, int32_t* availableNum) {
+    capacityModel model(false);
     cuListPropertyV2 cuListProp;
     cuListPropertyV2* udfCuListProp;
     cuPropertyV2* cuProp;
     cuPropertyV2* udfCuProp;
     int32_t udfCuGroupIdx = -1;
+    int32_t ret = XRM_ERROR_INVALID;
+    int64_t groupNum = 0;
 
-    if (cuGroupPropV2 == NULL || cuGroupResV2 == NULL) {
-        return (XRM_ERROR_INVALID);
-    }
+    if ((cuGroupPropV2 == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
     for (uint32_t cuGroupIdx = 0; cuGroupIdx < m_numUdfCuGroupV2; cuGroupIdx++) {
         /* compare, 0: equal */
         if (!m_udfCuGroupsV2[cuGroupIdx].udfCuGroupName.compare(cuGroupPropV2->udfCuGroupName.c_str())) {
@@ -3518,9 +5312,12 @@ int32_t xrm::system::resAllocCuGroupV2(cuGroupPropertyV2* cuGroupPropV2, cuGroup
         logMsg(XRM_LOG_ERROR, "%s : user defined cu group is not declared\n", __func__);
         return (XRM_ERROR_INVALID);
     }
+
+    deviceLockGuard devLock(this);
     for (int32_t cuListIdx = 0; cuListIdx < m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListNum; cuListIdx++) {
-        memset(&cuListProp, 0, sizeof(cuListPropertyV2));
         udfCuListProp = &m_udfCuGroupsV2[udfCuGroupIdx].optionUdfCuListProps[cuListIdx];
+        if (udfCuListProp->cuNum <= 0 || udfCuListProp->cuNum > XRM_MAX_LIST_CU_NUM_V2) continue;
+        memset(&cuListProp, 0, sizeof(cuListPropertyV2));
         cuListProp.cuNum = udfCuListProp->cuNum;
         for (int32_t i = 0; i < cuListProp.cuNum; i++) {
             cuProp = &cuListProp.cuProps[i];
@@ -3535,31 +5332,127 @@ int32_t xrm::system::resAllocCuGroupV2(cuGroupPropertyV2* cuGroupPropV2, cuGroup
             cuProp->clientProcessId = cuGroupPropV2->clientProcessId;
             cuProp->poolId = cuGroupPropV2->poolId;
         }
-        memset(cuGroupResV2, 0, sizeof(cuGroupResourceV2));
-        /*
-         * NOTE: here since the cuListResource has same member of cuGroupResource, so it's fine to
-         * use cuGroupResV2 to call resAllocCuList() directly, otherwise should use cuListResource instead.
-         */
-        ret = resAllocCuListV2(&cuListProp, (cuListResourceV2*)cuGroupResV2);
-        if (ret == XRM_SUCCESS) break;
+        model.items.clear();
+        /* the option list with invalid cu is skipped, as the allocation does */
+        if (capacityAddListV2(&model, &cuListProp) != XRM_SUCCESS) continue;
+        ret = XRM_SUCCESS;
+        groupNum += capacityCountLists(&model);
     }
+    *availableNum = (int32_t)std::min(groupNum, (int64_t)INT32_MAX);
     return (ret);
 }
 
+/*
+ * Checks how many cu pool could be reserved based on the request property. One round of
+ * the check takes the whole devices of the xclbin at first, then the cu lists, as the
+ * reservation does. The round is repeated in one go only when no whole device is taken.
+ *
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::resCheckCuPoolAvailableNum(cuPoolProperty* cuPoolProp, int32_t* availableNum) {
+    capacityModel model(true);
+    cuListProperty* cuListProp;
+    capacityUsage usage;
+    int32_t i, devId, ret;
+    int64_t poolNum = 0;
+    bool taken;
+
+    if ((cuPoolProp == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    cuListProp = &cuPoolProp->cuListProp;
+    if (cuPoolProp->cuListNum < 0 || cuPoolProp->xclbinNum < 0) return (XRM_ERROR_INVALID);
+    if (cuPoolProp->cuListNum == 0 && cuPoolProp->xclbinNum == 0) return (XRM_ERROR_INVALID);
+    if (cuPoolProp->cuListNum > 0 && (cuListProp->cuNum <= 0 || cuListProp->cuNum > XRM_MAX_LIST_CU_NUM))
+        return (XRM_ERROR_INVALID);
+
+    deviceLockGuard devLock(this);
+    for (i = 0; i < cuListProp->cuNum && cuPoolProp->cuListNum > 0; i++) {
+        ret = capacityAddItem(&model, &cuListProp->cuProps[i], -1, cuListProp->sameDevice ? 0 : -1);
+        if (ret != XRM_SUCCESS) return (ret);
+    }
+    while (poolNum < INT32_MAX) {
+        usage.clear();
+        taken = true;
+        for (i = 0; i < cuPoolProp->xclbinNum && taken; i++) {
+            taken = false;
+            for (devId = 0; devId < m_numDevice && !taken; devId++)
+                taken = capacityTakeDevice(&model, devId, cuPoolProp->xclbinUuid);
+        }
+        for (i = 0; i < cuPoolProp->cuListNum && taken; i++) taken = capacityTakeList(&model, usage);
+        if (!taken) break;
+        poolNum += capacityCommit(&model, usage, cuPoolProp->xclbinNum == 0);
+    }
+    *availableNum = (int32_t)std::min(poolNum, (int64_t)INT32_MAX);
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Checks how many cu pool could be reserved based on the request property version 2. One
+ * round of the check takes the devices of device id list, the whole devices of the xclbin,
+ * then the cu lists, as the reservation does.
+ *
+ * Lock: should enter lock (shared lock is enough), all devices are locked inside
+ */
+int32_t xrm::system::resCheckCuPoolAvailableNumV2(cuPoolPropertyV2* cuPoolPropV2, int32_t* availableNum) {
+    capacityModel model(true);
+    cuListPropertyV2* cuListProp;
+    deviceIdListPropertyV2* deviceIdListProp;
+    capacityUsage usage;
+    int32_t i, devId, ret;
+    int64_t poolNum = 0;
+    bool taken;
+
+    if ((cuPoolPropV2 == NULL) || (availableNum == NULL)) return (XRM_ERROR_INVALID);
+    *availableNum = 0;
+    cuListProp = &cuPoolPropV2->cuListProp;
+    deviceIdListProp = &cuPoolPropV2->deviceIdListProp;
+    if (cuPoolPropV2->cuListNum < 0 || cuPoolPropV2->xclbinNum < 0 || deviceIdListProp->deviceNum < 0 ||
+        deviceIdListProp->deviceNum > XRM_MAX_XILINX_DEVICES)
+        return (XRM_ERROR_INVALID);
+    if (cuPoolPropV2->cuListNum == 0 && cuPoolPropV2->xclbinNum == 0 && deviceIdListProp->deviceNum == 0)
+        return (XRM_ERROR_INVALID);
+    if (cuPoolPropV2->cuListNum > 0 && (cuListProp->cuNum <= 0 || cuListProp->cuNum > XRM_MAX_LIST_CU_NUM_V2))
+        return (XRM_ERROR_INVALID);
+
+    deviceLockGuard devLock(this);
+    if (cuPoolPropV2->cuListNum > 0) {
+        ret = capacityAddListV2(&model, cuListProp);
+        if (ret != XRM_SUCCESS) return (ret);
+    }
+    while (poolNum < INT32_MAX) {
+        usage.clear();
+        taken = true;
+        for (i = 0; i < deviceIdListProp->deviceNum && taken; i++)
+            taken = capacityTakeDevice(&model, (int32_t)(deviceIdListProp->deviceIds[i] & 0xFFFFFFFF), NULL);
+        for (i = 0; i < cuPoolPropV2->xclbinNum && taken; i++) {
+            taken = false;
+            for (devId = 0; devId < m_numDevice && !taken; devId++)
+                taken = capacityTakeDevice(&model, devId, cuPoolPropV2->xclbinUuid);
+        }
+        for (i = 0; i < cuPoolPropV2->cuListNum && taken; i++) taken = capacityTakeList(&model, usage);
+        if (!taken) break;
+        poolNum += capacityCommit(&model, usage, cuPoolPropV2->xclbinNum == 0 && deviceIdListProp->deviceNum == 0);
+    }
+    *availableNum = (int32_t)std::min(poolNum, (int64_t)INT32_MAX);
+    return (XRM_SUCCESS);
+}
+
 /*
  * the interface to free one cu resource
  *
- * lock: need to enter lock to protect the resource pool access during the free process
+ * lock: need to enter lock (shared lock is enough) to protect the resource pool access during
+ *       the free process, the device of the cu is locked inside
  */
 int32_t xrm::system::resReleaseCu(cuResource* cuRes) {
     if (cuRes == NULL) return (XRM_ERROR_INVALID);
 
     deviceData* dev;
     cuData* cu;
+    channelData* chan;
     int32_t devId, cuId, chanId;
     uint64_t allocServiceId;
     uint64_t clientId = cuRes->clientId;
-    int32_t i, reserveIdx, procChanCnt = 0;
+    int32_t reserveIdx;
     int32_t ret;
 
     devId = cuRes->deviceId;
@@ -3570,6 +5463,7 @@ int32_t xrm::system::resReleaseCu(cuResource* cuRes) {
     if (chanId < 0 || chanId > XRM_MAX_KERNEL_CHANNELS) return (XRM_ERROR_INVALID);
     allocServiceId = cuRes->allocServiceId;
 
+    deviceLockGuard devLock(this, devId);
     ret = XRM_ERROR;
     dev = &m_devList[devId];
     if (!dev->isLoaded) {
@@ -3580,63 +5474,50 @@ int32_t xrm::system::resReleaseCu(cuResource* cuRes) {
     }
     cu = &dev->xclbinInfo.cuList[cuId];
 
-    for (i = 0; i < XRM_MAX_KERNEL_CHANNELS; i++) {
-        if (cu->channels[i].allocServiceId != allocServiceId || cu->channels[i].poolId != cuRes->poolId ||
-            cu->channels[i].clientId != clientId || cu->channels[i].channelId != chanId) {
-            if (cu->channels[i].clientId == clientId) /* count how many other channel used by the same client */
-                procChanCnt++;
-            continue;
-        }
+    /* channel id is the index of the channel on cu, the channel should be in use and owned by the request */
+    if (chanId >= XRM_MAX_KERNEL_CHANNELS || !(cu->chanInuseMap[chanId / 64] & ((uint64_t)1 << (chanId % 64))))
+        return (ret);
+    chan = &cu->channels[chanId];
+    if (chan->allocServiceId != allocServiceId || chan->poolId != cuRes->poolId || chan->clientId != clientId)
+        return (ret);
 
-        /*
-         * For the release cu:
-         * if not from reserve pool, then return to Big pool
-         * if from reserve pool, pool is active, return to pool
-         * if from reserve pool, pool is in-active, return to Big pool
-         */
-        if (cuRes->poolId) {
-            /* from the reserve pool */
-            reserveIdx = isReservePoolUsingCu(cu, cuRes->poolId);
-            if (reserveIdx != -1) {
-                if (cu->reserves[reserveIdx].clientIsActive) {
-                    /* From reserve pool, reserve client is active, return to reserve pool */
-                    cu->reserves[reserveIdx].reserveUsedLoadUnified -= cu->channels[i].channelLoadUnified;
-                } else {
-                    /* From reserve pool, reserve client is NOT active, return resource to default pool */
-                    cu->totalUsedLoadUnified -= cu->channels[i].channelLoadUnified;
-                    updateDeviceLoad(cu->deviceId, -cu->channels[i].channelLoadUnified, -1);
-                }
+    /*
+     * For the release cu:
+     * if not from reserve pool, then return to Big pool
+     * if from reserve pool, pool is active, return to pool
+     * if from reserve pool, pool is in-active, return to Big pool
+     */
+    if (cuRes->poolId) {
+        /* from the reserve pool */
+        reserveIdx = isReservePoolUsingCu(cu, cuRes->poolId);
+        if (reserveIdx != -1) {
+            if (cu->reserves[reserveIdx].clientIsActive) {
+                /* From reserve pool, reserve client is active, return to reserve pool */
+                cu->reserves[reserveIdx].reserveUsedLoadUnified -= chan->channelLoadUnified;
             } else {
                 /* From reserve pool, reserve client is NOT active, return resource to default pool */
-                cu->totalUsedLoadUnified -= cu->channels[i].channelLoadUnified;
-                updateDeviceLoad(cu->deviceId, -cu->channels[i].channelLoadUnified, -1);
+                cu->hot->totalUsedLoadUnified -= chan->channelLoadUnified;
+                updateDeviceLoad(cu->deviceId, -chan->channelLoadUnified, -1);
             }
         } else {
-            /* return the resource into default pool */
-            cu->totalUsedLoadUnified -= cu->channels[i].channelLoadUnified;
-            updateDeviceLoad(cu->deviceId, -cu->channels[i].channelLoadUnified, -1);
-        }
-        cu->numChanInuse--;
-        cu->channels[i].allocServiceId = 0;
-        cu->channels[i].poolId = 0;
-        cu->channels[i].clientId = 0;
-        cu->channels[i].clientProcessId = 0;
-        cu->channels[i].channelLoadUnified = 0;
-        cu->channels[i].channelLoadOriginal = 0;
-
-        /* update dev->clientProcs ref count */
-        releaseClientOnDev(devId, clientId);
-
-        ret = XRM_SUCCESS;
+            /* From reserve pool, reserve client is NOT active, return resource to default pool */
+            cu->hot->totalUsedLoadUnified -= chan->channelLoadUnified;
+            updateDeviceLoad(cu->deviceId, -chan->channelLoadUnified, -1);
+        }
+    } else {
+        /* return the resource into default pool */
+        cu->hot->totalUsedLoadUnified -= chan->channelLoadUnified;
+        updateDeviceLoad(cu->deviceId, -chan->channelLoadUnified, -1);
     }
+    cuFreeChannel(cu, chanId);
 
-    /* If there is NO other channel used by the same client */
-    if (!procChanCnt) {
-        /* update cu->clients */
-        removeClientOnCu(cu, clientId);
-    }
+    /* update dev->clientProcs ref count */
+    releaseClientOnDev(devId, clientId);
 
-    return (ret);
+    /* update cu->clients, the client is removed if there is NO other channel used by it */
+    releaseClientChanOnCu(cu, clientId);
+
+    return (XRM_SUCCESS);
 }
 
 /*
@@ -3683,6 +5564,68 @@ int32_t xrm::system::resReleaseCuListV2(cuListResourceV2* cuListResV2) {
     return (ret);
 }
 
+/*
+ * Alloc a batch of independent cu, each one as resAllocCuV2(). The result of each cu is
+ * recorded in cuBatchResV2->cuResults, the resource of the failed cu is left empty.
+ *
+ * With allOrNothing, the batch stops at the first failed cu and the cu already allocated
+ * are released; the failed cu keeps its error and all others are marked as XRM_ERROR.
+ *
+ * XRM_SUCCESS: all cu of the batch are allocated
+ * Otherwise: the error of the first failed cu
+ *
+ * Lock: should enter lock during the cu allocation
+ */
+int32_t xrm::system::resAllocCuBatchV2(cuBatchPropertyV2* cuBatchPropV2, cuBatchResourceV2* cuBatchResV2) {
+    int32_t i, ret = XRM_SUCCESS;
+
+    if (cuBatchPropV2 == NULL || cuBatchResV2 == NULL) return (XRM_ERROR_INVALID);
+    if (cuBatchPropV2->cuNum <= 0 || cuBatchPropV2->cuNum > XRM_MAX_BATCH_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    /* the all-or-nothing batch is not seen half allocated by others */
+    if (cuBatchPropV2->allOrNothing) lockAllDevices();
+    cuBatchResV2->cuNum = cuBatchPropV2->cuNum;
+    for (i = 0; i < cuBatchPropV2->cuNum; i++) {
+        cuBatchResV2->cuResults[i] = resAllocCuV2(&cuBatchPropV2->cuProps[i], &cuBatchResV2->cuResources[i], true);
+        if (cuBatchResV2->cuResults[i] == XRM_SUCCESS) continue;
+        memset(&cuBatchResV2->cuResources[i], 0, sizeof(cuResource));
+        if (ret == XRM_SUCCESS) ret = cuBatchResV2->cuResults[i];
+        if (cuBatchPropV2->allOrNothing) break;
+    }
+    if (cuBatchPropV2->allOrNothing && ret != XRM_SUCCESS) {
+        for (int32_t j = 0; j < cuBatchPropV2->cuNum; j++) {
+            if (j == i) continue;
+            if (j < i) resReleaseCuV2(&cuBatchResV2->cuResources[j]);
+            memset(&cuBatchResV2->cuResources[j], 0, sizeof(cuResource));
+            cuBatchResV2->cuResults[j] = XRM_ERROR;
+        }
+    }
+    if (cuBatchPropV2->allOrNothing) unlockAllDevices();
+    return (ret);
+}
+
+/*
+ * Release a batch of cu, each one as resReleaseCuV2(), one failed cu does not stop the
+ * release of the others. The result of each cu is recorded in cuBatchResV2->cuResults.
+ *
+ * XRM_SUCCESS: all cu of the batch are released
+ * Otherwise: the error of the first failed cu
+ *
+ * Lock: should enter lock during the cu release
+ */
+int32_t xrm::system::resReleaseCuBatchV2(cuBatchResourceV2* cuBatchResV2) {
+    int32_t i, ret = XRM_SUCCESS;
+
+    if (cuBatchResV2 == NULL) return (XRM_ERROR_INVALID);
+    if (cuBatchResV2->cuNum <= 0 || cuBatchResV2->cuNum > XRM_MAX_BATCH_CU_NUM_V2) return (XRM_ERROR_INVALID);
+
+    for (i = 0; i < cuBatchResV2->cuNum; i++) {
+        cuBatchResV2->cuResults[i] = resReleaseCuV2(&cuBatchResV2->cuResources[i]);
+        if (cuBatchResV2->cuResults[i] != XRM_SUCCESS && ret == XRM_SUCCESS) ret = cuBatchResV2->cuResults[i];
+    }
+    return (ret);
+}
+
 int32_t xrm::system::resReleaseCuGroup(cuGroupResource* cuGroupRes) {
     int32_t i, ret;
     cuResource* cuRes;
@@ -3760,16 +5703,17 @@ int32_t xrm::system::getNextFreeDevForClient(int32_t* devId, cuProperty* cuProp)
         dev = &m_devList[i];
         if (!dev->isLoaded) continue;
 
+        lockDevice(i);
+        bool devAvailable = true;
         if (dev->isExcl) {
-            if (dev->clientProcs[0].clientId == clientId) {
-                /* the client is still inuse */
-                *devId = i;
-                return (XRM_SUCCESS);
-            }
-            continue;
+            /* only available when the client is still inuse */
+            if (dev->clientProcs[0].clientId != clientId) devAvailable = false;
+        }
+        unlockDevice(i);
+        if (devAvailable) {
+            *devId = i;
+            return (XRM_SUCCESS);
         }
-        *devId = i;
-        return (XRM_SUCCESS);
     }
     return (XRM_ERROR_NO_DEV);
 }
@@ -3794,6 +5738,7 @@ int32_t xrm::system::allocClientFromDev(int32_t devId, cuProperty* cuProp) {
     int32_t pidIdx;
     int32_t ref;
 
+    journalMarkProcs(devId);
     /* does process already have exclusive access? */
     if (deviceList[devId].isExcl) {
         if (deviceList[devId].clientProcs[0].clientId == clientId) {
@@ -3810,7 +5755,7 @@ int32_t xrm::system::allocClientFromDev(int32_t devId, cuProperty* cuProp) {
     if (excl) {
         ref = 0;
         /* is another client already using this as a non-exclusive device? */
-        for (pidIdx = 0; pidIdx < XRM_MAX_DEV_CLIENTS; pidIdx++) {
+        for (pidIdx = 0; pidIdx < (int32_t)deviceList[devId].clientProcs.size(); pidIdx++) {
             if (deviceList[devId].clientProcs[pidIdx].clientId &&
                 deviceList[devId].clientProcs[pidIdx].clientId != clientId) {
                 return (XRM_ERROR_NO_DEV);
@@ -3820,10 +5765,9 @@ int32_t xrm::system::allocClientFromDev(int32_t devId, cuProperty* cuProp) {
             }
         }
         deviceList[devId].isExcl = true;
-        memset(deviceList[devId].clientProcs, 0, sizeof(clientData) * XRM_MAX_DEV_CLIENTS);
-        deviceList[devId].clientProcs[0].clientId = clientId;
-        deviceList[devId].clientProcs[0].clientProcessId = clientProcessId;
-        deviceList[devId].clientProcs[0].ref = ref + 1;
+        /* no other client is using the device, only the slot of this client is moved */
+        deviceList[devId].clientProcs.clear();
+        devAddClientProc(devId, clientId, clientProcessId, ref + 1);
         return (XRM_SUCCESS);
     }
 
@@ -3831,21 +5775,55 @@ int32_t xrm::system::allocClientFromDev(int32_t devId, cuProperty* cuProp) {
      * register client as using non-exclusive device
      */
     /* client is already using this non-exclusive device? */
-    for (pidIdx = 0; pidIdx < XRM_MAX_DEV_CLIENTS; pidIdx++)
-        if (deviceList[devId].clientProcs[pidIdx].clientId == clientId) {
-            deviceList[devId].clientProcs[pidIdx].ref++;
-            return (XRM_SUCCESS);
-        }
+    auto it = deviceList[devId].clientIndex.find(clientId);
+    if (it != deviceList[devId].clientIndex.end() && it->second.procIdx >= 0) {
+        deviceList[devId].clientProcs[it->second.procIdx].ref++;
+        return (XRM_SUCCESS);
+    }
     /* There maybe empty slot in dev->clientProcs */
-    for (pidIdx = 0; pidIdx < XRM_MAX_DEV_CLIENTS; pidIdx++)
-        if (!deviceList[devId].clientProcs[pidIdx].clientId) {
-            deviceList[devId].clientProcs[pidIdx].clientId = clientId;
-            deviceList[devId].clientProcs[pidIdx].clientProcessId = clientProcessId;
-            deviceList[devId].clientProcs[pidIdx].ref = 1;
-            return (XRM_SUCCESS);
-        }
+    if (devAddClientProc(devId, clientId, clientProcessId, 1) >= 0) return (XRM_SUCCESS);
+
+    return (XRM_ERROR_NO_DEV);
+}
+
+/*
+ * Puts the client in the first empty slot of dev->clientProcs, or in a new slot at the end
+ * when there is no empty one. The client index of the device records the slot.
+ *
+ * ret: slot of the client,
+ *    : -1, all the XRM_MAX_DEV_CLIENTS slots are in use
+ */
+int32_t xrm::system::devAddClientProc(int32_t devId, uint64_t clientId, pid_t clientProcessId, int32_t ref) {
+    deviceData* dev = &m_devList[devId];
+    int32_t pidIdx;
+
+    for (pidIdx = 0; pidIdx < (int32_t)dev->clientProcs.size(); pidIdx++)
+        if (!dev->clientProcs[pidIdx].clientId) break;
+    if (pidIdx == (int32_t)dev->clientProcs.size()) {
+        if (pidIdx >= XRM_MAX_DEV_CLIENTS) return (-1);
+        dev->clientProcs.emplace_back();
+    }
+    dev->clientProcs[pidIdx].clientId = clientId;
+    dev->clientProcs[pidIdx].clientProcessId = clientProcessId;
+    dev->clientProcs[pidIdx].ref = ref;
+    dev->clientProcs[pidIdx].clientStartTime = getProcessStartTime(clientProcessId);
+    dev->clientIndex[clientId].procIdx = pidIdx;
+    return (pidIdx);
+}
 
-    return (XRM_ERROR_NO_DEV);
+/*
+ * Empties the slot of dev->clientProcs, the empty slots at the end are dropped. The caller
+ * updates the client index of the device.
+ */
+void xrm::system::devRemoveClientProc(int32_t devId, int32_t procIdx) {
+    deviceData* dev = &m_devList[devId];
+
+    if (procIdx < 0 || procIdx >= (int32_t)dev->clientProcs.size()) return;
+    dev->clientProcs[procIdx].clientId = 0;
+    dev->clientProcs[procIdx].clientProcessId = 0;
+    dev->clientProcs[procIdx].ref = 0;
+    dev->clientProcs[procIdx].clientStartTime = 0;
+    while (!dev->clientProcs.empty() && !dev->clientProcs.back().clientId) dev->clientProcs.pop_back();
 }
 
 /*
@@ -3869,6 +5847,33 @@ int32_t xrm::system::verifyProcess(pid_t pid) {
     return (XRM_SUCCESS);
 }
 
+/*
+ * To get the start time of the client process, field 22 of /proc/<pid>/stat in clock ticks
+ * since boot. It's only kept in the state to tell the process of a restored client from a
+ * later one given the same process id, so it's not looked up without persistence.
+ *
+ * return: the start time, 0 if unknown
+ */
+uint64_t xrm::system::getProcessStartTime(pid_t pid) {
+    char procfsStat[32] = {0};
+    char buf[1024];
+    uint64_t startTime = 0;
+
+    if (!m_persistence || pid <= 0) return (0);
+    snprintf(procfsStat, sizeof(procfsStat), "/proc/%d/stat", pid);
+    FILE* fp = fopen(procfsStat, "r");
+    if (fp == NULL) return (0);
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    /* the command name in field 2 may have spaces and ')', the fields after it are numbers */
+    char* field = strrchr(buf, ')');
+    if (field == NULL) return (0);
+    for (int32_t i = 2; i < 22 && field != NULL; i++) field = strchr(field + 1, ' ');
+    if (field != NULL) startTime = strtoull(field + 1, NULL, 10);
+    return (startTime);
+}
+
 /*
  * Alloc one cu (compute unit) from specified device(devId) based on the request property.
  *
@@ -3907,10 +5912,11 @@ cu_alloc_again:
          * if not, free device, increment dev count, re-loop
          */
         for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
             /*
              * compare, 0: equal
              *
@@ -4011,42 +6017,40 @@ int32_t xrm::system::allocChanClientFromCu(
             return XRM_FURTHER_CHECK;
         }
     } else {
-        if (cu->totalUsedLoadUnified + requestLoadUnified > XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
+        if (cu->hot->totalUsedLoadUnified + requestLoadUnified > XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
             return (XRM_ERROR_NO_KERNEL);
         }
         if ((policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_MOST_USED_FIRST ||
              policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_MOST_USED_FIRST) &&
-            cu->totalUsedLoadUnified + requestLoadUnified != XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
-            if (*preCu == NULL || (cu->totalUsedLoadUnified > (*preCu)->totalUsedLoadUnified)) {
+            cu->hot->totalUsedLoadUnified + requestLoadUnified != XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) {
+            if (*preCu == NULL || (cu->hot->totalUsedLoadUnified > (*preCu)->hot->totalUsedLoadUnified)) {
                 *preCu = cu;
             }
             return XRM_FURTHER_CHECK;
         }
         if ((policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST ||
              policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST) &&
-            cu->totalUsedLoadUnified != 0) {
-            if (*preCu == NULL || (cu->totalUsedLoadUnified < (*preCu)->totalUsedLoadUnified)) {
+            cu->hot->totalUsedLoadUnified != 0) {
+            if (*preCu == NULL || (cu->hot->totalUsedLoadUnified < (*preCu)->hot->totalUsedLoadUnified)) {
                 *preCu = cu;
             }
             return XRM_FURTHER_CHECK;
         }
     }
-    if (cu->numChanInuse == 0) { /* unused kernel */
+    if (cu->hot->numChanInuse == 0) { /* unused kernel */
         chanId = 0;
-        cu->channels[chanId].clientId = clientId;
+        uint64_t allocServiceId = getNextAllocServiceId();
+        cuSetChannelInuse(cu, chanId, clientId, allocServiceId);
         cu->channels[chanId].clientProcessId = clientProcessId;
         cu->channels[chanId].channelLoadUnified = requestLoadUnified;
         cu->channels[chanId].channelLoadOriginal = requestLoadOriginal;
-        uint64_t allocServiceId = getNextAllocServiceId();
-        cu->channels[chanId].allocServiceId = allocServiceId;
         cu->channels[chanId].poolId = reservePoolId;
         if (reservePoolId)
             cu->reserves[reserveIdx].reserveUsedLoadUnified += requestLoadUnified;
         else {
-            cu->totalUsedLoadUnified += requestLoadUnified;
+            cu->hot->totalUsedLoadUnified += requestLoadUnified;
             updateDeviceLoad(cu->deviceId, requestLoadUnified, -1);
         }
-        cu->numChanInuse++;
         /* Update cu->clients[], no empty slot in it */
         addClientToCu(cu, clientId);
 
@@ -4069,7 +6073,7 @@ int32_t xrm::system::allocChanClientFromCu(
         cuRes->poolId = reservePoolId;
 
         return (XRM_SUCCESS);
-    } else if (cu->numChanInuse < XRM_MAX_KERNEL_CHANNELS) { /* not maxed the space */
+    } else if (cu->hot->numChanInuse < XRM_MAX_KERNEL_CHANNELS) { /* not maxed the space */
                                                              /* kernel can support request load */
         chanId = cuFindFreeChannelId(cu);
         if (chanId < 0 || chanId > XRM_MAX_KERNEL_CHANNELS) {
@@ -4077,18 +6081,18 @@ int32_t xrm::system::allocChanClientFromCu(
             return (XRM_ERROR_NO_KERNEL);
         }
 
-        cu->channels[chanId].clientId = clientId;
+        uint64_t allocServiceId = getNextAllocServiceId();
+        cuSetChannelInuse(cu, chanId, clientId, allocServiceId);
         cu->channels[chanId].clientProcessId = clientProcessId;
         cu->channels[chanId].channelLoadUnified = requestLoadUnified;
         cu->channels[chanId].channelLoadOriginal = requestLoadOriginal;
-        uint64_t allocServiceId = getNextAllocServiceId();
-        cu->channels[chanId].allocServiceId = allocServiceId;
         cu->channels[chanId].poolId = reservePoolId;
         if (reservePoolId)
             cu->reserves[reserveIdx].reserveUsedLoadUnified += requestLoadUnified;
-        else
-            cu->totalUsedLoadUnified += requestLoadUnified;
-        cu->numChanInuse++;
+        else {
+            cu->hot->totalUsedLoadUnified += requestLoadUnified;
+            updateDeviceLoad(cu->deviceId, requestLoadUnified, -1);
+        }
         /* Update cu->clients[], no empty slot in it */
         addClientToCu(cu, clientId);
 
@@ -4119,9 +6123,9 @@ int32_t xrm::system::allocChanClientFromCu(
 
 /*
  * Add client id at the end of cu->clients[] list. One client uses multiple
- * channel will only be recorded with one slot in cu->clients[], no reference
- * count recorded. So for remove, the caller need to make sure there is no other
- * channels are still used by this client.
+ * channel will only be recorded with one slot in cu->clients[], the number of
+ * channels is counted in cu->clientChanNum[]. Call it once for each channel
+ * allocated to the client.
  *
  * There is no empty slot from clients[0] to clients[numClient - 1]
  */
@@ -4130,15 +6134,17 @@ void xrm::system::addClientToCu(cuData* cu, uint64_t clientId) {
 
     if (cu == NULL) return;
 
+    journalMarkCu(cu);
     i = isClientUsingCu(cu, clientId);
-    if (i >= 0) return;
-
-    /* advance clients pointer to next empty slot */
-    for (i = 0; cu->clients[i]; i++)
-        ;
+    if (i >= 0) {
+        cu->clientChanNum[i]++;
+        return;
+    }
 
-    cu->clients[i] = clientId;
-    cu->numClient++;
+    /* no empty slot, the next slot is at the end of list */
+    cu->clients.push_back(clientId);
+    cu->clientChanNum.push_back(1);
+    cu->hot->numClient++;
 
     return;
 }
@@ -4154,7 +6160,7 @@ void xrm::system::addClientToCu(cuData* cu, uint64_t clientId) {
 int32_t xrm::system::isClientUsingCu(cuData* cu, uint64_t clientId) {
     int32_t i;
 
-    for (i = 0; i < cu->numClient && i < XRM_MAX_KERNEL_CHANNELS; i++) {
+    for (i = 0; i < cu->hot->numClient; i++) {
         if (cu->clients[i] != clientId) continue;
 
         return (i);
@@ -4172,6 +6178,7 @@ int32_t xrm::system::releaseClientOnDev(int32_t devId, uint64_t clientId) {
     deviceData* deviceList = m_devList;
 
     if (!deviceList[devId].isLoaded) return (XRM_ERROR_NO_DEV);
+    journalMarkProcs(devId);
 
     if (deviceList[devId].isExcl) {
         if (deviceList[devId].clientProcs[0].clientId != clientId) {
@@ -4180,20 +6187,23 @@ int32_t xrm::system::releaseClientOnDev(int32_t devId, uint64_t clientId) {
         deviceList[devId].clientProcs[0].ref--;
         if (deviceList[devId].clientProcs[0].ref == 0) {
             deviceList[devId].isExcl = false;
-            deviceList[devId].clientProcs[0].clientId = 0;
-            deviceList[devId].clientProcs[0].clientProcessId = 0;
+            devRemoveClientProc(devId, 0);
+            deviceList[devId].clientIndex[clientId].procIdx = -1;
+            clientIndexTidy(devId, clientId);
         }
         return (XRM_SUCCESS);
     } else {
-        for (int32_t pidIdx = 0; pidIdx < XRM_MAX_DEV_CLIENTS; pidIdx++)
-            if (deviceList[devId].clientProcs[pidIdx].clientId == clientId) {
-                deviceList[devId].clientProcs[pidIdx].ref--;
-                if (deviceList[devId].clientProcs[pidIdx].ref == 0) {
-                    deviceList[devId].clientProcs[pidIdx].clientId = 0;
-                    deviceList[devId].clientProcs[pidIdx].clientProcessId = 0;
-                }
-                return (XRM_SUCCESS);
+        auto it = deviceList[devId].clientIndex.find(clientId);
+        if (it != deviceList[devId].clientIndex.end() && it->second.procIdx >= 0) {
+            int32_t pidIdx = it->second.procIdx;
+            deviceList[devId].clientProcs[pidIdx].ref--;
+            if (deviceList[devId].clientProcs[pidIdx].ref == 0) {
+                devRemoveClientProc(devId, pidIdx);
+                it->second.procIdx = -1;
+                clientIndexTidy(devId, clientId);
             }
+            return (XRM_SUCCESS);
+        }
     }
     return (XRM_ERROR_INVALID);
 }
@@ -4203,12 +6213,16 @@ int32_t xrm::system::releaseClientOnDev(int32_t devId, uint64_t clientId) {
  * The cu->channels and cu->clients are updated
  */
 void xrm::system::releaseAllCuChanClientOnDev(deviceData* dev, uint64_t clientId) {
-    int32_t i, j;
-
     if (dev == NULL) return;
 
-    for (i = 0; i < XRM_MAX_XILINX_KERNELS && i < dev->xclbinInfo.numCu; i++) {
-        cuData* cu = &dev->xclbinInfo.cuList[i];
+    auto it = dev->clientIndex.find(clientId);
+    if (it == dev->clientIndex.end()) return;
+    /* the index entry is changed while freeing the channels, go through a copy of it */
+    std::map<int32_t, std::set<int32_t> > cuChans = it->second.cuChans;
+
+    /* only the cu and channels used by the client are gone through */
+    for (auto& cuChan : cuChans) {
+        cuData* cu = &dev->xclbinInfo.cuList[cuChan.first];
 
         /*
          * for each CU:
@@ -4218,19 +6232,11 @@ void xrm::system::releaseAllCuChanClientOnDev(deviceData* dev, uint64_t clientId
          *    2.2) reserve pool is in-active: return to Big pool (default pool)
          */
 
-        /* Determine if client is using this cu */
-        if (clientId && (isClientUsingCu(cu, clientId) < 0)) continue;
-
         /* Update cu->clients, no empty slot in cu->clients */
         removeClientOnCu(cu, clientId);
 
-        /* clear the channel entries, there maybe empty slot in cu->channels */
-        for (j = 0; j < XRM_MAX_KERNEL_CHANNELS; j++) {
-            uint64_t cu_client = cu->channels[j].clientId;
-
-            /* clientId is 0, the channelLoadUnified are also 0 */
-            if (!cu_client || cu_client != clientId) continue;
-
+        /* clear the channel entries */
+        for (int32_t j : cuChan.second) {
             /*
              * if not from reserve pool, then return to Big pool
              * if from reserve pool, pool is active, return to pool
@@ -4238,59 +6244,35 @@ void xrm::system::releaseAllCuChanClientOnDev(deviceData* dev, uint64_t clientId
              */
             if (cu->channels[j].poolId == 0) {
                 /* Not allocated from reserve pool, then return to Big pool */
-                cu->totalUsedLoadUnified -= cu->channels[j].channelLoadUnified;
+                cu->hot->totalUsedLoadUnified -= cu->channels[j].channelLoadUnified;
                 updateDeviceLoad(cu->deviceId, -cu->channels[j].channelLoadUnified, -1);
-                cu->numChanInuse--;
-                cu->channels[j].clientId = 0;
-                cu->channels[j].clientProcessId = 0;
-                cu->channels[j].channelLoadUnified = 0;
-                cu->channels[j].channelLoadOriginal = 0;
-                cu->channels[j].allocServiceId = 0;
-                cu->channels[j].poolId = 0;
+                cuFreeChannel(cu, j);
             } else {
                 /* Allocated from reserve pool */
-                int32_t reservePoolIdx = -1;
-                for (int32_t reserveIdx = 0; reserveIdx < cu->numReserve; reserveIdx++) {
-                    if (!cu->reserves[reserveIdx].clientIsActive) continue;
-                    if (cu->reserves[reserveIdx].reservePoolId == cu->channels[j].poolId) {
-                        reservePoolIdx = reserveIdx;
-                        break;
-                    }
-                }
+                int32_t reservePoolIdx = isReservePoolUsingCu(cu, cu->channels[j].poolId);
+                if (reservePoolIdx != -1 && !cu->reserves[reservePoolIdx].clientIsActive) reservePoolIdx = -1;
 
                 if (reservePoolIdx != -1) {
                     /* from reserve pool, reserve pool is active, return to reserve pool */
                     cu->reserves[reservePoolIdx].reserveUsedLoadUnified -= cu->channels[j].channelLoadUnified;
-                    cu->numChanInuse--;
-                    cu->channels[j].clientId = 0;
-                    cu->channels[j].clientProcessId = 0;
-                    cu->channels[j].channelLoadUnified = 0;
-                    cu->channels[j].channelLoadOriginal = 0;
-                    cu->channels[j].allocServiceId = 0;
-                    cu->channels[j].poolId = 0;
+                    cuFreeChannel(cu, j);
                 } else {
                     /* from reserve pool, reserve pool is in-active, return to Big pool */
-                    cu->totalUsedLoadUnified -= cu->channels[j].channelLoadUnified;
+                    cu->hot->totalUsedLoadUnified -= cu->channels[j].channelLoadUnified;
                     updateDeviceLoad(cu->deviceId, -cu->channels[j].channelLoadUnified, -1);
-                    cu->numChanInuse--;
-                    cu->channels[j].clientId = 0;
-                    cu->channels[j].clientProcessId = 0;
-                    cu->channels[j].channelLoadUnified = 0;
-                    cu->channels[j].channelLoadOriginal = 0;
-                    cu->channels[j].allocServiceId = 0;
-                    cu->channels[j].poolId = 0;
+                    cuFreeChannel(cu, j);
                 }
             } // end from reserve pool
-        }     /* end channel clearing loop */
-    }         /* end cu loop */
+        } /* end channel clearing loop */
+    }     /* end cu loop */
 }
 
 /*
  * Check whether client is using the cu or not, if yes, remove it from
  * cu->clients[] list and fill the hole. One client uses multiple
- * channel will only be recorded with one slot in cu->clients[], no reference
- * count recorded. So for remove, the caller need to make sure there is no other
- * channels are still used by this client.
+ * channel will only be recorded with one slot in cu->clients[]. So for remove,
+ * the caller need to make sure there is no other channels are still used by
+ * this client, otherwise use releaseClientChanOnCu().
  *
  * There is no empty slot from clients[0] to clients[numClient - 1]
  */
@@ -4304,15 +6286,30 @@ void xrm::system::removeClientOnCu(cuData* cu, uint64_t clientId) {
     }
 
     /* Remove client and defragment list */
-    for (; i < cu->numClient - 1 && i < XRM_MAX_KERNEL_CHANNELS - 1; i++) cu->clients[i] = cu->clients[i + 1];
-
-    /* Zero the last item on the old list after defrag */
-    cu->clients[i] = 0;
-    cu->numClient--;
+    journalMarkCu(cu);
+    cu->clients.erase(cu->clients.begin() + i);
+    cu->clientChanNum.erase(cu->clientChanNum.begin() + i);
+    cu->hot->numClient--;
 
     return;
 }
 
+/*
+ * One channel of the client on the cu is released, remove the client from cu->clients[]
+ * when it's the last channel used by the client.
+ */
+void xrm::system::releaseClientChanOnCu(cuData* cu, uint64_t clientId) {
+    if (cu == NULL) return;
+
+    int32_t i = isClientUsingCu(cu, clientId);
+
+    if (i < 0) {
+        return;
+    }
+    cu->clientChanNum[i]--;
+    if (cu->clientChanNum[i] <= 0) removeClientOnCu(cu, clientId);
+}
+
 /*
  * check cu stat
  *
@@ -4332,77 +6329,105 @@ int32_t xrm::system::checkCuStat(cuResource* cuRes, cuStatus* cuStat) {
     cuId = cuRes->cuId;
     if (cuId < 0 || cuId > XRM_MAX_XILINX_KERNELS) return (XRM_ERROR_INVALID);
 
+    deviceLockGuard devLock(this, devId);
     dev = &m_devList[devId];
+    /* only the cu of the loaded xclbin have data */
+    if (cuId >= dev->xclbinInfo.numCu) return (XRM_ERROR_INVALID);
     cu = &dev->xclbinInfo.cuList[cuId];
 
     /* TODO:: need to get xrt/xma support to get the hardware stat */
-    if (cu->totalUsedLoadUnified > 0)
+    if (cu->hot->totalUsedLoadUnified > 0)
         cuStat->isBusy = true;
     else
         cuStat->isBusy = false;
-    cuStat->usedLoadUnified = cu->totalUsedLoadUnified;
-    cuStat->usedLoadOriginal = (cu->totalUsedLoadUnified << 8);
+    cuStat->usedLoadUnified = cu->hot->totalUsedLoadUnified;
+    cuStat->usedLoadOriginal = (cu->hot->totalUsedLoadUnified << 8);
 
     return (XRM_SUCCESS);
 }
 
 /*
  * increase number of concurrent client
+ *
+ * Lock: protected by counter lock
  */
 bool xrm::system::incNumConcurrentClient() {
+    bool ret = false;
+    pthread_mutex_lock(&m_counterLock);
     if (m_numConcurrentClient < m_limitConcurrentClient) {
         m_numConcurrentClient++;
-        return (true);
-    } else {
-        logMsg(XRM_LOG_DEBUG, "Reach limit of concurrent client (%d)\n", m_limitConcurrentClient);
-        return (false);
+        ret = true;
     }
+    pthread_mutex_unlock(&m_counterLock);
+    if (!ret) logMsg(XRM_LOG_DEBUG, "Reach limit of concurrent client (%d)\n", m_limitConcurrentClient);
+    return (ret);
 }
 
 /*
  * decrease number of concurrent client
+ *
+ * Lock: protected by counter lock
  */
 bool xrm::system::decNumConcurrentClient() {
+    bool ret = false;
+    pthread_mutex_lock(&m_counterLock);
     if (m_numConcurrentClient > 0) {
         m_numConcurrentClient--;
-        return (true);
-    } else {
-        return (false);
+        ret = true;
     }
+    pthread_mutex_unlock(&m_counterLock);
+    return (ret);
 }
 
 /*
  * get number of concurrent client
  *
- * Need to be proected by lock.
+ * Lock: protected by counter lock
  */
 uint32_t xrm::system::getNumConcurrentClient() {
     uint32_t numConcurrentClient;
+    pthread_mutex_lock(&m_counterLock);
     numConcurrentClient = m_numConcurrentClient;
+    pthread_mutex_unlock(&m_counterLock);
     return (numConcurrentClient);
 }
 
+/*
+ * The allocation service id taken by current thread but not yet used by a successful
+ * allocation, 0 if none. Allocations on different devices run in parallel, so each
+ * thread takes its own id from the counter instead of peeking at the counter.
+ */
+static thread_local uint64_t pendingAllocServiceId = 0;
+
 /*
  * get next allocation service id (0x1 - 0xFFFFFFFFFFFFFFFF)
  *
+ * The same id is returned until updateAllocServiceId() is called, so all the cu of one
+ * list allocation share the id.
+ *
  * return: next allocation service id
  */
 uint64_t xrm::system::getNextAllocServiceId() {
-    if (m_allocServiceId == 0xFFFFFFFFFFFFFFFF)
-        return (1);
-    else
-        return (m_allocServiceId + 1);
+    if (pendingAllocServiceId == 0) {
+        pthread_mutex_lock(&m_counterLock);
+        if (m_allocServiceId == 0xFFFFFFFFFFFFFFFF)
+            m_allocServiceId = 1;
+        else
+            m_allocServiceId++;
+        pendingAllocServiceId = m_allocServiceId;
+        pthread_mutex_unlock(&m_counterLock);
+    }
+    return (pendingAllocServiceId);
 }
 
 /*
  * update current allocation service id(0x1 - 0xFFFFFFFFFFFFFFFF)
  *
+ * The id taken by current thread is used, next allocation will take a new one.
  */
 void xrm::system::updateAllocServiceId() {
-    if (m_allocServiceId == 0xFFFFFFFFFFFFFFFF)
-        m_allocServiceId = 1;
-    else
-        m_allocServiceId++;
+    if (pendingAllocServiceId == 0) getNextAllocServiceId();
+    pendingAllocServiceId = 0;
 }
 
 /*
@@ -4433,11 +6458,14 @@ int32_t xrm::system::resAllocationQuery(allocationQueryInfo* allocQuery, cuListR
 
     cuNum = 0;
     memset(cuListRes, 0, sizeof(cuListResource));
-    /* Check all the devices */
+    /* Check all the devices, only the channels with the alloc service id are gone through */
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
-        /* Check all the cu on this device */
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->allocIndex.find(allocServiceId);
+        if (it == dev->allocIndex.end()) continue;
+        for (auto& cuChan : it->second) {
+            cuId = cuChan.first;
+            chanId = cuChan.second;
             cu = &dev->xclbinInfo.cuList[cuId];
             /* kernel name is presented, compare it; otherwise no need to compare */
             kernelNameEqual = true;
@@ -4450,40 +6478,35 @@ int32_t xrm::system::resAllocationQuery(allocationQueryInfo* allocQuery, cuListR
                 if (cu->kernelAlias.compare(allocQuery->kernelAlias)) kernelAliasEqual = false;
             }
             if (!(kernelNameEqual && kernelAliasEqual)) continue;
-            /* Check all the channels on this cu */
-            for (chanId = 0; chanId < XRM_MAX_KERNEL_CHANNELS; chanId++) {
-                chan = &cu->channels[chanId];
-                if (chan->allocServiceId == allocServiceId) {
-                    /* out of cu list limitation */
-                    if (cuNum >= XRM_MAX_LIST_CU_NUM) {
-                        memset(cuListRes, 0, sizeof(cuListResource));
-                        return (XRM_ERROR);
-                    }
-                    cuRes = &cuListRes->cuResources[cuNum];
-                    strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    cuRes->cuType = cu->cuType;
-                    cuRes->baseAddr = cu->baseAddr;
-                    cuRes->membankId = cu->membankId;
-                    cuRes->membankType = cu->membankType;
-                    cuRes->membankSize = cu->membankSize;
-                    cuRes->membankBaseAddr = cu->membankBaseAddr;
-                    cuRes->deviceId = devId;
-                    cuRes->cuId = cuId;
-                    cuRes->channelId = chanId;
-                    cuRes->allocServiceId = allocServiceId;
-                    cuRes->poolId = chan->poolId;
-                    cuRes->clientId = chan->clientId;
-                    cuRes->channelLoadUnified = chan->channelLoadUnified;
-                    cuRes->channelLoadOriginal = chan->channelLoadOriginal;
-                    cuNum++;
-                }
+            chan = &cu->channels[chanId];
+            /* out of cu list limitation */
+            if (cuNum >= XRM_MAX_LIST_CU_NUM) {
+                memset(cuListRes, 0, sizeof(cuListResource));
+                return (XRM_ERROR);
             }
+            cuRes = &cuListRes->cuResources[cuNum];
+            strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
+            cuRes->cuType = cu->cuType;
+            cuRes->baseAddr = cu->baseAddr;
+            cuRes->membankId = cu->membankId;
+            cuRes->membankType = cu->membankType;
+            cuRes->membankSize = cu->membankSize;
+            cuRes->membankBaseAddr = cu->membankBaseAddr;
+            cuRes->deviceId = devId;
+            cuRes->cuId = cuId;
+            cuRes->channelId = chanId;
+            cuRes->allocServiceId = allocServiceId;
+            cuRes->poolId = chan->poolId;
+            cuRes->clientId = chan->clientId;
+            cuRes->channelLoadUnified = chan->channelLoadUnified;
+            cuRes->channelLoadOriginal = chan->channelLoadOriginal;
+            cuNum++;
         }
     }
     cuListRes->cuNum = cuNum;
@@ -4518,11 +6541,14 @@ int32_t xrm::system::resAllocationQueryV2(allocationQueryInfoV2* allocQueryV2, c
 
     cuNum = 0;
     memset(cuListResV2, 0, sizeof(cuListResourceV2));
-    /* Check all the devices */
+    /* Check all the devices, only the channels with the alloc service id are gone through */
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
-        /* Check all the cu on this device */
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->allocIndex.find(allocServiceId);
+        if (it == dev->allocIndex.end()) continue;
+        for (auto& cuChan : it->second) {
+            cuId = cuChan.first;
+            chanId = cuChan.second;
             cu = &dev->xclbinInfo.cuList[cuId];
             /* kernel name is presented, compare it; otherwise no need to compare */
             kernelNameEqual = true;
@@ -4535,40 +6561,35 @@ int32_t xrm::system::resAllocationQueryV2(allocationQueryInfoV2* allocQueryV2, c
                 if (cu->kernelAlias.compare(allocQueryV2->kernelAlias)) kernelAliasEqual = false;
             }
             if (!(kernelNameEqual && kernelAliasEqual)) continue;
-            /* Check all the channels on this cu */
-            for (chanId = 0; chanId < XRM_MAX_KERNEL_CHANNELS; chanId++) {
-                chan = &cu->channels[chanId];
-                if (chan->allocServiceId == allocServiceId) {
-                    /* out of cu list limitation */
-                    if (cuNum >= XRM_MAX_LIST_CU_NUM_V2) {
-                        memset(cuListResV2, 0, sizeof(cuListResource));
-                        return (XRM_ERROR);
-                    }
-                    cuRes = &cuListResV2->cuResources[cuNum];
-                    strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    cuRes->cuType = cu->cuType;
-                    cuRes->baseAddr = cu->baseAddr;
-                    cuRes->membankId = cu->membankId;
-                    cuRes->membankType = cu->membankType;
-                    cuRes->membankSize = cu->membankSize;
-                    cuRes->membankBaseAddr = cu->membankBaseAddr;
-                    cuRes->deviceId = devId;
-                    cuRes->cuId = cuId;
-                    cuRes->channelId = chanId;
-                    cuRes->allocServiceId = allocServiceId;
-                    cuRes->poolId = chan->poolId;
-                    cuRes->clientId = chan->clientId;
-                    cuRes->channelLoadUnified = chan->channelLoadUnified;
-                    cuRes->channelLoadOriginal = chan->channelLoadOriginal;
-                    cuNum++;
-                }
+            chan = &cu->channels[chanId];
+            /* out of cu list limitation */
+            if (cuNum >= XRM_MAX_LIST_CU_NUM_V2) {
+                memset(cuListResV2, 0, sizeof(cuListResource));
+                return (XRM_ERROR);
             }
+            cuRes = &cuListResV2->cuResources[cuNum];
+            strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
+            cuRes->cuType = cu->cuType;
+            cuRes->baseAddr = cu->baseAddr;
+            cuRes->membankId = cu->membankId;
+            cuRes->membankType = cu->membankType;
+            cuRes->membankSize = cu->membankSize;
+            cuRes->membankBaseAddr = cu->membankBaseAddr;
+            cuRes->deviceId = devId;
+            cuRes->cuId = cuId;
+            cuRes->channelId = chanId;
+            cuRes->allocServiceId = allocServiceId;
+            cuRes->poolId = chan->poolId;
+            cuRes->clientId = chan->clientId;
+            cuRes->channelLoadUnified = chan->channelLoadUnified;
+            cuRes->channelLoadOriginal = chan->channelLoadOriginal;
+            cuNum++;
         }
     }
     cuListResV2->cuNum = cuNum;
@@ -4577,18 +6598,42 @@ int32_t xrm::system::resAllocationQueryV2(allocationQueryInfoV2* allocQueryV2, c
 
 /*
  * Recycle all resource from client whose connection is broken.
+ *
+ * Lock: should enter lock (shared lock is enough)
  */
 void xrm::system::recycleResource(uint64_t clientId) {
+    /* the client of the restored state is gone before reclaiming its resources */
+    pthread_mutex_lock(&m_counterLock);
+    m_orphanClients.erase(clientId);
+    pthread_mutex_unlock(&m_counterLock);
+
+    recycleClientOnDevices(clientId);
+    decNumConcurrentClient();
+}
+
+/*
+ * Recycles the resources held by the client on all the devices, the number of concurrent
+ * clients is updated by caller.
+ *
+ * Lock: should enter lock (shared lock is enough)
+ */
+void xrm::system::recycleClientOnDevices(uint64_t clientId) {
     deviceData* dev = NULL;
     cuData* cu = NULL;
     int32_t devId;
-    int64_t tmp_sum = 0;
 
-    /* Check all the devices */
+    /* Check all the devices, one device is locked at a time in ascending order */
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
         if (!dev->isLoaded) continue;
 
+        deviceLockGuard devLock(this, devId);
+        /* only the resources recorded in the client index of the device are gone through */
+        auto it = dev->clientIndex.find(clientId);
+        if (it == dev->clientIndex.end()) continue;
+        std::set<int32_t> reserveCus = it->second.reserveCus;
+        int32_t procIdx = it->second.procIdx;
+        int64_t tmp_sum = 0;
         /* relinquish all reserved resource from the client */
         /*
          * for each CU:
@@ -4597,49 +6642,19 @@ void xrm::system::recycleResource(uint64_t clientId) {
          * 2) resource allocated from pool of this client: reserved but not allocated back
          *    to Big pool (default pool), de-active the client and remove reserve pool
          */
-        for (int32_t cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        for (int32_t cuId : reserveCus) {
             cu = &dev->xclbinInfo.cuList[cuId];
-            for (int32_t reserveIdx = 0; reserveIdx < cu->numReserve; reserveIdx++) {
+            for (int32_t reserveIdx = 0; reserveIdx < cu->hot->numReserve; reserveIdx++) {
                 if (!cu->reserves[reserveIdx].clientIsActive) continue;
                 if (cu->reserves[reserveIdx].clientId == clientId) {
-                    int64_t tmp =
-                        cu->reserves[reserveIdx].reserveLoadUnified - cu->reserves[reserveIdx].reserveUsedLoadUnified;
-                    cu->totalUsedLoadUnified -= tmp;
-                    tmp_sum -= tmp;
-                    cu->totalReservedLoadUnified -= cu->reserves[reserveIdx].reserveLoadUnified;
-                    /*
-                     * To de-active the client and remove reserve pool.
-                     * The allocated resource from this reserve pool will be directly return
-                     * to Big pool in future (either during release or recycle) since the pool is de-active.
-                     */
-                    cu->reserves[reserveIdx].clientIsActive = false;
-                    cu->reserves[reserveIdx].reserveLoadUnified = 0;
-
-                    /* switch the slot until the last one */
-                    int32_t i;
-                    for (i = reserveIdx; i < cu->numReserve - 1; i++) {
-                        cu->reserves[i].reserveLoadUnified = cu->reserves[i + 1].reserveLoadUnified;
-                        cu->reserves[i].reserveUsedLoadUnified = cu->reserves[i + 1].reserveUsedLoadUnified;
-                        cu->reserves[i].reservePoolId = cu->reserves[i + 1].reservePoolId;
-                        cu->reserves[i].clientIsActive = cu->reserves[i + 1].clientIsActive;
-                        cu->reserves[i].clientId = cu->reserves[i + 1].clientId;
-                        cu->reserves[i].clientProcessId = cu->reserves[i + 1].clientProcessId;
-                    }
-                    /* empty the last slot */
-                    cu->reserves[i].reserveLoadUnified = 0;
-                    cu->reserves[i].reserveUsedLoadUnified = 0;
-                    cu->reserves[i].reservePoolId = 0;
-                    cu->reserves[i].clientIsActive = false;
-                    cu->reserves[i].clientId = 0;
-                    cu->reserves[i].clientProcessId = 0;
-                    cu->numReserve--;
+                    tmp_sum -= cuDeactivateReserve(cu, reserveIdx);
                     /* removed one slot, so set the reserveIdx to the right one */
                     reserveIdx--;
                 }
             }
         } // endif relinquish
 
-        updateDeviceLoad(devId, tmp_sum, 0);
+        updateDeviceLoad(devId, tmp_sum, -1);
         /* release all allocated resource from the client */
         /*
          * for each CU:
@@ -4648,31 +6663,218 @@ void xrm::system::recycleResource(uint64_t clientId) {
          *    2.1) reserve pool is active: return to reserver pool
          *    2.2) reserve pool is in-active: return to Big pool (default pool)
          */
-        if (dev->isExcl) {
-            if (dev->clientProcs[0].ref == 0) break;
+        if (procIdx >= 0) {
             /* recycle the resource from the client */
-            if (dev->clientProcs[0].clientId == clientId) {
-                releaseAllCuChanClientOnDev(dev, clientId);
+            journalMarkProcs(devId);
+            releaseAllCuChanClientOnDev(dev, clientId);
+            if (dev->isExcl) {
                 dev->isExcl = false;
-                memset(dev->clientProcs, 0, sizeof(clientData) * XRM_MAX_DEV_CLIENTS);
+                dev->clientProcs.clear();
+            } else {
+                devRemoveClientProc(devId, procIdx);
             }
-        } else {
-            for (int32_t i = 0; i < XRM_MAX_DEV_CLIENTS; i++) {
-                if (dev->clientProcs[i].ref == 0) continue;
-                /* recycle the resource from the client */
-                if (dev->clientProcs[i].clientId == clientId) {
-                    releaseAllCuChanClientOnDev(dev, clientId);
-                    dev->clientProcs[i].clientId = 0;
-                    dev->clientProcs[i].clientProcessId = 0;
-                    dev->clientProcs[i].ref = 0;
+        } // end of release
+        /* nothing is held by the client on this device any more */
+        dev->clientIndex.erase(clientId);
+    }
+}
+
+/*
+ * Gives the reserved but not allocated load of the reserve slot back to the cu, de-actives
+ * the client and removes the reserve slot. The resource allocated from this reserve pool
+ * will be directly returned to Big pool in future (either during release or recycle) since
+ * the pool is de-active.
+ *
+ * return: the load given back, the caller updates the device load with it
+ */
+int64_t xrm::system::cuDeactivateReserve(cuData* cu, int32_t reserveIdx) {
+    int64_t load = cu->reserves[reserveIdx].reserveLoadUnified - cu->reserves[reserveIdx].reserveUsedLoadUnified;
+
+    cu->hot->totalUsedLoadUnified -= load;
+    cu->hot->totalReservedLoadUnified -= cu->reserves[reserveIdx].reserveLoadUnified;
+    cu->reserves[reserveIdx].clientIsActive = false;
+    cu->reserves[reserveIdx].reserveLoadUnified = 0;
+    cuRemoveReserve(cu, reserveIdx);
+    return (load);
+}
+
+/*
+ * The sessions of the clients are gone with the earlier daemon run. The clients holding
+ * resources in the restored state are orphans until they reconnect and reclaim them, or
+ * the grace period ends and the ones whose process is gone are recycled.
+ *
+ * call while holding lock
+ */
+void xrm::system::collectOrphanClients() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&m_counterLock);
+    m_reclaimDeadline = now.tv_sec + m_reclaimGracePeriod;
+    for (int32_t devId = 0; devId < m_numDevice; devId++) {
+        deviceData* dev = &m_devList[devId];
+        if (!dev->isLoaded) continue;
+        for (auto& client : dev->clientIndex) {
+            orphanClient orphan = {0, 0};
+            if (client.second.procIdx >= 0) {
+                orphan.clientProcessId = dev->clientProcs[client.second.procIdx].clientProcessId;
+                orphan.clientStartTime = dev->clientProcs[client.second.procIdx].clientStartTime;
+            } else {
+                for (int32_t cuId : client.second.reserveCus) {
+                    cuData* cu = &dev->xclbinInfo.cuList[cuId];
+                    for (int32_t reserveIdx = 0; reserveIdx < cu->hot->numReserve; reserveIdx++) {
+                        if (cu->reserves[reserveIdx].clientIsActive &&
+                            cu->reserves[reserveIdx].clientId == client.first) {
+                            orphan.clientProcessId = cu->reserves[reserveIdx].clientProcessId;
+                            orphan.clientStartTime = cu->reserves[reserveIdx].clientStartTime;
+                        }
+                    }
                 }
             }
-        } // end of release
+            /* keep the process found first, it's the same one on all the devices */
+            m_orphanClients.insert(std::make_pair(client.first, orphan));
+        }
     }
+    pthread_mutex_unlock(&m_counterLock);
+    logMsg(XRM_LOG_NOTICE, "%s : %lu clients to reclaim their resources in %u seconds", __func__,
+           m_orphanClients.size(), m_reclaimGracePeriod);
+}
 
-    decNumConcurrentClient();
-    /* The save() function is time cost operation, so decide to not it here. */
-    // save();
+/*
+ * Re-binds the resources of the restored state to the client reconnecting after the daemon
+ * is restarted. The allocations and the reserve pools presented by the client are kept and
+ * moved to its process, the others still held by the client are recycled, the client
+ * no longer knows about them.
+ *
+ * XRM_SUCCESS: re-bound, keptAllocServiceIds and keptPoolIds are the presented ones found in
+ *              the restored state, numDropped is the number of allocations and pools recycled
+ * XRM_ERROR_INVALID: the client has nothing in the restored state to reclaim
+ *
+ * Lock: should enter lock
+ */
+int32_t xrm::system::reclaimClient(uint64_t clientId,
+                                   pid_t clientProcessId,
+                                   const std::set<uint64_t>& allocServiceIds,
+                                   const std::set<uint64_t>& poolIds,
+                                   std::set<uint64_t>* keptAllocServiceIds,
+                                   std::set<uint64_t>* keptPoolIds,
+                                   int32_t* numDropped) {
+    std::set<uint64_t> droppedAllocServiceIds, droppedPoolIds;
+    cuResource cuRes;
+    uint64_t clientStartTime = getProcessStartTime(clientProcessId);
+
+    keptAllocServiceIds->clear();
+    keptPoolIds->clear();
+    *numDropped = 0;
+    pthread_mutex_lock(&m_counterLock);
+    bool isOrphan = (m_orphanClients.erase(clientId) > 0);
+    pthread_mutex_unlock(&m_counterLock);
+    if (!isOrphan) return (XRM_ERROR_INVALID);
+
+    for (int32_t devId = 0; devId < m_numDevice; devId++) {
+        deviceData* dev = &m_devList[devId];
+        if (!dev->isLoaded) continue;
+
+        deviceLockGuard devLock(this, devId);
+        auto it = dev->clientIndex.find(clientId);
+        if (it == dev->clientIndex.end()) continue;
+        /* the client index changes while the channels are released, go through a copy */
+        clientDevIndex index = it->second;
+        for (auto& cuChans : index.cuChans) {
+            cuData* cu = &dev->xclbinInfo.cuList[cuChans.first];
+            for (int32_t chanId : cuChans.second) {
+                channelData* chan = &cu->channels[chanId];
+                if (allocServiceIds.count(chan->allocServiceId)) {
+                    keptAllocServiceIds->insert(chan->allocServiceId);
+                    chan->clientProcessId = clientProcessId;
+                    journalMarkChannel(cu, chanId);
+                    continue;
+                }
+                droppedAllocServiceIds.insert(chan->allocServiceId);
+                memset(&cuRes, 0, sizeof(cuResource));
+                cuRes.deviceId = devId;
+                cuRes.cuId = cu->cuId;
+                cuRes.channelId = chanId;
+                cuRes.allocServiceId = chan->allocServiceId;
+                cuRes.poolId = chan->poolId;
+                cuRes.clientId = clientId;
+                resReleaseCu(&cuRes);
+            }
+        }
+        int64_t loadSum = 0;
+        for (int32_t cuId : index.reserveCus) {
+            cuData* cu = &dev->xclbinInfo.cuList[cuId];
+            for (int32_t reserveIdx = 0; reserveIdx < cu->hot->numReserve; reserveIdx++) {
+                reserveData* reserve = &cu->reserves[reserveIdx];
+                if (!reserve->clientIsActive || reserve->clientId != clientId) continue;
+                if (poolIds.count(reserve->reservePoolId)) {
+                    keptPoolIds->insert(reserve->reservePoolId);
+                    reserve->clientProcessId = clientProcessId;
+                    reserve->clientStartTime = clientStartTime;
+                    journalMarkCu(cu);
+                    continue;
+                }
+                droppedPoolIds.insert(reserve->reservePoolId);
+                loadSum -= cuDeactivateReserve(cu, reserveIdx);
+                reserveIdx--;
+            }
+        }
+        updateDeviceLoad(devId, loadSum, -1);
+        it = dev->clientIndex.find(clientId);
+        if (it == dev->clientIndex.end()) continue;
+        if (it->second.procIdx >= 0) {
+            dev->clientProcs[it->second.procIdx].clientProcessId = clientProcessId;
+            dev->clientProcs[it->second.procIdx].clientStartTime = clientStartTime;
+            journalMarkProcs(devId);
+        }
+        clientIndexTidy(devId, clientId);
+    }
+    *numDropped = droppedAllocServiceIds.size() + droppedPoolIds.size();
+    logMsg(XRM_LOG_NOTICE, "%s : client %lu reclaimed by process %d, %d allocations and pools recycled", __func__,
+           clientId, clientProcessId, *numDropped);
+    return (XRM_SUCCESS);
+}
+
+/*
+ * Once the grace period ends, recycles the resources of the clients of the restored state
+ * whose process is gone. The clients still running keep their resources, they reconnect
+ * on their next request; they are checked again on the next call. A process started after
+ * the client's one, given the same process id, is not the client.
+ *
+ * return: true if any resource is recycled
+ *
+ * Lock: should not hold any system lock
+ */
+bool xrm::system::recycleOrphanClients() {
+    std::vector<uint64_t> clientIds;
+    std::map<uint64_t, orphanClient> orphanClients;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&m_counterLock);
+    if (now.tv_sec >= m_reclaimDeadline) orphanClients = m_orphanClients;
+    pthread_mutex_unlock(&m_counterLock);
+    for (auto& client : orphanClients) {
+        if (verifyProcess(client.second.clientProcessId) == XRM_ERROR ||
+            (client.second.clientStartTime &&
+             getProcessStartTime(client.second.clientProcessId) != client.second.clientStartTime))
+            clientIds.push_back(client.first);
+    }
+    if (clientIds.empty()) return (false);
+
+    enterSharedLock();
+    for (uint64_t clientId : clientIds) {
+        /* the client may have reclaimed meanwhile */
+        pthread_mutex_lock(&m_counterLock);
+        bool isOrphan = (m_orphanClients.erase(clientId) > 0);
+        pthread_mutex_unlock(&m_counterLock);
+        if (!isOrphan) continue;
+        logMsg(XRM_LOG_NOTICE, "%s : client %lu is not reclaimed, recycle its resources", __func__, clientId);
+        recycleClientOnDevices(clientId);
+    }
+    exitSharedLock();
+    journalCommit();
+    return (true);
 }
 
 /* the implementation of resource reserve and relinquish */
@@ -4711,15 +6913,57 @@ void xrm::system::updateReservePoolId() {
  * otherwise: return the index of reserve (reserves[i] is using it)
  */
 int32_t xrm::system::isReservePoolUsingCu(cuData* cu, uint64_t reservePoolId) {
-    int32_t i;
-
     if (reservePoolId < 1) return (-1);
-    for (i = 0; i < cu->numReserve && i < XRM_MAX_KERNEL_RESERVES; i++) {
-        if (cu->reserves[i].reservePoolId != reservePoolId) continue;
 
-        return (i);
+    deviceData* dev = &m_devList[cu->deviceId];
+    auto it = dev->reserveIndex.find(reservePoolId);
+    if (it == dev->reserveIndex.end()) return (-1);
+    auto cuIt = it->second.find(cu->cuId);
+    if (cuIt == it->second.end()) return (-1);
+    return (cuIt->second);
+}
+
+/*
+ * Appends a reserve slot of the pool to cu->reserves[], the caller updates the load of the cu.
+ *
+ * There is no empty slot from reserves[0] to reserves[numReserve - 1]
+ */
+void xrm::system::cuAddReserve(
+    cuData* cu, uint64_t reservePoolId, int32_t reserveLoadUnified, uint64_t clientId, pid_t clientProcessId) {
+    int32_t reserveIdx = cu->hot->numReserve;
+
+    journalMarkCu(cu);
+    cu->reserves.emplace_back();
+    cu->reserves[reserveIdx].reserveLoadUnified = reserveLoadUnified;
+    cu->reserves[reserveIdx].reserveUsedLoadUnified = 0;
+    cu->reserves[reserveIdx].reservePoolId = reservePoolId;
+    cu->reserves[reserveIdx].clientIsActive = true;
+    cu->reserves[reserveIdx].clientId = clientId;
+    cu->reserves[reserveIdx].clientProcessId = clientProcessId;
+    cu->reserves[reserveIdx].clientStartTime = getProcessStartTime(clientProcessId);
+    cu->hot->numReserve++;
+    m_devList[cu->deviceId].reserveIndex[reservePoolId][cu->cuId] = reserveIdx;
+    clientIndexAddReserve(cu, clientId);
+}
+
+/*
+ * Removes the reserve slot from cu->reserves[] and fills the hole, the caller updates the
+ * load of the cu.
+ */
+void xrm::system::cuRemoveReserve(cuData* cu, int32_t reserveIdx) {
+    deviceData* dev = &m_devList[cu->deviceId];
+    int32_t i;
+
+    journalMarkCu(cu);
+    auto it = dev->reserveIndex.find(cu->reserves[reserveIdx].reservePoolId);
+    if (it != dev->reserveIndex.end()) {
+        it->second.erase(cu->cuId);
+        if (it->second.empty()) dev->reserveIndex.erase(it);
     }
-    return (-1);
+    /* the slots after the removed one are moved forward */
+    cu->reserves.erase(cu->reserves.begin() + reserveIdx);
+    cu->hot->numReserve--;
+    for (i = reserveIdx; i < cu->hot->numReserve; i++) dev->reserveIndex[cu->reserves[i].reservePoolId][cu->cuId] = i;
 }
 
 /*
@@ -4737,27 +6981,23 @@ int32_t xrm::system::reserveLoadFromCu(uint64_t reservePoolId, cuData* cu, cuPro
     if (requestLoadUnified <= 0 || requestLoadUnified > XRM_MAX_CHAN_LOAD_GRANULARITY_1000000)
         return (XRM_ERROR_INVALID);
 
-    if (((cu->totalUsedLoadUnified + requestLoadUnified) <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) &&
-        ((cu->totalReservedLoadUnified + requestLoadUnified) <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000)) {
+    if (((cu->hot->totalUsedLoadUnified + requestLoadUnified) <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000) &&
+        ((cu->hot->totalReservedLoadUnified + requestLoadUnified) <= XRM_MAX_CHAN_LOAD_GRANULARITY_1000000)) {
         reserveIdx = isReservePoolUsingCu(cu, reservePoolId);
         if (reserveIdx != -1) {
             /* in use, update the existing reserve slot to record the information */
-            cu->totalUsedLoadUnified += requestLoadUnified;
+            journalMarkCu(cu);
+            cu->hot->totalUsedLoadUnified += requestLoadUnified;
             updateDeviceLoad(cu->deviceId, requestLoadUnified, -1);
-            cu->totalReservedLoadUnified += requestLoadUnified;
+            cu->hot->totalReservedLoadUnified += requestLoadUnified;
             cu->reserves[reserveIdx].reserveLoadUnified += requestLoadUnified;
             return (XRM_SUCCESS);
-        } else if (cu->numReserve < XRM_MAX_KERNEL_RESERVES) {
+        } else if (cu->hot->numReserve < XRM_MAX_KERNEL_RESERVES) {
             /* not in use, get a new reserve slot to record the information */
-            cu->totalUsedLoadUnified += requestLoadUnified;
+            cu->hot->totalUsedLoadUnified += requestLoadUnified;
             updateDeviceLoad(cu->deviceId, requestLoadUnified, -1);
-            cu->totalReservedLoadUnified += requestLoadUnified;
-            cu->reserves[cu->numReserve].reserveLoadUnified = requestLoadUnified;
-            cu->reserves[cu->numReserve].reservePoolId = reservePoolId;
-            cu->reserves[cu->numReserve].clientIsActive = true;
-            cu->reserves[cu->numReserve].clientId = cuProp->clientId;
-            cu->reserves[cu->numReserve].clientProcessId = cuProp->clientProcessId;
-            cu->numReserve++;
+            cu->hot->totalReservedLoadUnified += requestLoadUnified;
+            cuAddReserve(cu, reservePoolId, requestLoadUnified, cuProp->clientId, cuProp->clientProcessId);
             return (XRM_SUCCESS);
         }
     }
@@ -4811,10 +7051,11 @@ cu_reserve_loop:
          * if not, free device, increment dev count, re-loop
          */
         for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
             /*
              * compare, 0: equal
              *
@@ -4894,10 +7135,11 @@ cu_reserve_again:
          * if not, free device, increment dev count, re-loop
          */
         for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
             /*
              * compare, 0: equal
              *
@@ -5240,7 +7482,12 @@ int32_t xrm::system::relinquishCuFromDev(uint64_t reservePoolId, int32_t devId,
         logMsg(XRM_LOG_ERROR, "device [%d] is not loaded\n", devId);
         return (ret);
     }
-    for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+    /* only the cu reserved by the pool are gone through */
+    auto it = dev->reserveIndex.find(reservePoolId);
+    if (it == dev->reserveIndex.end()) return (ret);
+    for (auto& cuReserve : it->second) {
+        cuId = cuReserve.first;
+        int32_t i = cuReserve.second;
         cu = &dev->xclbinInfo.cuList[cuId];
         kernelNameEqual = true;
         if (cuProp->kernelName[0] != '\0') {
@@ -5253,37 +7500,19 @@ int32_t xrm::system::relinquishCuFromDev(uint64_t reservePoolId, int32_t devId,
         }
         if (!(kernelNameEqual && kernelAliasEqual)) continue;
 
-        for (int32_t i = 0; i < cu->numReserve; i++) {
-            if ((cu->reserves[i].reservePoolId == reservePoolId) &&
-                (cu->reserves[i].reserveLoadUnified == cuProp->requestLoadUnified)) {
-                /* there maybe same cu reserved, try others */
-                if (cu->reserves[i].reserveUsedLoadUnified) {
-                    continue;
-                }
-                cu->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
-                cu->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                /* switch the slot until the last one */
-                for (; i < cu->numReserve - 1; i++) {
-                    cu->reserves[i].reserveLoadUnified = cu->reserves[i + 1].reserveLoadUnified;
-                    cu->reserves[i].reserveUsedLoadUnified = cu->reserves[i + 1].reserveUsedLoadUnified;
-                    cu->reserves[i].reservePoolId = cu->reserves[i + 1].reservePoolId;
-                    cu->reserves[i].clientIsActive = cu->reserves[i + 1].clientIsActive;
-                    cu->reserves[i].clientId = cu->reserves[i + 1].clientId;
-                    cu->reserves[i].clientProcessId = cu->reserves[i + 1].clientProcessId;
-                }
-                /* empty the last slot */
-                cu->reserves[i].reserveLoadUnified = 0;
-                cu->reserves[i].reserveUsedLoadUnified = 0;
-                cu->reserves[i].reservePoolId = 0;
-                cu->reserves[i].clientIsActive = false;
-                cu->reserves[i].clientId = 0;
-                cu->reserves[i].clientProcessId = 0;
-                cu->numReserve--;
-                /* relinquished the cu successfully */
-                ret = XRM_SUCCESS;
-                return (ret);
+        if (cu->reserves[i].reserveLoadUnified == cuProp->requestLoadUnified) {
+            /* there maybe same cu reserved, try others */
+            if (cu->reserves[i].reserveUsedLoadUnified) {
+                continue;
             }
+            cu->hot->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
+            cu->hot->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            /* the index entry is changed, so return at once */
+            cuRemoveReserve(cu, i);
+            /* relinquished the cu successfully */
+            ret = XRM_SUCCESS;
+            return (ret);
         }
     }
     return (ret);
@@ -5305,36 +7534,21 @@ int32_t xrm::system::resRelinquishCuList(uint64_t reservePoolId) {
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
         if (!dev->isLoaded) continue;
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->reserveIndex.find(reservePoolId);
+        if (it == dev->reserveIndex.end()) continue;
+        /* the index entry is changed while relinquishing, go through a copy of it */
+        std::map<int32_t, int32_t> cuReserves = it->second;
+        for (auto& cuReserve : cuReserves) {
+            cuId = cuReserve.first;
+            int32_t i = cuReserve.second;
             cu = &dev->xclbinInfo.cuList[cuId];
-            for (int32_t i = 0; i < cu->numReserve; i++) {
-                if (cu->reserves[i].reservePoolId == reservePoolId) {
-                    if (cu->reserves[i].reserveUsedLoadUnified) {
-                        return (XRM_ERROR);
-                    }
-                    cu->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                    updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
-                    cu->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                    /* switch the slot until the last one */
-                    for (; i < cu->numReserve - 1; i++) {
-                        cu->reserves[i].reserveLoadUnified = cu->reserves[i + 1].reserveLoadUnified;
-                        cu->reserves[i].reserveUsedLoadUnified = cu->reserves[i + 1].reserveUsedLoadUnified;
-                        cu->reserves[i].reservePoolId = cu->reserves[i + 1].reservePoolId;
-                        cu->reserves[i].clientIsActive = cu->reserves[i + 1].clientIsActive;
-                        cu->reserves[i].clientId = cu->reserves[i + 1].clientId;
-                        cu->reserves[i].clientProcessId = cu->reserves[i + 1].clientProcessId;
-                    }
-                    /* empty the last slot */
-                    cu->reserves[i].reserveLoadUnified = 0;
-                    cu->reserves[i].reserveUsedLoadUnified = 0;
-                    cu->reserves[i].reservePoolId = 0;
-                    cu->reserves[i].clientIsActive = false;
-                    cu->reserves[i].clientId = 0;
-                    cu->reserves[i].clientProcessId = 0;
-                    cu->numReserve--;
-                    break;
-                }
+            if (cu->reserves[i].reserveUsedLoadUnified) {
+                return (XRM_ERROR);
             }
+            cu->hot->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
+            cu->hot->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            cuRemoveReserve(cu, i);
         }
     }
     return (XRM_SUCCESS);
@@ -5384,15 +7598,10 @@ int32_t xrm::system::resReserveCuOfXclbin(
         /* reserve the all the cu on this device */
         for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
             cu = &dev->xclbinInfo.cuList[cuId];
-            cu->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000; // will update dev load at end of loop
-            cu->totalReservedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
-            cu->reserves[0].reserveLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
-            cu->reserves[0].reserveUsedLoadUnified = 0;
-            cu->reserves[0].reservePoolId = reservePoolId;
-            cu->reserves[0].clientIsActive = true;
-            cu->reserves[0].clientId = clientId;
-            cu->reserves[0].clientProcessId = clientProcessId;
-            cu->numReserve = 1;
+            cu->hot->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000; // will update dev load at end of loop
+            cu->hot->totalReservedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
+            /* the device is not busy, so there is no reserve on the cu */
+            cuAddReserve(cu, reservePoolId, XRM_MAX_CU_LOAD_GRANULARITY_1000000, clientId, clientProcessId);
         }
         updateDeviceLoad(devId, 0, dev->xclbinInfo.numCu * XRM_MAX_CU_LOAD_GRANULARITY_1000000);
         *fromDevId = devId;
@@ -5440,15 +7649,10 @@ int32_t xrm::system::resReserveDevice(uint64_t reservePoolId,
     /* reserve the all the cu on this device */
     for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
         cu = &dev->xclbinInfo.cuList[cuId];
-        cu->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000; // end of loop for dev load
-        cu->totalReservedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
-        cu->reserves[0].reserveLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
-        cu->reserves[0].reserveUsedLoadUnified = 0;
-        cu->reserves[0].reservePoolId = reservePoolId;
-        cu->reserves[0].clientIsActive = true;
-        cu->reserves[0].clientId = clientId;
-        cu->reserves[0].clientProcessId = clientProcessId;
-        cu->numReserve = 1;
+        cu->hot->totalUsedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000; // end of loop for dev load
+        cu->hot->totalReservedLoadUnified = XRM_MAX_CU_LOAD_GRANULARITY_1000000;
+        /* the device is not busy, so there is no reserve on the cu */
+        cuAddReserve(cu, reservePoolId, XRM_MAX_CU_LOAD_GRANULARITY_1000000, clientId, clientProcessId);
     }
     updateDeviceLoad(devId, 0, dev->xclbinInfo.numCu * XRM_MAX_CU_LOAD_GRANULARITY_1000000);
     return (XRM_SUCCESS);
@@ -5619,36 +7823,21 @@ int32_t xrm::system::resRelinquishCuPool(uint64_t reservePoolId) {
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
         if (!dev->isLoaded) continue;
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->reserveIndex.find(reservePoolId);
+        if (it == dev->reserveIndex.end()) continue;
+        /* the index entry is changed while relinquishing, go through a copy of it */
+        std::map<int32_t, int32_t> cuReserves = it->second;
+        for (auto& cuReserve : cuReserves) {
+            cuId = cuReserve.first;
+            int32_t i = cuReserve.second;
             cu = &dev->xclbinInfo.cuList[cuId];
-            for (int32_t i = 0; i < cu->numReserve; i++) {
-                if (cu->reserves[i].reservePoolId == reservePoolId) {
-                    if (cu->reserves[i].reserveUsedLoadUnified) {
-                        return (XRM_ERROR);
-                    }
-                    cu->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                    updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
-                    cu->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
-                    /* switch the slot until the last one */
-                    for (; i < cu->numReserve - 1; i++) {
-                        cu->reserves[i].reserveLoadUnified = cu->reserves[i + 1].reserveLoadUnified;
-                        cu->reserves[i].reserveUsedLoadUnified = cu->reserves[i + 1].reserveUsedLoadUnified;
-                        cu->reserves[i].reservePoolId = cu->reserves[i + 1].reservePoolId;
-                        cu->reserves[i].clientIsActive = cu->reserves[i + 1].clientIsActive;
-                        cu->reserves[i].clientId = cu->reserves[i + 1].clientId;
-                        cu->reserves[i].clientProcessId = cu->reserves[i + 1].clientProcessId;
-                    }
-                    /* empty the last slot */
-                    cu->reserves[i].reserveLoadUnified = 0;
-                    cu->reserves[i].reserveUsedLoadUnified = 0;
-                    cu->reserves[i].reservePoolId = 0;
-                    cu->reserves[i].clientIsActive = false;
-                    cu->reserves[i].clientId = 0;
-                    cu->reserves[i].clientProcessId = 0;
-                    cu->numReserve--;
-                    break;
-                }
+            if (cu->reserves[i].reserveUsedLoadUnified) {
+                return (XRM_ERROR);
             }
+            cu->hot->totalUsedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            updateDeviceLoad(devId, -cu->reserves[i].reserveLoadUnified, -1);
+            cu->hot->totalReservedLoadUnified -= cu->reserves[i].reserveLoadUnified;
+            cuRemoveReserve(cu, i);
         }
     }
     return (XRM_SUCCESS);
@@ -5673,10 +7862,9 @@ int32_t xrm::system::resRelinquishCuPoolV2(uint64_t reservePoolId) {
  * Lock: should enter lock during the resource allocation query
  */
 int32_t xrm::system::resReservationQuery(uint64_t reservePoolId, cuPoolResource* cuPoolRes) {
-    int32_t devId, cuId, reserveIdx;
+    int32_t devId, cuId;
     deviceData* dev = NULL;
     cuData* cu = NULL;
-    reserveData* reserve = NULL;
     cuResource* cuRes = NULL;
     int32_t cuNum;
 
@@ -5689,44 +7877,40 @@ int32_t xrm::system::resReservationQuery(uint64_t reservePoolId, cuPoolResource*
 
     cuNum = 0;
     memset(cuPoolRes, 0, sizeof(cuPoolResource));
-    /* Check all the devices */
+    /* Check all the devices, only the cu reserved by the pool are gone through */
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
-        /* Check all the cu on this device */
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->reserveIndex.find(reservePoolId);
+        if (it == dev->reserveIndex.end()) continue;
+        for (auto& cuReserve : it->second) {
+            cuId = cuReserve.first;
             cu = &dev->xclbinInfo.cuList[cuId];
-            /* Check all the reservations on this cu */
-            for (reserveIdx = 0; reserveIdx < cu->numReserve; reserveIdx++) {
-                reserve = &cu->reserves[reserveIdx];
-                if (reserve->reservePoolId == reservePoolId) {
-                    /* out of cu pool limitation */
-                    if (cuNum >= XRM_MAX_POOL_CU_NUM) {
-                        break;
-                        /* to just return max number of cu, instead of return error.
-                         * // memset(cuPoolRes, 0, sizeof(cuPoolResource));
-                         * // return (XRM_ERROR);
-                         */
-                    }
-                    cuRes = &cuPoolRes->cuResources[cuNum];
-                    strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    cuRes->cuType = cu->cuType;
-                    cuRes->baseAddr = cu->baseAddr;
-                    cuRes->membankId = cu->membankId;
-                    cuRes->membankType = cu->membankType;
-                    cuRes->membankSize = cu->membankSize;
-                    cuRes->membankBaseAddr = cu->membankBaseAddr;
-                    cuRes->deviceId = devId;
-                    cuRes->cuId = cuId;
-                    cuRes->poolId = reservePoolId;
-                    cuNum++;
-                }
+            /* out of cu pool limitation */
+            if (cuNum >= XRM_MAX_POOL_CU_NUM) {
+                break;
+                /* to just return max number of cu, instead of return error.
+                 * // memset(cuPoolRes, 0, sizeof(cuPoolResource));
+                 * // return (XRM_ERROR);
+                 */
             }
+            cuRes = &cuPoolRes->cuResources[cuNum];
+            strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
+            cuRes->cuType = cu->cuType;
+            cuRes->baseAddr = cu->baseAddr;
+            cuRes->membankId = cu->membankId;
+            cuRes->membankType = cu->membankType;
+            cuRes->membankSize = cu->membankSize;
+            cuRes->membankBaseAddr = cu->membankBaseAddr;
+            cuRes->deviceId = devId;
+            cuRes->cuId = cuId;
+            cuRes->poolId = reservePoolId;
+            cuNum++;
         }
     }
     cuPoolRes->cuNum = cuNum;
@@ -5742,11 +7926,10 @@ int32_t xrm::system::resReservationQuery(uint64_t reservePoolId, cuPoolResource*
  * Lock: should enter lock during the resource allocation query
  */
 int32_t xrm::system::resReservationQueryV2(reservationQueryInfoV2* reserveQueryInfo, cuPoolResourceV2* cuPoolRes) {
-    int32_t devId, cuId, reserveIdx;
+    int32_t devId, cuId;
     deviceData* dev = NULL;
     cuData* cu = NULL;
     bool kernelNameEqual, kernelAliasEqual;
-    reserveData* reserve = NULL;
     cuResource* cuRes = NULL;
     int32_t cuNum;
 
@@ -5762,11 +7945,13 @@ int32_t xrm::system::resReservationQueryV2(reservationQueryInfoV2* reserveQueryI
 
     cuNum = 0;
     memset(cuPoolRes, 0, sizeof(cuPoolResource));
-    /* Check all the devices */
+    /* Check all the devices, only the cu reserved by the pool are gone through */
     for (devId = 0; devId < m_numDevice; devId++) {
         dev = &m_devList[devId];
-        /* Check all the cu on this device */
-        for (cuId = 0; cuId < dev->xclbinInfo.numCu; cuId++) {
+        auto it = dev->reserveIndex.find(reserveQueryInfo->poolId);
+        if (it == dev->reserveIndex.end()) continue;
+        for (auto& cuReserve : it->second) {
+            cuId = cuReserve.first;
             cu = &dev->xclbinInfo.cuList[cuId];
             /* kernel name is presented, compare it; otherwise no need to compare */
             kernelNameEqual = true;
@@ -5779,38 +7964,32 @@ int32_t xrm::system::resReservationQueryV2(reservationQueryInfoV2* reserveQueryI
                 if (cu->kernelAlias.compare(reserveQueryInfo->kernelAlias)) kernelAliasEqual = false;
             }
             if (!(kernelNameEqual && kernelAliasEqual)) continue;
-            /* Check all the reservations on this cu */
-            for (reserveIdx = 0; reserveIdx < cu->numReserve; reserveIdx++) {
-                reserve = &cu->reserves[reserveIdx];
-                if (reserve->reservePoolId == reserveQueryInfo->poolId) {
-                    /* out of cu pool limitation */
-                    if (cuNum >= XRM_MAX_POOL_CU_NUM_V2) {
-                        break;
-                        /* to just return max number of cu, instead of return error.
-                         * // memset(cuPoolRes, 0, sizeof(cuPoolResource));
-                         * // return (XRM_ERROR);
-                         */
-                    }
-                    cuRes = &cuPoolRes->cuResources[cuNum];
-                    strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
-                    strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
-                    cuRes->cuType = cu->cuType;
-                    cuRes->baseAddr = cu->baseAddr;
-                    cuRes->membankId = cu->membankId;
-                    cuRes->membankType = cu->membankType;
-                    cuRes->membankSize = cu->membankSize;
-                    cuRes->membankBaseAddr = cu->membankBaseAddr;
-                    cuRes->deviceId = devId;
-                    cuRes->cuId = cuId;
-                    cuRes->poolId = reserveQueryInfo->poolId;
-                    cuNum++;
-                }
+            /* out of cu pool limitation */
+            if (cuNum >= XRM_MAX_POOL_CU_NUM_V2) {
+                break;
+                /* to just return max number of cu, instead of return error.
+                 * // memset(cuPoolRes, 0, sizeof(cuPoolResource));
+                 * // return (XRM_ERROR);
+                 */
             }
+            cuRes = &cuPoolRes->cuResources[cuNum];
+            strncpy(cuRes->xclbinFileName, dev->xclbinName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->uuidStr, dev->xclbinInfo.uuidStr.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelPluginFileName, cu->kernelPluginFileName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelName, cu->kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->instanceName, cu->instanceName.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->kernelAlias, cu->kernelAlias.c_str(), XRM_MAX_NAME_LEN - 1);
+            strncpy(cuRes->cuName, cu->cuName.c_str(), XRM_MAX_NAME_LEN - 1);
+            cuRes->cuType = cu->cuType;
+            cuRes->baseAddr = cu->baseAddr;
+            cuRes->membankId = cu->membankId;
+            cuRes->membankType = cu->membankType;
+            cuRes->membankSize = cu->membankSize;
+            cuRes->membankBaseAddr = cu->membankBaseAddr;
+            cuRes->deviceId = devId;
+            cuRes->cuId = cuId;
+            cuRes->poolId = reserveQueryInfo->poolId;
+            cuNum++;
         }
     }
     cuPoolRes->cuNum = cuNum;
@@ -6154,7 +8333,6 @@ int32_t xrm::system::resAllocCuByDevLoad(cuPropertyV2* cuPropV2, cuResource* cuR
     cuData* cu;
     cuData* preCu = NULL;
     int32_t ret = 0;
-    bool kernelNameEqual, kernelAliasEqual, cuNameEqual;
     uint64_t clientId = cuPropV2->clientId;
     int32_t devId, cuId;
     int32_t preDevId = -1, preCuId = -1;
@@ -6164,16 +8342,27 @@ int32_t xrm::system::resAllocCuByDevLoad(cuPropertyV2* cuPropV2, cuResource* cuR
     cuProperty* cuProp = &tmpProp;
     // no need to check cuPropV2 or cuRes as it should be checked already
     cuPropertyCopyFromV2(cuProp, cuPropV2);
-    std::vector<xrm::deviceLoadInfo> devLoadArray(m_numDevice);
-    for (int i = 0; i < m_numDevice; i++) {
-        devLoadArray[i] = m_devList[i].devLoadInfo;
+    const cuIndexEntry* cuEntry = cuIndexFind(cuProp);
+    if (cuEntry == NULL) return (XRM_ERROR_NO_KERNEL);
+    /*
+     * Take the device ids from the device load order, most used first or least used first.
+     * The allocation below changes the device load and so the order, so don't iterate the
+     * order itself.
+     */
+    int32_t devIds[XRM_MAX_XILINX_DEVICES];
+    int32_t numDevice = 0;
+    pthread_mutex_lock(&m_counterLock);
+    if (cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST) {
+        for (auto it = m_devLoadOrder.begin(); it != m_devLoadOrder.end(); ++it) devIds[numDevice++] = it->second;
+    } else {
+        for (auto it = m_devLoadOrder.rbegin(); it != m_devLoadOrder.rend(); ++it) devIds[numDevice++] = it->second;
     }
-    std::sort(devLoadArray.begin(), devLoadArray.end());
+    pthread_mutex_unlock(&m_counterLock);
 
-    for (int i = m_numDevice - 1; i >= 0 && !cuAcquired; i--) {
-        devId = devLoadArray[i].deviceId;
-        if (cuPropV2->policyInfo == XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST)
-            devId = devLoadArray[m_numDevice - 1 - i].deviceId;
+    for (int i = 0; i < numDevice && !cuAcquired; i++) {
+        devId = devIds[i];
+        const std::vector<int32_t>& cuIds = cuEntry->cuIds[devId];
+        if (cuIds.empty()) continue;
         ret = allocClientFromDev(devId, cuProp);
         if (ret < 0) {
             continue;
@@ -6184,24 +8373,11 @@ int32_t xrm::system::resAllocCuByDevLoad(cuPropertyV2* cuPropV2, cuResource* cuR
          * Now check whether matching cu is on allocated device
          * if not, free device, increment dev count, re-loop
          */
-        for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
+        for (size_t j = 0; j < cuIds.size() && !cuAcquired; j++) {
+            cuId = cuIds[j];
             cu = &dev->xclbinInfo.cuList[cuId];
 
-            kernelNameEqual = true;
-            if (cuProp->kernelName[0] != '\0') {
-                if (cu->kernelName.compare(cuProp->kernelName)) kernelNameEqual = false;
-            }
-            /* kernel alias is presented, compare it; otherwise no need to compare */
-            kernelAliasEqual = true;
-            if (cuProp->kernelAlias[0] != '\0') {
-                if (cu->kernelAlias.compare(cuProp->kernelAlias)) kernelAliasEqual = false;
-            }
-            /* cu name is presented, compare it; otherwise no need to compare */
-            cuNameEqual = true;
-            if (cuProp->cuName[0] != '\0') {
-                if (cu->cuName.compare(cuProp->cuName)) cuNameEqual = false;
-            }
-            if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
+            if (!isCuMatching(cu, cuProp)) continue;
             cuData* tmpCu = preCu;
             /* alloc channel and register client id */
             ret = allocChanClientFromCu(cu, cuProp, cuRes, cuPropV2->policyInfo, &preCu);
@@ -6258,7 +8434,6 @@ int32_t xrm::system::resAllocCuByCuLoad(cuPropertyV2* cuPropV2, cuResource* cuRe
     cuData* cu;
     cuData* preCu = NULL;
     int32_t ret = 0;
-    bool kernelNameEqual, kernelAliasEqual, cuNameEqual;
     uint64_t clientId = cuPropV2->clientId;
     int32_t devId, cuId;
     int32_t preDevId = -1, preCuId = -1;
@@ -6269,12 +8444,16 @@ int32_t xrm::system::resAllocCuByCuLoad(cuPropertyV2* cuPropV2, cuResource* cuRe
     cuProperty* cuProp = &tmpProp;
     // no need to check cuPropV2 or cuRes as it should be checked already
     cuPropertyCopyFromV2(cuProp, cuPropV2);
+    const cuIndexEntry* cuEntry = cuIndexFind(cuProp);
+    if (cuEntry == NULL) return (XRM_ERROR_NO_KERNEL);
 cu_alloc_loop:
     for (devId = -1; !cuAcquired && (devId < m_numDevice);) {
         devId = allocDevForClient(&devId, cuProp);
         if (devId < 0) {
             break;
         }
+        const std::vector<int32_t>& cuIds = cuEntry->cuIds[devId];
+        if (cuIds.empty()) continue;
 
         ret = allocClientFromDev(devId, cuProp);
         if (ret < 0) {
@@ -6285,31 +8464,18 @@ cu_alloc_loop:
          * Now check whether matching cu is on allocated device
          * if not, free device, increment dev count, re-loop
          */
-        for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-            cu = &dev->xclbinInfo.cuList[cuId];
+        for (size_t j = 0; j < cuIds.size() && !cuAcquired; j++) {
+            cuId = cuIds[j];
+            cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
             /* first attempt to re-use existing kernels; else, use a new kernel */
-            if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
-            /*
-             * compare, 0: equal
-             *
-             * kernel name is presented, compare it; otherwise no need to compare
-             */
-            kernelNameEqual = true;
-            if (cuProp->kernelName[0] != '\0') {
-                if (cu->kernelName.compare(cuProp->kernelName)) kernelNameEqual = false;
-            }
-            /* kernel alias is presented, compare it; otherwise no need to compare */
-            kernelAliasEqual = true;
-            if (cuProp->kernelAlias[0] != '\0') {
-                if (cu->kernelAlias.compare(cuProp->kernelAlias)) kernelAliasEqual = false;
-            }
-            /* cu name is presented, compare it; otherwise no need to compare */
-            cuNameEqual = true;
-            if (cuProp->cuName[0] != '\0') {
-                if (cu->cuName.compare(cuProp->cuName)) cuNameEqual = false;
-            }
-            if (!(kernelNameEqual && kernelAliasEqual && cuNameEqual)) continue;
+            if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+            /* the cu without enough free load is skipped before its cu data is touched */
+            if (!cuProp->poolId &&
+                hot->totalUsedLoadUnified + cuProp->requestLoadUnified > XRM_MAX_CHAN_LOAD_GRANULARITY_1000000)
+                continue;
+            cu = &dev->xclbinInfo.cuList[cuId];
+            if (!isCuMatching(cu, cuProp)) continue;
             cuData* tmpCu = preCu;
             /* alloc channel and register client id */
             ret = allocChanClientFromCu(cu, cuProp, cuRes, cuPropV2->policyInfo, &preCu);
@@ -6408,10 +8574,11 @@ cu_alloc_from_dev_loop:
     // * and try to allocate requested cu.
     //
     for (cuId = 0; cuId < XRM_MAX_XILINX_KERNELS && cuId < dev->xclbinInfo.numCu && !cuAcquired; cuId++) {
-        cu = &dev->xclbinInfo.cuList[cuId];
+        cuHotData* hot = &dev->xclbinInfo.cuHot[cuId];
 
         /* first attempt to re-use existing kernels; else, use a new kernel */
-        if ((cuAffinityPass && cu->numClient == 0) || (!cuAffinityPass && cu->numClient > 0)) continue;
+        if ((cuAffinityPass && hot->numClient == 0) || (!cuAffinityPass && hot->numClient > 0)) continue;
+        cu = &dev->xclbinInfo.cuList[cuId];
         /*
          * compare, 0: equal
          *
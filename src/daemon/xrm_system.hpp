@@ -20,7 +20,13 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <tuple>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -34,11 +40,6 @@
 #define BOOST_SPIRIT_THREADSAFE // must before json_parser.h and ptree.hpp
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
-#include <boost/serialization/serialization.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <syslog.h>
 #include <signal.h>
 #include <xrt.h>
@@ -46,10 +47,20 @@
 #include "xrm_limits.h"
 #include "xrm_error.h"
 #include "xrm.h"
+#include "xrm_snapshot.hpp"
+#include "xrm_journal.hpp"
+#ifdef XRM_SIM_DEVICE
+#include "xrm_sim_device.hpp"
+#endif
 
 namespace pt = boost::property_tree;
 // XRM_FURTHER_CHECK is used when it can't decide if current cu is best candidate.
 #define XRM_FURTHER_CHECK (-1)
+/* words of the in use channel bitmap of one cu, one bit of cuData::chanFullMap for each word */
+#define XRM_CHAN_BITMAP_WORDS ((XRM_MAX_KERNEL_CHANNELS + 63) / 64)
+#if XRM_CHAN_BITMAP_WORDS > 64
+#error "cuData::chanFullMap can not cover all the channels"
+#endif
 
 namespace xrm {
 
@@ -83,13 +94,6 @@ typedef struct cuProperty {
                           * the system default resource pool id is 0.
                           */
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& kernelName& kernelAlias& cuName& devExcl& requestLoadUnified& requestLoadOriginal& clientId&
-            clientProcessId& poolId;
-    }
 } cuProperty;
 
 /* list of request compute unit resource property */
@@ -98,12 +102,6 @@ typedef struct cuListProperty {
     int32_t cuNum;
     bool sameDevice;
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& cuProps& cuNum& sameDevice;
-    }
 } cuListProperty;
 
 /* user defined compute unit resource group information */
@@ -112,12 +110,6 @@ typedef struct udfCuGroupInformation {
     cuListProperty optionUdfCuListProps[XRM_MAX_UDF_CU_GROUP_OPTION_LIST_NUM];
     int32_t optionUdfCuListNum;
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& udfCuGroupName& optionUdfCuListProps& optionUdfCuListNum;
-    }
 } udfCuGroupInformation;
 
 /* compute resource group property */
@@ -262,13 +254,6 @@ typedef struct cuPropertyV2 {
                           * the system default resource pool id is 0.
                           */
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& kernelName& kernelAlias& cuName& deviceInfo& memoryInfo& policyInfo& devExcl& requestLoadUnified&
-            requestLoadOriginal& clientId& clientProcessId& poolId;
-    }
 } cuPropertyV2;
 
 /* item flags  */
@@ -282,12 +267,6 @@ typedef struct cuListPropertyV2 {
     cuPropertyV2 cuProps[XRM_MAX_LIST_CU_NUM_V2];
     int32_t cuNum;
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& cuProps& cuNum;
-    }
 } cuListPropertyV2;
 
 /* sub list of request compute unit resource property version 2 */
@@ -296,12 +275,6 @@ typedef struct cuSubListPropertyV2 {
     int32_t indexInOriList[XRM_MAX_LIST_CU_NUM_V2];
     int32_t cuNum;
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& cuProps& indexInOriList& cuNum;
-    }
 } cuSubListPropertyV2;
 
 /* user defined compute unit resource group information version 2 */
@@ -310,12 +283,6 @@ typedef struct udfCuGroupInformationV2 {
     cuListPropertyV2 optionUdfCuListProps[XRM_MAX_UDF_CU_GROUP_OPTION_LIST_NUM_V2];
     int32_t optionUdfCuListNum;
     uint8_t extData[64]; // for future extension
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& udfCuGroupName& optionUdfCuListProps& optionUdfCuListNum;
-    }
 } udfCuGroupInformationV2;
 
 /* compute resource group property version 2 */
@@ -357,6 +324,26 @@ typedef struct cuListResourceV2 {
     uint8_t extData[64]; // for future extension
 } cuListResourceV2;
 
+/*
+ * batch of independent compute unit requests version 2
+ */
+typedef struct cuBatchPropertyV2 {
+    cuPropertyV2 cuProps[XRM_MAX_BATCH_CU_NUM_V2];
+    int32_t cuNum;
+    bool allOrNothing;   // the batch is released as a whole if any cu of it fails
+    uint8_t extData[64]; // for future extension
+} cuBatchPropertyV2;
+
+/*
+ * allocated/released compute unit resource batch version 2, with the result of each cu
+ */
+typedef struct cuBatchResourceV2 {
+    cuResource cuResources[XRM_MAX_BATCH_CU_NUM_V2];
+    int32_t cuResults[XRM_MAX_BATCH_CU_NUM_V2];
+    int32_t cuNum;
+    uint8_t extData[64]; // for future extension
+} cuBatchResourceV2;
+
 /*
  * allocated/released sub compute unit resource list version 2
  */
@@ -437,12 +424,6 @@ typedef struct channelData {
                                   * bit[27 -  8] granularity of 1000000 (0 - 1000000)
                                   * bit[ 7 -  0] granularity of 100 (0 - 100)
                                   */
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& channelId& allocServiceId& poolId& clientId& clientProcessId& channelLoadUnified& channelLoadOriginal;
-    }
 } channelData;
 
 /* reserve related data */
@@ -453,12 +434,7 @@ typedef struct reserveData {
     bool clientIsActive;
     uint64_t clientId;
     pid_t clientProcessId;
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& reservePoolId& reserveLoadUnified& reserveUsedLoadUnified& clientIsActive& clientId& clientProcessId;
-    }
+    uint64_t clientStartTime; // start time of the client process, 0: unknown
 } reserveData;
 
 struct deviceData;
@@ -473,9 +449,28 @@ typedef struct deviceLoadInfo {
         devCurrentLoad = 0;
     }
     deviceLoadInfo() {}
-    bool operator<(const deviceLoadInfo& b) { return devLoadRate < b.devLoadRate || deviceId < b.deviceId; }
+    bool operator<(const deviceLoadInfo& b) const {
+        return devLoadRate < b.devLoadRate || (devLoadRate == b.devLoadRate && deviceId < b.deviceId);
+    }
 } deviceLoadInfo;
 
+/* (devLoadRate, deviceId) of all the devices, in ascending order of device load */
+typedef std::set<std::pair<int32_t, int32_t> > deviceLoadOrder;
+
+/*
+ * Scheduling state of one cu, it's all the allocation scan reads from the cu. The hot data of
+ * the cu on one device are packed in xclbinInformation::cuHot, apart from the descriptive data
+ * and the channel bookkeeping in cuData.
+ */
+typedef struct cuHotData {
+    int32_t totalUsedLoadUnified;         // granularity of 1,000,000, allocated load in default pool + reserved load
+    int32_t totalReservedLoadUnified;     // granularity of 1,000,000, reserved load
+    int32_t totalReservedUsedLoadUnified; // granularity of 1,000,000, used load in reserved load
+    int32_t numChanInuse;                 // number of channels in use
+    int32_t numClient;                    // current number of processes attached to cu
+    int32_t numReserve;                   // number of reserves on this cu
+} cuHotData;
+
 /* compute unit data */
 typedef struct cuData {
     int32_t cuId;          // index on one device, start from 0
@@ -492,25 +487,21 @@ typedef struct cuData {
     uint32_t membankType;     // connected memory bank type
     uint64_t membankSize;     // connected memory bank size
     uint64_t membankBaseAddr; // connected memory bank base address
-    channelData channels[XRM_MAX_KERNEL_CHANNELS];
-    int32_t numChanInuse;
-    uint64_t clients[XRM_MAX_KERNEL_CHANNELS]; // client id attached to cu
-    int32_t numClient;                         // current number of processes attached to cu
-    reserveData reserves[XRM_MAX_KERNEL_RESERVES];
-    int32_t numReserve;                   // number of reserves on this cu
-    int32_t totalUsedLoadUnified;         // granularity of 1,000,000, allocated load in default pool + reserved load
-    int32_t totalReservedLoadUnified;     // granularity of 1,000,000, reserved load
-    int32_t totalReservedUsedLoadUnified; // granularity of 1,000,000, used load in reserved load
+    /*
+     * indexed by channel id, grows up to the highest channel id in use and shrinks when the
+     * highest ones are freed, at most XRM_MAX_KERNEL_CHANNELS
+     */
+    std::vector<channelData> channels;
+    uint64_t chanInuseMap[XRM_CHAN_BITMAP_WORDS]; // bit set: the channel is in use, not saved
+    uint64_t chanFullMap;                         // bit set: the word of chanInuseMap is full, not saved
+    std::vector<uint64_t> clients;                // client id attached to cu, numClient entries
+    std::vector<int32_t> clientChanNum;           // number of channels used by clients[i], not saved
+    std::vector<reserveData> reserves;            // numReserve entries, at most XRM_MAX_KERNEL_RESERVES
+    cuHotData* hot;                               // entry of the cu in xclbinInformation::cuHot, not saved
+    bool journalDirty = false;                    // changed since the last journal record, not saved
+    std::vector<int32_t> journalDirtyChans;       // channels changed since the last journal record, not saved
 
     int32_t deviceId;
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& cuId& cuType& kernelName& kernelAlias& cuName& instanceName& kernelPluginFileName& maxCapacity& baseAddr&
-            baseAddr& channels& numChanInuse& clients& numClient& reserves& numReserve& totalUsedLoadUnified&
-                totalReservedLoadUnified& totalReservedUsedLoadUnified;
-    }
 } cuData;
 
 /* memory topology information */
@@ -520,12 +511,6 @@ typedef struct memTopologyData {
     uint64_t memSize;
     uint64_t memBaseAddress;
     unsigned char memTag[16];
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& memType& memUsed& memSize& memBaseAddress& memTag;
-    }
 } memTopologyData;
 
 /* connectivity information */
@@ -533,12 +518,6 @@ typedef struct connectData {
     int32_t argIndex;
     int32_t ipLayoutIndex;
     int32_t memDataIndex;
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& argIndex& ipLayoutIndex& memDataIndex;
-    }
 } connectData;
 
 /* xclbin information */
@@ -548,32 +527,40 @@ typedef struct xclbinInformation {
     int32_t numCu;
     int32_t numHardwareCu;
     int32_t numSoftwareCu;
-    cuData cuList[XRM_MAX_XILINX_KERNELS];
+    std::vector<cuData> cuList;   // numCu entries, at most XRM_MAX_XILINX_KERNELS
+    std::vector<cuHotData> cuHot; // hot data of cuList[i], always the same size as cuList
     int32_t numMemBank;
     int32_t numConnect;
     memTopologyData memTopologyList[XRM_MAX_DDR_MAP];
-    connectData connectList[XRM_MAX_CONNECTION_ENTRIES];
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& uuid& uuidStr& numCu& numHardwareCu& numSoftwareCu& cuList& numMemBank& numConnect& memTopologyList&
-            connectList;
-    }
+    std::vector<connectData> connectList; // numConnect entries
 } xclbinInformation;
 
 typedef struct clientData {
     uint64_t clientId;
     pid_t clientProcessId;
     int32_t ref;
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& clientId& clientProcessId& ref;
-    }
+    uint64_t clientStartTime; // start time of the client process, 0: unknown
 } clientData;
 
+/*
+ * Client of the restored state not reclaimed yet. The start time tells the process apart
+ * from a later one given the same process id.
+ */
+typedef struct orphanClient {
+    pid_t clientProcessId;
+    uint64_t clientStartTime; // 0: unknown
+} orphanClient;
+
+/*
+ * Resources held by one client on one device, so they can be recycled without going
+ * through all the cu, channels and client slots of the device.
+ */
+typedef struct clientDevIndex {
+    int32_t procIdx = -1;                         // slot in deviceData::clientProcs[], -1: not using the device
+    std::map<int32_t, std::set<int32_t> > cuChans; // cu id -> id of channels used by the client
+    std::set<int32_t> reserveCus;                  // id of cu reserved by the client, may be relinquished already
+} clientDevIndex;
+
 typedef struct deviceData {
     std::string dsaName;
     std::string xclbinName;
@@ -585,7 +572,18 @@ typedef struct deviceData {
     xclDeviceHandle deviceHandle;
     xclDeviceInfo2 deviceInfo;
     xclbinInformation xclbinInfo;
-    clientData clientProcs[XRM_MAX_DEV_CLIENTS]; // processes using device (allocation but NOT reservation)
+    /*
+     * processes using device (allocation but NOT reservation), the slot with client id 0 is
+     * free, no free slot at the end, at most XRM_MAX_DEV_CLIENTS
+     */
+    std::vector<clientData> clientProcs;
+    std::unordered_map<uint64_t, clientDevIndex> clientIndex; // client id -> resources held, not saved
+    /* alloc service id -> (cu id, channel id) of the channels allocated with it, not saved */
+    std::unordered_map<uint64_t, std::set<std::pair<int32_t, int32_t> > > allocIndex;
+    /* reserve pool id -> cu id -> index of cu->reserves[] reserved by the pool, not saved */
+    std::unordered_map<uint64_t, std::map<int32_t, int32_t> > reserveIndex;
+    std::vector<int32_t> journalDirtyCus; // cu changed since the last journal record, not saved
+    bool journalProcsDirty = false;       // clientProcs changed since the last journal record, not saved
 
     deviceLoadInfo devLoadInfo;
     void updateDeviceLoad(int64_t loadChangeVal, int64_t setCurLoadVal) {
@@ -598,13 +596,58 @@ typedef struct deviceData {
             devLoadInfo.devCurrentLoad * 1000 / (xclbinInfo.numCu * XRM_MAX_CHAN_LOAD_GRANULARITY_1000000);
         return;
     }
+} deviceData;
+
+/*
+ * Entry of the cu index: the id of cu with the same kernel name (or kernel alias, or cu
+ * name) on each device, in ascending order.
+ */
+typedef struct cuIndexEntry {
+    std::vector<int32_t> cuIds[XRM_MAX_XILINX_DEVICES];
+    int32_t numCu = 0;
+} cuIndexEntry;
+
+typedef std::unordered_map<std::string, cuIndexEntry> cuIndexMap;
+
+/*
+ * Free capacity of one cu seen by the available number check, the check takes resource
+ * from this copy and never changes the cu data.
+ */
+typedef struct cuCapacity {
+    int32_t deviceId;
+    int32_t cuId;
+    int64_t freeLoadUnified; // free load of cu, or free load of the reserve when allocating from pool
+    int32_t freeSlots;       // free channels when allocating, free reserve slots when reserving
+} cuCapacity;
+
+/* one cu of the list being checked */
+typedef struct capacityItem {
+    cuProperty cuProp;
+    int32_t sameDevGroup;            // -1: any device; items of one group are from same device, groups from different
+    std::vector<int32_t> candidates; // index of the matching cu in capacityModel::cus, in device id and cu id order
+} capacityItem;
+
+/* load and slots taken from one cu by one round of the check */
+typedef std::map<int32_t, std::pair<int64_t, int32_t> > capacityUsage;
 
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& dsaName& xclbinName& devId& isDisabled& isLoaded& isExcl& xclbinInfo& clientProcs;
+/*
+ * Capacity model used by the available number check: the cu are copied in on demand, one
+ * round takes one cu list (or one cu pool) from the model, and the round is repeated as
+ * long as it fits. So the cost depends on the number of candidate cu, not on the number
+ * of channels or of the answer.
+ */
+typedef struct capacityModel {
+    bool isReserve; // reservation: loads of one pool on one cu share one reserve slot
+    std::vector<cuCapacity> cus;
+    std::map<std::tuple<int32_t, int32_t, uint64_t>, int32_t> cuPos; // (device id, cu id, pool id) -> index of cus
+    std::vector<capacityItem> items;
+    bool devTaken[XRM_MAX_XILINX_DEVICES]; // whole device is reserved by the check
+    bool devUsed[XRM_MAX_XILINX_DEVICES];  // part of the device is taken by the check
+    capacityModel(bool reserve) : isReserve(reserve) {
+        memset(devTaken, 0, sizeof(devTaken));
+        memset(devUsed, 0, sizeof(devUsed));
     }
-} deviceData;
+} capacityModel;
 
 typedef struct pluginInformation {
     std::string xrmPluginName;
@@ -714,9 +757,27 @@ struct DevLoad {
     uint64_t curDevLoad;
 };
 
+/*
+ * Timing of the snapshots taken so far. The stall is the time the devices are locked for the
+ * snapshot, the allocations wait for it; the duration is the time until the file is written.
+ */
+typedef struct snapshotStats {
+    uint64_t numSnapshot;
+    uint64_t numFailed;
+    uint64_t lastDurationUs;
+    uint64_t maxDurationUs;
+    uint64_t totalDurationUs;
+    uint64_t lastStallUs;
+    uint64_t maxStallUs;
+    uint64_t totalStallUs;
+} snapshotStats;
+
+class metrics;
+
 class system {
    public:
     system() {}
+    ~system() { stopSnapshotThread(); }
 
     void initSystem();
     void initConfig();
@@ -736,6 +797,8 @@ class system {
     int32_t getDeviceNumber();
     int32_t getLogLevel();
     uint64_t getNewClientId();
+    bool isEarlierClientId(uint64_t clientId);
+    uint64_t getGeneration();
     uint32_t getNumConcurrentClient();
     bool incNumConcurrentClient();
     bool decNumConcurrentClient();
@@ -748,12 +811,33 @@ class system {
     void initLock();
     void enterLock();
     void exitLock();
+    void enterSharedLock();
+    void exitSharedLock();
+    void lockDevice(int32_t devId);
+    void unlockDevice(int32_t devId);
+    void lockAllDevices();
+    void unlockAllDevices();
     void logMsg(xrmLogLevelType logLevel, const char* format, ...);
 
     void save();
     bool restore();
+    void journalCommit();
+    void startSnapshotThread();
+    void stopSnapshotThread();
+    snapshotStats getSnapshotStats();
+    void setMetrics(metrics* daemonMetrics) { m_metrics = daemonMetrics; }
+    metrics* getMetrics() { return m_metrics; }
+    void publishMetrics();
 
     void recycleResource(uint64_t clientId);
+    int32_t reclaimClient(uint64_t clientId,
+                          pid_t clientProcessId,
+                          const std::set<uint64_t>& allocServiceIds,
+                          const std::set<uint64_t>& poolIds,
+                          std::set<uint64_t>* keptAllocServiceIds,
+                          std::set<uint64_t>* keptPoolIds,
+                          int32_t* numDropped);
+    bool recycleOrphanClients();
 
     uint64_t getCuMaxCapacity(cuProperty* cuProp);
     int32_t checkCuStat(cuResource* crRes, cuStatus* cuStat);
@@ -776,9 +860,19 @@ class system {
     int32_t resAllocationQueryV2(allocationQueryInfoV2* allocQueryV2, cuListResourceV2* cuListResV2);
     int32_t resReleaseCuV2(cuResource* cuRes);
     int32_t resReleaseCuListV2(cuListResourceV2* cuListResV2);
+    int32_t resAllocCuBatchV2(cuBatchPropertyV2* cuBatchPropV2, cuBatchResourceV2* cuBatchResV2);
+    int32_t resReleaseCuBatchV2(cuBatchResourceV2* cuBatchResV2);
     int32_t resUdfCuGroupDeclareV2(udfCuGroupInformationV2* udfCuGroupInfoV2);
     int32_t resUdfCuGroupUndeclareV2(udfCuGroupInformationV2* udfCuGroupInfoV2);
     int32_t resAllocCuGroupV2(cuGroupPropertyV2* cuGroupPropV2, cuGroupResourceV2* cuGroupResV2);
+    int32_t resCheckCuAvailableNum(cuProperty* cuProp, int32_t* availableNum);
+    int32_t resCheckCuAvailableNumV2(cuPropertyV2* cuPropV2, int32_t* availableNum);
+    int32_t resCheckCuListAvailableNum(cuListProperty* cuListProp, int32_t* availableNum);
+    int32_t resCheckCuListAvailableNumV2(cuListPropertyV2* cuListPropV2, int32_t* availableNum);
+    int32_t resCheckCuGroupAvailableNum(cuGroupProperty* cuGroupProp, int32_t* availableNum);
+    int32_t resCheckCuGroupAvailableNumV2(cuGroupPropertyV2* cuGroupPropV2, int32_t* availableNum);
+    int32_t resCheckCuPoolAvailableNum(cuPoolProperty* cuPoolProp, int32_t* availableNum);
+    int32_t resCheckCuPoolAvailableNumV2(cuPoolPropertyV2* cuPoolPropV2, int32_t* availableNum);
     int32_t resReleaseCuGroupV2(cuGroupResourceV2* cuGroupResV2);
     void flushUdfCuGroupInfoV2(uint32_t udfCuGroupIdx);
     int32_t resAllocCu(cuProperty* cuProp, cuResource* cuRes, bool updateId);
@@ -843,13 +937,34 @@ class system {
     int32_t wrapIPName2Index(xclDeviceHandle handle, const char* ipName);
     int32_t wrapLockDevice(xclDeviceHandle handle);
     int32_t wrapUnlockDevice(xclDeviceHandle handle);
-    void updateDeviceLoad(int32_t devId, int64_t loadIncreased, int64_t setLoadVal) {
-        m_devList[devId].updateDeviceLoad(loadIncreased, setLoadVal);
-    }
+    void updateDeviceLoad(int32_t devId, int64_t loadIncreased, int64_t setLoadVal);
 
    private:
     int32_t xclbinLoadToDevice(int32_t devId, std::string& errmsg);
     int32_t openDevice(int32_t devId);
+    void snapshotPutDevice(snapshotWriter& writer, deviceData* dev);
+    bool snapshotGetDevice(snapshotReader& reader, deviceData* dev);
+    void snapshotPutUdfCuGroups(snapshotWriter& writer);
+    bool snapshotGetUdfCuGroups(snapshotReader& reader);
+    void snapshotPutCuState(snapshotWriter& writer, cuData* cu);
+    bool snapshotGetCuState(snapshotReader& reader, cuData* cu);
+    bool snapshotGetCuChannels(snapshotReader& reader, cuData* cu);
+    bool saveSnapshot();
+    void saveSnapshotInChild();
+    void updateSnapshotStats(bool saved, uint64_t durationUs, uint64_t stallUs);
+    void snapshotThreadFunc();
+    int32_t journalReplay(uint64_t seq, std::vector<deviceData>& devices);
+    bool journalApply(snapshotReader& reader, std::vector<deviceData>& devices);
+    void journalMarkCu(cuData* cu);
+    void journalMarkChannel(cuData* cu, int32_t chanId);
+    void journalMarkProcs(int32_t devId);
+    void journalFlushDevice(int32_t devId);
+    void journalDiscardDevice(int32_t devId);
+    void journalDevice(int32_t devId);
+    void journalUdfCuGroups();
+    void collectOrphanClients();
+    void recycleClientOnDevices(uint64_t clientId);
+    int64_t cuDeactivateReserve(cuData* cu, int32_t reserveIdx);
     int32_t xclbinFileReadUuid(std::string& name, std::string& uuidStr, std::string& errmsg);
     int32_t xclbinReadFile(int32_t devId, std::string& name, std::string& errmsg);
     int32_t deviceLoadXclbin(int32_t devId, std::string& xclbin, std::string& errmsg);
@@ -867,17 +982,49 @@ class system {
     int32_t xclbinGetLayout(int32_t devId, std::string& errmsg);
     int32_t xclbinGetConnectivity(int32_t devId, std::string& errmsg);
     int32_t xclbinGetMemTopology(int32_t devId, std::string& errmsg);
+#ifdef XRM_SIM_DEVICE
+    int32_t xclbinGetSimLayout(int32_t devId, std::string& errmsg);
+#endif
 
     void deviceDumpResource(int32_t devId);
     int32_t deviceLockXclbin(int32_t devId);
     int32_t deviceUnlockXclbin(int32_t devId);
 
+    void cuListResize(xclbinInformation* xclbinInfo, size_t numCu);
     int32_t cuFindFreeChannelId(cuData* cu);
     void cuInitChannels(cuData* cu);
+    void cuSetChannelInuse(cuData* cu, int32_t chanId, uint64_t clientId, uint64_t allocServiceId);
+    void cuFreeChannel(cuData* cu, int32_t chanId);
+    void cuRebuildChannelIndex(cuData* cu);
+    void clientIndexAddReserve(cuData* cu, uint64_t clientId);
+    void clientIndexTidy(int32_t devId, uint64_t clientId);
+    void rebuildDeviceIndex(int32_t devId);
+    void cuAddReserve(
+        cuData* cu, uint64_t reservePoolId, int32_t reserveLoadUnified, uint64_t clientId, pid_t clientProcessId);
+    void cuRemoveReserve(cuData* cu, int32_t reserveIdx);
+    int32_t devAddClientProc(int32_t devId, uint64_t clientId, pid_t clientProcessId, int32_t ref);
+    void devRemoveClientProc(int32_t devId, int32_t procIdx);
+
+    void cuIndexAddDevice(int32_t devId);
+    void cuIndexRemoveDevice(int32_t devId);
+    const cuIndexEntry* cuIndexFind(cuProperty* cuProp);
+    cuData* cuIndexFirstCu(const cuIndexEntry* entry);
+    bool isCuMatching(cuData* cu, cuProperty* cuProp);
+
+    bool capacityIsDeviceUsable(capacityModel* model, int32_t devId, cuProperty* cuProp);
+    int32_t capacityAddItem(capacityModel* model, cuProperty* cuProp, int32_t deviceId, int32_t sameDevGroup);
+    int32_t capacityAddListV2(capacityModel* model, cuListPropertyV2* cuListPropV2);
+    bool capacityTakeCu(capacityModel* model, capacityItem* item, int32_t devId, capacityUsage& usage);
+    bool capacityTakeList(capacityModel* model, capacityUsage& usage);
+    bool capacityTakeDevice(capacityModel* model, int32_t devId, unsigned char* uuid);
+    int32_t capacityCommit(capacityModel* model, capacityUsage& usage, bool repeat);
+    int32_t capacityCountLists(capacityModel* model);
+    int32_t capacityCountCu(cuProperty* cuProp, int32_t deviceId, int32_t* availableNum);
 
     int32_t allocDevForClient(int32_t* devId, cuProperty* cuProp);
     int32_t getNextFreeDevForClient(int32_t* devId, cuProperty* cuProp);
     int32_t verifyProcess(pid_t pid);
+    uint64_t getProcessStartTime(pid_t pid);
     int32_t allocClientFromDev(int32_t devId, cuProperty* cuProp);
     int32_t allocCuFromDev(int32_t devId, cuProperty* cuProp, cuResource* cuRes);
     // allocChanClientFromCu is compatible with previous version (no policy support for allocating cu) if default last
@@ -890,6 +1037,7 @@ class system {
     int32_t releaseClientOnDev(int32_t devId, uint64_t clientId);
     void releaseAllCuChanClientOnDev(deviceData* dev, uint64_t clientId);
     void removeClientOnCu(cuData* cu, uint64_t clientId);
+    void releaseClientChanOnCu(cuData* cu, uint64_t clientId);
 
     uint64_t getNextAllocServiceId();
     void updateAllocServiceId();
@@ -904,6 +1052,8 @@ class system {
     deviceData m_devList[XRM_MAX_XILINX_DEVICES];
     uint32_t m_logLevel;
     uint64_t m_clientId;
+    uint64_t m_clientIdBase; // first client id of this daemon run, not saved
+    uint64_t m_generation;   // tells one daemon run from another, not saved
     uint32_t m_numConcurrentClient;
     uint32_t m_limitConcurrentClient;
     int32_t m_numDevice;
@@ -916,19 +1066,65 @@ class system {
     libVersionDepFunctionsData m_libVersionDepFuncs;
     std::string m_xrtVersionFileFullPathName;
     std::string m_libXrtCoreFileFullPathName;
+#ifdef XRM_SIM_DEVICE
+    std::string m_simDeviceFileFullPathName;
+#endif
     uint64_t m_allocServiceId;
     uint64_t m_reservePoolId;
-    pthread_mutex_t m_lock;
+    pthread_rwlock_t m_lock;
+    pthread_mutex_t m_devLocks[XRM_MAX_XILINX_DEVICES];
+    pthread_mutex_t m_counterLock;
+    pthread_mutex_t m_snapshotLock;
+    deviceLoadOrder m_devLoadOrder; // protected by counter lock, not saved
+    /* cu index of the loaded devices, rebuilt on xclbin load and unload, not saved */
+    cuIndexMap m_kernelNameIndex;
+    cuIndexMap m_kernelAliasIndex;
+    cuIndexMap m_cuNameIndex;
     bool m_devicesInited;
+    bool m_persistence;                     // save the state to the snapshot file, not saved
+    std::string m_snapshotFileFullPathName; // not saved
+    std::string m_journalFileFullPathName;  // not saved
+    bool m_journalSync;                     // not saved
+    uint64_t m_journalCompactSize;          // not saved
+    journal m_journal;                      // changes since the last snapshot, not saved
+    uint32_t m_reclaimGracePeriod;          // not saved
+    /* client id -> process of the clients of the restored state not reclaimed yet, protected by counter lock, not saved */
+    std::map<uint64_t, orphanClient> m_orphanClients;
+    time_t m_reclaimDeadline; // CLOCK_MONOTONIC seconds the grace period ends, not saved
+    bool m_backgroundSnapshot;   // not saved
+    uint32_t m_snapshotInterval; // not saved
+    /* the snapshot thread takes the snapshots after the one at start, not saved */
+    std::thread m_snapshotThread;
+    std::mutex m_snapshotThreadLock;
+    std::condition_variable m_snapshotCond;
+    bool m_snapshotRequested = false;  // protected by m_snapshotThreadLock
+    bool m_snapshotThreadExit = false; // protected by m_snapshotThreadLock
+    snapshotStats m_snapshotStats = {}; // protected by m_snapshotThreadLock
+    metrics* m_metrics = NULL;  // counters of the metrics endpoint, NULL when not served
+    uint64_t m_lockHeldSince;   // CLOCK_MONOTONIC us the system lock is taken exclusively
+};
 
-    friend class boost::serialization::access;
-
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int version) {
-        std::ignore = version;
-        ar& m_logLevel& m_clientId& m_numConcurrentClient& m_devList& m_numDevice& m_udfCuGroups& m_udfCuGroupsV2&
-            m_numUdfCuGroup& m_numUdfCuGroupV2& m_allocServiceId& m_reservePoolId;
+/*
+ * Holds the lock of one device, or the locks of all devices when no device id is given,
+ * until the end of the scope.
+ */
+class deviceLockGuard {
+   public:
+    deviceLockGuard(system* sys, int32_t devId) : m_system(sys), m_devId(devId), m_allDevices(false) {
+        m_system->lockDevice(m_devId);
+    }
+    deviceLockGuard(system* sys) : m_system(sys), m_devId(-1), m_allDevices(true) { m_system->lockAllDevices(); }
+    ~deviceLockGuard() {
+        if (m_allDevices)
+            m_system->unlockAllDevices();
+        else
+            m_system->unlockDevice(m_devId);
     }
+
+   private:
+    system* m_system;
+    int32_t m_devId;
+    bool m_allDevices;
 };
 } // namespace xrm
 
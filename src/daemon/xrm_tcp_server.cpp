@@ -15,10 +15,53 @@
  * under the License.
  */
 
+#include <sys/stat.h>
 #include "xrm_tcp_session.hpp"
 #include "xrm_tcp_server.hpp"
 
 using boost::asio::ip::tcp;
+using boost::asio::local::stream_protocol;
+
+xrm::server::~server() {
+    if (!m_unixSocketPath.empty()) ::unlink(m_unixSocketPath.c_str());
+}
+
+/*
+ * Listen on the unix domain socket in addition to the tcp port. Local clients
+ * prefer it since it avoids the loopback tcp stack and reports the peer credential.
+ *
+ * The tcp port is already bound at this point, so no other daemon instance is
+ * serving; any existing socket file is stale and safe to remove.
+ *
+ * return:
+ *   XRM_SUCCESS: the unix domain socket is listening, or it is disabled by empty path
+ *   XRM_ERROR: failed to listen on the unix domain socket, only tcp is served
+ */
+int32_t xrm::server::listenLocal(const std::string& unixSocketPath) {
+    boost::system::error_code ec;
+
+    if (unixSocketPath.empty()) {
+        m_system->logMsg(XRM_LOG_NOTICE, "%s: unix domain socket is disabled", __func__);
+        return (XRM_SUCCESS);
+    }
+    ::unlink(unixSocketPath.c_str());
+    m_localAcceptor.open(stream_protocol(), ec);
+    if (!ec) m_localAcceptor.bind(stream_protocol::endpoint(unixSocketPath), ec);
+    if (!ec) m_localAcceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+    if (ec) {
+        m_system->logMsg(XRM_LOG_ERROR, "%s: failed to listen on %s, error %s = %d, %s", __func__,
+                         unixSocketPath.c_str(), ec.category().name(), ec.value(), ec.message().c_str());
+        boost::system::error_code closeEc;
+        m_localAcceptor.close(closeEc);
+        return (XRM_ERROR);
+    }
+    /* any local user may connect, same as the tcp port on loopback */
+    ::chmod(unixSocketPath.c_str(), 0666);
+    m_unixSocketPath = unixSocketPath;
+    m_system->logMsg(XRM_LOG_NOTICE, "%s: listening on %s", __func__, unixSocketPath.c_str());
+    doLocalAccept();
+    return (XRM_SUCCESS);
+}
 
 void xrm::server::doAccept() {
     m_acceptor.async_accept(m_socket, [this](boost::system::error_code ec) {
@@ -29,12 +72,32 @@ void xrm::server::doAccept() {
             // m_system->logMsg(XRM_LOG_ERROR, "%s: doAccept(), numConcurrentClient = %lu", __func__,
             // numConcurrentClient);
         } else {
-            auto thisSession = std::make_shared<xrm::session>(std::move(m_socket));
+            auto thisSession = std::make_shared<xrm::session>(
+                m_ioService, boost::asio::generic::stream_protocol::socket(std::move(m_socket)));
             thisSession->setSystem(m_system);
             thisSession->setRegistry(m_registry);
+            thisSession->setWaitQueue(m_waitQueue);
             thisSession->start();
         }
 
         doAccept();
     });
 }
+
+void xrm::server::doLocalAccept() {
+    m_localAcceptor.async_accept(m_localSocket, [this](boost::system::error_code ec) {
+        if (ec) {
+            m_system->logMsg(XRM_LOG_ERROR, "%s: error %s = %d, %s", __func__, ec.category().name(), ec.value(),
+                             ec.message().c_str());
+        } else {
+            auto thisSession = std::make_shared<xrm::session>(
+                m_ioService, boost::asio::generic::stream_protocol::socket(std::move(m_localSocket)));
+            thisSession->setSystem(m_system);
+            thisSession->setRegistry(m_registry);
+            thisSession->setWaitQueue(m_waitQueue);
+            thisSession->start();
+        }
+
+        doLocalAccept();
+    });
+}
@@ -25,6 +25,7 @@
 #include <boost/asio.hpp>
 #include "xrm_command.hpp"
 #include "xrm_system.hpp"
+#include "xrm_wait_queue.hpp"
 
 using boost::asio::ip::tcp;
 
@@ -32,21 +33,37 @@ namespace xrm {
 class server {
    public:
     server(boost::asio::io_service& ioService, short port)
-        : m_acceptor(ioService, tcp::endpoint(tcp::v4(), port)), m_socket(ioService) {
+        : m_ioService(ioService),
+          m_acceptor(ioService, tcp::endpoint(tcp::v4(), port)),
+          m_socket(ioService),
+          m_localAcceptor(ioService),
+          m_localSocket(ioService) {
         doAccept();
     }
 
+    ~server();
+
     void setSystem(xrm::system* sys) { m_system = sys; }
 
     void setRegistry(xrm::commandRegistry* registry) { m_registry = registry; }
 
+    void setWaitQueue(xrm::waitQueue* waitQueue) { m_waitQueue = waitQueue; }
+
+    int32_t listenLocal(const std::string& unixSocketPath);
+
    private:
     void doAccept();
+    void doLocalAccept();
 
+    boost::asio::io_service& m_ioService;
     tcp::acceptor m_acceptor;
     tcp::socket m_socket;
+    boost::asio::local::stream_protocol::acceptor m_localAcceptor;
+    boost::asio::local::stream_protocol::socket m_localSocket;
+    std::string m_unixSocketPath;
     xrm::system* m_system;
     xrm::commandRegistry* m_registry;
+    xrm::waitQueue* m_waitQueue;
 };
 } // namespace xrm
 
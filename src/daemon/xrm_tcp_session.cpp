@@ -17,10 +17,118 @@
 
 #include "xrm_tcp_session.hpp"
 
+/*
+ * Allocation requests which may wait in the daemon for free resource.
+ */
+static bool isWaitableRequest(uint16_t opcode, const std::string& name) {
+    switch (opcode) {
+        case xrm::BINARY_OP_CU_ALLOC:
+        case xrm::BINARY_OP_CU_ALLOC_V2:
+        case xrm::BINARY_OP_CU_LIST_ALLOC:
+        case xrm::BINARY_OP_CU_LIST_ALLOC_V2:
+            return (true);
+        case xrm::BINARY_OP_JSON:
+            return (name == "cuAlloc" || name == "cuAllocV2" || name == "cuListAlloc" || name == "cuListAllocV2" ||
+                    name == "cuGroupAlloc" || name == "cuGroupAllocV2");
+        default:
+            return (false);
+    }
+}
+
+/*
+ * Requests after which a waiting allocation may be satisfied: resource is released,
+ * relinquished or recycled, or new resource comes with xclbin load and device enable.
+ */
+static bool isReleasingRequest(uint16_t opcode, const std::string& name) {
+    switch (opcode) {
+        case xrm::BINARY_OP_CU_RELEASE:
+        case xrm::BINARY_OP_CU_RELEASE_V2:
+        case xrm::BINARY_OP_CU_LIST_RELEASE:
+        case xrm::BINARY_OP_CU_LIST_RELEASE_V2:
+        case xrm::BINARY_OP_CU_BATCH_RELEASE_V2:
+            return (true);
+        case xrm::BINARY_OP_JSON:
+            return (name == "cuRelease" || name == "cuReleaseV2" || name == "cuListRelease" ||
+                    name == "cuListReleaseV2" || name == "cuGroupRelease" || name == "cuGroupReleaseV2" ||
+                    name == "cuPoolRelinquish" || name == "cuPoolRelinquishV2" || name == "destroyContext" ||
+                    name == "reclaimContext" ||
+                    name == "load" || name == "loadOneDevice" || name == "enableDevices" ||
+                    name == "enableOneDevice");
+        default:
+            return (false);
+    }
+}
+
+/*
+ * Key of the wait queue: the single cu request waits with the ones asking for the same kernel
+ * from the same pool, the cu list and cu group requests share one queue.
+ */
+static std::string waitKey(const xrm::binaryHeader& header,
+                           const char* payload,
+                           boost::property_tree::ptree& cmdtree) {
+    if (header.opcode == xrm::BINARY_OP_CU_ALLOC || header.opcode == xrm::BINARY_OP_CU_ALLOC_V2) {
+        char kernelName[XRM_MAX_NAME_LEN], kernelAlias[XRM_MAX_NAME_LEN];
+        xrm::binaryDecoder dec(payload, header.payloadSize);
+        dec.getUint64(); // clientId
+        dec.getInt32();  // clientProcessId
+        dec.getString(kernelName, sizeof(kernelName));
+        dec.getString(kernelAlias, sizeof(kernelAlias));
+        dec.getUint8(); // devExcl
+        if (header.opcode == xrm::BINARY_OP_CU_ALLOC_V2) {
+            dec.getUint64(); // deviceInfo
+            dec.getUint64(); // memoryInfo
+            dec.getUint64(); // policyInfo
+        }
+        dec.getInt32(); // requestLoadUnified
+        dec.getInt32(); // requestLoadOriginal
+        uint64_t poolId = dec.getUint64();
+        return (std::string(kernelName) + "/" + kernelAlias + "@" + std::to_string(poolId));
+    }
+    std::string name = cmdtree.get<std::string>("request.name", "");
+    if (name == "cuAlloc" || name == "cuAllocV2")
+        return (cmdtree.get<std::string>("request.parameters.kernelName", "") + "/" +
+                cmdtree.get<std::string>("request.parameters.kernelAlias", "") + "@" +
+                std::to_string(cmdtree.get<uint64_t>("request.parameters.poolId", 0)));
+    return ("");
+}
+
+void xrm::session::start() {
+    readPeerCredential();
+    if (m_system->getMetrics() != NULL) {
+        m_system->getMetrics()->openSession(m_isLocal ? metrics::TRANSPORT_UNIX : metrics::TRANSPORT_TCP);
+        m_started = true;
+    }
+    doRead();
+}
+
+xrm::session::~session() {
+    if (m_started) m_system->getMetrics()->closeSession(m_isLocal ? metrics::TRANSPORT_UNIX : metrics::TRANSPORT_TCP);
+}
+
+/*
+ * For unix domain socket connection, the kernel reports the credential of the peer
+ * process. It is used as client identity instead of the process id claimed in request.
+ */
+void xrm::session::readPeerCredential() {
+    boost::system::error_code ec;
+    auto localEndpoint = m_socket.local_endpoint(ec);
+    if (ec || localEndpoint.protocol().family() != AF_UNIX) return;
+    m_isLocal = true;
+
+    socklen_t credLen = sizeof(m_peerCred);
+    if (getsockopt(m_socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &m_peerCred, &credLen) == 0) {
+        m_peerCredValid = true;
+        m_system->logMsg(XRM_LOG_DEBUG, "%s: peer pid = %d, uid = %d, gid = %d", __func__, m_peerCred.pid,
+                         m_peerCred.uid, m_peerCred.gid);
+    } else {
+        m_system->logMsg(XRM_LOG_ERROR, "%s: failed to get peer credential, errno = %d", __func__, errno);
+    }
+}
+
 void xrm::session::doRead() {
     auto self(shared_from_this());
     m_socket.async_read_some(boost::asio::buffer(m_indata, max_length),
-                             [this, self](boost::system::error_code const& ec, std::size_t length) {
+                             m_strand.wrap([this, self](boost::system::error_code const& ec, std::size_t length) {
                                  if (ec) {
                                      /* please note that XRM_LOG_DEBUG may NOT be print out on CentOS */
                                      m_system->logMsg(XRM_LOG_DEBUG, "doRead(): ec %s = %d", ec.category().name(),
@@ -30,46 +138,252 @@ void xrm::session::doRead() {
                                      uint64_t clientId = this->getClientId();
                                      /* please note that XRM_LOG_DEBUG may NOT be print out on CentOS */
                                      m_system->logMsg(XRM_LOG_DEBUG, "doRead(): clintId = %lu", clientId);
-                                     m_system->enterLock();
-                                     if (clientId) m_system->recycleResource(clientId);
-                                     m_system->exitLock();
+                                     recycleClient();
                                  }
                                  if (length == 0) {
                                      m_system->logMsg(XRM_LOG_DEBUG, "doRead(): receive 0 length on read, ignored");
-                                 } else {
-                                     handleCmd(length);
+                                     return;
                                  }
-                             });
+                                 m_inbuf.append(m_indata, length);
+                                 processInput();
+                                 if (!m_socket.is_open()) return;
+                                 /* keep reading so that client can pipeline requests */
+                                 if (isReadBlocked())
+                                     m_readPaused = true;
+                                 else
+                                     doRead();
+                             }));
 }
 
-void xrm::session::doWrite(std::size_t length) {
+/*
+ * Handles all the complete requests in the received data, the incomplete tail is
+ * kept until more data arrives.
+ */
+void xrm::session::processInput() {
+    std::size_t offset = 0;
+    xrm::binaryHeader header;
+
+    /* the requests after the parked one are handled once it's done */
+    while (offset < m_inbuf.size() && !m_waiting) {
+        const char* data = m_inbuf.data() + offset;
+        std::size_t size = m_inbuf.size() - offset;
+        if (!xrm::binaryIsMessagePrefix(data, size)) {
+            /* legacy unframed JSON request, all received data is taken as one request */
+            std::string jsonRsp, rsp;
+            handleCmd(data, size, jsonRsp);
+            uint32_t rspLen = jsonRsp.length();
+            rsp.push_back(rspLen & 0xff);
+            rsp.push_back((rspLen >> 8) & 0xff);
+            rsp.push_back((rspLen >> 16) & 0xff);
+            rsp.push_back((rspLen >> 24) & 0xff);
+            rsp.append(jsonRsp);
+            queueResponse(rsp);
+            if (isReleasingRequest(xrm::BINARY_OP_JSON, m_cmdtree.get<std::string>("request.name", "")))
+                m_waitQueue->notify();
+            offset = m_inbuf.size();
+            break;
+        }
+        if (!xrm::binaryDecodeHeader(data, size, header)) break; // header is not complete yet
+        if (header.payloadSize > XRM_BINARY_MAX_PAYLOAD_SIZE) {
+            /* can not find the next request boundary any more */
+            m_system->logMsg(XRM_LOG_ERROR, "%s: request payload size %u exceeds limit %d, close session", __func__,
+                             header.payloadSize, XRM_BINARY_MAX_PAYLOAD_SIZE);
+            closeSession();
+            return;
+        }
+        if (size - XRM_BINARY_HEADER_SIZE < header.payloadSize) break; // payload is not complete yet
+        handleBinaryCmd(header, data + XRM_BINARY_HEADER_SIZE);
+        offset += XRM_BINARY_HEADER_SIZE + header.payloadSize;
+    }
+    m_inbuf.erase(0, offset);
+}
+
+/*
+ * Queues the response, responses are written back in the order of requests. The changes
+ * made by the request are in the journal before the client is told about them.
+ */
+void xrm::session::queueResponse(std::string& rsp) {
+    m_system->journalCommit();
+    bool writing = !m_writeQueue.empty();
+    m_writeQueue.push_back(std::move(rsp));
+    if (!writing) doWrite();
+}
+
+void xrm::session::doWrite() {
     auto self(shared_from_this());
-    boost::asio::async_write(m_socket, boost::asio::buffer(m_outdata, length),
-                             [this, self](boost::system::error_code const& ec, std::size_t /*length*/) {
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_writeQueue.front()),
+                             m_strand.wrap([this, self](boost::system::error_code const& ec, std::size_t /*length*/) {
                                  if (ec) {
                                      uint64_t clientId = this->getClientId();
                                      /* please note that XRM_LOG_DEBUG may NOT be print out on CentOS */
                                      m_system->logMsg(XRM_LOG_DEBUG, "doWrite(): ec %s = %d, clientId = %lu",
                                                       ec.category().name(), ec.value(), clientId);
-                                     m_system->enterLock();
-                                     if (clientId) m_system->recycleResource(clientId);
-                                     m_system->exitLock();
-                                 } else {
+                                     recycleClient();
+                                     return;
+                                 }
+                                 m_writeQueue.pop_front();
+                                 if (!m_writeQueue.empty()) doWrite();
+                                 if (m_readPaused && !isReadBlocked()) {
+                                     m_readPaused = false;
                                      doRead();
                                  }
-                             });
+                             }));
 }
 
-void xrm::session::handleCmd(std::size_t length) {
+/*
+ * Drops the connection on protocol error, the resource of the client is recycled.
+ */
+void xrm::session::closeSession() {
+    recycleClient();
+    boost::system::error_code ec;
+    m_socket.shutdown(boost::asio::socket_base::shutdown_both, ec);
+    m_socket.close(ec);
+}
+
+/*
+ * The client is gone, its parked request is dropped and its resource is recycled.
+ */
+void xrm::session::recycleClient() {
+    uint64_t clientId = getClientId();
+    cancelWait();
+    m_system->enterSharedLock();
+    if (clientId) m_system->recycleResource(clientId);
+    m_system->exitSharedLock();
+    m_system->journalCommit();
+    if (clientId) m_waitQueue->notify();
+}
+
+void xrm::session::handleBinaryCmd(const xrm::binaryHeader& header, const char* payload) {
+    std::string rsp, name;
+    int32_t ret;
+    /* read before the request is tried, see waitQueue::park() */
+    uint64_t generation = m_waitQueue->getGeneration();
+
+    if (header.opcode == xrm::BINARY_OP_JSON) {
+        std::string jsonRsp;
+        ret = handleCmd(payload, header.payloadSize, jsonRsp);
+        name = m_cmdtree.get<std::string>("request.name", "");
+        xrm::binaryEncodeMessage(rsp, header.opcode, XRM_SUCCESS, header.requestId, jsonRsp, header.version);
+    } else {
+        pid_t peerPid = m_peerCredValid ? m_peerCred.pid : 0;
+        ret = xrm::processBinaryCmd(m_system, header, payload, peerPid, rsp);
+    }
+    if (ret != XRM_SUCCESS && ret != XRM_ERROR_INVALID && header.version >= XRM_BINARY_PROTOCOL_VERSION_3 &&
+        header.status != 0 && isWaitableRequest(header.opcode, name)) {
+        waitRequest(header, payload, generation, rsp);
+        return;
+    }
+    queueResponse(rsp);
+    if (isReleasingRequest(header.opcode, name)) m_waitQueue->notify();
+}
+
+/*
+ * Parks the allocation request which can not be satisfied now, rsp is its failure response.
+ * It's retried by the wait queue whenever resource may be freed, and answered with the
+ * failure if it's still not satisfied when the wait time (header.status) is out.
+ */
+void xrm::session::waitRequest(const xrm::binaryHeader& header,
+                               const char* payload,
+                               uint64_t generation,
+                               std::string& rsp) {
     auto self(shared_from_this());
+    xrm::binaryHeader reqHeader = header;
+    std::string reqPayload(payload, header.payloadSize);
+    boost::property_tree::ptree cmdtree;
+    if (header.opcode == xrm::BINARY_OP_JSON) cmdtree = m_cmdtree;
+    std::string key = waitKey(header, payload, cmdtree);
+
+    /* called by the wait queue, maybe on the strand of another session */
+    auto attempt = [this, self, reqHeader, reqPayload, cmdtree]() mutable -> bool {
+        std::string retryRsp;
+        int32_t ret = retryRequest(reqHeader, reqPayload, cmdtree, retryRsp);
+        if (ret != XRM_SUCCESS && ret != XRM_ERROR_INVALID) return (false);
+        m_strand.post([this, self, retryRsp]() mutable { completeWait(retryRsp); });
+        return (true);
+    };
+    m_waiting = true;
+    m_waitFailedRsp = std::move(rsp);
+    m_waiterId = m_waitQueue->park(key, attempt, generation);
+    m_system->logMsg(XRM_LOG_DEBUG, "%s: clientId = %lu, waiterId = %lu, wait %d ms", __func__, m_clientId,
+                     m_waiterId, header.status);
+    if (m_waiterId == 0 || header.status == XRM_BINARY_WAIT_FOREVER) return;
+
+    uint64_t waiterId = m_waiterId;
+    m_waitTimer.expires_from_now(boost::posix_time::milliseconds(header.status));
+    m_waitTimer.async_wait(m_strand.wrap([this, self, waiterId](boost::system::error_code const& ec) {
+        if (ec == boost::asio::error::operation_aborted || !m_waiting || m_waiterId != waiterId) return;
+        /* it may be satisfied just now, then the response is already on the way */
+        if (!m_waitQueue->cancel(waiterId)) return;
+        std::string failedRsp = std::move(m_waitFailedRsp);
+        completeWait(failedRsp);
+    }));
+}
+
+/*
+ * Tries the parked request again. Only the data fixed since the session start is used,
+ * so it's safe to be called outside of the strand.
+ */
+int32_t xrm::session::retryRequest(const xrm::binaryHeader& header,
+                                   const std::string& payload,
+                                   boost::property_tree::ptree& cmdtree,
+                                   std::string& rsp) {
+    if (header.opcode != xrm::BINARY_OP_JSON) {
+        pid_t peerPid = m_peerCredValid ? m_peerCred.pid : 0;
+        return (xrm::processBinaryCmd(m_system, header, payload.data(), peerPid, rsp));
+    }
+    std::stringstream outstr;
+    boost::property_tree::ptree outrsp;
+    std::string name = cmdtree.get<std::string>("request.name", "");
+    m_registry->dispatch(name, cmdtree, outrsp);
+    boost::property_tree::write_json(outstr, outrsp);
+    xrm::binaryEncodeMessage(rsp, header.opcode, XRM_SUCCESS, header.requestId, outstr.str(), header.version);
+    return (outrsp.get<int32_t>("response.status.value", XRM_ERROR));
+}
 
+/*
+ * The parked request is answered, then the requests received meanwhile are handled.
+ */
+void xrm::session::completeWait(std::string& rsp) {
+    if (!m_waiting) return; // dropped since the client is gone
+    m_waiting = false;
+    m_waiterId = 0;
+    m_waitFailedRsp.clear();
+    boost::system::error_code ec;
+    m_waitTimer.cancel(ec);
+    queueResponse(rsp);
+    processInput();
+    if (m_readPaused && m_socket.is_open() && !isReadBlocked()) {
+        m_readPaused = false;
+        doRead();
+    }
+}
+
+/*
+ * Drops the parked request. If it's satisfied meanwhile, the allocated resource is left
+ * to the recycle of the client.
+ */
+void xrm::session::cancelWait() {
+    if (!m_waiting) return;
+    if (m_waiterId) m_waitQueue->cancel(m_waiterId);
+    m_waiting = false;
+    m_waiterId = 0;
+    m_waitFailedRsp.clear();
+    boost::system::error_code ec;
+    m_waitTimer.cancel(ec);
+}
+
+/*
+ * Handles one JSON request, the JSON response text is returned in rsp, and the return value
+ * of the command is returned.
+ */
+int32_t xrm::session::handleCmd(const char* data, std::size_t length, std::string& rsp) {
     std::stringstream instr;
     std::stringstream outstr;
     std::string name, strRequestId, recordClientId;
 
-    m_indata[length] = 0;
-    instr << m_indata;
+    instr << std::string(data, length);
     boost::property_tree::ptree outrsp;
+    m_cmdtree.clear();
     try {
         boost::property_tree::read_json(instr, m_cmdtree);
     } catch (const boost::property_tree::json_parser_error& e) {
@@ -100,19 +414,23 @@ void xrm::session::handleCmd(std::size_t length) {
      * NOTE: During xrm context creating call, the client id will be recorded. It will be used
      * for resource automatic recycle when host application closes connection to XRM daemon.
      */
+    /* the process id from peer credential is trusted over the one claimed by the client */
+    if (m_peerCredValid && m_cmdtree.get_optional<pid_t>("request.parameters.clientProcessId")) {
+        m_cmdtree.put("request.parameters.clientProcessId", m_peerCred.pid);
+    }
+
     recordClientId = m_cmdtree.get<std::string>("request.parameters.recordClientId", "");
     if (recordClientId.c_str()[0] != '\0') {
         m_clientId = m_cmdtree.get<uint64_t>("request.parameters.clientId");
         m_clientProcessId = m_cmdtree.get<pid_t>("request.parameters.clientProcessId");
     }
     m_registry->dispatch(name, m_cmdtree, outrsp);
+    /* one round trip context creating: the client id is the one just given by createContext */
+    if (recordClientId.c_str()[0] != '\0' && name == "createContext")
+        m_clientId = outrsp.get<uint64_t>("response.data.clientId", 0);
 
 end_of_cmd:
     boost::property_tree::write_json(outstr, outrsp);
-    *m_outdata = outstr.str().length() & 0xff;
-    *(m_outdata + 1) = (outstr.str().length() >> 8) & 0xff;
-    *(m_outdata + 2) = (outstr.str().length() >> 16) & 0xff;
-    *(m_outdata + 3) = (outstr.str().length() >> 24) & 0xff;
-    std::strncpy(m_outdata + sizeof(int), outstr.str().c_str(), max_length - 1 - sizeof(int));
-    doWrite(outstr.str().length() + sizeof(int));
+    rsp = outstr.str();
+    return (outrsp.get<int32_t>("response.status.value", XRM_ERROR));
 }
@@ -19,47 +19,104 @@
 #define _XRM_TCP_SESSION_HPP_
 
 #include <cstdlib>
+#include <deque>
 #include <iostream>
 #include <sstream>
 #include <memory>
 #include <utility>
+#include <sys/socket.h>
 #include <boost/asio.hpp>
+#include "xrm_binary_protocol.hpp"
 #include "xrm_command.hpp"
 #include "xrm_command_registry.hpp"
+#include "xrm_metrics.hpp"
 #include "xrm_system.hpp"
+#include "xrm_wait_queue.hpp"
 
 using boost::asio::ip::tcp;
 
 namespace xrm {
 
+/*
+ * One client connection, either over tcp or over the unix domain socket.
+ *
+ * Framed requests (see xrm_binary_protocol.hpp) are accumulated until complete, so
+ * one request may arrive in several reads and one read may carry several pipelined
+ * requests. They are handled in the order received and the responses are queued and
+ * written back in the same order.
+ *
+ * The daemon runs several io threads, the handlers of one session are serialized by
+ * the strand, different sessions are handled in parallel.
+ *
+ * An allocation request asking to wait (see xrm_binary_protocol.hpp) is parked in the
+ * wait queue when it can not be satisfied. The session handles no more requests until it
+ * is answered, but keeps reading so that the close of client is still noticed.
+ */
 class session : public std::enable_shared_from_this<session> {
    public:
-    session(tcp::socket socket) : m_socket(std::move(socket)) {}
+    session(boost::asio::io_service& ioService, boost::asio::generic::stream_protocol::socket socket)
+        : m_strand(ioService), m_socket(std::move(socket)), m_waitTimer(ioService) {}
+    ~session();
 
-    void start() { doRead(); }
+    void start();
 
     void setSystem(xrm::system* sys) { m_system = sys; }
 
     void setRegistry(xrm::commandRegistry* registry) { m_registry = registry; }
 
+    void setWaitQueue(xrm::waitQueue* waitQueue) { m_waitQueue = waitQueue; }
+
     uint64_t getClientId() const { return m_clientId; }
     pid_t getClientProcessId() const { return m_clientProcessId; }
+    bool hasPeerCredential() const { return m_peerCredValid; }
 
    private:
+    void readPeerCredential();
     void doRead();
-    void handleCmd(std::size_t length);
-    void doWrite(std::size_t length);
+    void processInput();
+    int32_t handleCmd(const char* data, std::size_t length, std::string& rsp);
+    void handleBinaryCmd(const xrm::binaryHeader& header, const char* payload);
+    void waitRequest(const xrm::binaryHeader& header, const char* payload, uint64_t generation, std::string& rsp);
+    int32_t retryRequest(const xrm::binaryHeader& header,
+                         const std::string& payload,
+                         boost::property_tree::ptree& cmdtree,
+                         std::string& rsp);
+    void completeWait(std::string& rsp);
+    void cancelWait();
+    void recycleClient();
+    void queueResponse(std::string& rsp);
+    void doWrite();
+    void closeSession();
+    /* too many responses are not yet written back, or too much input piles up behind the parked request */
+    bool isReadBlocked() const {
+        return (m_writeQueue.size() >= max_pending_responses || (m_waiting && m_inbuf.size() >= max_length));
+    }
 
     enum { max_length = 131072 };
+    /* stop reading more requests when so many responses are not yet written back */
+    enum { max_pending_responses = 1024 };
 
-    tcp::socket m_socket;
+    boost::asio::io_service::strand m_strand;
+    boost::asio::generic::stream_protocol::socket m_socket;
     uint64_t m_clientId = 0;
     pid_t m_clientProcessId = 0;
+    bool m_peerCredValid = false;
+    bool m_isLocal = false; // connected over the unix domain socket
+    bool m_started = false; // counted in the sessions of the metrics
+    struct ucred m_peerCred;
     char m_indata[max_length];
-    char m_outdata[max_length];
+    std::string m_inbuf; // received data not yet handled
+    std::deque<std::string> m_writeQueue;
+    bool m_readPaused = false;
     boost::property_tree::ptree m_cmdtree;
+    /* the parked request, m_waiterId is 0 if it's done at park time */
+    bool m_waiting = false;
+    uint64_t m_waiterId = 0;
+    std::string m_waitFailedRsp; // answered on wait timeout
+    boost::asio::deadline_timer m_waitTimer;
     xrm::system* m_system;
     xrm::commandRegistry* m_registry;
+    xrm::waitQueue* m_waitQueue;
 };
 } // namespace xrm
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "xrm_wait_queue.hpp"
+
+/*
+ * Parks one request at the tail of the queue of the key.
+ *
+ * seenGeneration is the generation read before the request was tried, if any notify()
+ * came in between, the freed capacity may have been missed, so the request is retried
+ * here once unless other requests of the same key are already waiting ahead of it.
+ *
+ * return:
+ *   0: the request is done by the retry, the attempt function has handed over the response
+ *   otherwise: id of the parked waiter, used to cancel it
+ */
+uint64_t xrm::waitQueue::park(const std::string& key, attemptFunc attempt, uint64_t seenGeneration) {
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    /* counted before the generation is checked, pairs with notify() */
+    m_numWaiters++;
+    std::deque<waiter>& queue = m_queues[key];
+    if (queue.empty() && m_generation.load() != seenGeneration && attempt()) {
+        m_queues.erase(key);
+        m_numWaiters--;
+        return (0);
+    }
+    uint64_t waiterId = m_nextWaiterId++;
+    queue.push_back({waiterId, attempt});
+    m_waiterKeys[waiterId] = key;
+    return (waiterId);
+}
+
+/*
+ * Removes the parked waiter, it's used on wait timeout and on session close.
+ *
+ * return:
+ *   true: the waiter is removed, its attempt function will not be called any more
+ *   false: the waiter is not parked, it's already done
+ */
+bool xrm::waitQueue::cancel(uint64_t waiterId) {
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    auto keyIter = m_waiterKeys.find(waiterId);
+    if (keyIter == m_waiterKeys.end()) return (false);
+    auto queueIter = m_queues.find(keyIter->second);
+    std::deque<waiter>& queue = queueIter->second;
+    for (auto iter = queue.begin(); iter != queue.end(); iter++) {
+        if (iter->id == waiterId) {
+            queue.erase(iter);
+            break;
+        }
+    }
+    if (queue.empty()) m_queues.erase(queueIter);
+    m_waiterKeys.erase(keyIter);
+    m_numWaiters--;
+    return (true);
+}
+
+/*
+ * Capacity may have been freed, retries the waiters. It's cheap when nobody is waiting,
+ * so it's called after every release without checking what's released.
+ */
+void xrm::waitQueue::notify() {
+    m_generation++;
+    if (m_numWaiters.load() == 0) return;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (auto iter = m_queues.begin(); iter != m_queues.end();) {
+        retryQueue(iter->second);
+        if (iter->second.empty())
+            iter = m_queues.erase(iter);
+        else
+            iter++;
+    }
+}
+
+/*
+ * Retries from the head of the queue, stops at the first waiter still not satisfied so
+ * that later waiters do not take the capacity the earlier one is waiting for.
+ */
+void xrm::waitQueue::retryQueue(std::deque<waiter>& queue) {
+    while (!queue.empty()) {
+        if (!queue.front().attempt()) break;
+        m_waiterKeys.erase(queue.front().id);
+        queue.pop_front();
+        m_numWaiters--;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _XRM_WAIT_QUEUE_HPP_
+#define _XRM_WAIT_QUEUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace xrm {
+
+/*
+ * Allocation requests waiting in the daemon for free capacity.
+ *
+ * A request which can not be satisfied is parked instead of being answered with failure.
+ * Parked requests are kept in FIFO queues keyed by what they ask for (kernel and pool of
+ * single cu request, one shared queue for cu list and cu group requests), so that a waiter
+ * only holds back later waiters asking for the same thing.
+ *
+ * Whenever capacity may be freed (release, relinquish, recycle, load), notify() retries the
+ * head of each queue; as long as the head is satisfied the next one is retried, so freed
+ * capacity goes to the earliest waiter. The retry is done by the attempt function given at
+ * park time, it returns true when the request is done (the response is handed over to the
+ * session of the waiter) and false if it should keep waiting.
+ *
+ * Lock: the attempt functions are called with the wait queue lock held, they may enter the
+ * system lock but must not call back into the wait queue.
+ */
+class waitQueue {
+   public:
+    typedef std::function<bool()> attemptFunc;
+
+    waitQueue() {}
+
+    uint64_t getGeneration() const { return m_generation.load(); }
+    int32_t getNumWaiters() const { return m_numWaiters.load(); }
+
+    uint64_t park(const std::string& key, attemptFunc attempt, uint64_t seenGeneration);
+    bool cancel(uint64_t waiterId);
+    void notify();
+
+   private:
+    typedef struct waiter {
+        uint64_t id;
+        attemptFunc attempt;
+    } waiter;
+
+    void retryQueue(std::deque<waiter>& queue);
+
+    std::mutex m_lock;
+    std::map<std::string, std::deque<waiter> > m_queues;
+    std::map<uint64_t, std::string> m_waiterKeys; // key of each parked waiter
+    uint64_t m_nextWaiterId = 1;
+    std::atomic<uint64_t> m_generation{0}; // number of notify() calls
+    std::atomic<int32_t> m_numWaiters{0};
+};
+} // namespace xrm
+
+#endif // _XRM_WAIT_QUEUE_HPP_
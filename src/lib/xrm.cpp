@@ -15,34 +15,106 @@
  * under the License.
  */
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
+#include <sys/eventfd.h>
 #include <boost/asio.hpp>
+#include <boost/property_tree/ini_parser.hpp>
 
 #include "xrm.h"
 #include "experimental/xrm_experimental.h"
 #include "xrm_system.hpp"
+#include "xrm_binary_protocol.hpp"
 
 using boost::asio::ip::tcp;
 namespace pt = boost::property_tree;
+namespace generic = boost::asio::generic;
 
-static std::recursive_mutex xrmMutex;
+/*
+ * wait time (ms) the daemon may hold the allocation request sent by this thread, 0 means no wait,
+ * XRM_ALLOC_WAIT_FOREVER is XRM_BINARY_WAIT_FOREVER of the binary protocol
+ */
+static thread_local int32_t xrmWaitTime = 0;
+
+/* one asynchronous request, run by the worker thread of the context */
+struct xrmAsyncRequest {
+    uint64_t requestId;
+    std::function<int32_t()> request; // the synchronous call, returns the result
+    xrmAsyncCallback callback;
+    void* userData;
+};
+
+/* the worker thread of the asynchronous requests of one context, started on first submission */
+struct xrmAsyncWorker {
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<xrmAsyncRequest> requests;        // submitted, not run yet
+    std::deque<xrmAsyncCompletion> completions;  // completed without callback, not polled yet
+    int32_t eventFd = -1;                        // readable while completions is not empty
+    uint64_t nextRequestId = 1;
+    bool stopping = false;
+};
 
 struct xrmPrivateContext {
     uint32_t xrmApiVersion;
     xrmLogLevelType xrmLogLevel;
     uint64_t xrmClientId;
-    tcp::socket* socket;
+    generic::stream_protocol::socket* socket; // unix domain socket, or tcp socket as fallback
     boost::asio::io_service* ioService;
-    tcp::resolver* resolver;
+    uint32_t binaryProtocolVersion;     // negotiated binary protocol version, 0 means JSON only
+    uint64_t nextRequestId;             // request id of the next framed request
+    uint64_t daemonGeneration;          // generation of the daemon run, 0 if the daemon does not tell
+    bool disconnected;                  // the connection is broken and failed to reconnect
+    std::recursive_mutex requestMutex;  // one request on the connection at a time
+    xrmAsyncWorker asyncWorker;
+    /* resources held by the context, presented to the restarted daemon to reclaim them */
+    std::mutex heldMutex;
+    std::map<uint64_t, int32_t> heldAllocServiceIds; // alloc service id -> number of cu held
+    std::set<uint64_t> heldPoolIds;                 // reserve pool ids held
 };
 
 enum { maxLength = 131072 };
 
 static int32_t xrmJsonRequest(xrmContext context, const char* jsonReq, char* jsonRsp);
+static int32_t xrmBinaryRequest(xrmPrivateContext* ctx,
+                                uint16_t opcode,
+                                const std::string& reqPayload,
+                                std::string& rspPayload,
+                                int32_t* status);
+static int32_t xrmBinaryTransfer(xrmPrivateContext* ctx,
+                                 uint16_t opcode,
+                                 const std::string& reqPayload,
+                                 std::string& rspPayload,
+                                 int32_t* status);
+static bool xrmConnect(xrmPrivateContext* ctx);
+static bool xrmConnectLocal(xrmPrivateContext* ctx);
+static int32_t xrmHandshake(xrmPrivateContext* ctx);
+static bool xrmReconnect(xrmPrivateContext* ctx);
+static void xrmReclaim(xrmPrivateContext* ctx);
+static int32_t xrmReconcileRelease(xrmPrivateContext* ctx,
+                                   uint16_t opcode,
+                                   const std::string& reqPayload,
+                                   std::string& rspPayload,
+                                   int32_t* status);
+static void xrmTrackReserve(xrmPrivateContext* ctx, uint64_t poolId);
+static void xrmTrackRelinquish(xrmPrivateContext* ctx, uint64_t poolId);
+static uint64_t xrmAsyncSubmit(xrmPrivateContext* ctx,
+                               std::function<int32_t()> request,
+                               xrmAsyncCallback callback,
+                               void* userData);
+static void xrmAsyncStop(xrmPrivateContext* ctx);
 static void hexstrToBin(std::string& inStr, int32_t insz, unsigned char* out);
 static void binToHexstr(unsigned char* in, int32_t insz, std::string& outStr);
 static void xrmLog(xrmLogLevelType contextLogLevel, xrmLogLevelType logLevel, const char* format, ...);
@@ -52,14 +124,13 @@ static bool xrmIsCuGroupExisting(xrmContext context, xrmCuGroupProperty* cuGroup
 int32_t xrmRetrieveLoadInfo(int32_t origInputLoad);
 
 /**
- * \brief Establishes a connection with the XRM daemon
+ * \brief Establishes a connection with the XRM daemon. If the connection is broken
+ * later, e.g. the daemon is restarted, the context reconnects and keeps its client id.
  *
  * @param xrmApiVersion the XRM API version number
  * @return xrmContext, pointer to created context or NULL on fail
  */
 xrmContext xrmCreateContext(uint32_t xrmApiVersion) {
-    std::unique_lock<std::recursive_mutex> lock(xrmMutex);
-
     if (xrmApiVersion != XRM_API_VERSION_1) {
         xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): wrong XRM API version: %d", __func__, xrmApiVersion);
         return (NULL);
@@ -71,82 +142,42 @@ xrmContext xrmCreateContext(uint32_t xrmApiVersion) {
         return (NULL);
     }
     ctx->xrmApiVersion = XRM_API_VERSION_1;
+    ctx->xrmClientId = 0;
+    ctx->socket = NULL;
+    ctx->ioService = NULL;
+    ctx->binaryProtocolVersion = 0;
+    ctx->nextRequestId = 1;
+    ctx->daemonGeneration = 0;
+    ctx->disconnected = false;
+    /*
+     * Need to temporarily set the log level to avoid debug message during context creating.
+     */
+    ctx->xrmLogLevel = (xrmLogLevelType)XRM_DEFAULT_LOG_LEVEL;
 
     try {
         ctx->ioService = new boost::asio::io_service;
-        ctx->socket = new tcp::socket(*ctx->ioService);
-        ctx->resolver = new tcp::resolver(*ctx->ioService);
-
-        boost::asio::connect(*ctx->socket, ctx->resolver->resolve({"127.0.0.1", "9763"}));
+        ctx->socket = new generic::stream_protocol::socket(*ctx->ioService);
     } catch (std::exception& e) {
         xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+    }
+    if (ctx->socket == NULL || !xrmConnect(ctx)) {
         if (ctx->socket) {
             /* disconnect first, then release resource */
             boost::system::error_code ec;
-            ctx->socket->shutdown(tcp::socket::shutdown_both, ec);
-            if (ec) {
-                xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s: socket shutdown error %s = %d", __func__,
-                       ec.category().name(), ec.value());
-            }
+            ctx->socket->shutdown(boost::asio::socket_base::shutdown_both, ec);
             delete ctx->socket;
         }
-        if (ctx->resolver) {
-            ctx->resolver->cancel();
-            delete ctx->resolver;
-        }
         if (ctx->ioService) {
             ctx->ioService->stop();
             delete ctx->ioService;
         }
         ctx->socket = NULL;
         ctx->ioService = NULL;
-        ctx->resolver = NULL;
         delete ctx;
         return (NULL);
     }
 
-    char jsonRsp[maxLength];
-    memset(jsonRsp, 0, maxLength * sizeof(char));
-    pt::ptree createContextTree;
-    createContextTree.put("request.name", "createContext");
-    createContextTree.put("request.requestId", 1);
-    createContextTree.put("request.parameters.context", "readContext");
-    std::stringstream reqstr;
-    /*
-     * Need to temporarily set the log level to avoid debug message during context creating.
-     */
-    ctx->xrmLogLevel = (xrmLogLevelType)XRM_DEFAULT_LOG_LEVEL;
-    boost::property_tree::write_json(reqstr, createContextTree);
-    if (xrmJsonRequest((xrmContext)ctx, reqstr.str().c_str(), jsonRsp) != XRM_SUCCESS) {
-        xrmDestroyContext(ctx);
-        return (NULL);
-    }
-    std::stringstream rspstr;
-    rspstr << jsonRsp;
-    pt::ptree rspTree;
-    boost::property_tree::read_json(rspstr, rspTree);
-    auto logLevel = rspTree.get<int32_t>("response.status.value");
-    ctx->xrmLogLevel = (xrmLogLevelType)logLevel;
-    ctx->xrmClientId = rspTree.get<uint64_t>("response.data.clientId");
-    if (ctx->xrmClientId == 0) {
-        // clientId is 0 means reaching limit of concurrent client
-        xrmDestroyContext(ctx);
-        return (NULL);
-    }
-
-    memset(jsonRsp, 0, maxLength * sizeof(char));
-    pt::ptree echoContextTree;
-    pid_t clientProcessId = getpid();
-    echoContextTree.put("request.name", "echoContext");
-    echoContextTree.put("request.requestId", 1);
-    echoContextTree.put("request.parameters.context", "echoContext");
-    echoContextTree.put("request.parameters.echo", "echo");
-    echoContextTree.put("request.parameters.recordClientId", "recordClientId");
-    echoContextTree.put("request.parameters.clientId", ctx->xrmClientId);
-    echoContextTree.put("request.parameters.clientProcessId", clientProcessId);
-    std::stringstream echoReqstr;
-    boost::property_tree::write_json(echoReqstr, echoContextTree);
-    if (xrmJsonRequest((xrmContext)ctx, echoReqstr.str().c_str(), jsonRsp) != XRM_SUCCESS) {
+    if (xrmHandshake(ctx) != XRM_SUCCESS) {
         xrmDestroyContext(ctx);
         return (NULL);
     }
@@ -162,7 +193,8 @@ xrmContext xrmCreateContext(uint32_t xrmApiVersion) {
 int32_t xrmDestroyContext(xrmContext context) {
     xrmPrivateContext* ctx = (xrmPrivateContext*)context;
 
-    std::unique_lock<std::recursive_mutex> lock(xrmMutex);
+    /* the submitted asynchronous requests are completed while the connection is still there */
+    if (ctx != NULL && ctx->xrmApiVersion == XRM_API_VERSION_1) xrmAsyncStop(ctx);
 
     if (ctx != NULL) {
         if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
@@ -170,6 +202,8 @@ int32_t xrmDestroyContext(xrmContext context) {
             return (XRM_ERROR);
         }
 
+        /* wait for the request of other thread on this context, if any, to finish */
+        std::unique_lock<std::recursive_mutex> requestLock(ctx->requestMutex);
         char jsonRsp[maxLength];
         memset(jsonRsp, 0, maxLength * sizeof(char));
         pt::ptree destroyContextTree;
@@ -187,20 +221,16 @@ int32_t xrmDestroyContext(xrmContext context) {
         if (ctx->socket) {
             /* disconnect first, then release resource */
             boost::system::error_code ec;
-            ctx->socket->shutdown(tcp::socket::shutdown_both, ec);
+            ctx->socket->shutdown(boost::asio::socket_base::shutdown_both, ec);
             delete ctx->socket;
         }
-        if (ctx->resolver) {
-            ctx->resolver->cancel();
-            delete ctx->resolver;
-        }
         if (ctx->ioService) {
             ctx->ioService->stop();
             delete ctx->ioService;
         }
         ctx->socket = NULL;
         ctx->ioService = NULL;
-        ctx->resolver = NULL;
+        requestLock.unlock();
         delete ctx;
         return (XRM_SUCCESS);
     } else {
@@ -209,6 +239,358 @@ int32_t xrmDestroyContext(xrmContext context) {
     }
 }
 
+/**
+ * Internal function.
+ *
+ * \brief connects to the XRM daemon, prefer the unix domain socket, fall back to
+ * tcp if daemon is not listening on it. The tcp address is the loopback, no need
+ * to go through the resolver.
+ *
+ * @param ctx the context being created or reconnected
+ * @return bool, true on connected or false on NOT connected
+ */
+static bool xrmConnect(xrmPrivateContext* ctx) {
+    if (xrmConnectLocal(ctx)) return (true);
+
+    boost::system::error_code ec;
+    tcp::socket tcpSocket(*ctx->ioService);
+    tcpSocket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), XRM_DEFAULT_TCP_PORT), ec);
+    if (ec) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: fail to connect to daemon, %s = %d", __func__,
+               ec.category().name(), ec.value());
+        return (false);
+    }
+    *ctx->socket = generic::stream_protocol::socket(std::move(tcpSocket));
+    return (true);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief gets the unix domain socket path the daemon listens on, the unixSocketPath of
+ * the xrm.ini installed with the daemon, i.e. bin/xrm.ini next to the lib directory of
+ * libxrm, or the default path if it's not set. The file is read once.
+ *
+ * @return std::string, the unix domain socket path
+ */
+static std::string xrmGetIniUnixSocketPath() {
+    static const std::string unixSocketPath = []() {
+        Dl_info info;
+        pt::ptree iniTree;
+        if (dladdr((void*)&xrmGetIniUnixSocketPath, &info) != 0 && info.dli_fname != NULL) {
+            try {
+                auto iniPath = boost::filesystem::path(info.dli_fname).parent_path() / ".." / "bin" / "xrm.ini";
+                if (boost::filesystem::exists(iniPath)) boost::property_tree::read_ini(iniPath.string(), iniTree);
+            } catch (std::exception& e) {
+                xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+            }
+        }
+        return (iniTree.get<std::string>("XRM.unixSocketPath", XRM_DEFAULT_UNIX_SOCKET_PATH));
+    }();
+    return (unixSocketPath);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief connects to the XRM daemon through the unix domain socket. The socket
+ * path can be overridden with environment variable XRM_UNIX_SOCKET_PATH, and
+ * empty value disables it; otherwise it's the one the daemon reads from xrm.ini.
+ *
+ * @param ctx the context being created
+ * @return bool, true on connected or false on NOT connected
+ */
+static bool xrmConnectLocal(xrmPrivateContext* ctx) {
+    const char* envSocketPath = std::getenv("XRM_UNIX_SOCKET_PATH");
+    std::string unixSocketPath = (envSocketPath != NULL) ? envSocketPath : xrmGetIniUnixSocketPath();
+    if (unixSocketPath.empty()) return (false);
+
+    boost::system::error_code ec;
+    ctx->socket->connect(boost::asio::local::stream_protocol::endpoint(unixSocketPath), ec);
+    if (ec) {
+        /* the peer credentials of the unix domain socket are not there on the tcp connection */
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "%s: fail to connect to %s, %s = %d, fall back to tcp", __func__,
+               unixSocketPath.c_str(), ec.category().name(), ec.value());
+        boost::system::error_code closeEc;
+        ctx->socket->close(closeEc);
+        return (false);
+    }
+    return (true);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief creates the daemon side context in one round trip: the daemon gives the client
+ * id, which is recorded for the connection at the same time, and answers the log level,
+ * the binary protocol version and the generation of the daemon run. The context having
+ * a client id (reconnecting) asks to keep it, the daemon keeps the id given by its earlier
+ * run. The daemon not answering the generation does not record the client id, it's done
+ * by the second round trip, echoContext.
+ *
+ * @param ctx the context being created or reconnected
+ * @return int32_t, 0 on success or appropriate error number
+ */
+static int32_t xrmHandshake(xrmPrivateContext* ctx) {
+    char jsonRsp[maxLength];
+    memset(jsonRsp, 0, maxLength * sizeof(char));
+    pt::ptree createContextTree;
+    pid_t clientProcessId = getpid();
+    createContextTree.put("request.name", "createContext");
+    createContextTree.put("request.requestId", 1);
+    createContextTree.put("request.parameters.context", "readContext");
+    createContextTree.put("request.parameters.binaryProtocolVersion", XRM_BINARY_PROTOCOL_VERSION);
+    createContextTree.put("request.parameters.recordClientId", "recordClientId");
+    createContextTree.put("request.parameters.clientId", ctx->xrmClientId);
+    createContextTree.put("request.parameters.clientProcessId", clientProcessId);
+    std::stringstream reqstr;
+    boost::property_tree::write_json(reqstr, createContextTree);
+    /* the handshake is always unframed JSON, the version is negotiated by it */
+    ctx->binaryProtocolVersion = 0;
+    if (xrmJsonRequest((xrmContext)ctx, reqstr.str().c_str(), jsonRsp) != XRM_SUCCESS) return (XRM_ERROR_CONNECT_FAIL);
+    std::stringstream rspstr;
+    rspstr << jsonRsp;
+    pt::ptree rspTree;
+    try {
+        boost::property_tree::read_json(rspstr, rspTree);
+    } catch (std::exception& e) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+        return (XRM_ERROR);
+    }
+    auto logLevel = rspTree.get<int32_t>("response.status.value", XRM_DEFAULT_LOG_LEVEL);
+    ctx->xrmLogLevel = (xrmLogLevelType)logLevel;
+    ctx->xrmClientId = rspTree.get<uint64_t>("response.data.clientId", 0);
+    /* daemon without binary protocol support does not answer the version, keep using JSON */
+    ctx->binaryProtocolVersion = rspTree.get<uint32_t>("response.data.binaryProtocolVersion", 0);
+    ctx->daemonGeneration = rspTree.get<uint64_t>("response.data.generation", 0);
+    if (ctx->xrmClientId == 0) {
+        // clientId is 0 means reaching limit of concurrent client
+        return (XRM_ERROR);
+    }
+    if (ctx->daemonGeneration != 0) return (XRM_SUCCESS);
+
+    memset(jsonRsp, 0, maxLength * sizeof(char));
+    pt::ptree echoContextTree;
+    echoContextTree.put("request.name", "echoContext");
+    echoContextTree.put("request.requestId", 1);
+    echoContextTree.put("request.parameters.context", "echoContext");
+    echoContextTree.put("request.parameters.echo", "echo");
+    echoContextTree.put("request.parameters.recordClientId", "recordClientId");
+    echoContextTree.put("request.parameters.clientId", ctx->xrmClientId);
+    echoContextTree.put("request.parameters.clientProcessId", clientProcessId);
+    std::stringstream echoReqstr;
+    boost::property_tree::write_json(echoReqstr, echoContextTree);
+    if (xrmJsonRequest((xrmContext)ctx, echoReqstr.str().c_str(), jsonRsp) != XRM_SUCCESS)
+        return (XRM_ERROR_CONNECT_FAIL);
+    return (XRM_SUCCESS);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief re-establishes the connection after it's broken, e.g. the daemon is restarted.
+ * The restarted daemon is waited for up to XRM_RECONNECT_TIMEOUT_MS, if it's still not
+ * there, later requests try to reconnect once without waiting. Only the context created
+ * by the daemon telling its generation reconnects. Once reconnected to a restarted daemon,
+ * the resources held by the context are reclaimed. It's called with the request lock of
+ * the context held.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @return bool, true if the session is re-established with the same client id and
+ *         binary protocol version, so the broken request can be sent again
+ */
+static bool xrmReconnect(xrmPrivateContext* ctx) {
+    uint64_t clientId = ctx->xrmClientId;
+    uint32_t binaryProtocolVersion = ctx->binaryProtocolVersion;
+    uint64_t generation = ctx->daemonGeneration;
+    boost::system::error_code ec;
+
+    if (generation == 0) return (false);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(ctx->disconnected ? 0 : XRM_RECONNECT_TIMEOUT_MS);
+    while (true) {
+        ctx->socket->close(ec);
+        if (xrmConnect(ctx) && xrmHandshake(ctx) == XRM_SUCCESS) break;
+        /* keep the negotiated state, the broken connection fails the later requests */
+        ctx->xrmClientId = clientId;
+        ctx->binaryProtocolVersion = binaryProtocolVersion;
+        ctx->daemonGeneration = generation;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            ctx->disconnected = true;
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: fail to reconnect to daemon, client id %lu", __func__,
+                   clientId);
+            return (false);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(XRM_RECONNECT_INTERVAL_MS));
+    }
+    ctx->disconnected = false;
+    xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "%s: reconnected to daemon, generation %lu -> %lu, client id %lu -> %lu",
+           __func__, generation, ctx->daemonGeneration, clientId, ctx->xrmClientId);
+    if (ctx->xrmClientId != clientId || ctx->binaryProtocolVersion != binaryProtocolVersion) return (false);
+    /* the restarted daemon recycles the resources not reclaimed in its grace period */
+    if (ctx->daemonGeneration != generation) xrmReclaim(ctx);
+    return (true);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief presents the allocations and the reserve pools held by the context to the
+ * restarted daemon, which re-binds them to this process. The resources not kept by the
+ * daemon, or all of them if the daemon did not restore its state, are gone and no longer held.
+ * It's called with the request lock of the context held, the request is not sent again
+ * if the connection breaks.
+ *
+ * @param ctx the context just reconnected to the restarted daemon
+ * @return void
+ */
+static void xrmReclaim(xrmPrivateContext* ctx) {
+    char jsonRsp[maxLength];
+    memset(jsonRsp, 0, maxLength * sizeof(char));
+    pt::ptree reclaimContextTree;
+    pid_t clientProcessId = getpid();
+    int32_t i = 0;
+    reclaimContextTree.put("request.name", "reclaimContext");
+    reclaimContextTree.put("request.requestId", 1);
+    reclaimContextTree.put("request.parameters.clientId", ctx->xrmClientId);
+    reclaimContextTree.put("request.parameters.clientProcessId", clientProcessId);
+    {
+        std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+        reclaimContextTree.put("request.parameters.allocServiceIdNum", ctx->heldAllocServiceIds.size());
+        for (auto& held : ctx->heldAllocServiceIds)
+            reclaimContextTree.put("request.parameters.allocServiceId" + std::to_string(i++), held.first);
+        i = 0;
+        reclaimContextTree.put("request.parameters.poolIdNum", ctx->heldPoolIds.size());
+        for (uint64_t poolId : ctx->heldPoolIds)
+            reclaimContextTree.put("request.parameters.poolId" + std::to_string(i++), poolId);
+    }
+    std::stringstream reqstr;
+    boost::property_tree::write_json(reqstr, reclaimContextTree);
+
+    int32_t ret = XRM_SUCCESS;
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_2) {
+        /* not through xrmJsonRequest(), it would reconnect again */
+        std::string rspPayload;
+        int32_t status;
+        if (xrmBinaryTransfer(ctx, xrm::BINARY_OP_JSON, reqstr.str(), rspPayload, &status) != XRM_SUCCESS ||
+            rspPayload.size() >= maxLength)
+            ret = XRM_ERROR_CONNECT_FAIL;
+        else
+            memcpy(jsonRsp, rspPayload.data(), rspPayload.size());
+    } else if (xrmJsonRequest((xrmContext)ctx, reqstr.str().c_str(), jsonRsp) != XRM_SUCCESS) {
+        ret = XRM_ERROR_CONNECT_FAIL;
+    }
+    if (ret == XRM_ERROR_CONNECT_FAIL) return;
+
+    std::stringstream rspstr;
+    rspstr << jsonRsp;
+    pt::ptree rspTree;
+    try {
+        boost::property_tree::read_json(rspstr, rspTree);
+    } catch (std::exception& e) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+        return;
+    }
+    ret = rspTree.get<int32_t>("response.status.value", XRM_ERROR);
+    if (ret != XRM_SUCCESS) {
+        /* the daemon has nothing of this context, the resources held are recycled */
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: resources of client id %lu are not restored by daemon",
+               __func__, ctx->xrmClientId);
+        std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+        ctx->heldAllocServiceIds.clear();
+        ctx->heldPoolIds.clear();
+        return;
+    }
+    xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "%s: resources of client id %lu reclaimed, %d not restored", __func__,
+           ctx->xrmClientId, rspTree.get<int32_t>("response.data.numDropped", 0));
+
+    /* the ones not kept are gone, e.g. released by the request broken by the restart */
+    std::set<uint64_t> keptAllocServiceIds, keptPoolIds;
+    int32_t num = rspTree.get<int32_t>("response.data.allocServiceIdNum", 0);
+    for (i = 0; i < num; i++)
+        keptAllocServiceIds.insert(rspTree.get<uint64_t>("response.data.allocServiceId" + std::to_string(i), 0));
+    num = rspTree.get<int32_t>("response.data.poolIdNum", 0);
+    for (i = 0; i < num; i++) keptPoolIds.insert(rspTree.get<uint64_t>("response.data.poolId" + std::to_string(i), 0));
+    std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+    for (auto it = ctx->heldAllocServiceIds.begin(); it != ctx->heldAllocServiceIds.end();) {
+        if (keptAllocServiceIds.count(it->first))
+            ++it;
+        else
+            it = ctx->heldAllocServiceIds.erase(it);
+    }
+    for (auto it = ctx->heldPoolIds.begin(); it != ctx->heldPoolIds.end();) {
+        if (keptPoolIds.count(*it))
+            ++it;
+        else
+            it = ctx->heldPoolIds.erase(it);
+    }
+}
+
+/**
+ * Internal function.
+ *
+ * \brief records the cu allocated to the context, so they can be reclaimed after the
+ * daemon is restarted.
+ *
+ * @param ctx the context allocating the cu
+ * @param cuResources the cu resources allocated
+ * @param cuNum number of cu resources
+ * @return void
+ */
+template <typename T>
+static void xrmTrackAlloc(xrmPrivateContext* ctx, const T* cuResources, int32_t cuNum) {
+    std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+    for (int32_t i = 0; i < cuNum; i++) ctx->heldAllocServiceIds[cuResources[i].allocServiceId]++;
+}
+
+/**
+ * Internal function.
+ *
+ * \brief forgets the cu released by the context.
+ *
+ * @param ctx the context releasing the cu
+ * @param cuResources the cu resources released
+ * @param cuNum number of cu resources
+ * @return void
+ */
+template <typename T>
+static void xrmTrackRelease(xrmPrivateContext* ctx, const T* cuResources, int32_t cuNum) {
+    std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+    for (int32_t i = 0; i < cuNum; i++) {
+        auto it = ctx->heldAllocServiceIds.find(cuResources[i].allocServiceId);
+        if (it != ctx->heldAllocServiceIds.end() && --it->second <= 0) ctx->heldAllocServiceIds.erase(it);
+    }
+}
+
+/**
+ * Internal function.
+ *
+ * \brief records the pool reserved by the context.
+ *
+ * @param ctx the context reserving the pool
+ * @param poolId the reserve pool id, 0 if the reservation failed
+ * @return void
+ */
+static void xrmTrackReserve(xrmPrivateContext* ctx, uint64_t poolId) {
+    if (poolId == 0) return;
+    std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+    ctx->heldPoolIds.insert(poolId);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief forgets the pool relinquished by the context.
+ *
+ * @param ctx the context relinquishing the pool
+ * @param poolId the reserve pool id
+ * @return void
+ */
+static void xrmTrackRelinquish(xrmPrivateContext* ctx, uint64_t poolId) {
+    std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+    ctx->heldPoolIds.erase(poolId);
+}
+
 /**
  * Internal function.
  *
@@ -260,7 +642,24 @@ static int32_t xrmJsonRequest(xrmContext context, const char* jsonReq, char* jso
         return (rc);
     }
 
-    std::unique_lock<std::recursive_mutex> lock(xrmMutex);
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_2) {
+        /* framed request, the request may be larger than one read of daemon */
+        std::string rspPayload;
+        int32_t status;
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "Sending %s\n", jsonReq);
+        rc = xrmBinaryRequest(ctx, xrm::BINARY_OP_JSON, std::string(jsonReq), rspPayload, &status);
+        if (rc != XRM_SUCCESS) return (rc);
+        if (rspPayload.size() >= maxLength) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: response size %lu is too large\n", __func__,
+                   rspPayload.size());
+            return (XRM_ERROR);
+        }
+        memcpy(jsonRsp, rspPayload.data(), rspPayload.size());
+        jsonRsp[rspPayload.size()] = '\0';
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "%s\n", jsonRsp);
+        return (rc);
+    }
+    std::unique_lock<std::recursive_mutex> requestLock(ctx->requestMutex);
     try {
         // Send request
         size_t reqLen = std::strlen(jsonReq);
@@ -307,6 +706,320 @@ static int32_t xrmJsonRequest(xrmContext context, const char* jsonReq, char* jso
     return (rc);
 }
 
+/**
+ * Internal function.
+ *
+ * \brief sends a binary request message to the XRM daemon and
+ * copies the binary response payload to caller. It's only used
+ * after the binary protocol is negotiated during context creating.
+ *
+ * Requests are serialized per context only, contexts of different threads
+ * talk to the daemon in parallel over their own connections. While the daemon
+ * holds an allocation request waiting for free resource, only this context is
+ * kept busy.
+ *
+ * If the connection is broken, e.g. the daemon is restarted, the session is
+ * re-established and the request is sent again. A release or relinquish request
+ * is not sent again blindly to a restarted daemon, it's reconciled against the
+ * resources reclaimed, see xrmReconcileRelease().
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @param opcode the binary command opcode
+ * @param reqPayload request payload
+ * @param rspPayload response payload
+ * @param status the return value of command from XRM daemon
+ * @return int32_t, 0 on success or appropriate error number
+ **/
+static int32_t xrmBinaryRequest(xrmPrivateContext* ctx,
+                                uint16_t opcode,
+                                const std::string& reqPayload,
+                                std::string& rspPayload,
+                                int32_t* status) {
+    std::unique_lock<std::recursive_mutex> requestLock(ctx->requestMutex);
+    if (!ctx->disconnected && xrmBinaryTransfer(ctx, opcode, reqPayload, rspPayload, status) == XRM_SUCCESS)
+        return (XRM_SUCCESS);
+    uint64_t generation = ctx->daemonGeneration;
+    if (!xrmReconnect(ctx)) return (XRM_ERROR);
+    if (ctx->daemonGeneration != generation)
+        return (xrmReconcileRelease(ctx, opcode, reqPayload, rspPayload, status));
+    return (xrmBinaryTransfer(ctx, opcode, reqPayload, rspPayload, status));
+}
+
+/**
+ * Internal function.
+ *
+ * \brief gets the allocation service ids and the reserve pool ids a request releases.
+ *
+ * @param opcode the binary command opcode
+ * @param reqPayload request payload
+ * @param allocServiceIds the allocation service ids released, one per cu
+ * @param poolIds the reserve pool ids relinquished
+ * @param jsonName the name of JSON request
+ * @return bool, true if it's a release or relinquish request
+ */
+static bool xrmGetReleasingIds(uint16_t opcode,
+                               const std::string& reqPayload,
+                               std::vector<uint64_t>& allocServiceIds,
+                               std::vector<uint64_t>& poolIds,
+                               std::string& jsonName) {
+    xrm::binaryDecoder dec(reqPayload.data(), reqPayload.size());
+    int32_t cuNum = 1;
+
+    switch (opcode) {
+        case xrm::BINARY_OP_CU_LIST_RELEASE:
+        case xrm::BINARY_OP_CU_LIST_RELEASE_V2:
+        case xrm::BINARY_OP_CU_BATCH_RELEASE_V2:
+            dec.getUint64(); // clientId
+            cuNum = dec.getInt32();
+            break;
+        case xrm::BINARY_OP_CU_RELEASE:
+        case xrm::BINARY_OP_CU_RELEASE_V2:
+            dec.getUint64(); // clientId
+            break;
+        case xrm::BINARY_OP_JSON: {
+            pt::ptree reqTree;
+            try {
+                std::stringstream reqstr(reqPayload);
+                boost::property_tree::read_json(reqstr, reqTree);
+            } catch (std::exception& e) {
+                xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+                return (false);
+            }
+            jsonName = reqTree.get<std::string>("request.name", "");
+            if (jsonName == "cuRelease" || jsonName == "cuReleaseV2") {
+                allocServiceIds.push_back(reqTree.get<uint64_t>("request.parameters.allocServiceId", 0));
+            } else if (jsonName == "cuListRelease" || jsonName == "cuListReleaseV2" || jsonName == "cuGroupRelease" ||
+                       jsonName == "cuGroupReleaseV2") {
+                cuNum = reqTree.get<int32_t>("request.parameters.cuNum", 0);
+                for (int32_t i = 0; i < cuNum; i++)
+                    allocServiceIds.push_back(
+                        reqTree.get<uint64_t>("request.parameters.allocServiceId" + std::to_string(i), 0));
+            } else if (jsonName == "cuPoolRelinquish" || jsonName == "cuPoolRelinquishV2") {
+                poolIds.push_back(reqTree.get<uint64_t>("request.parameters.poolId", 0));
+            } else {
+                return (false);
+            }
+            return (true);
+        }
+        default:
+            return (false);
+    }
+    for (int32_t i = 0; i < cuNum && dec.ok(); i++) {
+        dec.getInt32(); // deviceId
+        dec.getInt32(); // cuId
+        dec.getInt32(); // channelId
+        dec.getInt32(); // cuType
+        allocServiceIds.push_back(dec.getUint64());
+        dec.getInt32(); // channelLoadUnified
+        dec.getInt32(); // channelLoadOriginal
+        dec.getUint64(); // poolId
+    }
+    return (dec.ok());
+}
+
+/**
+ * Internal function.
+ *
+ * \brief reconciles the request broken by the restart of daemon against the resources
+ * reclaimed from the restarted daemon. The release and relinquish requests may have been
+ * done by the daemon before the restart, sending them again would release what is no
+ * longer held by the context. The resources not kept by the restarted daemon are gone,
+ * they're reported as released without sending the request; the request is only sent
+ * again if the daemon kept them, i.e. it was not done before the restart. Other requests
+ * are sent again. It's called with the request lock of the context held.
+ *
+ * @param ctx the context just reconnected to the restarted daemon
+ * @param opcode the binary command opcode
+ * @param reqPayload request payload
+ * @param rspPayload response payload
+ * @param status the return value of command from XRM daemon
+ * @return int32_t, 0 on success or XRM_ERROR if the connection is broken
+ */
+static int32_t xrmReconcileRelease(xrmPrivateContext* ctx,
+                                   uint16_t opcode,
+                                   const std::string& reqPayload,
+                                   std::string& rspPayload,
+                                   int32_t* status) {
+    std::vector<uint64_t> allocServiceIds, poolIds;
+    std::vector<bool> isGone;
+    std::string jsonName;
+    size_t numGone = 0;
+
+    if (!xrmGetReleasingIds(opcode, reqPayload, allocServiceIds, poolIds, jsonName))
+        return (xrmBinaryTransfer(ctx, opcode, reqPayload, rspPayload, status));
+    {
+        std::lock_guard<std::mutex> heldLock(ctx->heldMutex);
+        for (uint64_t allocServiceId : allocServiceIds)
+            isGone.push_back(ctx->heldAllocServiceIds.count(allocServiceId) == 0);
+        for (uint64_t poolId : poolIds) isGone.push_back(ctx->heldPoolIds.count(poolId) == 0);
+    }
+    for (bool gone : isGone) numGone += gone;
+
+    if (numGone < isGone.size()) {
+        /* still held, the request was not done before the restart */
+        if (xrmBinaryTransfer(ctx, opcode, reqPayload, rspPayload, status) != XRM_SUCCESS) return (XRM_ERROR);
+        if (opcode != xrm::BINARY_OP_CU_BATCH_RELEASE_V2 || numGone == 0 || *status != XRM_SUCCESS)
+            return (XRM_SUCCESS);
+        /* the cu gone are released, whatever the restarted daemon says */
+        xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+        int32_t cuNum = dec.getInt32();
+        if (!dec.ok() || cuNum != (int32_t)isGone.size()) return (XRM_SUCCESS);
+        std::string payload;
+        xrm::binaryEncoder enc(payload);
+        enc.putInt32(cuNum);
+        for (int32_t i = 0; i < cuNum; i++) {
+            int32_t result = dec.getInt32();
+            enc.putInt32(isGone[i] ? XRM_SUCCESS : result);
+        }
+        if (dec.ok()) rspPayload.swap(payload);
+        return (XRM_SUCCESS);
+    }
+
+    /* released before the restart, or recycled by the restarted daemon */
+    xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "%s: opcode %d %s is done before daemon restart, not sent again",
+           __func__, opcode, jsonName.c_str());
+    *status = XRM_SUCCESS;
+    rspPayload.clear();
+    if (opcode == xrm::BINARY_OP_CU_BATCH_RELEASE_V2) {
+        xrm::binaryEncoder enc(rspPayload);
+        enc.putInt32((int32_t)isGone.size());
+        for (size_t i = 0; i < isGone.size(); i++) enc.putInt32(XRM_SUCCESS);
+    } else if (opcode == xrm::BINARY_OP_JSON) {
+        pt::ptree rspTree;
+        rspTree.put("response.name", jsonName);
+        rspTree.put("response.requestId", 1);
+        rspTree.put("response.status.value", XRM_SUCCESS);
+        std::stringstream rspstr;
+        boost::property_tree::write_json(rspstr, rspTree);
+        rspPayload = rspstr.str();
+    }
+    return (XRM_SUCCESS);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief writes one binary request message and reads its response on the
+ * connection of the context, called with the request lock of the context held.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @param opcode the binary command opcode
+ * @param reqPayload request payload
+ * @param rspPayload response payload
+ * @param status the return value of command from XRM daemon
+ * @return int32_t, 0 on success or XRM_ERROR if the connection is broken
+ **/
+static int32_t xrmBinaryTransfer(xrmPrivateContext* ctx,
+                                 uint16_t opcode,
+                                 const std::string& reqPayload,
+                                 std::string& rspPayload,
+                                 int32_t* status) {
+    boost::system::error_code ec;
+    std::string reqMsg;
+    char rspHeader[XRM_BINARY_HEADER_SIZE];
+    xrm::binaryHeader header;
+
+    uint64_t requestId = ctx->nextRequestId++;
+    int32_t waitTime = (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_3) ? xrmWaitTime : 0;
+    xrm::binaryEncodeMessage(reqMsg, opcode, waitTime, requestId, reqPayload, ctx->binaryProtocolVersion);
+    try {
+        // Send request
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_NOTICE, "Sending binary request, opcode %d", opcode);
+        boost::asio::write(*ctx->socket, boost::asio::buffer(reqMsg), ec);
+        if (ec) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: write error %s = %d", __func__, ec.category().name(),
+                   ec.value());
+            return (XRM_ERROR);
+        }
+
+        // Get response
+        boost::asio::read(*ctx->socket, boost::asio::buffer(rspHeader, XRM_BINARY_HEADER_SIZE), ec);
+        if (ec) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: read error %s = %d", __func__, ec.category().name(),
+                   ec.value());
+            return (XRM_ERROR);
+        }
+        if (!xrm::binaryDecodeHeader(rspHeader, XRM_BINARY_HEADER_SIZE, header) || header.opcode != opcode ||
+            header.requestId != requestId || header.payloadSize > XRM_BINARY_MAX_PAYLOAD_SIZE) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: invalid response header", __func__);
+            return (XRM_ERROR);
+        }
+        rspPayload.resize(header.payloadSize);
+        if (header.payloadSize) {
+            boost::asio::read(*ctx->socket, boost::asio::buffer(&rspPayload[0], header.payloadSize), ec);
+            if (ec) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: read error %s = %d", __func__, ec.category().name(),
+                       ec.value());
+                return (XRM_ERROR);
+            }
+        }
+        *status = header.status;
+    } catch (std::exception& e) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+        return (XRM_ERROR);
+    }
+
+    return (XRM_SUCCESS);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief decodes one allocated cu resource from binary response payload.
+ *
+ * @param dec the decoder of response payload
+ * @param cuRes the cu resource, xrmCuResource or xrmCuResourceV2
+ * @return void
+ */
+template <typename cuResourceType>
+static void xrmBinaryGetCuResource(xrm::binaryDecoder& dec, cuResourceType* cuRes) {
+    char uuidStr[XRM_MAX_NAME_LEN];
+
+    dec.getString(cuRes->xclbinFileName, sizeof(cuRes->xclbinFileName));
+    dec.getString(uuidStr, sizeof(uuidStr));
+    std::string uuidString(uuidStr);
+    hexstrToBin(uuidString, 2 * sizeof(uuid_t), (unsigned char*)cuRes->uuid);
+    dec.getString(cuRes->kernelPluginFileName, sizeof(cuRes->kernelPluginFileName));
+    dec.getString(cuRes->kernelName, sizeof(cuRes->kernelName));
+    dec.getString(cuRes->kernelAlias, sizeof(cuRes->kernelAlias));
+    dec.getString(cuRes->instanceName, sizeof(cuRes->instanceName));
+    dec.getString(cuRes->cuName, sizeof(cuRes->cuName));
+    cuRes->deviceId = dec.getInt32();
+    cuRes->cuId = dec.getInt32();
+    cuRes->channelId = dec.getInt32();
+    cuRes->cuType = (xrmCuType)dec.getInt32();
+    cuRes->baseAddr = dec.getUint64();
+    cuRes->membankId = dec.getUint32();
+    cuRes->membankType = dec.getUint32();
+    cuRes->membankSize = dec.getUint64();
+    cuRes->membankBaseAddr = dec.getUint64();
+    cuRes->allocServiceId = dec.getUint64();
+    cuRes->channelLoad = dec.getInt32();
+    cuRes->poolId = dec.getUint64();
+}
+
+/**
+ * Internal function.
+ *
+ * \brief encodes one cu resource to be released into binary request payload.
+ *
+ * @param enc the encoder of request payload
+ * @param cuRes the cu resource, xrmCuResource or xrmCuResourceV2
+ * @param unifiedLoad the channel load of granularity 1,000,000
+ * @return void
+ */
+template <typename cuResourceType>
+static void xrmBinaryPutReleasingCuResource(xrm::binaryEncoder& enc, cuResourceType* cuRes, int32_t unifiedLoad) {
+    enc.putInt32(cuRes->deviceId);
+    enc.putInt32(cuRes->cuId);
+    enc.putInt32(cuRes->channelId);
+    enc.putInt32((int32_t)cuRes->cuType);
+    enc.putUint64(cuRes->allocServiceId);
+    enc.putInt32(unifiedLoad);
+    enc.putInt32(cuRes->channelLoad);
+    enc.putUint64(cuRes->poolId);
+}
+
 /**
  * Internal function.
  *
@@ -685,6 +1398,29 @@ int32_t xrmCuAlloc(xrmContext context, xrmCuProperty* cuProp, xrmCuResource* cuR
 
     memset(cuRes, 0, sizeof(xrmCuResource));
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t ret;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(getpid());
+        enc.putString(cuProp->kernelName);
+        enc.putString(cuProp->kernelAlias);
+        enc.putUint8(cuProp->devExcl ? 1 : 0);
+        enc.putInt32(unifiedLoad);
+        enc.putInt32(cuProp->requestLoad);
+        enc.putUint64(cuProp->poolId);
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_ALLOC, reqPayload, rspPayload, &ret) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (ret == XRM_SUCCESS) {
+            xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+            xrmBinaryGetCuResource(dec, cuRes);
+            if (!dec.ok()) return (XRM_ERROR);
+            xrmTrackAlloc(ctx, cuRes, 1);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuAllocTree;
@@ -743,6 +1479,7 @@ int32_t xrmCuAlloc(xrmContext context, xrmCuProperty* cuProp, xrmCuResource* cuR
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -870,6 +1607,7 @@ int32_t xrmCuAllocFromDev(xrmContext context, int32_t deviceId, xrmCuProperty* c
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -997,6 +1735,7 @@ int32_t xrmCuAllocLeastUsedFromDev(xrmContext context, int32_t deviceId, xrmCuPr
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -1039,6 +1778,46 @@ int32_t xrmCuListAlloc(xrmContext context, xrmCuListProperty* cuListProp, xrmCuL
         return (XRM_ERROR_INVALID);
     }
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(getpid());
+        enc.putInt32(cuListProp->cuNum);
+        enc.putUint8(cuListProp->sameDevice ? 1 : 0);
+        for (i = 0; i < cuListProp->cuNum; i++) {
+            cuProp = &cuListProp->cuProps[i];
+            if ((cuProp->kernelName[0] == '\0') && (cuProp->kernelAlias[0] == '\0')) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s cuProps[%d] neither kernel name nor alias are provided",
+                       __func__, i);
+                return (XRM_ERROR_INVALID);
+            }
+            unifiedLoad = xrmRetrieveLoadInfo(cuProp->requestLoad);
+            if (unifiedLoad < 0) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong request load: 0x%x", __func__,
+                       cuProp->requestLoad);
+                return (XRM_ERROR_INVALID);
+            }
+            enc.putString(cuProp->kernelName);
+            enc.putString(cuProp->kernelAlias);
+            enc.putUint8(cuProp->devExcl ? 1 : 0);
+            enc.putInt32(unifiedLoad);
+            enc.putInt32(cuProp->requestLoad);
+            enc.putUint64(cuProp->poolId);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_LIST_ALLOC, reqPayload, rspPayload, &ret) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (ret == XRM_SUCCESS) {
+            xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+            cuListRes->cuNum = dec.getInt32();
+            if (cuListRes->cuNum < 0 || cuListRes->cuNum > XRM_MAX_LIST_CU_NUM) return (XRM_ERROR);
+            for (i = 0; i < cuListRes->cuNum; i++) xrmBinaryGetCuResource(dec, &cuListRes->cuResources[i]);
+            if (!dec.ok()) return (XRM_ERROR);
+            xrmTrackAlloc(ctx, cuListRes->cuResources, cuListRes->cuNum);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuListAllocTree;
@@ -1120,6 +1899,7 @@ int32_t xrmCuListAlloc(xrmContext context, xrmCuListProperty* cuListProp, xrmCuL
             cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize" + std::to_string(i));
             cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr" + std::to_string(i));
             cuRes->poolId = rspTree.get<int32_t>("response.data.poolId" + std::to_string(i));
+            xrmTrackAlloc(ctx, cuRes, 1);
         }
     }
     return (ret);
@@ -1358,6 +2138,7 @@ int32_t xrmCuGroupAlloc(xrmContext context, xrmCuGroupProperty* cuGroupProp, xrm
             cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize" + std::to_string(i));
             cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr" + std::to_string(i));
             cuRes->poolId = rspTree.get<int32_t>("response.data.poolId" + std::to_string(i));
+            xrmTrackAlloc(ctx, cuRes, 1);
         }
     }
     return (ret);
@@ -1447,6 +2228,26 @@ int32_t xrmCuCheckStatus(xrmContext context, xrmCuResource* cuRes, xrmCuStat* cu
     }
     memset(cuStat, 0, sizeof(xrmCuStat));
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t ret;
+        enc.putInt32(cuRes->deviceId);
+        enc.putInt32(cuRes->cuId);
+        enc.putInt32(cuRes->channelId);
+        enc.putInt32((int32_t)cuRes->cuType);
+        enc.putUint64(cuRes->allocServiceId);
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_CHECK_STATUS, reqPayload, rspPayload, &ret) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (ret == XRM_SUCCESS) {
+            xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+            cuStat->isBusy = (dec.getUint8() != 0);
+            cuStat->usedLoad = dec.getInt32();
+            if (!dec.ok()) return (XRM_ERROR);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuCheckStatusTree;
@@ -1524,6 +2325,20 @@ bool xrmCuRelease(xrmContext context, xrmCuResource* cuRes) {
         return (XRM_ERROR_INVALID);
     }
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        xrmBinaryPutReleasingCuResource(enc, cuRes, unifiedLoad);
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_RELEASE, reqPayload, rspPayload, &value) != XRM_SUCCESS) return (ret);
+        if (value == XRM_SUCCESS) {
+            ret = true;
+            xrmTrackRelease(ctx, cuRes, 1);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree xrmCuRelease;
@@ -1552,6 +2367,7 @@ bool xrmCuRelease(xrmContext context, xrmCuResource* cuRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -1591,6 +2407,30 @@ bool xrmCuListRelease(xrmContext context, xrmCuListResource* cuListRes) {
     }
 
     /* will release all the resource */
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(cuListRes->cuNum);
+        for (i = 0; i < cuListRes->cuNum; i++) {
+            cuRes = &cuListRes->cuResources[i];
+            unifiedLoad = xrmRetrieveLoadInfo(cuRes->channelLoad);
+            if (unifiedLoad < 0) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong channel load: 0x%x", __func__,
+                       cuRes->channelLoad);
+                return (XRM_ERROR_INVALID);
+            }
+            xrmBinaryPutReleasingCuResource(enc, cuRes, unifiedLoad);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_LIST_RELEASE, reqPayload, rspPayload, &value) != XRM_SUCCESS) return (ret);
+        if (value == XRM_SUCCESS) {
+            ret = true;
+            xrmTrackRelease(ctx, cuListRes->cuResources, cuListRes->cuNum);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuListReleaseTree;
@@ -1627,6 +2467,7 @@ bool xrmCuListRelease(xrmContext context, xrmCuListResource* cuListRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuListRes->cuResources, cuListRes->cuNum);
     }
 
     return (ret);
@@ -1703,6 +2544,7 @@ bool xrmCuGroupRelease(xrmContext context, xrmCuGroupResource* cuGroupRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuGroupRes->cuResources, cuGroupRes->cuNum);
     }
 
     return (ret);
@@ -2407,6 +3249,7 @@ uint64_t xrmCuPoolReserve(xrmContext context, xrmCuPoolProperty* cuPoolProp) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         reserve_poolId = rspTree.get<int64_t>("response.data.poolId");
+        xrmTrackReserve(ctx, reserve_poolId);
     } else {
         reserve_poolId = 0;
     }
@@ -2458,6 +3301,7 @@ bool xrmCuPoolRelinquish(xrmContext context, uint64_t poolId) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelinquish(ctx, poolId);
     }
     return (ret);
 }
@@ -2730,6 +3574,7 @@ int32_t xrmCuAllocWithLoad(xrmContext context, xrmCuProperty* cuProp, char* xclb
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -2867,6 +3712,7 @@ int32_t xrmCuAllocLeastUsedWithLoad(xrmContext context,
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -2955,15 +3801,32 @@ int32_t xrmLoadAndAllCuAlloc(xrmContext context, char* xclbinFileName, xrmCuList
             cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize" + std::to_string(i));
             cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr" + std::to_string(i));
             cuRes->poolId = rspTree.get<int32_t>("response.data.poolId" + std::to_string(i));
+            xrmTrackAlloc(ctx, cuRes, 1);
         }
     }
     return (ret);
 }
 
+/**
+ * Internal function.
+ *
+ * \brief checks whether the blocking allocation may still retry.
+ *
+ * @param deadline the time the blocking allocation gives up
+ * @param timeout the wait time (ms) of the blocking allocation, XRM_ALLOC_WAIT_FOREVER for no limit
+ * @return bool, true if there is time left
+ */
+static bool xrmIsTimeLeft(std::chrono::steady_clock::time_point deadline, int32_t timeout) {
+    return (timeout == XRM_ALLOC_WAIT_FOREVER || std::chrono::steady_clock::now() < deadline);
+}
+
 /**
  * \brief Blocking function of xrmCuAlloc(), this function will try to do cu allocation
  * until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuProp the property of cu.
  *             kernelName: the kernel name requested.
@@ -2996,6 +3859,54 @@ int32_t xrmLoadAndAllCuAlloc(xrmContext context, char* xclbinFileName, xrmCuList
  * @return int32_t, 0 on success or appropriate error number
  */
 int32_t xrmCuBlockingAlloc(xrmContext context, xrmCuProperty* cuProp, uint64_t interval, xrmCuResource* cuRes) {
+    return (xrmCuBlockingAllocWithTimeout(context, cuProp, interval, XRM_ALLOC_WAIT_FOREVER, cuRes));
+}
+
+/**
+ * \brief Blocking function of xrmCuAlloc() with timeout, this function will try to do cu
+ * allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu.
+ *             kernelName: the kernel name requested.
+ *             kernelAlias: the alias of kernel name requested.
+ *             devExcl: request exclusive device usage for this client.
+ *             requestLoad: request load, only one type granularity at one time.
+ *                          bit[31 - 28] reserved
+ *                          bit[27 -  8] granularity of 1000000 (0 - 1000000)
+ *                          bit[ 7 -  0] granularity of 100 (0 - 100)
+ *             poolId: request to allocate cu from specified resource pool.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuRes cu resource.
+ *             xclbinFileName: xclbin (path and name) attached to this device.
+ *             kernelPluginFileName: kernel plugin (only name) attached to this device.
+ *             kernelName: the kernel name of allocated cu.
+ *             kernelAlias: the name alias of allocated cu.
+ *             instanceName: the instance name of allocated cu.
+ *             cuName: the name of allocated cu (kernelName:instanceName).
+ *             uuid: uuid of the loaded xclbin file.
+ *             deviceId: device id of this cu.
+ *             cuId: cu id of this cu.
+ *             channelId: channel id of this cu.
+ *             cuType: type of cu, hardware kernel or soft kernel.
+ *             allocServiceId: service id for this cu allocation.
+ *             channelLoad: allocated load of this cu, only one type granularity at one time.
+ *                          bit[31 - 28] reserved
+ *                          bit[27 -  8] granularity of 1000000 (0 - 1000000)
+ *                          bit[ 7 -  0] granularity of 100 (0 - 100)
+ *             poolId: id of the cu pool this cu comes from, the default pool id is 0.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuBlockingAllocWithTimeout(xrmContext context,
+                                      xrmCuProperty* cuProp,
+                                      uint64_t interval,
+                                      int32_t timeout,
+                                      xrmCuResource* cuRes) {
     xrmPrivateContext* ctx = (xrmPrivateContext*)context;
     int32_t unifiedLoad; // granularity of 1,000,000
 
@@ -3020,16 +3931,28 @@ int32_t xrmCuBlockingAlloc(xrmContext context, xrmCuProperty* cuProp, uint64_t i
         xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: interval out range [0 - 1000000].\n", __func__);
         return (XRM_ERROR_INVALID);
     }
+    if (timeout < 0 && timeout != XRM_ALLOC_WAIT_FOREVER) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: timeout %d is out of range.\n", __func__,
+               timeout);
+        return (XRM_ERROR_INVALID);
+    }
 
     if (!xrmIsCuExisting(ctx, cuProp)) return (XRM_ERROR_NO_KERNEL);
     int32_t ret = XRM_ERROR_NO_KERNEL;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_3) {
+        /* the daemon holds the request until it's satisfied or the time is out, no interval used */
+        xrmWaitTime = timeout;
+        ret = xrmCuAlloc(ctx, cuProp, cuRes);
+        xrmWaitTime = 0;
+    }
     if (interval)
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuAlloc(ctx, cuProp, cuRes);
             usleep(interval);
         }
     else
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuAlloc(ctx, cuProp, cuRes);
             sched_yield();
         }
@@ -3040,6 +3963,9 @@ int32_t xrmCuBlockingAlloc(xrmContext context, xrmCuProperty* cuProp, uint64_t i
  * \brief Blocking function of xrmCuListAlloc(), this function will try to do cu list allocation
  * until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuListProp the property of cu list.
  *             cuProps: cu prop list to fill kernelName, devExcl and requestLoad, starting from cuProps[0], no hole.
@@ -3055,6 +3981,34 @@ int32_t xrmCuListBlockingAlloc(xrmContext context,
                                xrmCuListProperty* cuListProp,
                                uint64_t interval,
                                xrmCuListResource* cuListRes) {
+    return (xrmCuListBlockingAllocWithTimeout(context, cuListProp, interval, XRM_ALLOC_WAIT_FOREVER, cuListRes));
+}
+
+/**
+ * \brief Blocking function of xrmCuListAlloc() with timeout, this function will try to do cu
+ * list allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListProp the property of cu list.
+ *             cuProps: cu prop list to fill kernelName, devExcl and requestLoad, starting from cuProps[0], no hole.
+ *             cuNum: request number of cu in this list.
+ *             sameDevice request this list of cu from same device.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu list, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuListRes cu list resource.
+ *             cuResources: cu resource list to fill the allocated cus infor, starting from cuResources[0], no hole.
+ *             cuNum: allocated cu number in this list.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuListBlockingAllocWithTimeout(xrmContext context,
+                                          xrmCuListProperty* cuListProp,
+                                          uint64_t interval,
+                                          int32_t timeout,
+                                          xrmCuListResource* cuListRes) {
     xrmPrivateContext* ctx = (xrmPrivateContext*)context;
 
     if (ctx == NULL || cuListProp == NULL || cuListRes == NULL) {
@@ -3075,16 +4029,28 @@ int32_t xrmCuListBlockingAlloc(xrmContext context,
         xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: interval out range [0 - 1000000].\n", __func__);
         return (XRM_ERROR_INVALID);
     }
+    if (timeout < 0 && timeout != XRM_ALLOC_WAIT_FOREVER) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: timeout %d is out of range.\n", __func__,
+               timeout);
+        return (XRM_ERROR_INVALID);
+    }
 
     if (!xrmIsCuListExisting(ctx, cuListProp)) return (XRM_ERROR_NO_KERNEL);
     int32_t ret = XRM_ERROR_NO_KERNEL;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_3) {
+        /* the daemon holds the request until it's satisfied or the time is out, no interval used */
+        xrmWaitTime = timeout;
+        ret = xrmCuListAlloc(ctx, cuListProp, cuListRes);
+        xrmWaitTime = 0;
+    }
     if (interval)
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuListAlloc(ctx, cuListProp, cuListRes);
             usleep(interval);
         }
     else
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuListAlloc(ctx, cuListProp, cuListRes);
             sched_yield();
         }
@@ -3095,6 +4061,9 @@ int32_t xrmCuListBlockingAlloc(xrmContext context,
  * \brief Blocking function of xrmCuGroupAlloc(), this function will try to do cu group
  * allocation until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuGroupProp the property of cu group.
  *            udfCuGroupName: user defined cu group type name.
@@ -3109,6 +4078,33 @@ int32_t xrmCuGroupBlockingAlloc(xrmContext context,
                                 xrmCuGroupProperty* cuGroupProp,
                                 uint64_t interval,
                                 xrmCuGroupResource* cuGroupRes) {
+    return (xrmCuGroupBlockingAllocWithTimeout(context, cuGroupProp, interval, XRM_ALLOC_WAIT_FOREVER, cuGroupRes));
+}
+
+/**
+ * \brief Blocking function of xrmCuGroupAlloc() with timeout, this function will try to do cu
+ * group allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupProp the property of cu group.
+ *            udfCuGroupName: user defined cu group type name.
+ *            poolId: id of the cu pool this group CUs come from, the system default pool id is 0.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu group, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuGroupRes cu group resource.
+ *            cuResources cu resource group to fill the allocated cus infor, starting from cuResources[0], no hole.
+ *            cuNum allocated cu number in this list.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuGroupBlockingAllocWithTimeout(xrmContext context,
+                                           xrmCuGroupProperty* cuGroupProp,
+                                           uint64_t interval,
+                                           int32_t timeout,
+                                           xrmCuGroupResource* cuGroupRes) {
     int32_t i;
     xrmCuProperty* cuProp;
     xrmCuResource* cuRes;
@@ -3131,16 +4127,28 @@ int32_t xrmCuGroupBlockingAlloc(xrmContext context,
         xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: interval out range [0 - 1000000].\n", __func__);
         return (XRM_ERROR_INVALID);
     }
+    if (timeout < 0 && timeout != XRM_ALLOC_WAIT_FOREVER) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): invalid input: timeout %d is out of range.\n", __func__,
+               timeout);
+        return (XRM_ERROR_INVALID);
+    }
 
     if (!xrmIsCuGroupExisting(ctx, cuGroupProp)) return (XRM_ERROR_NO_KERNEL);
     int32_t ret = XRM_ERROR_NO_KERNEL;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_3) {
+        /* the daemon holds the request until it's satisfied or the time is out, no interval used */
+        xrmWaitTime = timeout;
+        ret = xrmCuGroupAlloc(ctx, cuGroupProp, cuGroupRes);
+        xrmWaitTime = 0;
+    }
     if (interval)
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuGroupAlloc(ctx, cuGroupProp, cuGroupRes);
             usleep(interval);
         }
     else
-        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL)) {
+        while ((ret != XRM_SUCCESS) && (ret != XRM_ERROR_CONNECT_FAIL) && xrmIsTimeLeft(deadline, timeout)) {
             ret = xrmCuGroupAlloc(ctx, cuGroupProp, cuGroupRes);
             sched_yield();
         }
@@ -3238,6 +4246,32 @@ int32_t xrmCuAllocV2(xrmContext context, xrmCuPropertyV2* cuProp, xrmCuResourceV
 
     memset(cuRes, 0, sizeof(xrmCuResourceV2));
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t ret;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(getpid());
+        enc.putString(cuProp->kernelName);
+        enc.putString(cuProp->kernelAlias);
+        enc.putUint8(cuProp->devExcl ? 1 : 0);
+        enc.putUint64(cuProp->deviceInfo);
+        enc.putUint64(cuProp->memoryInfo);
+        enc.putUint64(cuProp->policyInfo);
+        enc.putInt32(unifiedLoad);
+        enc.putInt32(cuProp->requestLoad);
+        enc.putUint64(cuProp->poolId);
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_ALLOC_V2, reqPayload, rspPayload, &ret) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (ret == XRM_SUCCESS) {
+            xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+            xrmBinaryGetCuResource(dec, cuRes);
+            if (!dec.ok()) return (XRM_ERROR);
+            xrmTrackAlloc(ctx, cuRes, 1);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuAllocTree;
@@ -3299,6 +4333,7 @@ int32_t xrmCuAllocV2(xrmContext context, xrmCuPropertyV2* cuProp, xrmCuResourceV
         cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize");
         cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr");
         cuRes->poolId = rspTree.get<uint64_t>("response.data.poolId");
+        xrmTrackAlloc(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -3352,6 +4387,52 @@ int32_t xrmCuListAllocV2(xrmContext context, xrmCuListPropertyV2* cuListProp, xr
         return (XRM_ERROR_INVALID);
     }
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(getpid());
+        enc.putInt32(cuListProp->cuNum);
+        for (i = 0; i < cuListProp->cuNum; i++) {
+            cuProp = &cuListProp->cuProps[i];
+            if ((cuProp->kernelName[0] == '\0') && (cuProp->kernelAlias[0] == '\0')) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s cuProps[%d] neither kernel name nor alias are provided",
+                       __func__, i);
+                return (XRM_ERROR_INVALID);
+            }
+            unifiedLoad = xrmRetrieveLoadInfo(cuProp->requestLoad);
+            if (unifiedLoad < 0) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong request load: 0x%x", __func__,
+                       cuProp->requestLoad);
+                return (XRM_ERROR_INVALID);
+            }
+            if (cuProp->policyInfo) {
+                // as cu/dev most/least used policy will not work for cu list allocation, so force it to 0
+                cuProp->policyInfo = 0;
+            }
+            enc.putString(cuProp->kernelName);
+            enc.putString(cuProp->kernelAlias);
+            enc.putUint8(cuProp->devExcl ? 1 : 0);
+            enc.putUint64(cuProp->deviceInfo);
+            enc.putUint64(cuProp->memoryInfo);
+            enc.putUint64(cuProp->policyInfo);
+            enc.putInt32(unifiedLoad);
+            enc.putInt32(cuProp->requestLoad);
+            enc.putUint64(cuProp->poolId);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_LIST_ALLOC_V2, reqPayload, rspPayload, &ret) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (ret == XRM_SUCCESS) {
+            xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+            cuListRes->cuNum = dec.getInt32();
+            if (cuListRes->cuNum < 0 || cuListRes->cuNum > XRM_MAX_LIST_CU_NUM_V2) return (XRM_ERROR);
+            for (i = 0; i < cuListRes->cuNum; i++) xrmBinaryGetCuResource(dec, &cuListRes->cuResources[i]);
+            if (!dec.ok()) return (XRM_ERROR);
+            xrmTrackAlloc(ctx, cuListRes->cuResources, cuListRes->cuNum);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuListAllocTree;
@@ -3436,6 +4517,7 @@ int32_t xrmCuListAllocV2(xrmContext context, xrmCuListPropertyV2* cuListProp, xr
             cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize" + std::to_string(i));
             cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr" + std::to_string(i));
             cuRes->poolId = rspTree.get<int32_t>("response.data.poolId" + std::to_string(i));
+            xrmTrackAlloc(ctx, cuRes, 1);
         }
     }
     return (ret);
@@ -3484,6 +4566,20 @@ bool xrmCuReleaseV2(xrmContext context, xrmCuResourceV2* cuRes) {
         return (XRM_ERROR_INVALID);
     }
 
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        xrmBinaryPutReleasingCuResource(enc, cuRes, unifiedLoad);
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_RELEASE_V2, reqPayload, rspPayload, &value) != XRM_SUCCESS) return (ret);
+        if (value == XRM_SUCCESS) {
+            ret = true;
+            xrmTrackRelease(ctx, cuRes, 1);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree xrmCuRelease;
@@ -3512,6 +4608,7 @@ bool xrmCuReleaseV2(xrmContext context, xrmCuResourceV2* cuRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuRes, 1);
     }
     return (ret);
 }
@@ -3551,6 +4648,30 @@ bool xrmCuListReleaseV2(xrmContext context, xrmCuListResourceV2* cuListRes) {
     }
 
     /* will release all the resource */
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_1) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(cuListRes->cuNum);
+        for (i = 0; i < cuListRes->cuNum; i++) {
+            cuRes = &cuListRes->cuResources[i];
+            unifiedLoad = xrmRetrieveLoadInfo(cuRes->channelLoad);
+            if (unifiedLoad < 0) {
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong channel load: 0x%x", __func__,
+                       cuRes->channelLoad);
+                return (XRM_ERROR_INVALID);
+            }
+            xrmBinaryPutReleasingCuResource(enc, cuRes, unifiedLoad);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_LIST_RELEASE_V2, reqPayload, rspPayload, &value) != XRM_SUCCESS) return (ret);
+        if (value == XRM_SUCCESS) {
+            ret = true;
+            xrmTrackRelease(ctx, cuListRes->cuResources, cuListRes->cuNum);
+        }
+        return (ret);
+    }
+
     char jsonRsp[maxLength];
     memset(jsonRsp, 0, maxLength * sizeof(char));
     pt::ptree cuListReleaseTree;
@@ -3587,8 +4708,199 @@ bool xrmCuListReleaseV2(xrmContext context, xrmCuListResourceV2* cuListRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuListRes->cuResources, cuListRes->cuNum);
+    }
+
+    return (ret);
+}
+
+/**
+ * \brief Allocates a batch of independent compute unit resources in one request,
+ * each cu is allocated as xrmCuAllocV2().
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuBatchProp the property of cu batch.
+ *             cuProps: cu prop list, each one as the cuProp of xrmCuAllocV2(), starting from cuProps[0], no hole.
+ *             cuNum: request number of cu in this batch.
+ *             allOrNothing: if any cu can not be allocated, the allocated ones are released, the failed
+ *                           cu gets its error in cuResults and all others get XRM_ERROR.
+ * @param cuBatchRes the cu batch resource.
+ *             cuResources: the allocated cu of cuProps[i] is filled into cuResources[i].
+ *             cuResults: result of each cu, 0 on success or appropriate error number.
+ *             cuNum: number of cu in this batch, same as the request.
+ * @return int32_t, 0 if all cu are allocated, or the error number of the first failed cu.
+ */
+int32_t xrmCuBatchAllocV2(xrmContext context, xrmCuBatchPropertyV2* cuBatchProp, xrmCuBatchResourceV2* cuBatchRes) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+    int32_t i, ret = XRM_SUCCESS;
+    xrmCuPropertyV2* cuProp;
+    int32_t unifiedLoads[XRM_MAX_BATCH_CU_NUM_V2]; // granularity of 1,000,000
+
+    if (ctx == NULL || cuBatchProp == NULL || cuBatchRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context, cu batch properties or resource pointer is NULL\n",
+               __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (XRM_ERROR_INVALID);
+    }
+    if (cuBatchProp->cuNum <= 0 || cuBatchProp->cuNum > XRM_MAX_BATCH_CU_NUM_V2) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): request batch prop cuNum is %d, out of range from 1 to %d.\n",
+               __func__, cuBatchProp->cuNum, XRM_MAX_BATCH_CU_NUM_V2);
+        return (XRM_ERROR_INVALID);
+    }
+    for (i = 0; i < cuBatchProp->cuNum; i++) {
+        cuProp = &cuBatchProp->cuProps[i];
+        if ((cuProp->kernelName[0] == '\0') && (cuProp->kernelAlias[0] == '\0')) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): neither kernel name nor alias are provided for cu %d",
+                   __func__, i);
+            return (XRM_ERROR_INVALID);
+        }
+        unifiedLoads[i] = xrmRetrieveLoadInfo(cuProp->requestLoad);
+        if (unifiedLoads[i] < 0) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong request load of cu %d: 0x%x", __func__, i,
+                   cuProp->requestLoad);
+            return (XRM_ERROR_INVALID);
+        }
+    }
+
+    memset(cuBatchRes, 0, sizeof(xrmCuBatchResourceV2));
+    cuBatchRes->cuNum = cuBatchProp->cuNum;
+
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_4) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(getpid());
+        enc.putUint8(cuBatchProp->allOrNothing ? 1 : 0);
+        enc.putInt32(cuBatchProp->cuNum);
+        for (i = 0; i < cuBatchProp->cuNum; i++) {
+            cuProp = &cuBatchProp->cuProps[i];
+            enc.putString(cuProp->kernelName);
+            enc.putString(cuProp->kernelAlias);
+            enc.putUint8(cuProp->devExcl ? 1 : 0);
+            enc.putUint64(cuProp->deviceInfo);
+            enc.putUint64(cuProp->memoryInfo);
+            enc.putUint64(cuProp->policyInfo);
+            enc.putInt32(unifiedLoads[i]);
+            enc.putInt32(cuProp->requestLoad);
+            enc.putUint64(cuProp->poolId);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_BATCH_ALLOC_V2, reqPayload, rspPayload, &value) != XRM_SUCCESS)
+            return (XRM_ERROR_CONNECT_FAIL);
+        if (value != XRM_SUCCESS) return (value);
+        xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+        ret = dec.getInt32();
+        if (dec.getInt32() != cuBatchProp->cuNum) return (XRM_ERROR);
+        for (i = 0; i < cuBatchProp->cuNum; i++) {
+            cuBatchRes->cuResults[i] = dec.getInt32();
+            if (cuBatchRes->cuResults[i] == XRM_SUCCESS) xrmBinaryGetCuResource(dec, &cuBatchRes->cuResources[i]);
+        }
+        if (!dec.ok()) return (XRM_ERROR);
+        for (i = 0; i < cuBatchProp->cuNum; i++) {
+            if (cuBatchRes->cuResults[i] == XRM_SUCCESS) xrmTrackAlloc(ctx, &cuBatchRes->cuResources[i], 1);
+        }
+        return (ret);
+    }
+
+    /* daemon without batch support, the cu are allocated one by one */
+    for (i = 0; i < cuBatchProp->cuNum; i++) {
+        cuBatchRes->cuResults[i] = xrmCuAllocV2(ctx, &cuBatchProp->cuProps[i], &cuBatchRes->cuResources[i]);
+        if (cuBatchRes->cuResults[i] == XRM_SUCCESS) continue;
+        if (ret == XRM_SUCCESS) ret = cuBatchRes->cuResults[i];
+        if (cuBatchProp->allOrNothing) break;
+    }
+    if (cuBatchProp->allOrNothing && ret != XRM_SUCCESS) {
+        for (int32_t j = 0; j < cuBatchProp->cuNum; j++) {
+            if (j == i) continue;
+            if (j < i) xrmCuReleaseV2(ctx, &cuBatchRes->cuResources[j]);
+            memset(&cuBatchRes->cuResources[j], 0, sizeof(xrmCuResourceV2));
+            cuBatchRes->cuResults[j] = XRM_ERROR;
+        }
+    }
+    return (ret);
+}
+
+/**
+ * \brief Releases a batch of previously allocated resources in one request.
+ *
+ * @param context the context created through xrmCreateContext().
+ * @param cuBatchRes the cu batch resource.
+ *             cuResources: cu resource list to be released, starting from cuResources[0], no hole.
+ *             cuResults: the cu with non-zero result is skipped, so the batch partly allocated by
+ *                        xrmCuBatchAllocV2() can be released directly. Result of each cu release
+ *                        is put back, 0 on success or appropriate error number.
+ *             cuNum: number of cu in this batch.
+ * @return bool, true if all cu are released or false on any fail.
+ */
+bool xrmCuBatchReleaseV2(xrmContext context, xrmCuBatchResourceV2* cuBatchRes) {
+    bool ret = true;
+    int32_t i, releaseNum = 0;
+    xrmCuResourceV2* cuRes;
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+    int32_t releaseIdx[XRM_MAX_BATCH_CU_NUM_V2]; // index of the cu to release in the batch
+    int32_t unifiedLoad;                         // granularity of 1,000,000
+
+    if (ctx == NULL || cuBatchRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or cu batch resource pointer is NULL\n", __func__);
+        return (false);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (false);
+    }
+    if (cuBatchRes->cuNum < 0 || cuBatchRes->cuNum > XRM_MAX_BATCH_CU_NUM_V2) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): batch resource cuNum is %d, out of range 0 - %d.\n",
+               __func__, cuBatchRes->cuNum, XRM_MAX_BATCH_CU_NUM_V2);
+        return (false);
+    }
+    for (i = 0; i < cuBatchRes->cuNum; i++) {
+        if (cuBatchRes->cuResults[i] != XRM_SUCCESS) continue;
+        if (xrmRetrieveLoadInfo(cuBatchRes->cuResources[i].channelLoad) < 0) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): wrong channel load of cu %d: 0x%x", __func__, i,
+                   cuBatchRes->cuResources[i].channelLoad);
+            return (false);
+        }
+        releaseIdx[releaseNum++] = i;
+    }
+    /* Nothing to release */
+    if (releaseNum == 0) return (ret);
+
+    if (ctx->binaryProtocolVersion >= XRM_BINARY_PROTOCOL_VERSION_4) {
+        std::string reqPayload, rspPayload;
+        xrm::binaryEncoder enc(reqPayload);
+        int32_t value;
+        enc.putUint64(ctx->xrmClientId);
+        enc.putInt32(releaseNum);
+        for (i = 0; i < releaseNum; i++) {
+            cuRes = &cuBatchRes->cuResources[releaseIdx[i]];
+            unifiedLoad = xrmRetrieveLoadInfo(cuRes->channelLoad);
+            xrmBinaryPutReleasingCuResource(enc, cuRes, unifiedLoad);
+        }
+        if (xrmBinaryRequest(ctx, xrm::BINARY_OP_CU_BATCH_RELEASE_V2, reqPayload, rspPayload, &value) != XRM_SUCCESS)
+            return (false);
+        if (value != XRM_SUCCESS) return (false);
+        xrm::binaryDecoder dec(rspPayload.data(), rspPayload.size());
+        if (dec.getInt32() != releaseNum) return (false);
+        for (i = 0; i < releaseNum; i++) {
+            cuBatchRes->cuResults[releaseIdx[i]] = dec.getInt32();
+            if (cuBatchRes->cuResults[releaseIdx[i]] != XRM_SUCCESS)
+                ret = false;
+            else
+                xrmTrackRelease(ctx, &cuBatchRes->cuResources[releaseIdx[i]], 1);
+        }
+        if (!dec.ok()) return (false);
+        return (ret);
     }
 
+    /* daemon without batch support, the cu are released one by one */
+    for (i = 0; i < releaseNum; i++) {
+        if (xrmCuReleaseV2(ctx, &cuBatchRes->cuResources[releaseIdx[i]])) continue;
+        cuBatchRes->cuResults[releaseIdx[i]] = XRM_ERROR;
+        ret = false;
+    }
     return (ret);
 }
 
@@ -3820,6 +5132,7 @@ int32_t xrmCuGroupAllocV2(xrmContext context, xrmCuGroupPropertyV2* cuGroupProp,
             cuRes->membankSize = rspTree.get<uint64_t>("response.data.membankSize" + std::to_string(i));
             cuRes->membankBaseAddr = rspTree.get<uint64_t>("response.data.membankBaseAddr" + std::to_string(i));
             cuRes->poolId = rspTree.get<int32_t>("response.data.poolId" + std::to_string(i));
+            xrmTrackAlloc(ctx, cuRes, 1);
         }
     }
     return (ret);
@@ -3896,6 +5209,7 @@ bool xrmCuGroupReleaseV2(xrmContext context, xrmCuGroupResourceV2* cuGroupRes) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelease(ctx, cuGroupRes->cuResources, cuGroupRes->cuNum);
     }
 
     return (ret);
@@ -4466,6 +5780,7 @@ uint64_t xrmCuPoolReserveV2(xrmContext context, xrmCuPoolPropertyV2* cuPoolProp,
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         reserve_poolId = rspTree.get<int64_t>("response.data.poolId");
+        xrmTrackReserve(ctx, reserve_poolId);
 
         cuPoolResInfor->cuListNum = rspTree.get<int32_t>("response.data.cuListNum");
         for (i = 0; i < cuPoolResInfor->cuListNum; i++) {
@@ -4539,6 +5854,7 @@ bool xrmCuPoolRelinquishV2(xrmContext context, uint64_t poolId) {
     auto value = rspTree.get<int32_t>("response.status.value");
     if (value == XRM_SUCCESS) {
         ret = true;
+        xrmTrackRelinquish(ctx, poolId);
     }
     return (ret);
 }
@@ -4634,3 +5950,390 @@ int32_t xrmReservationQueryV2(xrmContext context,
     }
     return (ret);
 }
+
+/**
+ * Internal function.
+ *
+ * \brief runs the asynchronous requests of the context in submission order until
+ * the worker is stopped and no request is left.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @return void
+ */
+static void xrmAsyncRun(xrmPrivateContext* ctx) {
+    xrmAsyncWorker& worker = ctx->asyncWorker;
+    std::unique_lock<std::mutex> guard(worker.lock);
+
+    while (true) {
+        worker.cond.wait(guard, [&worker] { return (worker.stopping || !worker.requests.empty()); });
+        if (worker.requests.empty()) break;
+        xrmAsyncRequest req = std::move(worker.requests.front());
+        worker.requests.pop_front();
+        guard.unlock();
+
+        int32_t result = req.request();
+        if (req.callback != NULL) req.callback(req.requestId, result, req.userData);
+
+        guard.lock();
+        if (req.callback == NULL) {
+            xrmAsyncCompletion completion;
+            memset(&completion, 0, sizeof(xrmAsyncCompletion));
+            completion.requestId = req.requestId;
+            completion.result = result;
+            completion.userData = req.userData;
+            worker.completions.push_back(completion);
+            uint64_t one = 1;
+            if (write(worker.eventFd, &one, sizeof(one)) != sizeof(one))
+                xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: fail to signal event fd", __func__);
+        }
+    }
+}
+
+/**
+ * Internal function.
+ *
+ * \brief creates the event fd of the asynchronous completions if it's not created yet.
+ * It's called with the worker lock held.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @return int32_t, 0 on success or appropriate error number
+ */
+static int32_t xrmAsyncOpenEventFd(xrmPrivateContext* ctx) {
+    xrmAsyncWorker& worker = ctx->asyncWorker;
+
+    if (worker.eventFd >= 0) return (XRM_SUCCESS);
+    worker.eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker.eventFd < 0) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: fail to create event fd, errno %d", __func__, errno);
+        return (XRM_ERROR);
+    }
+    return (XRM_SUCCESS);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief queues one asynchronous request, the worker thread is started on first submission.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @param request the synchronous call to run, returns the result
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+static uint64_t xrmAsyncSubmit(xrmPrivateContext* ctx,
+                               std::function<int32_t()> request,
+                               xrmAsyncCallback callback,
+                               void* userData) {
+    xrmAsyncWorker& worker = ctx->asyncWorker;
+    std::lock_guard<std::mutex> guard(worker.lock);
+
+    if (worker.stopping) return (0);
+    if (callback == NULL && xrmAsyncOpenEventFd(ctx) != XRM_SUCCESS) return (0);
+    if (!worker.thread.joinable()) {
+        try {
+            worker.thread = std::thread(xrmAsyncRun, ctx);
+        } catch (std::exception& e) {
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s Exception: %s\n", __func__, e.what());
+            return (0);
+        }
+    }
+    uint64_t requestId = worker.nextRequestId++;
+    worker.requests.push_back({requestId, std::move(request), callback, userData});
+    worker.cond.notify_one();
+    return (requestId);
+}
+
+/**
+ * Internal function.
+ *
+ * \brief stops the worker thread after all submitted requests are completed, and closes
+ * the event fd. It must not be called from the completion callback.
+ *
+ * @param ctx the context created through xrmCreateContext()
+ * @return void
+ */
+static void xrmAsyncStop(xrmPrivateContext* ctx) {
+    xrmAsyncWorker& worker = ctx->asyncWorker;
+
+    {
+        std::lock_guard<std::mutex> guard(worker.lock);
+        worker.stopping = true;
+        worker.cond.notify_one();
+    }
+    if (worker.thread.joinable()) worker.thread.join();
+    if (worker.eventFd >= 0) {
+        close(worker.eventFd);
+        worker.eventFd = -1;
+    }
+}
+
+/**
+ * \brief Gets the event fd of the context for asynchronous requests submitted without
+ * callback. The fd is readable while there are completions to be taken by xrmAsyncPoll(),
+ * so it can be added into the epoll or poll loop of the application. The fd is owned by
+ * the context and closed by xrmDestroyContext().
+ *
+ * @param context the context created through xrmCreateContext()
+ * @return int32_t, the event fd (>= 0) or appropriate error number
+ */
+int32_t xrmAsyncGetEventFd(xrmContext context) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context pointer is NULL\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (XRM_ERROR_INVALID);
+    }
+    std::lock_guard<std::mutex> guard(ctx->asyncWorker.lock);
+    if (xrmAsyncOpenEventFd(ctx) != XRM_SUCCESS) return (XRM_ERROR);
+    return (ctx->asyncWorker.eventFd);
+}
+
+/**
+ * \brief Takes the queued completions of asynchronous requests submitted without callback,
+ * never blocks.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param completions the array to fill the completions, in completion order
+ * @param maxNum the size of completions array
+ * @return int32_t, number of completions taken (>= 0) or appropriate error number
+ */
+int32_t xrmAsyncPoll(xrmContext context, xrmAsyncCompletion* completions, int32_t maxNum) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+    int32_t num = 0;
+
+    if (ctx == NULL || completions == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or completions pointer is NULL\n", __func__);
+        return (XRM_ERROR_INVALID);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (XRM_ERROR_INVALID);
+    }
+    if (maxNum <= 0) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s(): maxNum %d is not positive", __func__, maxNum);
+        return (XRM_ERROR_INVALID);
+    }
+
+    xrmAsyncWorker& worker = ctx->asyncWorker;
+    std::lock_guard<std::mutex> guard(worker.lock);
+    while (num < maxNum && !worker.completions.empty()) {
+        completions[num++] = worker.completions.front();
+        worker.completions.pop_front();
+    }
+    /* the event fd is readable only while completions are left */
+    if (worker.completions.empty() && worker.eventFd >= 0) {
+        uint64_t count;
+        if (read(worker.eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s: fail to read event fd, errno %d", __func__, errno);
+    }
+    return (num);
+}
+
+/**
+ * \brief Submits xrmCuAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu, as xrmCuAllocV2()
+ * @param cuRes the cu resource filled on completion, as xrmCuAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuAllocV2(xrmContext context,
+                           xrmCuPropertyV2* cuProp,
+                           xrmCuResourceV2* cuRes,
+                           xrmAsyncCallback callback,
+                           void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuProp == NULL || cuRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context, cu properties or resource pointer is NULL\n", __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    xrmCuPropertyV2 prop = *cuProp;
+    return (xrmAsyncSubmit(ctx, [ctx, prop, cuRes]() mutable { return (xrmCuAllocV2(ctx, &prop, cuRes)); },
+                           callback, userData));
+}
+
+/**
+ * \brief Submits xrmCuReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuRes the cu resource to be released, as xrmCuReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuReleaseV2(xrmContext context, xrmCuResourceV2* cuRes, xrmAsyncCallback callback, void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or cu resource pointer is NULL\n", __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    return (xrmAsyncSubmit(
+        ctx, [ctx, cuRes]() { return (xrmCuReleaseV2(ctx, cuRes) ? XRM_SUCCESS : XRM_ERROR); }, callback,
+        userData));
+}
+
+/**
+ * \brief Submits xrmCuListAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListProp the property of cu list, as xrmCuListAllocV2()
+ * @param cuListRes the cu list resource filled on completion, as xrmCuListAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuListAllocV2(xrmContext context,
+                               xrmCuListPropertyV2* cuListProp,
+                               xrmCuListResourceV2* cuListRes,
+                               xrmAsyncCallback callback,
+                               void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuListProp == NULL || cuListRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context, cu list properties or resource pointer is NULL\n",
+               __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    xrmCuListPropertyV2 prop = *cuListProp;
+    return (xrmAsyncSubmit(ctx,
+                           [ctx, prop, cuListRes]() mutable { return (xrmCuListAllocV2(ctx, &prop, cuListRes)); },
+                           callback, userData));
+}
+
+/**
+ * \brief Submits xrmCuListReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListRes the cu list resource to be released, as xrmCuListReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuListReleaseV2(xrmContext context,
+                                 xrmCuListResourceV2* cuListRes,
+                                 xrmAsyncCallback callback,
+                                 void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuListRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or cu list resource pointer is NULL\n", __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    return (xrmAsyncSubmit(
+        ctx, [ctx, cuListRes]() { return (xrmCuListReleaseV2(ctx, cuListRes) ? XRM_SUCCESS : XRM_ERROR); },
+        callback, userData));
+}
+
+/**
+ * \brief Submits xrmCuGroupAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupProp the property of cu group, as xrmCuGroupAllocV2()
+ * @param cuGroupRes the cu group resource filled on completion, as xrmCuGroupAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuGroupAllocV2(xrmContext context,
+                                xrmCuGroupPropertyV2* cuGroupProp,
+                                xrmCuGroupResourceV2* cuGroupRes,
+                                xrmAsyncCallback callback,
+                                void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuGroupProp == NULL || cuGroupRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context, cu group properties or resource pointer is NULL\n",
+               __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    xrmCuGroupPropertyV2 prop = *cuGroupProp;
+    return (xrmAsyncSubmit(ctx,
+                           [ctx, prop, cuGroupRes]() mutable { return (xrmCuGroupAllocV2(ctx, &prop, cuGroupRes)); },
+                           callback, userData));
+}
+
+/**
+ * \brief Submits xrmCuGroupReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupRes the cu group resource to be released, as xrmCuGroupReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuGroupReleaseV2(xrmContext context,
+                                  xrmCuGroupResourceV2* cuGroupRes,
+                                  xrmAsyncCallback callback,
+                                  void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuGroupRes == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or cu group resource pointer is NULL\n", __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    return (xrmAsyncSubmit(
+        ctx, [ctx, cuGroupRes]() { return (xrmCuGroupReleaseV2(ctx, cuGroupRes) ? XRM_SUCCESS : XRM_ERROR); },
+        callback, userData));
+}
+
+/**
+ * \brief Submits xrmCheckCuAvailableNumV2() asynchronously, the result is the available
+ * cu number or appropriate error number.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu, as xrmCheckCuAvailableNumV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCheckCuAvailableNumV2(xrmContext context,
+                                       xrmCuPropertyV2* cuProp,
+                                       xrmAsyncCallback callback,
+                                       void* userData) {
+    xrmPrivateContext* ctx = (xrmPrivateContext*)context;
+
+    if (ctx == NULL || cuProp == NULL) {
+        xrmLog(XRM_LOG_ERROR, XRM_LOG_ERROR, "%s(): context or cu properties pointer is NULL\n", __func__);
+        return (0);
+    }
+    if (ctx->xrmApiVersion != XRM_API_VERSION_1) {
+        xrmLog(ctx->xrmLogLevel, XRM_LOG_ERROR, "%s wrong xrm api version %d", __func__, ctx->xrmApiVersion);
+        return (0);
+    }
+    xrmCuPropertyV2 prop = *cuProp;
+    return (xrmAsyncSubmit(ctx, [ctx, prop]() mutable { return (xrmCheckCuAvailableNumV2(ctx, &prop)); }, callback,
+                           userData));
+}
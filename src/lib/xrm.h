@@ -269,6 +269,9 @@ typedef struct xrmCuPropertyV2 {
 #define XRM_LOAD_GRANULARIY_1000000_SHIFT 8
 #define XRM_LOAD_GRANULARIY_1000000_MASK 0xFFFFF
 
+/* timeout of the blocking allocation to wait for the resource without limit */
+#define XRM_ALLOC_WAIT_FOREVER (-1)
+
 /* list of request compute resource property version 2 */
 typedef struct xrmCuListPropertyV2 {
     xrmCuPropertyV2 cuProps[XRM_MAX_LIST_CU_NUM_V2];
@@ -383,6 +386,26 @@ typedef struct xrmCuListResourceV2 {
     uint8_t extData[64]; // for future extension
 } xrmCuListResourceV2;
 
+/*
+ * batch of independent compute resource request version 2
+ */
+typedef struct xrmCuBatchPropertyV2 {
+    xrmCuPropertyV2 cuProps[XRM_MAX_BATCH_CU_NUM_V2];
+    int32_t cuNum;       // total number of requested cu in the batch
+    bool allOrNothing;   // allocate nothing if any cu of the batch can not be allocated
+    uint8_t extData[64]; // for future extension
+} xrmCuBatchPropertyV2;
+
+/*
+ * allocated/released compute resource batch version 2
+ */
+typedef struct xrmCuBatchResourceV2 {
+    xrmCuResourceV2 cuResources[XRM_MAX_BATCH_CU_NUM_V2];
+    int32_t cuResults[XRM_MAX_BATCH_CU_NUM_V2]; // result of each cu, 0 on success or appropriate error number
+    int32_t cuNum;
+    uint8_t extData[64]; // for future extension
+} xrmCuBatchResourceV2;
+
 /*
  * allocated/released compute resource group version 2
  */
@@ -481,8 +504,21 @@ typedef enum xrmLogLevelType {
 
 typedef void* xrmContext;
 
+/*
+ * asynchronous request related data struct
+ */
+typedef void (*xrmAsyncCallback)(uint64_t requestId, int32_t result, void* userData);
+
+typedef struct xrmAsyncCompletion {
+    uint64_t requestId;  // id returned when the request was submitted
+    int32_t result;      // result of the request, same as the return value of the synchronous call
+    void* userData;      // user data given when the request was submitted
+    uint32_t extData[4]; // for future extension
+} xrmAsyncCompletion;
+
 /**
- * \brief Establishes a connection with the XRM daemon
+ * \brief Establishes a connection with the XRM daemon. If the connection is broken
+ * later, e.g. the daemon is restarted, the context reconnects and keeps its client id.
  *
  * @param xrmApiVersion the XRM API version number
  * @return xrmContext, pointer to created context or NULL on fail
@@ -933,6 +969,9 @@ int32_t xrmLoadAndAllCuAlloc(xrmContext context, char* xclbinFileName, xrmCuList
  * \brief Blocking function of xrmCuAlloc(), this function will try to do cu allocation
  * until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuProp the property of cu.
  *             kernelName: the kernel name requested.
@@ -966,10 +1005,59 @@ int32_t xrmLoadAndAllCuAlloc(xrmContext context, char* xclbinFileName, xrmCuList
  */
 int32_t xrmCuBlockingAlloc(xrmContext context, xrmCuProperty* cuProp, uint64_t interval, xrmCuResource* cuRes);
 
+/**
+ * \brief Blocking function of xrmCuAlloc() with timeout, this function will try to do cu
+ * allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu.
+ *             kernelName: the kernel name requested.
+ *             kernelAlias: the alias of kernel name requested.
+ *             devExcl: request exclusive device usage for this client.
+ *             requestLoad: request load, only one type granularity at one time.
+ *                          bit[31 - 28] reserved
+ *                          bit[27 -  8] granularity of 1000000 (0 - 1000000)
+ *                          bit[ 7 -  0] granularity of 100 (0 - 100)
+ *             poolId: request to allocate cu from specified resource pool.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuRes cu resource.
+ *             xclbinFileName: xclbin (path and name) attached to this device.
+ *             kernelPluginFileName: kernel plugin (only name) attached to this device.
+ *             kernelName: the kernel name of allocated cu.
+ *             kernelAlias: the name alias of allocated cu.
+ *             instanceName: the instance name of allocated cu.
+ *             cuName: the name of allocated cu (kernelName:instanceName).
+ *             uuid: uuid of the loaded xclbin file.
+ *             deviceId: device id of this cu.
+ *             cuId: cu id of this cu.
+ *             channelId: channel id of this cu.
+ *             cuType: type of cu, hardware kernel or soft kernel.
+ *             allocServiceId: service id for this cu allocation.
+ *             channelLoad: allocated load of this cu, only one type granularity at one time.
+ *                          bit[31 - 28] reserved
+ *                          bit[27 -  8] granularity of 1000000 (0 - 1000000)
+ *                          bit[ 7 -  0] granularity of 100 (0 - 100)
+ *             poolId: id of the cu pool this cu comes from, the default pool id is 0.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuBlockingAllocWithTimeout(xrmContext context,
+                                      xrmCuProperty* cuProp,
+                                      uint64_t interval,
+                                      int32_t timeout,
+                                      xrmCuResource* cuRes);
+
 /**
  * \brief Blocking function of xrmCuListAlloc(), this function will try to do cu list allocation
  * until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuListProp the property of cu list.
  *             cuProps: cu prop list to fill kernelName, devExcl and requestLoad, starting from cuProps[0], no hole.
@@ -986,10 +1074,39 @@ int32_t xrmCuListBlockingAlloc(xrmContext context,
                                uint64_t interval,
                                xrmCuListResource* cuListRes);
 
+/**
+ * \brief Blocking function of xrmCuListAlloc() with timeout, this function will try to do cu
+ * list allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListProp the property of cu list.
+ *             cuProps: cu prop list to fill kernelName, devExcl and requestLoad, starting from cuProps[0], no hole.
+ *             cuNum: request number of cu in this list.
+ *             sameDevice request this list of cu from same device.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu list, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuListRes cu list resource.
+ *             cuResources: cu resource list to fill the allocated cus infor, starting from cuResources[0], no hole.
+ *             cuNum: allocated cu number in this list.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuListBlockingAllocWithTimeout(xrmContext context,
+                                          xrmCuListProperty* cuListProp,
+                                          uint64_t interval,
+                                          int32_t timeout,
+                                          xrmCuListResource* cuListRes);
+
 /**
  * \brief Blocking function of xrmCuGroupAlloc(), this function will try to do cu group
  * allocation until success.
  *
+ * The daemon holds the request until it's satisfied by the released resource, the interval
+ * is only used to retry with the daemon not supporting it.
+ *
  * @param context the context created through xrmCreateContext()
  * @param cuGroupProp the property of cu group.
  *            udfCuGroupName: user defined cu group type name.
@@ -1005,6 +1122,31 @@ int32_t xrmCuGroupBlockingAlloc(xrmContext context,
                                 uint64_t interval,
                                 xrmCuGroupResource* cuGroupRes);
 
+/**
+ * \brief Blocking function of xrmCuGroupAlloc() with timeout, this function will try to do cu
+ * group allocation until success or the time is out.
+ *
+ * The daemon holds the request until it's satisfied by the released resource or the time
+ * is out, the interval is only used to retry with the daemon not supporting it.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupProp the property of cu group.
+ *            udfCuGroupName: user defined cu group type name.
+ *            poolId: id of the cu pool this group CUs come from, the system default pool id is 0.
+ * @param interval the interval time (useconds) before re-trying, [0 - 1000000], other value is invalid.
+ * @param timeout the time (milliseconds) to wait for the cu group, 0 or positive, or XRM_ALLOC_WAIT_FOREVER
+ *                to wait without limit, other value is invalid.
+ * @param cuGroupRes cu group resource.
+ *            cuResources cu resource group to fill the allocated cus infor, starting from cuResources[0], no hole.
+ *            cuNum allocated cu number in this list.
+ * @return int32_t, 0 on success or appropriate error number, the error of the allocation if the time is out
+ */
+int32_t xrmCuGroupBlockingAllocWithTimeout(xrmContext context,
+                                           xrmCuGroupProperty* cuGroupProp,
+                                           uint64_t interval,
+                                           int32_t timeout,
+                                           xrmCuGroupResource* cuGroupRes);
+
 /**
  * \brief Allocates compute unit with a device, cu, and channel given a
  * kernel name or alias or both and request load. This function also
@@ -1137,6 +1279,38 @@ bool xrmCuReleaseV2(xrmContext context, xrmCuResourceV2* cuRes);
  */
 bool xrmCuListReleaseV2(xrmContext context, xrmCuListResourceV2* cuListRes);
 
+/**
+ * \brief Allocates a batch of independent compute unit resources in one request,
+ * each cu is allocated as xrmCuAllocV2().
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuBatchProp the property of cu batch.
+ *             cuProps: cu prop list, each one as the cuProp of xrmCuAllocV2(), starting from cuProps[0], no hole.
+ *             cuNum: request number of cu in this batch.
+ *             allOrNothing: if any cu can not be allocated, the allocated ones are released, the failed
+ *                           cu gets its error in cuResults and all others get XRM_ERROR.
+ * @param cuBatchRes the cu batch resource.
+ *             cuResources: the allocated cu of cuProps[i] is filled into cuResources[i].
+ *             cuResults: result of each cu, 0 on success or appropriate error number.
+ *             cuNum: number of cu in this batch, same as the request.
+ * @return int32_t, 0 if all cu are allocated, or the error number of the first failed cu.
+ */
+int32_t xrmCuBatchAllocV2(xrmContext context, xrmCuBatchPropertyV2* cuBatchProp, xrmCuBatchResourceV2* cuBatchRes);
+
+/**
+ * \brief Releases a batch of previously allocated resources in one request.
+ *
+ * @param context the context created through xrmCreateContext().
+ * @param cuBatchRes the cu batch resource.
+ *             cuResources: cu resource list to be released, starting from cuResources[0], no hole.
+ *             cuResults: the cu with non-zero result is skipped, so the batch partly allocated by
+ *                        xrmCuBatchAllocV2() can be released directly. Result of each cu release
+ *                        is put back, 0 on success or appropriate error number.
+ *             cuNum: number of cu in this batch.
+ * @return bool, true if all cu are released or false on any fail.
+ */
+bool xrmCuBatchReleaseV2(xrmContext context, xrmCuBatchResourceV2* cuBatchRes);
+
 /**
  * \brief Declares user defined cu group type given the specified
  * kernels's property with cu name (kernelName:instanceName) and request load.
@@ -1321,6 +1495,148 @@ int32_t xrmReservationQueryV2(xrmContext context,
                               xrmReservationQueryInfoV2* reserveQueryInfo,
                               xrmCuPoolResourceV2* cuPoolRes);
 
+/**
+ * \brief Asynchronous requests.
+ *
+ * The asynchronous calls submit the request and return at once, the request is run in
+ * the background by one worker thread of the context, in submission order. Completion
+ * is delivered in one of two ways:
+ *   1) callback is not NULL: the callback is called from the worker thread with the
+ *      request id, the result and the user data. It should not block and must not
+ *      destroy the context.
+ *   2) callback is NULL: the completion is queued on the context and the event fd of
+ *      the context (see xrmAsyncGetEventFd()) becomes readable, the completions are
+ *      taken with xrmAsyncPoll().
+ * The result is the return value of the synchronous call, for the release calls it's
+ * 0 on success or XRM_ERROR on fail. The property is copied at submission, the resource
+ * (and the output of the request) must be kept valid until the request is completed.
+ * All submitted requests are completed before xrmDestroyContext() returns.
+ */
+
+/**
+ * \brief Gets the event fd of the context for asynchronous requests submitted without
+ * callback. The fd is readable while there are completions to be taken by xrmAsyncPoll(),
+ * so it can be added into the epoll or poll loop of the application. The fd is owned by
+ * the context and closed by xrmDestroyContext().
+ *
+ * @param context the context created through xrmCreateContext()
+ * @return int32_t, the event fd (>= 0) or appropriate error number
+ */
+int32_t xrmAsyncGetEventFd(xrmContext context);
+
+/**
+ * \brief Takes the queued completions of asynchronous requests submitted without callback,
+ * never blocks.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param completions the array to fill the completions, in completion order
+ * @param maxNum the size of completions array
+ * @return int32_t, number of completions taken (>= 0) or appropriate error number
+ */
+int32_t xrmAsyncPoll(xrmContext context, xrmAsyncCompletion* completions, int32_t maxNum);
+
+/**
+ * \brief Submits xrmCuAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu, as xrmCuAllocV2()
+ * @param cuRes the cu resource filled on completion, as xrmCuAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuAllocV2(xrmContext context,
+                           xrmCuPropertyV2* cuProp,
+                           xrmCuResourceV2* cuRes,
+                           xrmAsyncCallback callback,
+                           void* userData);
+
+/**
+ * \brief Submits xrmCuReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuRes the cu resource to be released, as xrmCuReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuReleaseV2(xrmContext context, xrmCuResourceV2* cuRes, xrmAsyncCallback callback, void* userData);
+
+/**
+ * \brief Submits xrmCuListAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListProp the property of cu list, as xrmCuListAllocV2()
+ * @param cuListRes the cu list resource filled on completion, as xrmCuListAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuListAllocV2(xrmContext context,
+                               xrmCuListPropertyV2* cuListProp,
+                               xrmCuListResourceV2* cuListRes,
+                               xrmAsyncCallback callback,
+                               void* userData);
+
+/**
+ * \brief Submits xrmCuListReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuListRes the cu list resource to be released, as xrmCuListReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuListReleaseV2(xrmContext context,
+                                 xrmCuListResourceV2* cuListRes,
+                                 xrmAsyncCallback callback,
+                                 void* userData);
+
+/**
+ * \brief Submits xrmCuGroupAllocV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupProp the property of cu group, as xrmCuGroupAllocV2()
+ * @param cuGroupRes the cu group resource filled on completion, as xrmCuGroupAllocV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuGroupAllocV2(xrmContext context,
+                                xrmCuGroupPropertyV2* cuGroupProp,
+                                xrmCuGroupResourceV2* cuGroupRes,
+                                xrmAsyncCallback callback,
+                                void* userData);
+
+/**
+ * \brief Submits xrmCuGroupReleaseV2() asynchronously.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuGroupRes the cu group resource to be released, as xrmCuGroupReleaseV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCuGroupReleaseV2(xrmContext context,
+                                  xrmCuGroupResourceV2* cuGroupRes,
+                                  xrmAsyncCallback callback,
+                                  void* userData);
+
+/**
+ * \brief Submits xrmCheckCuAvailableNumV2() asynchronously, the result is the available
+ * cu number or appropriate error number.
+ *
+ * @param context the context created through xrmCreateContext()
+ * @param cuProp the property of cu, as xrmCheckCuAvailableNumV2()
+ * @param callback the completion callback, NULL to deliver the completion through the event fd
+ * @param userData user data handed back on completion
+ * @return uint64_t, request id (> 0) or 0 on fail
+ */
+uint64_t xrmAsyncCheckCuAvailableNumV2(xrmContext context,
+                                       xrmCuPropertyV2* cuProp,
+                                       xrmAsyncCallback callback,
+                                       void* userData);
+
 #ifdef __cplusplus
 }
 #endif
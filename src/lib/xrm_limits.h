@@ -44,6 +44,7 @@
 #define XRM_MAX_GROUP_CU_NUM_V2 64
 #define XRM_MAX_POOL_CU_NUM_V2 128
 #define XRM_MAX_POOL_CU_LIST_NUM_V2 8
+#define XRM_MAX_BATCH_CU_NUM_V2 64
 #define XRM_MAX_DEV_CLIENTS (XRM_MAX_XILINX_KERNELS * 8)
 #define XRM_MAX_REGS_PER_IP 1
 #define XRM_MAX_CONNECTION_ENTRIES (XRM_MAX_DDR_MAP * XRM_MAX_XILINX_KERNELS * XRM_MAX_REGS_PER_IP)
@@ -53,6 +54,11 @@
 
 #define XRM_DEFAULT_INTERVAL_US 100000 // default interval (useconds), 100 ms
 
+#define XRM_DEFAULT_TCP_PORT 9763                         // default tcp port of xrm daemon
+#define XRM_DEFAULT_UNIX_SOCKET_PATH "/var/run/xrmd.sock" // default unix domain socket path of xrm daemon
+#define XRM_RECONNECT_TIMEOUT_MS 5000                     // time (ms) to wait for the restarted daemon
+#define XRM_RECONNECT_INTERVAL_MS 100                     // interval (ms) between reconnect tries
+
 #define XRM_MIN_LOG_LEVEL XRM_LOG_EMERGENCY // min log level
 #define XRM_MAX_LOG_LEVEL XRM_LOG_DEBUG     // max log level
 #define XRM_DEFAULT_LOG_LEVEL XRM_LOG_ERROR // default log level
@@ -60,4 +66,7 @@
 #define XRM_MAX_LIMIT_CONCURRENT_CLIENT 1000000   // max limit concurrent client
 #define XRM_DEFAULT_LIMIT_CONCURRENT_CLIENT 40000 // default limit concurrent client
 
+#define XRM_MAX_IO_THREAD_NUMBER 64    // max number of io threads in xrm daemon
+#define XRM_DEFAULT_IO_THREAD_NUMBER 4 // default number of io threads in xrm daemon
+
 #endif // _XRM_LIMITS_H_
@@ -4136,6 +4136,130 @@ void xrmCuAllocFromDevReleaseGranularity1000000Test(xrmContext* ctx) {
     printf("<<<<<<<==  end the xrm allocation from specified device test ===>>>>>>>>\n");
 }
 
+/*
+ * Compares the available number reported by the check function with the number of
+ * allocations which really succeed, the allocations go on one beyond the reported number.
+ */
+static void xrmCheckAvailableNumReport(const char* name, int32_t availableNum, int32_t allocatedNum) {
+    if (availableNum < 0)
+        printf("fail to check %s available number, ret = %d\n", name, availableNum);
+    else if (availableNum == allocatedNum)
+        printf("success, %s available number %d is allocated\n", name, availableNum);
+    else
+        printf("fail, %s available number is %d, %d are allocated\n", name, availableNum, allocatedNum);
+}
+
+void xrmCheckAvailableNumMatchAllocTest(xrmContext* ctx) {
+    int32_t i, availableNum, allocatedNum;
+    printf("<<<<<<<==  start the xrm check available number test ===>>>>>>>>\n");
+    if (ctx == NULL) {
+        printf("ctx is null, fail to do check available number test\n");
+        return;
+    }
+
+    printf("Test 35-1: check scaler cu available number, then alloc scaler cu until it fails\n");
+    xrmCuProperty scalerCuProp;
+    xrmCuResource* scalerCuRes = (xrmCuResource*)malloc(sizeof(xrmCuResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+    memset(&scalerCuProp, 0, sizeof(xrmCuProperty));
+    memset(scalerCuRes, 0, sizeof(xrmCuResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+    strcpy(scalerCuProp.kernelName, "scaler");
+    strcpy(scalerCuProp.kernelAlias, "");
+    scalerCuProp.devExcl = false;
+    scalerCuProp.requestLoad = 30;
+    scalerCuProp.poolId = 0;
+    availableNum = xrmCheckCuAvailableNum(ctx, &scalerCuProp);
+    for (allocatedNum = 0; allocatedNum < XRM_CHECK_NUM_TEST_MAX_ALLOC; allocatedNum++)
+        if (xrmCuAlloc(ctx, &scalerCuProp, &scalerCuRes[allocatedNum]) != XRM_SUCCESS) break;
+    xrmCheckAvailableNumReport("scaler cu", availableNum, allocatedNum);
+    for (i = 0; i < allocatedNum; i++) xrmCuRelease(ctx, &scalerCuRes[i]);
+    free(scalerCuRes);
+
+    printf("Test 35-2: check encoder cu list (same device) available number, then alloc the list until it fails\n");
+    xrmCuListProperty encCuListProp;
+    xrmCuListResource* encCuListRes =
+        (xrmCuListResource*)malloc(sizeof(xrmCuListResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+    memset(&encCuListProp, 0, sizeof(xrmCuListProperty));
+    memset(encCuListRes, 0, sizeof(xrmCuListResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+    encCuListProp.cuNum = 3;
+    encCuListProp.sameDevice = true;
+    for (i = 0; i < encCuListProp.cuNum; i++) {
+        strcpy(encCuListProp.cuProps[i].kernelName, "encoder");
+        strcpy(encCuListProp.cuProps[i].kernelAlias, "");
+        encCuListProp.cuProps[i].devExcl = false;
+        encCuListProp.cuProps[i].requestLoad = 40;
+        encCuListProp.cuProps[i].poolId = 0;
+    }
+    availableNum = xrmCheckCuListAvailableNum(ctx, &encCuListProp);
+    for (allocatedNum = 0; allocatedNum < XRM_CHECK_NUM_TEST_MAX_ALLOC; allocatedNum++)
+        if (xrmCuListAlloc(ctx, &encCuListProp, &encCuListRes[allocatedNum]) != XRM_SUCCESS) break;
+    xrmCheckAvailableNumReport("encoder cu list (same device)", availableNum, allocatedNum);
+    for (i = 0; i < allocatedNum; i++) xrmCuListRelease(ctx, &encCuListRes[i]);
+    free(encCuListRes);
+
+    printf("Test 35-3: check user defined cu group available number, then alloc the group until it fails\n");
+    char udfCuGroupName[XRM_MAX_NAME_LEN];
+    xrmUdfCuGroupProperty* udfCuGroupProp = (xrmUdfCuGroupProperty*)malloc(sizeof(xrmUdfCuGroupProperty));
+    xrmUdfCuListProperty* udfCuListProp;
+    memset(udfCuGroupProp, 0, sizeof(xrmUdfCuGroupProperty));
+    strcpy(udfCuGroupName, "udfCuGroupCheckNum");
+    udfCuGroupProp->optionUdfCuListNum = 2;
+    /* the first option takes two cu on one device, the second one cu */
+    udfCuListProp = &udfCuGroupProp->optionUdfCuListProps[0];
+    udfCuListProp->cuNum = 2;
+    udfCuListProp->sameDevice = true;
+    strcpy(udfCuListProp->udfCuProps[0].cuName, "lookahead:lookahead_0");
+    udfCuListProp->udfCuProps[0].requestLoad = 60;
+    strcpy(udfCuListProp->udfCuProps[1].cuName, "krnl_vadd:krnl_vadd_1");
+    udfCuListProp->udfCuProps[1].requestLoad = 60;
+    udfCuListProp = &udfCuGroupProp->optionUdfCuListProps[1];
+    udfCuListProp->cuNum = 1;
+    udfCuListProp->sameDevice = true;
+    strcpy(udfCuListProp->udfCuProps[0].cuName, "lookahead:lookahead_1");
+    udfCuListProp->udfCuProps[0].requestLoad = 60;
+    if (xrmUdfCuGroupDeclare(ctx, udfCuGroupProp, udfCuGroupName) != XRM_SUCCESS) {
+        printf("xrmUdfCuGroupDeclare(): fail to declare user defined cu group\n");
+    } else {
+        xrmCuGroupProperty cuGroupProp;
+        xrmCuGroupResource* cuGroupRes =
+            (xrmCuGroupResource*)malloc(sizeof(xrmCuGroupResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+        memset(&cuGroupProp, 0, sizeof(xrmCuGroupProperty));
+        memset(cuGroupRes, 0, sizeof(xrmCuGroupResource) * XRM_CHECK_NUM_TEST_MAX_ALLOC);
+        strcpy(cuGroupProp.udfCuGroupName, udfCuGroupName);
+        cuGroupProp.poolId = 0;
+        availableNum = xrmCheckCuGroupAvailableNum(ctx, &cuGroupProp);
+        for (allocatedNum = 0; allocatedNum < XRM_CHECK_NUM_TEST_MAX_ALLOC; allocatedNum++)
+            if (xrmCuGroupAlloc(ctx, &cuGroupProp, &cuGroupRes[allocatedNum]) != XRM_SUCCESS) break;
+        xrmCheckAvailableNumReport("user defined cu group", availableNum, allocatedNum);
+        for (i = 0; i < allocatedNum; i++) xrmCuGroupRelease(ctx, &cuGroupRes[i]);
+        free(cuGroupRes);
+        if (xrmUdfCuGroupUndeclare(ctx, udfCuGroupName) != XRM_SUCCESS)
+            printf("xrmUdfCuGroupUndeclare(): fail to undeclare user defined cu group\n");
+    }
+    free(udfCuGroupProp);
+
+    printf("Test 35-4: check krnl_vadd cu pool available number, then reserve the pool until it fails\n");
+    xrmCuPoolProperty vaddCuPoolProp;
+    uint64_t reservePoolIds[XRM_CHECK_NUM_TEST_MAX_ALLOC];
+    memset(&vaddCuPoolProp, 0, sizeof(xrmCuPoolProperty));
+    vaddCuPoolProp.cuListProp.cuNum = 2;
+    for (i = 0; i < vaddCuPoolProp.cuListProp.cuNum; i++) {
+        strcpy(vaddCuPoolProp.cuListProp.cuProps[i].kernelName, "krnl_vadd");
+        strcpy(vaddCuPoolProp.cuListProp.cuProps[i].kernelAlias, "");
+        vaddCuPoolProp.cuListProp.cuProps[i].devExcl = false;
+        vaddCuPoolProp.cuListProp.cuProps[i].requestLoad = 50;
+    }
+    vaddCuPoolProp.cuListNum = 1;
+    availableNum = xrmCheckCuPoolAvailableNum(ctx, &vaddCuPoolProp);
+    for (allocatedNum = 0; allocatedNum < XRM_CHECK_NUM_TEST_MAX_ALLOC; allocatedNum++) {
+        reservePoolIds[allocatedNum] = xrmCuPoolReserve(ctx, &vaddCuPoolProp);
+        if (reservePoolIds[allocatedNum] == 0) break;
+    }
+    xrmCheckAvailableNumReport("krnl_vadd cu pool", availableNum, allocatedNum);
+    for (i = 0; i < allocatedNum; i++) xrmCuPoolRelinquish(ctx, reservePoolIds[i]);
+
+    printf("<<<<<<<==  end the xrm check available number test ===>>>>>>>>\n");
+}
+
 void xrmConcurrentContextTest(int32_t numContext) {
     printf("<<<<<<<==  Start the xrm context test ===>>>>>>>>\n\n");
     xrmContext* ctx;
@@ -4168,6 +4292,324 @@ void xrmConcurrentContextTest(int32_t numContext) {
     printf("<<<<<<<==  End the xrm context test ===>>>>>>>>\n\n");
 }
 
+/*
+ * The second cu of the batch can't be allocated, the batch is allocated with and
+ * without allOrNothing.
+ */
+void xrmCuBatchAllocReleaseV2Test(xrmContext* ctx) {
+    int i;
+    int32_t ret, availableNumBefore, availableNumAfter;
+    printf("<<<<<<<==  start the xrm batch allocation V2 test ===>>>>>>>>\n");
+    if (ctx == NULL) {
+        printf("ctx is null, fail to do cu batch alloc test\n");
+        return;
+    }
+
+    xrmCuBatchPropertyV2* cuBatchProp = (xrmCuBatchPropertyV2*)malloc(sizeof(xrmCuBatchPropertyV2));
+    xrmCuBatchResourceV2* cuBatchRes = (xrmCuBatchResourceV2*)malloc(sizeof(xrmCuBatchResourceV2));
+    memset(cuBatchProp, 0, sizeof(xrmCuBatchPropertyV2));
+    memset(cuBatchRes, 0, sizeof(xrmCuBatchResourceV2));
+
+    cuBatchProp->cuNum = 3;
+    strcpy(cuBatchProp->cuProps[0].kernelName, "scaler");
+    strcpy(cuBatchProp->cuProps[1].kernelName, "no_such_kernel");
+    strcpy(cuBatchProp->cuProps[2].kernelName, "encoder");
+    for (i = 0; i < cuBatchProp->cuNum; i++) {
+        strcpy(cuBatchProp->cuProps[i].kernelAlias, "");
+        cuBatchProp->cuProps[i].devExcl = false;
+        cuBatchProp->cuProps[i].requestLoad = 30;
+        cuBatchProp->cuProps[i].poolId = 0;
+    }
+    cuBatchProp->allOrNothing = false;
+
+    printf("Test V2-3-1: Alloc cu batch with one cu not available\n");
+    ret = xrmCuBatchAllocV2(ctx, cuBatchProp, cuBatchRes);
+    if (ret == XRM_SUCCESS) {
+        printf("xrmCuBatchAllocV2: fail, the batch with a not existing kernel is allocated\n");
+    } else if (cuBatchRes->cuResults[0] != XRM_SUCCESS || cuBatchRes->cuResults[1] == XRM_SUCCESS ||
+               cuBatchRes->cuResults[2] != XRM_SUCCESS) {
+        printf("xrmCuBatchAllocV2: fail, wrong results %d %d %d\n", cuBatchRes->cuResults[0],
+               cuBatchRes->cuResults[1], cuBatchRes->cuResults[2]);
+    } else {
+        printf("xrmCuBatchAllocV2: success, ret = %d, cu 1 result = %d\n", ret, cuBatchRes->cuResults[1]);
+        for (i = 0; i < cuBatchRes->cuNum; i++) {
+            if (cuBatchRes->cuResults[i] != XRM_SUCCESS) continue;
+            printf("Allocated cu %d: \n", i);
+            printf("   kernelName is:  %s\n", cuBatchRes->cuResources[i].kernelName);
+            printf("   cuName is:  %s\n", cuBatchRes->cuResources[i].cuName);
+            printf("   deviceId is:  %d\n", cuBatchRes->cuResources[i].deviceId);
+            printf("   cuId is:  %d\n", cuBatchRes->cuResources[i].cuId);
+            printf("   channelId is:  %d\n", cuBatchRes->cuResources[i].channelId);
+            printf("   allocServiceId is:  %lu\n", cuBatchRes->cuResources[i].allocServiceId);
+            printf("   channelLoad is:  %d\n", cuBatchRes->cuResources[i].channelLoad);
+        }
+    }
+
+    printf("Test V2-3-2: release cu batch, the failed cu is skipped\n");
+    if (xrmCuBatchReleaseV2(ctx, cuBatchRes) && cuBatchRes->cuResults[0] == XRM_SUCCESS &&
+        cuBatchRes->cuResults[2] == XRM_SUCCESS)
+        printf("success to release cu batch\n");
+    else
+        printf("fail to release cu batch\n");
+
+    printf("Test V2-3-3: Alloc cu batch with all or nothing, the allocated cu are rolled back\n");
+    availableNumBefore = xrmCheckCuAvailableNumV2(ctx, &cuBatchProp->cuProps[0]);
+    cuBatchProp->allOrNothing = true;
+    memset(cuBatchRes, 0, sizeof(xrmCuBatchResourceV2));
+    ret = xrmCuBatchAllocV2(ctx, cuBatchProp, cuBatchRes);
+    availableNumAfter = xrmCheckCuAvailableNumV2(ctx, &cuBatchProp->cuProps[0]);
+    if (ret == XRM_SUCCESS) {
+        printf("xrmCuBatchAllocV2: fail, the batch with a not existing kernel is allocated\n");
+        xrmCuBatchReleaseV2(ctx, cuBatchRes);
+    } else if (cuBatchRes->cuResults[0] == XRM_SUCCESS || cuBatchRes->cuResults[1] == XRM_SUCCESS ||
+               cuBatchRes->cuResults[2] == XRM_SUCCESS) {
+        printf("xrmCuBatchAllocV2: fail, wrong results %d %d %d\n", cuBatchRes->cuResults[0],
+               cuBatchRes->cuResults[1], cuBatchRes->cuResults[2]);
+        xrmCuBatchReleaseV2(ctx, cuBatchRes);
+    } else if (availableNumBefore != availableNumAfter) {
+        printf("xrmCuBatchAllocV2: fail, scaler cu available number %d is %d after roll back\n",
+               availableNumBefore, availableNumAfter);
+    } else {
+        printf("xrmCuBatchAllocV2: success, ret = %d, nothing is allocated\n", ret);
+    }
+
+    printf("Test V2-3-4: release cu batch with nothing allocated\n");
+    if (xrmCuBatchReleaseV2(ctx, cuBatchRes))
+        printf("success to release cu batch\n");
+    else
+        printf("fail to release cu batch\n");
+
+    free(cuBatchProp);
+    free(cuBatchRes);
+    printf("<<<<<<<==  end the xrm batch allocation V2 test ===>>>>>>>>\n");
+}
+
+/* result of one asynchronous request completed by callback */
+typedef struct xrmAsyncTestRecord {
+    uint64_t requestId;
+    int32_t result;
+    int32_t calledNum;
+} xrmAsyncTestRecord;
+
+static void xrmAsyncTestCallback(uint64_t requestId, int32_t result, void* userData) {
+    xrmAsyncTestRecord* record = (xrmAsyncTestRecord*)userData;
+    record->requestId = requestId;
+    record->result = result;
+    record->calledNum++;
+}
+
+/*
+ * Waits on the event fd in poll() until the completions of all the requests are taken,
+ * then checks the result and the user data of each one.
+ */
+static int32_t xrmAsyncTestWaitCompletions(xrmContext* ctx, int32_t fd, uint64_t* requestIds, int32_t* userTags,
+                                           int32_t requestNum) {
+    xrmAsyncCompletion completions[XRM_ASYNC_TEST_REQUEST_NUM];
+    struct pollfd pfd;
+    int32_t i, num, doneNum = 0, failNum = 0;
+
+    while (doneNum < requestNum) {
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, XRM_ASYNC_TEST_POLL_TIMEOUT_MS) <= 0) {
+            printf("no completion in %d ms, %d of %d completed\n", XRM_ASYNC_TEST_POLL_TIMEOUT_MS, doneNum,
+                   requestNum);
+            return (-1);
+        }
+        num = xrmAsyncPoll(ctx, completions, XRM_ASYNC_TEST_REQUEST_NUM);
+        for (i = 0; i < num; i++) {
+            /* completed in submission order */
+            if (completions[i].requestId != requestIds[doneNum] || completions[i].userData != &userTags[doneNum] ||
+                completions[i].result != XRM_SUCCESS) {
+                printf("wrong completion %d: requestId %lu, result %d\n", doneNum, completions[i].requestId,
+                       completions[i].result);
+                failNum++;
+            }
+            doneNum++;
+        }
+    }
+    return (failNum ? -1 : 0);
+}
+
+void xrmAsyncAllocReleaseV2Test(xrmContext* ctx) {
+    int32_t i, fd;
+    uint64_t requestIds[XRM_ASYNC_TEST_REQUEST_NUM];
+    int32_t userTags[XRM_ASYNC_TEST_REQUEST_NUM];
+    xrmAsyncTestRecord records[XRM_ASYNC_TEST_REQUEST_NUM * 2];
+    printf("<<<<<<<==  start the xrm asynchronous request V2 test ===>>>>>>>>\n");
+    if (ctx == NULL) {
+        printf("ctx is null, fail to do asynchronous request test\n");
+        return;
+    }
+
+    xrmCuPropertyV2 scalerCuProp;
+    xrmCuResourceV2* scalerCuRes = (xrmCuResourceV2*)malloc(sizeof(xrmCuResourceV2) * XRM_ASYNC_TEST_REQUEST_NUM);
+    memset(&scalerCuProp, 0, sizeof(xrmCuPropertyV2));
+    memset(scalerCuRes, 0, sizeof(xrmCuResourceV2) * XRM_ASYNC_TEST_REQUEST_NUM);
+    strcpy(scalerCuProp.kernelName, "scaler");
+    strcpy(scalerCuProp.kernelAlias, "");
+    scalerCuProp.devExcl = false;
+    scalerCuProp.requestLoad = 20;
+    scalerCuProp.poolId = 0;
+
+    printf("Test V2-4-1: get event fd of context\n");
+    fd = xrmAsyncGetEventFd(ctx);
+    if (fd < 0) {
+        printf("xrmAsyncGetEventFd: fail to get event fd, ret = %d\n", fd);
+        free(scalerCuRes);
+        return;
+    }
+
+    printf("Test V2-4-2: submit %d scaler cu alloc without callback, wait on event fd\n", XRM_ASYNC_TEST_REQUEST_NUM);
+    for (i = 0; i < XRM_ASYNC_TEST_REQUEST_NUM; i++) {
+        userTags[i] = i;
+        requestIds[i] = xrmAsyncCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[i], NULL, &userTags[i]);
+        if (requestIds[i] == 0) printf("xrmAsyncCuAllocV2: fail to submit request %d\n", i);
+    }
+    if (xrmAsyncTestWaitCompletions(ctx, fd, requestIds, userTags, XRM_ASYNC_TEST_REQUEST_NUM) == 0)
+        printf("success to alloc scaler cu asynchronously\n");
+    else
+        printf("fail to alloc scaler cu asynchronously\n");
+
+    printf("Test V2-4-3: submit %d scaler cu release without callback, wait on event fd\n",
+           XRM_ASYNC_TEST_REQUEST_NUM);
+    for (i = 0; i < XRM_ASYNC_TEST_REQUEST_NUM; i++)
+        requestIds[i] = xrmAsyncCuReleaseV2(ctx, &scalerCuRes[i], NULL, &userTags[i]);
+    if (xrmAsyncTestWaitCompletions(ctx, fd, requestIds, userTags, XRM_ASYNC_TEST_REQUEST_NUM) == 0)
+        printf("success to release scaler cu asynchronously\n");
+    else
+        printf("fail to release scaler cu asynchronously\n");
+
+    printf("Test V2-4-4: submit scaler cu alloc and release with callback, then destroy the context\n");
+    xrmContext* asyncCtx = (xrmContext*)xrmCreateContext(XRM_API_VERSION_1);
+    if (asyncCtx == NULL) {
+        printf("fail to create context\n");
+        free(scalerCuRes);
+        return;
+    }
+    memset(records, 0, sizeof(records));
+    memset(scalerCuRes, 0, sizeof(xrmCuResourceV2) * XRM_ASYNC_TEST_REQUEST_NUM);
+    for (i = 0; i < XRM_ASYNC_TEST_REQUEST_NUM; i++) {
+        /* the requests run in submission order, so the release sees the allocated resource */
+        requestIds[i] =
+            xrmAsyncCuAllocV2(asyncCtx, &scalerCuProp, &scalerCuRes[i], xrmAsyncTestCallback, &records[i * 2]);
+        xrmAsyncCuReleaseV2(asyncCtx, &scalerCuRes[i], xrmAsyncTestCallback, &records[i * 2 + 1]);
+    }
+    /* all the submitted requests are completed before it returns */
+    if (xrmDestroyContext(asyncCtx) != XRM_SUCCESS) printf("fail to destroy context\n");
+    int32_t failNum = 0;
+    for (i = 0; i < XRM_ASYNC_TEST_REQUEST_NUM * 2; i++) {
+        if (records[i].calledNum != 1 || records[i].result != XRM_SUCCESS ||
+            (i % 2 == 0 && records[i].requestId != requestIds[i / 2])) {
+            printf("wrong completion %d: called %d times, requestId %lu, result %d\n", i, records[i].calledNum,
+                   records[i].requestId, records[i].result);
+            failNum++;
+        }
+    }
+    if (failNum == 0)
+        printf("success, all the requests are completed by callback before the context is destroyed\n");
+    else
+        printf("fail, %d requests are not completed as expected\n", failNum);
+
+    free(scalerCuRes);
+    printf("<<<<<<<==  end the xrm asynchronous request V2 test ===>>>>>>>>\n");
+}
+
+static void xrmDevLoadTestSetDevice(xrmCuPropertyV2* cuProp, uint64_t deviceIndex, uint64_t constraintType) {
+    cuProp->deviceInfo = (deviceIndex << XRM_DEVICE_INFO_DEVICE_INDEX_SHIFT) |
+                         (constraintType << XRM_DEVICE_INFO_CONSTRAINT_TYPE_SHIFT);
+}
+
+/*
+ * The device load counts the load of every channel on the device, including the
+ * channels sharing a cu, so the device load policy must see it after sharing.
+ */
+void xrmDevLoadAfterCuShareV2Test(xrmContext* ctx) {
+    int32_t i;
+    printf("<<<<<<<==  start the xrm device load after cu share V2 test ===>>>>>>>>\n");
+    if (ctx == NULL) {
+        printf("ctx is null, fail to do device load test\n");
+        return;
+    }
+
+    xrmCuPropertyV2 scalerCuProp;
+    xrmCuResourceV2 scalerCuRes[4];
+    memset(&scalerCuProp, 0, sizeof(xrmCuPropertyV2));
+    memset(scalerCuRes, 0, sizeof(scalerCuRes));
+    strcpy(scalerCuProp.kernelName, "scaler");
+    strcpy(scalerCuProp.kernelAlias, "");
+    scalerCuProp.devExcl = false;
+    scalerCuProp.poolId = 0;
+    scalerCuProp.policyInfo = XRM_POLICY_INFO_CONSTRAINT_TYPE_NULL;
+
+    printf("Test V2-5-1: alloc two scaler cu sharing one cu on device 0, one scaler cu on device 1\n");
+    xrmDevLoadTestSetDevice(&scalerCuProp, 0, XRM_DEVICE_INFO_CONSTRAINT_TYPE_HARDWARE_DEVICE_INDEX);
+    scalerCuProp.requestLoad = 50;
+    if (xrmCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[0]) != XRM_SUCCESS) {
+        printf("xrmCuAllocV2: fail to alloc scaler cu on device 0\n");
+        return;
+    }
+    scalerCuProp.requestLoad = 40;
+    if (xrmCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[1]) != XRM_SUCCESS) {
+        printf("xrmCuAllocV2: fail to alloc scaler cu on device 0\n");
+        xrmCuReleaseV2(ctx, &scalerCuRes[0]);
+        return;
+    }
+    xrmDevLoadTestSetDevice(&scalerCuProp, 1, XRM_DEVICE_INFO_CONSTRAINT_TYPE_HARDWARE_DEVICE_INDEX);
+    scalerCuProp.requestLoad = 60;
+    if (xrmCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[2]) != XRM_SUCCESS) {
+        printf("xrmCuAllocV2: fail to alloc scaler cu on device 1\n");
+        xrmCuReleaseV2(ctx, &scalerCuRes[1]);
+        xrmCuReleaseV2(ctx, &scalerCuRes[0]);
+        return;
+    }
+    if (scalerCuRes[0].cuId == scalerCuRes[1].cuId)
+        printf("success, scaler cu %d on device 0 is shared\n", scalerCuRes[0].cuId);
+    else
+        printf("fail, scaler cu on device 0 is not shared: cu %d and cu %d\n", scalerCuRes[0].cuId,
+               scalerCuRes[1].cuId);
+
+    /* device 0 is loaded with 90, device 1 with 60 */
+    printf("Test V2-5-2: alloc scaler cu by policy --- device most used first, expect device 0\n");
+    xrmDevLoadTestSetDevice(&scalerCuProp, 0, XRM_DEVICE_INFO_CONSTRAINT_TYPE_NULL);
+    scalerCuProp.policyInfo = XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_MOST_USED_FIRST;
+    scalerCuProp.requestLoad = 5;
+    if (xrmCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[3]) != XRM_SUCCESS) {
+        printf("xrmCuAllocV2: fail to alloc scaler cu by policy\n");
+    } else {
+        if (scalerCuRes[3].deviceId == 0)
+            printf("success, device load counts the shared cu\n");
+        else
+            printf("fail, allocated on device %d, device load misses the shared cu\n", scalerCuRes[3].deviceId);
+        xrmCuReleaseV2(ctx, &scalerCuRes[3]);
+    }
+
+    /* device 0 is loaded with 50, device 1 with 60 */
+    printf("Test V2-5-3: release the shared scaler cu, alloc by policy again, expect device 1\n");
+    xrmCuReleaseV2(ctx, &scalerCuRes[1]);
+    memset(&scalerCuRes[3], 0, sizeof(xrmCuResourceV2));
+    if (xrmCuAllocV2(ctx, &scalerCuProp, &scalerCuRes[3]) != XRM_SUCCESS) {
+        printf("xrmCuAllocV2: fail to alloc scaler cu by policy\n");
+    } else {
+        if (scalerCuRes[3].deviceId == 1)
+            printf("success, device load drops with the shared cu release\n");
+        else
+            printf("fail, allocated on device %d, device load keeps the released cu\n", scalerCuRes[3].deviceId);
+        xrmCuReleaseV2(ctx, &scalerCuRes[3]);
+    }
+
+    printf("Test V2-5-4: release scaler cu\n");
+    for (i = 0; i < 3; i++) {
+        if (i == 1) continue;
+        if (xrmCuReleaseV2(ctx, &scalerCuRes[i]))
+            printf("success to release scaler cu\n");
+        else
+            printf("fail to release scaler cu\n");
+    }
+    printf("<<<<<<<==  end the xrm device load after cu share V2 test ===>>>>>>>>\n");
+}
+
 void xrmCuAllocReleaseV2ByPolicyMostUsedFirstTest(xrmContext* ctx, int policyId) {
     int32_t ret;
     printf("<<<<<<<==  start the xrm allocation V2 by policy :%d --- most used first test: %s ===>>>>>>>>\n", policyId,
@@ -4340,6 +4782,8 @@ void testXrmFunctions(void) {
     xrmCuAllocQueryReleaseUsingAliasTest(ctx);
     xrmCheckCuListAvailableNumUsingAliasTest(ctx);
     xrmCuPoolReserveAllocReleaseRelinquishTest(ctx);
+    xrmCheckAvailableNumMatchAllocTest(ctx);
+    xrmDevLoadAfterCuShareV2Test(ctx);
 
     xrmCuAllocReleaseV2ByPolicyLeastUsedFirstTest(ctx, 2); // least used by cu load
     // printf("press any char to continue\n");
@@ -4383,6 +4827,8 @@ void testXrmFunctions(void) {
 
     xrmCuAllocReleaseV2Test(ctx);
     xrmCuListAllocReleaseV2Test(ctx);
+    xrmCuBatchAllocReleaseV2Test(ctx);
+    xrmAsyncAllocReleaseV2Test(ctx);
 
     xrmCuPoolReserveAllocReleaseRelinquishV2Test(ctx);
 
@@ -26,6 +26,7 @@
 #include <time.h>
 #include <libgen.h>
 #include <stdint.h>
+#include <poll.h>
 #include <uuid/uuid.h>
 #include <xrm.h>
 
@@ -33,6 +34,13 @@
 extern "C" {
 #endif
 
+/* number of requests submitted at once in the asynchronous request test */
+#define XRM_ASYNC_TEST_REQUEST_NUM 4
+/* wait time (milliseconds) of the event fd in the asynchronous request test */
+#define XRM_ASYNC_TEST_POLL_TIMEOUT_MS 5000
+/* allocations tried at most in the check available number test */
+#define XRM_CHECK_NUM_TEST_MAX_ALLOC 256
+
 void xrmConcurrentContextTest(int32_t numContext);
 void xrmCuAllocReleaseTest(xrmContext* ctx);
 void xrmCuListAllocReleaseTest(xrmContext* ctx);
@@ -70,8 +78,12 @@ void xrmCuBlockingAllocReleaseGranularity1000000Test(xrmContext* ctx);
 void xrmCuListBlockingAllocReleaseGranularity1000000Test(xrmContext* ctx);
 void xrmCuGroupBlockingAllocReleaseGranularity1000000Test(xrmContext* ctx);
 void xrmCuAllocFromDevReleaseGranularity1000000Test(xrmContext* ctx);
+void xrmCheckAvailableNumMatchAllocTest(xrmContext* ctx);
 void xrmCuAllocReleaseV2Test(xrmContext* ctx);
 void xrmCuListAllocReleaseV2Test(xrmContext* ctx);
+void xrmCuBatchAllocReleaseV2Test(xrmContext* ctx);
+void xrmAsyncAllocReleaseV2Test(xrmContext* ctx);
+void xrmDevLoadAfterCuShareV2Test(xrmContext* ctx);
 void xrmCuPoolReserveAllocReleaseRelinquishV2Test(xrmContext* ctx);
 
 #ifdef __cplusplus
@@ -0,0 +1,629 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "example_test_xrm_bench.hpp"
+
+/*
+ * This example is the throughput and latency benchmark of xrmd through libxrm.
+ *
+ * N processes x M threads x K contexts run a mix of cu alloc / release (V1 and V2),
+ * cu list alloc, cu group alloc, cu pool reserve, allocation query and available cu
+ * number check. All the threads start together after the contexts are created, each
+ * command is timed and the throughput and p50 / p99 / p999 latency of each command
+ * are reported, also written to json or csv file.
+ *
+ * The run is repeated for each combination of the process, thread and context numbers
+ * given, and optionally for each xclbin loaded to each number of devices given, so a
+ * scaling regression shows up as a change in one row. With the xrmd built with the
+ * simulated device backend, xrm_bench_sim_devices.json in this directory describes 16
+ * devices and xclbins with 8, 32 and 144 cu of kernel "bench":
+ *
+ *   env XRM_SIM_DEVICE_FILE=test/example_10/xrm_bench_sim_devices.json xrmd &
+ *   ./example_test_xrm_bench -k bench -P 1,4 -T 1,4,16 -D 1,4,16 \
+ *       -X /tmp/xrm_bench_8cu.xclbin,/tmp/xrm_bench_144cu.xclbin -o result.json
+ */
+
+using namespace std;
+
+static const char* benchCmdNames[BENCH_CMD_NUM] = {
+    "cuAlloc",          "allocationQuery",  "cuRelease",           "cuAllocV2",
+    "cuReleaseV2",      "cuListAlloc",      "cuListRelease",       "cuGroupAllocV2",
+    "cuGroupReleaseV2", "cuPoolReserveV2",  "cuPoolRelinquishV2",  "checkCuAvailableNum"};
+
+uint64_t getTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec);
+}
+
+static uint32_t* benchSamples(benchShared* shared, benchConfig& config, int32_t threadIdx, int32_t cmd) {
+    uint32_t* samples = (uint32_t*)(shared + 1);
+    return (&samples[((size_t)threadIdx * BENCH_CMD_NUM + cmd) * config.ops]);
+}
+
+/*
+ * Records the latency of the command, or counts the failure.
+ */
+static void benchRecord(
+    benchShared* shared, benchConfig& config, int32_t threadIdx, int32_t cmd, uint64_t startNs, bool ok) {
+    benchThreadResult* result = &shared->results[threadIdx];
+    if (!ok) {
+        result->failed[cmd]++;
+        return;
+    }
+    uint64_t ns = getTimeNs() - startNs;
+    benchSamples(shared, config, threadIdx, cmd)[result->count[cmd]++] = (ns > 0xFFFFFFFF) ? 0xFFFFFFFF : ns;
+}
+
+static void benchSetCuProp(benchConfig& config, xrmCuProperty* cuProp) {
+    memset(cuProp, 0, sizeof(xrmCuProperty));
+    strncpy(cuProp->kernelName, config.kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->requestLoad = config.requestLoad;
+    cuProp->poolId = 0;
+}
+
+static void benchSetCuPropV2(benchConfig& config, xrmCuPropertyV2* cuProp) {
+    memset(cuProp, 0, sizeof(xrmCuPropertyV2));
+    strncpy(cuProp->kernelName, config.kernelName.c_str(), XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->requestLoad = config.requestLoad;
+    cuProp->poolId = 0;
+}
+
+/*
+ * One thread of the benchmark, the operations in the mask are run in order in each loop
+ * with the contexts used in turn.
+ */
+static void benchThread(benchShared* shared, benchConfig config, int32_t threadIdx, string udfCuGroupName) {
+    vector<xrmContext> ctxs;
+    xrmCuProperty cuProp;
+    xrmCuResource cuRes;
+    xrmCuPropertyV2 cuPropV2;
+    xrmCuResourceV2 cuResV2;
+    xrmCuListProperty cuListProp;
+    xrmCuListResource cuListRes;
+    xrmCuGroupPropertyV2 cuGroupProp;
+    xrmCuGroupResourceV2 cuGroupRes;
+    xrmCuPoolPropertyV2 cuPoolProp;
+    xrmCuPoolResInforV2 cuPoolResInfor;
+    uint64_t startNs;
+    bool ok;
+
+    benchSetCuProp(config, &cuProp);
+    benchSetCuPropV2(config, &cuPropV2);
+    memset(&cuListProp, 0, sizeof(xrmCuListProperty));
+    cuListProp.cuNum = 2;
+    cuListProp.sameDevice = false;
+    benchSetCuProp(config, &cuListProp.cuProps[0]);
+    benchSetCuProp(config, &cuListProp.cuProps[1]);
+    memset(&cuGroupProp, 0, sizeof(xrmCuGroupPropertyV2));
+    strncpy(cuGroupProp.udfCuGroupName, udfCuGroupName.c_str(), XRM_MAX_NAME_LEN - 1);
+    cuGroupProp.poolId = 0;
+    memset(&cuPoolProp, 0, sizeof(xrmCuPoolPropertyV2));
+    cuPoolProp.cuListProp.cuNum = 1;
+    benchSetCuPropV2(config, &cuPoolProp.cuListProp.cuProps[0]);
+    cuPoolProp.cuListNum = 1;
+
+    for (int32_t i = 0; i < config.contexts; i++) {
+        xrmContext ctx = xrmCreateContext(XRM_API_VERSION_1);
+        if (ctx == NULL) {
+            printf("thread %d: create context failed\n", threadIdx);
+            break;
+        }
+        ctxs.push_back(ctx);
+    }
+
+    __sync_fetch_and_add(&shared->ready, 1);
+    while (!shared->start) usleep(100);
+
+    for (int32_t op = 0; op < config.ops && !ctxs.empty(); op++) {
+        xrmContext ctx = ctxs[op % ctxs.size()];
+        if (config.opMask & BENCH_OP_ALLOC) {
+            memset(&cuRes, 0, sizeof(xrmCuResource));
+            startNs = getTimeNs();
+            ok = (xrmCuAlloc(ctx, &cuProp, &cuRes) == XRM_SUCCESS);
+            benchRecord(shared, config, threadIdx, BENCH_CU_ALLOC, startNs, ok);
+            if (ok) {
+                xrmAllocationQueryInfo allocQuery;
+                memset(&allocQuery, 0, sizeof(xrmAllocationQueryInfo));
+                allocQuery.allocServiceId = cuRes.allocServiceId;
+                memset(&cuListRes, 0, sizeof(xrmCuListResource));
+                startNs = getTimeNs();
+                ok = (xrmAllocationQuery(ctx, &allocQuery, &cuListRes) == XRM_SUCCESS);
+                benchRecord(shared, config, threadIdx, BENCH_ALLOCATION_QUERY, startNs, ok);
+                startNs = getTimeNs();
+                ok = xrmCuRelease(ctx, &cuRes);
+                benchRecord(shared, config, threadIdx, BENCH_CU_RELEASE, startNs, ok);
+            }
+        }
+        if (config.opMask & BENCH_OP_ALLOC_V2) {
+            memset(&cuResV2, 0, sizeof(xrmCuResourceV2));
+            startNs = getTimeNs();
+            ok = (xrmCuAllocV2(ctx, &cuPropV2, &cuResV2) == XRM_SUCCESS);
+            benchRecord(shared, config, threadIdx, BENCH_CU_ALLOC_V2, startNs, ok);
+            if (ok) {
+                startNs = getTimeNs();
+                ok = xrmCuReleaseV2(ctx, &cuResV2);
+                benchRecord(shared, config, threadIdx, BENCH_CU_RELEASE_V2, startNs, ok);
+            }
+        }
+        if (config.opMask & BENCH_OP_LIST) {
+            memset(&cuListRes, 0, sizeof(xrmCuListResource));
+            startNs = getTimeNs();
+            ok = (xrmCuListAlloc(ctx, &cuListProp, &cuListRes) == XRM_SUCCESS);
+            benchRecord(shared, config, threadIdx, BENCH_CU_LIST_ALLOC, startNs, ok);
+            if (ok) {
+                startNs = getTimeNs();
+                ok = xrmCuListRelease(ctx, &cuListRes);
+                benchRecord(shared, config, threadIdx, BENCH_CU_LIST_RELEASE, startNs, ok);
+            }
+        }
+        if (config.opMask & BENCH_OP_GROUP) {
+            memset(&cuGroupRes, 0, sizeof(xrmCuGroupResourceV2));
+            startNs = getTimeNs();
+            ok = (xrmCuGroupAllocV2(ctx, &cuGroupProp, &cuGroupRes) == XRM_SUCCESS);
+            benchRecord(shared, config, threadIdx, BENCH_CU_GROUP_ALLOC, startNs, ok);
+            if (ok) {
+                startNs = getTimeNs();
+                ok = xrmCuGroupReleaseV2(ctx, &cuGroupRes);
+                benchRecord(shared, config, threadIdx, BENCH_CU_GROUP_RELEASE, startNs, ok);
+            }
+        }
+        if (config.opMask & BENCH_OP_POOL) {
+            memset(&cuPoolResInfor, 0, sizeof(xrmCuPoolResInforV2));
+            startNs = getTimeNs();
+            uint64_t poolId = xrmCuPoolReserveV2(ctx, &cuPoolProp, &cuPoolResInfor);
+            benchRecord(shared, config, threadIdx, BENCH_CU_POOL_RESERVE, startNs, (poolId != 0));
+            if (poolId != 0) {
+                startNs = getTimeNs();
+                ok = xrmCuPoolRelinquishV2(ctx, poolId);
+                benchRecord(shared, config, threadIdx, BENCH_CU_POOL_RELINQUISH, startNs, ok);
+            }
+        }
+        if (config.opMask & BENCH_OP_CHECK) {
+            startNs = getTimeNs();
+            ok = (xrmCheckCuAvailableNum(ctx, &cuProp) >= 0);
+            benchRecord(shared, config, threadIdx, BENCH_CHECK_CU_AVAILABLE_NUM, startNs, ok);
+        }
+    }
+    shared->results[threadIdx].endNs = getTimeNs();
+
+    for (size_t i = 0; i < ctxs.size(); i++) xrmDestroyContext(ctxs[i]);
+}
+
+/*
+ * One process of the benchmark, the user defined cu group is declared by each process.
+ */
+static void benchProcess(benchShared* shared, benchConfig& config, int32_t procIdx) {
+    xrmContext ctx = NULL;
+    string udfCuGroupName = "xrm_bench_group_" + to_string(getpid());
+
+    if (config.opMask & BENCH_OP_GROUP) {
+        xrmUdfCuGroupPropertyV2 udfCuGroupProp;
+        memset(&udfCuGroupProp, 0, sizeof(xrmUdfCuGroupPropertyV2));
+        udfCuGroupProp.optionUdfCuListNum = 1;
+        udfCuGroupProp.optionUdfCuListProps[0].cuNum = 1;
+        xrmUdfCuPropertyV2* udfCuProp = &udfCuGroupProp.optionUdfCuListProps[0].udfCuProps[0];
+        strncpy(udfCuProp->cuName, config.udfCuName.c_str(), XRM_MAX_NAME_LEN - 1);
+        udfCuProp->devExcl = false;
+        udfCuProp->requestLoad = config.requestLoad;
+        ctx = xrmCreateContext(XRM_API_VERSION_1);
+        if (ctx == NULL || xrmUdfCuGroupDeclareV2(ctx, &udfCuGroupProp, (char*)udfCuGroupName.c_str()) != 0)
+            printf("process %d: declare user defined cu group %s failed\n", procIdx, udfCuGroupName.c_str());
+    }
+
+    vector<thread> threads;
+    for (int32_t t = 0; t < config.threads; t++)
+        threads.push_back(thread(benchThread, shared, config, procIdx * config.threads + t, udfCuGroupName));
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    if (ctx != NULL) {
+        xrmUdfCuGroupUndeclareV2(ctx, (char*)udfCuGroupName.c_str());
+        xrmDestroyContext(ctx);
+    }
+}
+
+/*
+ * Nearest rank percentile of the sorted samples, in us.
+ */
+static double benchPercentile(vector<uint32_t>& sorted, double percent) {
+    if (sorted.empty()) return (0);
+    size_t rank = (size_t)(percent / 100 * sorted.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return (sorted[rank - 1] / 1000.0);
+}
+
+/*
+ * Loads the xclbin to the first given number of devices after unloading all the devices.
+ */
+static int32_t benchLoadDevices(xrmContext ctx, benchConfig& config) {
+    for (int32_t devId = 0; devId < XRM_MAX_XILINX_DEVICES; devId++) xrmUnloadOneDevice(ctx, devId);
+    for (int32_t devId = 0; devId < config.devices; devId++) {
+        if (xrmLoadOneDevice(ctx, devId, (char*)config.xclbin.c_str()) != devId) {
+            printf("load %s to device %d failed\n", config.xclbin.c_str(), devId);
+            return (-1);
+        }
+    }
+    return (0);
+}
+
+/*
+ * Runs the benchmark with the config in child processes, the result is filled with the
+ * statistics of all the threads.
+ */
+int32_t xrmBenchRun(benchConfig& config, benchResult& result) {
+    int32_t numThread = config.procs * config.threads;
+    size_t numSample = (size_t)numThread * BENCH_CMD_NUM * config.ops;
+    if (numSample > MAX_BENCH_SAMPLES) {
+        printf("%zu latency samples are out of range of %d, reduce the operations\n", numSample, MAX_BENCH_SAMPLES);
+        return (-1);
+    }
+
+    xrmContext ctx = xrmCreateContext(XRM_API_VERSION_1);
+    if (ctx == NULL) {
+        printf("create context failed\n");
+        return (-1);
+    }
+    if (!config.xclbin.empty() && benchLoadDevices(ctx, config) != 0) {
+        xrmDestroyContext(ctx);
+        return (-1);
+    }
+    xrmCuProperty cuProp;
+    benchSetCuProp(config, &cuProp);
+    cuProp.requestLoad = 100;
+    result.config = config;
+    result.cuNum = xrmCheckCuAvailableNum(ctx, &cuProp);
+    xrmDestroyContext(ctx);
+
+    size_t sharedSize = sizeof(benchShared) + numSample * sizeof(uint32_t);
+    benchShared* shared =
+        (benchShared*)mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        printf("failed to map %zu bytes of shared memory\n", sharedSize);
+        return (-1);
+    }
+    memset(shared, 0, sizeof(benchShared));
+
+    vector<pid_t> pids;
+    for (int32_t p = 0; p < config.procs; p++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            benchProcess(shared, config, p);
+            _exit(0);
+        }
+        if (pid < 0) {
+            printf("fork failed\n");
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    /* start all the threads together once all the contexts are created */
+    uint64_t readyDeadlineNs = getTimeNs() + (uint64_t)BENCH_READY_TIMEOUT_SECONDS * 1000000000;
+    while (shared->ready < numThread && getTimeNs() < readyDeadlineNs) usleep(1000);
+    if (shared->ready < numThread) printf("only %d of %d threads are ready\n", shared->ready, numThread);
+    uint64_t startNs = getTimeNs();
+    shared->start = 1;
+    for (size_t p = 0; p < pids.size(); p++) waitpid(pids[p], NULL, 0);
+
+    uint64_t endNs = startNs;
+    for (int32_t t = 0; t < numThread; t++) endNs = max(endNs, shared->results[t].endNs);
+    result.elapsedUs = (endNs - startNs) / 1000.0;
+    for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) {
+        benchCmdStat* stat = &result.stats[cmd];
+        vector<uint32_t> sorted;
+        uint64_t failed = 0, sumNs = 0;
+        for (int32_t t = 0; t < numThread; t++) {
+            uint32_t* samples = benchSamples(shared, config, t, cmd);
+            sorted.insert(sorted.end(), samples, samples + shared->results[t].count[cmd]);
+            failed += shared->results[t].failed[cmd];
+        }
+        sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i < sorted.size(); i++) sumNs += sorted[i];
+        stat->count = sorted.size();
+        stat->failed = failed;
+        stat->throughput = (result.elapsedUs > 0) ? stat->count * 1000000.0 / result.elapsedUs : 0;
+        stat->meanUs = sorted.empty() ? 0 : (double)sumNs / sorted.size() / 1000.0;
+        stat->p50Us = benchPercentile(sorted, 50);
+        stat->p99Us = benchPercentile(sorted, 99);
+        stat->p999Us = benchPercentile(sorted, 99.9);
+        stat->maxUs = sorted.empty() ? 0 : sorted.back() / 1000.0;
+    }
+    munmap(shared, sharedSize);
+    return (((int32_t)pids.size() == config.procs) ? 0 : -1);
+}
+
+void xrmBenchPrint(benchResult& result) {
+    benchConfig* config = &result.config;
+    printf("devices %d, cu %d, procs %d, threads %d, contexts %d, ops %d, elapsed %.0f us\n", config->devices,
+           result.cuNum, config->procs, config->threads, config->contexts, config->ops, result.elapsedUs);
+    printf("%20s %10s %8s %12s %10s %10s %10s %10s %10s\n", "command", "count", "failed", "ops/s", "mean(us)",
+           "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) {
+        benchCmdStat* stat = &result.stats[cmd];
+        if (stat->count == 0 && stat->failed == 0) continue;
+        printf("%20s %10lu %8lu %12.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n", benchCmdNames[cmd], stat->count,
+               stat->failed, stat->throughput, stat->meanUs, stat->p50Us, stat->p99Us, stat->p999Us, stat->maxUs);
+    }
+    printf("\n");
+}
+
+/*
+ * Total throughput of each run against the run with the fewest threads of the same
+ * xclbin, devices, processes and contexts, shows how the commands scale with threads.
+ */
+void xrmBenchPrintScaling(vector<benchResult>& results) {
+    printf("thread scaling\n");
+    printf("%8s %8s %8s %8s %12s %8s\n", "devices", "procs", "contexts", "threads", "ops/s", "scaling");
+    for (size_t i = 0; i < results.size(); i++) {
+        benchConfig* config = &results[i].config;
+        double throughput = 0, baseThroughput = 0;
+        int32_t baseThreads = 0;
+        for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) throughput += results[i].stats[cmd].throughput;
+        for (size_t j = 0; j < results.size(); j++) {
+            benchConfig* base = &results[j].config;
+            if (base->xclbin != config->xclbin || base->devices != config->devices || base->procs != config->procs ||
+                base->contexts != config->contexts)
+                continue;
+            if (baseThreads != 0 && base->threads >= baseThreads) continue;
+            baseThreads = base->threads;
+            baseThroughput = 0;
+            for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) baseThroughput += results[j].stats[cmd].throughput;
+        }
+        printf("%8d %8d %8d %8d %12.0f %7.2fx\n", config->devices, config->procs, config->contexts, config->threads,
+               throughput, (baseThroughput > 0) ? throughput / baseThroughput : 0);
+    }
+    printf("\n");
+}
+
+int32_t xrmBenchWriteJson(const string& fileName, vector<benchResult>& results) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", fileName.c_str());
+        return (-1);
+    }
+    fprintf(fp, "{\n    \"results\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+        benchResult* result = &results[i];
+        benchConfig* config = &result->config;
+        fprintf(fp, "%s\n        {\n", i ? "," : "");
+        fprintf(fp, "            \"kernelName\": \"%s\",\n", config->kernelName.c_str());
+        fprintf(fp, "            \"xclbin\": \"%s\",\n", config->xclbin.c_str());
+        fprintf(fp, "            \"devices\": %d,\n", config->devices);
+        fprintf(fp, "            \"cuNum\": %d,\n", result->cuNum);
+        fprintf(fp, "            \"procs\": %d,\n", config->procs);
+        fprintf(fp, "            \"threads\": %d,\n", config->threads);
+        fprintf(fp, "            \"contexts\": %d,\n", config->contexts);
+        fprintf(fp, "            \"opsPerThread\": %d,\n", config->ops);
+        fprintf(fp, "            \"elapsedUs\": %.0f,\n", result->elapsedUs);
+        fprintf(fp, "            \"commands\": [");
+        bool first = true;
+        for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) {
+            benchCmdStat* stat = &result->stats[cmd];
+            if (stat->count == 0 && stat->failed == 0) continue;
+            fprintf(fp,
+                    "%s\n                {\"command\": \"%s\", \"count\": %lu, \"failed\": %lu, \"throughput\": %.1f, "
+                    "\"meanUs\": %.2f, \"p50Us\": %.2f, \"p99Us\": %.2f, \"p999Us\": %.2f, \"maxUs\": %.2f}",
+                    first ? "" : ",", benchCmdNames[cmd], stat->count, stat->failed, stat->throughput, stat->meanUs,
+                    stat->p50Us, stat->p99Us, stat->p999Us, stat->maxUs);
+            first = false;
+        }
+        fprintf(fp, "\n            ]\n        }");
+    }
+    fprintf(fp, "\n    ]\n}\n");
+    fclose(fp);
+    return (0);
+}
+
+int32_t xrmBenchWriteCsv(const string& fileName, vector<benchResult>& results) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", fileName.c_str());
+        return (-1);
+    }
+    fprintf(fp, "kernelName,xclbin,devices,cuNum,procs,threads,contexts,opsPerThread,elapsedUs,command,count,failed,"
+                "throughput,meanUs,p50Us,p99Us,p999Us,maxUs\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        benchResult* result = &results[i];
+        benchConfig* config = &result->config;
+        for (int32_t cmd = 0; cmd < BENCH_CMD_NUM; cmd++) {
+            benchCmdStat* stat = &result->stats[cmd];
+            if (stat->count == 0 && stat->failed == 0) continue;
+            fprintf(fp, "%s,%s,%d,%d,%d,%d,%d,%d,%.0f,%s,%lu,%lu,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                    config->kernelName.c_str(), config->xclbin.c_str(), config->devices, result->cuNum,
+                    config->procs, config->threads, config->contexts, config->ops, result->elapsedUs,
+                    benchCmdNames[cmd], stat->count, stat->failed, stat->throughput, stat->meanUs, stat->p50Us,
+                    stat->p99Us, stat->p999Us, stat->maxUs);
+        }
+    }
+    fclose(fp);
+    return (0);
+}
+
+static vector<string> splitList(const char* str) {
+    vector<string> items;
+    string item;
+    for (const char* p = str;; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) items.push_back(item);
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return (items);
+}
+
+static bool parseIntList(const char* str, int32_t minVal, int32_t maxVal, vector<int32_t>& values) {
+    values.clear();
+    for (auto& item : splitList(str)) {
+        int32_t val = atoi(item.c_str());
+        if (val < minVal || val > maxVal) {
+            printf("invalid value: %s, out of range: %d - %d\n", item.c_str(), minVal, maxVal);
+            return (false);
+        }
+        values.push_back(val);
+    }
+    return (!values.empty());
+}
+
+static bool parseOpMask(const char* str, uint32_t& opMask) {
+    const char* opNames[] = {"alloc", "allocv2", "list", "group", "pool", "check"};
+    opMask = 0;
+    for (auto& item : splitList(str)) {
+        if (item == "all") {
+            opMask |= BENCH_OP_ALL;
+            continue;
+        }
+        int32_t i;
+        for (i = 0; i < 6; i++) {
+            if (item == opNames[i]) break;
+        }
+        if (i == 6) {
+            printf("unknown operation: %s\n", item.c_str());
+            return (false);
+        }
+        opMask |= (1 << i);
+    }
+    return (opMask != 0);
+}
+
+static void usage() {
+    printf("How to run the test:\n");
+    printf("./example_test_xrm_bench -k kernelName [options]\n");
+    printf("  -k kernelName     kernel to allocate\n");
+    printf("  -u cuName         cu of the user defined group, default is kernelName:kernelName_0\n");
+    printf("  -l load           request load of each cu in 1 - 100, default is 1\n");
+    printf("  -m ops            operation mix of alloc,allocv2,list,group,pool,check, default is all\n");
+    printf("  -n ops            operations of each thread, default is 1000\n");
+    printf("  -P procs          list of process numbers, default is 1\n");
+    printf("  -T threads        list of thread numbers of each process, default is 1\n");
+    printf("  -C contexts       list of context numbers of each thread, default is 1\n");
+    printf("  -X xclbins        list of xclbin files to load, default is to use the loaded devices\n");
+    printf("  -D devices        list of device numbers to load each xclbin, default is 1\n");
+    printf("  -o file           write the results to file, csv if the name ends with .csv, otherwise json\n");
+    printf("  the lists are separated by ',', the benchmark runs with each combination of them\n");
+}
+
+int main(int argc, char* argv[]) {
+    benchConfig config;
+    vector<int32_t> procsList = {1}, threadsList = {1}, contextsList = {1}, devicesList = {1};
+    vector<string> xclbinList;
+    string outFileName;
+    int opt;
+
+    config.requestLoad = 1;
+    config.opMask = BENCH_OP_ALL;
+    config.ops = 1000;
+    while ((opt = getopt(argc, argv, "k:u:l:m:n:P:T:C:X:D:o:h")) != -1) {
+        bool ok = true;
+        switch (opt) {
+            case 'k':
+                config.kernelName = optarg;
+                break;
+            case 'u':
+                config.udfCuName = optarg;
+                break;
+            case 'l':
+                config.requestLoad = atoi(optarg);
+                ok = (config.requestLoad >= 1 && config.requestLoad <= 100);
+                break;
+            case 'm':
+                ok = parseOpMask(optarg, config.opMask);
+                break;
+            case 'n':
+                config.ops = atoi(optarg);
+                ok = (config.ops >= 1 && config.ops <= MAX_BENCH_OPS);
+                break;
+            case 'P':
+                ok = parseIntList(optarg, 1, MAX_BENCH_PROCS, procsList);
+                break;
+            case 'T':
+                ok = parseIntList(optarg, 1, MAX_BENCH_THREADS, threadsList);
+                break;
+            case 'C':
+                ok = parseIntList(optarg, 1, MAX_BENCH_CONTEXTS, contextsList);
+                break;
+            case 'X':
+                xclbinList = splitList(optarg);
+                break;
+            case 'D':
+                ok = parseIntList(optarg, 1, XRM_MAX_XILINX_DEVICES, devicesList);
+                break;
+            case 'o':
+                outFileName = optarg;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            usage();
+            return 0;
+        }
+    }
+    if (config.kernelName.empty()) {
+        usage();
+        return 0;
+    }
+    if (config.udfCuName.empty()) config.udfCuName = config.kernelName + ":" + config.kernelName + "_0";
+    /* empty xclbin name means to use the devices already loaded */
+    if (xclbinList.empty()) {
+        xclbinList.push_back("");
+        devicesList = {0};
+    }
+
+    printf("<<<<<<<==  Start the xrm benchmark ===>>>>>>>>\n\n");
+    vector<benchResult> results;
+    for (auto& xclbin : xclbinList) {
+        for (auto devices : devicesList) {
+            for (auto procs : procsList) {
+                for (auto threads : threadsList) {
+                    for (auto contexts : contextsList) {
+                        benchResult result;
+                        config.xclbin = xclbin;
+                        config.devices = devices;
+                        config.procs = procs;
+                        config.threads = threads;
+                        config.contexts = contexts;
+                        memset(result.stats, 0, sizeof(result.stats));
+                        if (xrmBenchRun(config, result) != 0) {
+                            printf("benchmark failed\n");
+                            continue;
+                        }
+                        xrmBenchPrint(result);
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+    if (threadsList.size() > 1) xrmBenchPrintScaling(results);
+    if (!outFileName.empty()) {
+        bool isCsv = outFileName.size() > 4 && outFileName.compare(outFileName.size() - 4, 4, ".csv") == 0;
+        if (isCsv)
+            xrmBenchWriteCsv(outFileName, results);
+        else
+            xrmBenchWriteJson(outFileName, results);
+        printf("results are written to %s\n", outFileName.c_str());
+    }
+    printf("<<<<<<<==  End the xrm benchmark ===>>>>>>>>\n\n");
+    return 0;
+}
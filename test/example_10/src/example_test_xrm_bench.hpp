@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _EXAMPLE_TEST_XRM_BENCH_HPP_
+#define _EXAMPLE_TEST_XRM_BENCH_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+#include <xrm.h>
+
+#define MAX_BENCH_PROCS 64
+#define MAX_BENCH_THREADS 64
+#define MAX_BENCH_CONTEXTS 16
+#define MAX_BENCH_OPS 1000000
+#define MAX_BENCH_SAMPLES (64 * 1024 * 1024) // latency samples of one run, 256MB of shared memory
+#define BENCH_READY_TIMEOUT_SECONDS 60
+
+using namespace std;
+
+/* the commands timed by the benchmark, a failed command is counted but not timed */
+typedef enum benchCmd {
+    BENCH_CU_ALLOC = 0,
+    BENCH_ALLOCATION_QUERY,
+    BENCH_CU_RELEASE,
+    BENCH_CU_ALLOC_V2,
+    BENCH_CU_RELEASE_V2,
+    BENCH_CU_LIST_ALLOC,
+    BENCH_CU_LIST_RELEASE,
+    BENCH_CU_GROUP_ALLOC,
+    BENCH_CU_GROUP_RELEASE,
+    BENCH_CU_POOL_RESERVE,
+    BENCH_CU_POOL_RELINQUISH,
+    BENCH_CHECK_CU_AVAILABLE_NUM,
+    BENCH_CMD_NUM
+} benchCmd;
+
+/* the operation mix, one operation runs one or more commands */
+#define BENCH_OP_ALLOC (1 << 0)    // cuAlloc, allocationQuery, cuRelease
+#define BENCH_OP_ALLOC_V2 (1 << 1) // cuAllocV2, cuReleaseV2
+#define BENCH_OP_LIST (1 << 2)     // cuListAlloc, cuListRelease
+#define BENCH_OP_GROUP (1 << 3)    // cuGroupAllocV2, cuGroupReleaseV2
+#define BENCH_OP_POOL (1 << 4)     // cuPoolReserveV2, cuPoolRelinquishV2
+#define BENCH_OP_CHECK (1 << 5)    // checkCuAvailableNum
+#define BENCH_OP_ALL 0x3F
+
+typedef struct benchConfig {
+    string kernelName;
+    string udfCuName; // cu of the user defined group, kernelName:instanceName
+    int32_t requestLoad;
+    uint32_t opMask;
+    int32_t ops; // operations of each thread
+    int32_t procs;
+    int32_t threads;
+    int32_t contexts; // contexts of each thread, used in turn
+    int32_t devices;  // devices loaded with the xclbin, 0: not loaded by the benchmark
+    string xclbin;
+} benchConfig;
+
+/* result of one thread, in the memory shared with the parent process */
+typedef struct benchThreadResult {
+    uint64_t endNs;
+    uint32_t count[BENCH_CMD_NUM];
+    uint32_t failed[BENCH_CMD_NUM];
+} benchThreadResult;
+
+typedef struct benchShared {
+    volatile int32_t ready;
+    volatile int32_t start;
+    benchThreadResult results[MAX_BENCH_PROCS * MAX_BENCH_THREADS];
+    /* followed by latency samples in ns, [procs * threads][BENCH_CMD_NUM][ops] */
+} benchShared;
+
+typedef struct benchCmdStat {
+    uint64_t count;
+    uint64_t failed;
+    double throughput; // commands per second
+    double meanUs;
+    double p50Us;
+    double p99Us;
+    double p999Us;
+    double maxUs;
+} benchCmdStat;
+
+typedef struct benchResult {
+    benchConfig config;
+    int32_t cuNum; // cu of the kernel, taken from the available number at full load
+    double elapsedUs;
+    benchCmdStat stats[BENCH_CMD_NUM];
+} benchResult;
+
+uint64_t getTimeNs();
+int32_t xrmBenchRun(benchConfig& config, benchResult& result);
+void xrmBenchPrint(benchResult& result);
+void xrmBenchPrintScaling(vector<benchResult>& results);
+int32_t xrmBenchWriteJson(const string& fileName, vector<benchResult>& results);
+int32_t xrmBenchWriteCsv(const string& fileName, vector<benchResult>& results);
+
+#endif // _EXAMPLE_TEST_XRM_BENCH_HPP_
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "example_test_xrm_engine_bench.hpp"
+
+/*
+ * This example is the in-process benchmark of the allocation engine of xrmd.
+ *
+ * It links xrm::system of the daemon directly, there is no socket, no json and no libxrm
+ * on the path, so the cost of the engine can be told apart from the cost of the IPC which
+ * is measured by example_10. The devices are simulated: for each run a description with
+ * the given number of devices, each loaded with an xclbin of the given number of cu of
+ * kernel "bench", is written to a temporary file and loaded through the simulated device
+ * backend.
+ *
+ * Before the timed calls, the cu are filled with requests of the given load up to the
+ * occupancy level, spread over the given number of clients and over the devices. Then each
+ * engine function is called for the given iterations, taking the same system lock as its
+ * daemon command:
+ *
+ *   resAllocCu / resReleaseCu
+ *   resAllocCuV2 with no policy and with each policyInfo constraint type
+ *   resAllocCuListV2 of 4 cu on 2 virtual devices
+ *   resReserveCuPoolV2
+ *   checkCuStat
+ *   recycleResource of a client owning 4 cu
+ *
+ * Every combination of the lists given is run, for example:
+ *
+ *   ./example_test_xrm_engine_bench -D 1,16 -U 8,144 -L 10000,1000 -O 0,50,90 -K 1,100 -o result.csv
+ *
+ * It's built with the daemon sources, see the build option XRM_ENGINE_BENCH.
+ */
+
+using namespace std;
+using namespace xrm;
+
+static const char* engineOpNames[ENGINE_OP_NUM] = {"resAllocCu",
+                                                   "resReleaseCu",
+                                                   "resAllocCuV2",
+                                                   "resAllocCuV2CuMostUsedFirst",
+                                                   "resAllocCuV2CuLeastUsedFirst",
+                                                   "resAllocCuV2DevMostUsedFirst",
+                                                   "resAllocCuV2DevLeastUsedFirst",
+                                                   "resAllocCuListV2",
+                                                   "resReserveCuPoolV2",
+                                                   "checkCuStat",
+                                                   "recycleResource"};
+
+static const uint64_t enginePolicies[] = {
+    XRM_POLICY_INFO_CONSTRAINT_TYPE_NULL, XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_MOST_USED_FIRST,
+    XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST, XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_MOST_USED_FIRST,
+    XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST};
+
+/* latency samples of each engine function in one run */
+typedef struct engineSamples {
+    vector<uint64_t> ns[ENGINE_OP_NUM];
+    uint64_t failed[ENGINE_OP_NUM];
+} engineSamples;
+
+uint64_t getTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec);
+}
+
+static void engineRecord(engineSamples& samples, int32_t op, uint64_t startNs, bool ok) {
+    if (!ok) {
+        samples.failed[op]++;
+        return;
+    }
+    samples.ns[op].push_back(getTimeNs() - startNs);
+}
+
+/*
+ * Same as libxrm, the load of percentage is sent with granularity of 100, others with
+ * granularity of 1,000,000.
+ */
+static int32_t engineLoadOriginal(int32_t requestLoad) {
+    if (requestLoad % 10000 == 0) return (requestLoad / 10000);
+    return (requestLoad << 8);
+}
+
+static void engineSetCuProp(engineConfig& config, uint64_t clientId, cuProperty* cuProp) {
+    memset(cuProp, 0, sizeof(cuProperty));
+    strncpy(cuProp->kernelName, ENGINE_BENCH_KERNEL_NAME, XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->requestLoadUnified = config.requestLoad;
+    cuProp->requestLoadOriginal = engineLoadOriginal(config.requestLoad);
+    cuProp->clientId = clientId;
+    cuProp->clientProcessId = getpid();
+    cuProp->poolId = 0;
+}
+
+static void engineSetCuPropV2(engineConfig& config, uint64_t clientId, cuPropertyV2* cuProp) {
+    memset(cuProp, 0, sizeof(cuPropertyV2));
+    strncpy(cuProp->kernelName, ENGINE_BENCH_KERNEL_NAME, XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->requestLoadUnified = config.requestLoad;
+    cuProp->requestLoadOriginal = engineLoadOriginal(config.requestLoad);
+    cuProp->clientId = clientId;
+    cuProp->clientProcessId = getpid();
+    cuProp->poolId = 0;
+}
+
+/*
+ * Writes the description of the simulated devices of the run.
+ */
+static int32_t engineWriteSimDescription(engineConfig& config, const string& fileName) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", fileName.c_str());
+        return (-1);
+    }
+    fprintf(fp, "{\n    \"devices\": [ { \"dsaName\": \"xilinx_sim_engine_bench\", \"count\": %d } ],\n",
+            config.devices);
+    fprintf(fp, "    \"xclbins\": [ { \"name\": \"%s\", \"kernels\": [ { \"name\": \"%s\", \"instances\": %d } ] } ]\n}\n",
+            ENGINE_BENCH_XCLBIN_NAME, ENGINE_BENCH_KERNEL_NAME, config.cuPerDevice);
+    fclose(fp);
+    return (0);
+}
+
+/*
+ * Creates the system with the simulated devices loaded with the bench xclbin.
+ */
+static xrm::system* engineCreateSystem(engineConfig& config) {
+    string descFileName = "/tmp/xrm_engine_bench_" + to_string(getpid()) + ".json";
+    if (engineWriteSimDescription(config, descFileName) != 0) return (NULL);
+    setenv("XRM_SIM_DEVICE_FILE", descFileName.c_str(), 1);
+
+    xrm::system* sys = new xrm::system;
+    sys->initLock();
+    sys->initSystem();
+    for (int32_t devId = 0; devId < config.devices; devId++) {
+        pt::ptree loadTree;
+        string errmsg;
+        loadTree.put("xclbinFileName", ENGINE_BENCH_XCLBIN_NAME);
+        loadTree.put("deviceId", devId);
+        sys->enterLock();
+        int32_t ret = sys->loadOneDevice(loadTree, errmsg);
+        sys->exitLock();
+        if (ret != devId) {
+            printf("load %s to simulated device %d failed: %s\n", ENGINE_BENCH_XCLBIN_NAME, devId, errmsg.c_str());
+            delete sys;
+            sys = NULL;
+            break;
+        }
+    }
+    unlink(descFileName.c_str());
+    return (sys);
+}
+
+/*
+ * Takes the cu load up to the occupancy level, the fill requests are spread over the clients.
+ * The device least used first policy spreads the load over the devices, so that the cu list
+ * on 2 virtual devices still fits at mid occupancy. Returns the load taken in granularity of
+ * 1,000,000.
+ */
+static int64_t engineFill(xrm::system* sys, engineConfig& config, vector<uint64_t>& clientIds) {
+    int64_t targetLoad = (int64_t)config.devices * config.cuPerDevice * 1000000 * config.occupancy / 100;
+    int64_t filledLoad = 0;
+    cuPropertyV2 cuProp;
+    cuResource cuRes;
+
+    sys->enterSharedLock();
+    for (int32_t i = 0; filledLoad + config.requestLoad <= targetLoad; i++) {
+        engineSetCuPropV2(config, clientIds[i % clientIds.size()], &cuProp);
+        cuProp.policyInfo = (uint64_t)XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST
+                            << XRM_POLICY_INFO_CONSTRAINT_TYPE_SHIFT;
+        memset(&cuRes, 0, sizeof(cuResource));
+        if (sys->resAllocCuV2(&cuProp, &cuRes, true) != XRM_SUCCESS) break;
+        filledLoad += config.requestLoad;
+    }
+    sys->exitSharedLock();
+    return (filledLoad);
+}
+
+static void engineBenchAllocCu(xrm::system* sys, engineConfig& config, vector<uint64_t>& clientIds,
+                               engineSamples& samples) {
+    cuProperty cuProp;
+    cuResource cuRes;
+    uint64_t startNs;
+    bool ok;
+
+    for (int32_t i = 0; i < config.iterations; i++) {
+        engineSetCuProp(config, clientIds[i % clientIds.size()], &cuProp);
+        memset(&cuRes, 0, sizeof(cuResource));
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        ok = (sys->resAllocCu(&cuProp, &cuRes, true) == XRM_SUCCESS);
+        engineRecord(samples, ENGINE_ALLOC_CU, startNs, ok);
+        sys->exitSharedLock();
+        if (!ok) continue;
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        ok = (sys->resReleaseCu(&cuRes) == XRM_SUCCESS);
+        engineRecord(samples, ENGINE_RELEASE_CU, startNs, ok);
+        sys->exitSharedLock();
+    }
+}
+
+static void engineBenchAllocCuV2(xrm::system* sys, engineConfig& config, vector<uint64_t>& clientIds,
+                                 engineSamples& samples) {
+    cuPropertyV2 cuProp;
+    cuResource cuRes;
+    uint64_t startNs;
+    bool ok;
+
+    for (int32_t p = 0; p < (int32_t)(sizeof(enginePolicies) / sizeof(enginePolicies[0])); p++) {
+        int32_t op = ENGINE_ALLOC_CU_V2 + p;
+        for (int32_t i = 0; i < config.iterations; i++) {
+            engineSetCuPropV2(config, clientIds[i % clientIds.size()], &cuProp);
+            cuProp.policyInfo = enginePolicies[p] << XRM_POLICY_INFO_CONSTRAINT_TYPE_SHIFT;
+            memset(&cuRes, 0, sizeof(cuResource));
+            sys->enterSharedLock();
+            startNs = getTimeNs();
+            ok = (sys->resAllocCuV2(&cuProp, &cuRes, true) == XRM_SUCCESS);
+            engineRecord(samples, op, startNs, ok);
+            if (ok) sys->resReleaseCuV2(&cuRes);
+            sys->exitSharedLock();
+        }
+    }
+}
+
+/*
+ * The first half of the cu list is on one virtual device and the second half on another.
+ */
+static void engineBenchAllocCuListV2(xrm::system* sys, engineConfig& config, vector<uint64_t>& clientIds,
+                                     engineSamples& samples) {
+    cuListPropertyV2* cuListProp = (cuListPropertyV2*)malloc(sizeof(cuListPropertyV2));
+    cuListResourceV2* cuListRes = (cuListResourceV2*)malloc(sizeof(cuListResourceV2));
+    uint64_t startNs;
+    bool ok;
+
+    for (int32_t i = 0; i < config.iterations; i++) {
+        memset(cuListProp, 0, sizeof(cuListPropertyV2));
+        cuListProp->cuNum = ENGINE_BENCH_LIST_CU_NUM;
+        for (int32_t c = 0; c < ENGINE_BENCH_LIST_CU_NUM; c++) {
+            engineSetCuPropV2(config, clientIds[i % clientIds.size()], &cuListProp->cuProps[c]);
+            cuListProp->cuProps[c].deviceInfo =
+                ((uint64_t)XRM_DEVICE_INFO_CONSTRAINT_TYPE_VIRTUAL_DEVICE_INDEX << XRM_DEVICE_INFO_CONSTRAINT_TYPE_SHIFT) |
+                ((uint64_t)(c * 2 / ENGINE_BENCH_LIST_CU_NUM) << XRM_DEVICE_INFO_DEVICE_INDEX_SHIFT);
+        }
+        memset(cuListRes, 0, sizeof(cuListResourceV2));
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        ok = (sys->resAllocCuListV2(cuListProp, cuListRes) == XRM_SUCCESS);
+        engineRecord(samples, ENGINE_ALLOC_CU_LIST_V2, startNs, ok);
+        if (ok) sys->resReleaseCuListV2(cuListRes);
+        sys->exitSharedLock();
+    }
+    free(cuListProp);
+    free(cuListRes);
+}
+
+static void engineBenchReserveCuPoolV2(xrm::system* sys, engineConfig& config, vector<uint64_t>& clientIds,
+                                       engineSamples& samples) {
+    cuPoolPropertyV2* cuPoolProp = (cuPoolPropertyV2*)malloc(sizeof(cuPoolPropertyV2));
+    cuPoolResInforV2* cuPoolResInfor = (cuPoolResInforV2*)malloc(sizeof(cuPoolResInforV2));
+    uint64_t startNs;
+
+    for (int32_t i = 0; i < config.iterations; i++) {
+        uint64_t clientId = clientIds[i % clientIds.size()];
+        memset(cuPoolProp, 0, sizeof(cuPoolPropertyV2));
+        cuPoolProp->cuListProp.cuNum = 1;
+        engineSetCuPropV2(config, clientId, &cuPoolProp->cuListProp.cuProps[0]);
+        cuPoolProp->cuListNum = 1;
+        cuPoolProp->clientId = clientId;
+        cuPoolProp->clientProcessId = getpid();
+        memset(cuPoolResInfor, 0, sizeof(cuPoolResInforV2));
+        sys->enterLock();
+        startNs = getTimeNs();
+        uint64_t poolId = sys->resReserveCuPoolV2(cuPoolProp, cuPoolResInfor);
+        engineRecord(samples, ENGINE_RESERVE_CU_POOL_V2, startNs, (poolId != 0));
+        if (poolId != 0) sys->resRelinquishCuPoolV2(poolId);
+        sys->exitLock();
+    }
+    free(cuPoolProp);
+    free(cuPoolResInfor);
+}
+
+/*
+ * The stat is checked on cu spread over all the devices.
+ */
+static void engineBenchCheckCuStat(xrm::system* sys, engineConfig& config, engineSamples& samples) {
+    cuResource cuRes;
+    cuStatus cuStat;
+    uint64_t startNs;
+    bool ok;
+
+    for (int32_t i = 0; i < config.iterations; i++) {
+        memset(&cuRes, 0, sizeof(cuResource));
+        cuRes.deviceId = i % config.devices;
+        cuRes.cuId = (i / config.devices) % config.cuPerDevice;
+        memset(&cuStat, 0, sizeof(cuStatus));
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        ok = (sys->checkCuStat(&cuRes, &cuStat) == XRM_SUCCESS);
+        engineRecord(samples, ENGINE_CHECK_CU_STAT, startNs, ok);
+        sys->exitSharedLock();
+    }
+}
+
+/*
+ * Each time a new client takes some cu, then all its resources are recycled as if its
+ * context was destroyed.
+ */
+static void engineBenchRecycleResource(xrm::system* sys, engineConfig& config, engineSamples& samples) {
+    cuProperty cuProp;
+    cuResource cuRes;
+    uint64_t startNs;
+
+    for (int32_t i = 0; i < config.iterations; i++) {
+        uint64_t clientId = sys->getNewClientId();
+        engineSetCuProp(config, clientId, &cuProp);
+        sys->enterSharedLock();
+        for (int32_t c = 0; c < ENGINE_BENCH_RECYCLE_CU_NUM; c++) {
+            memset(&cuRes, 0, sizeof(cuResource));
+            if (sys->resAllocCu(&cuProp, &cuRes, true) != XRM_SUCCESS) break;
+        }
+        startNs = getTimeNs();
+        sys->recycleResource(clientId);
+        engineRecord(samples, ENGINE_RECYCLE_RESOURCE, startNs, true);
+        sys->exitSharedLock();
+    }
+}
+
+/*
+ * Nearest rank percentile of the sorted samples.
+ */
+static double enginePercentile(vector<uint64_t>& sorted, double percent) {
+    if (sorted.empty()) return (0);
+    size_t rank = (size_t)(percent / 100 * sorted.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return ((double)sorted[rank - 1]);
+}
+
+/*
+ * Runs the benchmark with the config on a new system, the result is filled with the
+ * statistics of each engine function.
+ */
+int32_t xrmEngineBenchRun(engineConfig& config, engineResult& result) {
+    xrm::system* sys = engineCreateSystem(config);
+    if (sys == NULL) return (-1);
+
+    vector<uint64_t> clientIds;
+    for (int32_t i = 0; i < config.clients; i++) clientIds.push_back(sys->getNewClientId());
+
+    result.config = config;
+    int64_t filledLoad = engineFill(sys, config, clientIds);
+    result.occupiedLoad = (int32_t)(filledLoad * 100 / ((int64_t)config.devices * config.cuPerDevice * 1000000));
+
+    engineSamples samples;
+    memset(samples.failed, 0, sizeof(samples.failed));
+    for (int32_t op = 0; op < ENGINE_OP_NUM; op++) samples.ns[op].reserve(config.iterations);
+    engineBenchAllocCu(sys, config, clientIds, samples);
+    engineBenchAllocCuV2(sys, config, clientIds, samples);
+    engineBenchAllocCuListV2(sys, config, clientIds, samples);
+    engineBenchReserveCuPoolV2(sys, config, clientIds, samples);
+    engineBenchCheckCuStat(sys, config, samples);
+    engineBenchRecycleResource(sys, config, samples);
+
+    for (int32_t op = 0; op < ENGINE_OP_NUM; op++) {
+        engineOpStat* stat = &result.stats[op];
+        vector<uint64_t>& sorted = samples.ns[op];
+        uint64_t sumNs = 0;
+        sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i < sorted.size(); i++) sumNs += sorted[i];
+        stat->count = sorted.size();
+        stat->failed = samples.failed[op];
+        stat->meanNs = sorted.empty() ? 0 : (double)sumNs / sorted.size();
+        stat->p50Ns = enginePercentile(sorted, 50);
+        stat->p99Ns = enginePercentile(sorted, 99);
+        stat->maxNs = sorted.empty() ? 0 : (double)sorted.back();
+    }
+
+    /* give back the fill resources before the system is gone */
+    sys->enterSharedLock();
+    for (size_t i = 0; i < clientIds.size(); i++) sys->recycleResource(clientIds[i]);
+    sys->exitSharedLock();
+    delete sys;
+    return (0);
+}
+
+void xrmEngineBenchPrint(engineResult& result) {
+    engineConfig* config = &result.config;
+    printf("devices %d, cu per device %d, request load %d, occupancy %d%% (taken %d%%), clients %d, iterations %d\n",
+           config->devices, config->cuPerDevice, config->requestLoad, config->occupancy, result.occupiedLoad,
+           config->clients, config->iterations);
+    printf("%30s %10s %8s %12s %12s %12s %12s\n", "function", "count", "failed", "mean(ns)", "p50(ns)", "p99(ns)",
+           "max(ns)");
+    bool noSample = false;
+    for (int32_t op = 0; op < ENGINE_OP_NUM; op++) {
+        engineOpStat* stat = &result.stats[op];
+        if (stat->count == 0) {
+            /* no call succeeded, there is no latency to report */
+            printf("%30s %10lu %8lu %12s %12s %12s %12s\n", engineOpNames[op], stat->count, stat->failed, "n/a", "n/a",
+                   "n/a", "n/a");
+            noSample = true;
+            continue;
+        }
+        printf("%30s %10lu %8lu %12.0f %12.0f %12.0f %12.0f\n", engineOpNames[op], stat->count, stat->failed,
+               stat->meanNs, stat->p50Ns, stat->p99Ns, stat->maxNs);
+    }
+    if (noSample) printf("n/a: no call succeeded at this occupancy, there is no latency to report\n");
+    printf("\n");
+}
+
+int32_t xrmEngineBenchWriteJson(const string& fileName, vector<engineResult>& results) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", fileName.c_str());
+        return (-1);
+    }
+    fprintf(fp, "{\n    \"results\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+        engineResult* result = &results[i];
+        engineConfig* config = &result->config;
+        fprintf(fp, "%s\n        {\n", i ? "," : "");
+        fprintf(fp, "            \"devices\": %d,\n", config->devices);
+        fprintf(fp, "            \"cuPerDevice\": %d,\n", config->cuPerDevice);
+        fprintf(fp, "            \"requestLoad\": %d,\n", config->requestLoad);
+        fprintf(fp, "            \"occupancy\": %d,\n", config->occupancy);
+        fprintf(fp, "            \"occupiedLoad\": %d,\n", result->occupiedLoad);
+        fprintf(fp, "            \"clients\": %d,\n", config->clients);
+        fprintf(fp, "            \"iterations\": %d,\n", config->iterations);
+        fprintf(fp, "            \"functions\": [");
+        for (int32_t op = 0; op < ENGINE_OP_NUM; op++) {
+            engineOpStat* stat = &result->stats[op];
+            if (stat->count == 0) {
+                /* the latency is null when no call succeeded */
+                fprintf(fp,
+                        "%s\n                {\"function\": \"%s\", \"count\": 0, \"failed\": %lu, \"meanNs\": null, "
+                        "\"p50Ns\": null, \"p99Ns\": null, \"maxNs\": null}",
+                        op ? "," : "", engineOpNames[op], stat->failed);
+                continue;
+            }
+            fprintf(fp,
+                    "%s\n                {\"function\": \"%s\", \"count\": %lu, \"failed\": %lu, \"meanNs\": %.0f, "
+                    "\"p50Ns\": %.0f, \"p99Ns\": %.0f, \"maxNs\": %.0f}",
+                    op ? "," : "", engineOpNames[op], stat->count, stat->failed, stat->meanNs, stat->p50Ns,
+                    stat->p99Ns, stat->maxNs);
+        }
+        fprintf(fp, "\n            ]\n        }");
+    }
+    fprintf(fp, "\n    ]\n}\n");
+    fclose(fp);
+    return (0);
+}
+
+int32_t xrmEngineBenchWriteCsv(const string& fileName, vector<engineResult>& results) {
+    FILE* fp = fopen(fileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", fileName.c_str());
+        return (-1);
+    }
+    fprintf(fp, "devices,cuPerDevice,requestLoad,occupancy,occupiedLoad,clients,iterations,function,count,failed,"
+                "meanNs,p50Ns,p99Ns,maxNs\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        engineResult* result = &results[i];
+        engineConfig* config = &result->config;
+        for (int32_t op = 0; op < ENGINE_OP_NUM; op++) {
+            engineOpStat* stat = &result->stats[op];
+            if (stat->count == 0) {
+                /* the latency fields are empty when no call succeeded */
+                fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%s,0,%lu,,,,\n", config->devices, config->cuPerDevice,
+                        config->requestLoad, config->occupancy, result->occupiedLoad, config->clients,
+                        config->iterations, engineOpNames[op], stat->failed);
+                continue;
+            }
+            fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%s,%lu,%lu,%.0f,%.0f,%.0f,%.0f\n", config->devices,
+                    config->cuPerDevice, config->requestLoad, config->occupancy, result->occupiedLoad,
+                    config->clients, config->iterations, engineOpNames[op], stat->count, stat->failed,
+                    stat->meanNs, stat->p50Ns, stat->p99Ns, stat->maxNs);
+        }
+    }
+    fclose(fp);
+    return (0);
+}
+
+static bool parseIntList(const char* str, int32_t minVal, int32_t maxVal, vector<int32_t>& values) {
+    string item;
+    values.clear();
+    for (const char* p = str;; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) {
+                int32_t val = atoi(item.c_str());
+                if (val < minVal || val > maxVal) {
+                    printf("invalid value: %s, out of range: %d - %d\n", item.c_str(), minVal, maxVal);
+                    return (false);
+                }
+                values.push_back(val);
+            }
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return (!values.empty());
+}
+
+static void usage() {
+    printf("How to run the test:\n");
+    printf("./example_test_xrm_engine_bench [options]\n");
+    printf("  -D devices        list of simulated device numbers, default is 1\n");
+    printf("  -U cu             list of cu numbers of each device, default is 8\n");
+    printf("  -L load           list of request loads in granularity of 1,000,000, default is 10000\n");
+    printf("  -O occupancy      list of cu load percentages taken before the timed calls, default is 0\n");
+    printf("  -K clients        list of client numbers, default is 1\n");
+    printf("  -n iterations     timed calls of each function, default is 10000\n");
+    printf("  -o file           write the results to file, csv if the name ends with .csv, otherwise json\n");
+    printf("  the lists are separated by ',', the benchmark runs with each combination of them\n");
+}
+
+int main(int argc, char* argv[]) {
+    engineConfig config;
+    vector<int32_t> devicesList = {1}, cuList = {8}, loadList = {10000}, occupancyList = {0}, clientsList = {1};
+    string outFileName;
+    int opt;
+
+    config.iterations = 10000;
+    while ((opt = getopt(argc, argv, "D:U:L:O:K:n:o:h")) != -1) {
+        bool ok = true;
+        switch (opt) {
+            case 'D':
+                ok = parseIntList(optarg, 1, XRM_MAX_XILINX_DEVICES, devicesList);
+                break;
+            case 'U':
+                ok = parseIntList(optarg, 1, XRM_MAX_XILINX_KERNELS, cuList);
+                break;
+            case 'L':
+                ok = parseIntList(optarg, 1, XRM_MAX_CU_LOAD_GRANULARITY_1000000, loadList);
+                break;
+            case 'O':
+                ok = parseIntList(optarg, 0, 100, occupancyList);
+                break;
+            case 'K':
+                ok = parseIntList(optarg, 1, MAX_ENGINE_BENCH_CLIENTS, clientsList);
+                break;
+            case 'n':
+                config.iterations = atoi(optarg);
+                ok = (config.iterations >= 1 && config.iterations <= MAX_ENGINE_BENCH_ITERATIONS);
+                break;
+            case 'o':
+                outFileName = optarg;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            usage();
+            return 0;
+        }
+    }
+
+    printf("<<<<<<<==  Start the xrm engine benchmark ===>>>>>>>>\n\n");
+    vector<engineResult> results;
+    for (auto devices : devicesList) {
+        for (auto cuPerDevice : cuList) {
+            for (auto requestLoad : loadList) {
+                for (auto occupancy : occupancyList) {
+                    for (auto clients : clientsList) {
+                        engineResult result;
+                        config.devices = devices;
+                        config.cuPerDevice = cuPerDevice;
+                        config.requestLoad = requestLoad;
+                        config.occupancy = occupancy;
+                        config.clients = clients;
+                        memset(result.stats, 0, sizeof(result.stats));
+                        if (xrmEngineBenchRun(config, result) != 0) {
+                            printf("benchmark failed\n");
+                            continue;
+                        }
+                        xrmEngineBenchPrint(result);
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+    if (!outFileName.empty()) {
+        bool isCsv = outFileName.size() > 4 && outFileName.compare(outFileName.size() - 4, 4, ".csv") == 0;
+        if (isCsv)
+            xrmEngineBenchWriteCsv(outFileName, results);
+        else
+            xrmEngineBenchWriteJson(outFileName, results);
+        printf("results are written to %s\n", outFileName.c_str());
+    }
+    printf("<<<<<<<==  End the xrm engine benchmark ===>>>>>>>>\n\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _EXAMPLE_TEST_XRM_ENGINE_BENCH_HPP_
+#define _EXAMPLE_TEST_XRM_ENGINE_BENCH_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+#include "xrm_system.hpp"
+
+#define ENGINE_BENCH_KERNEL_NAME "bench"
+#define ENGINE_BENCH_XCLBIN_NAME "/tmp/xrm_engine_bench.xclbin"
+#define ENGINE_BENCH_LIST_CU_NUM 4    // cu of the list, two cu on each of two virtual devices
+#define ENGINE_BENCH_RECYCLE_CU_NUM 4 // cu owned by the client when it's recycled
+#define MAX_ENGINE_BENCH_ITERATIONS 1000000
+#define MAX_ENGINE_BENCH_CLIENTS 1000
+
+using namespace std;
+
+/* the engine functions timed by the benchmark, a failed call is counted but not timed */
+typedef enum engineOp {
+    ENGINE_ALLOC_CU = 0,
+    ENGINE_RELEASE_CU,
+    ENGINE_ALLOC_CU_V2,                 // no policy
+    ENGINE_ALLOC_CU_V2_CU_MOST_USED,    // XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_MOST_USED_FIRST
+    ENGINE_ALLOC_CU_V2_CU_LEAST_USED,   // XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST
+    ENGINE_ALLOC_CU_V2_DEV_MOST_USED,   // XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_MOST_USED_FIRST
+    ENGINE_ALLOC_CU_V2_DEV_LEAST_USED,  // XRM_POLICY_INFO_CONSTRAINT_TYPE_DEV_LEAST_USED_FIRST
+    ENGINE_ALLOC_CU_LIST_V2,            // cu on virtual devices
+    ENGINE_RESERVE_CU_POOL_V2,
+    ENGINE_CHECK_CU_STAT,
+    ENGINE_RECYCLE_RESOURCE,
+    ENGINE_OP_NUM
+} engineOp;
+
+typedef struct engineConfig {
+    int32_t devices;
+    int32_t cuPerDevice;
+    int32_t requestLoad; // load of each request, granularity of 1,000,000
+    int32_t occupancy;   // percentage of the total cu load taken before the timed calls
+    int32_t clients;     // clients the fill and the timed requests are spread over
+    int32_t iterations;  // timed calls of each function
+} engineConfig;
+
+typedef struct engineOpStat {
+    uint64_t count;
+    uint64_t failed;
+    double meanNs;
+    double p50Ns;
+    double p99Ns;
+    double maxNs;
+} engineOpStat;
+
+typedef struct engineResult {
+    engineConfig config;
+    int32_t occupiedLoad; // percentage of the total cu load really taken by the fill
+    engineOpStat stats[ENGINE_OP_NUM];
+} engineResult;
+
+uint64_t getTimeNs();
+int32_t xrmEngineBenchRun(engineConfig& config, engineResult& result);
+void xrmEngineBenchPrint(engineResult& result);
+int32_t xrmEngineBenchWriteJson(const string& fileName, vector<engineResult>& results);
+int32_t xrmEngineBenchWriteCsv(const string& fileName, vector<engineResult>& results);
+
+#endif // _EXAMPLE_TEST_XRM_ENGINE_BENCH_HPP_
@@ -19,15 +19,9 @@
 
 int32_t wrapperXrmCuAlloc(xrmContext* context, xrmCuProperty* cuProp, xrmCuResource* cuRes, bool blockAlloc) {
     int32_t ret;
-    int64_t i = 0;
     if (blockAlloc) {
-        ret = xrmCuAlloc(context, cuProp, cuRes);
-        while (ret != XRM_SUCCESS) {
-            sleep(XRM_WAIT_SECONDS); // wait 10 seconds
-            i++;
-            printf("try to alloc cu list again: %lu\n", i);
-            ret = xrmCuAlloc(context, cuProp, cuRes);
-        }
+        /* the daemon holds the request until the cu is released by others, no polling here */
+        ret = xrmCuBlockingAlloc(context, cuProp, XRM_RETRY_INTERVAL_US, cuRes);
         return (ret);
     } else {
         ret = xrmCuAlloc(context, cuProp, cuRes);
@@ -40,15 +34,9 @@ int32_t wrapperXrmCuListAlloc(xrmContext* context,
                               xrmCuListResource* cuListRes,
                               bool blockAlloc) {
     int32_t ret;
-    int64_t i = 0;
     if (blockAlloc) {
-        ret = xrmCuListAlloc(context, cuListProp, cuListRes);
-        while (ret != XRM_SUCCESS) {
-            sleep(XRM_WAIT_SECONDS); // wait 10 seconds
-            i++;
-            printf("try to alloc cu list again: %lu\n", i);
-            ret = xrmCuListAlloc(context, cuListProp, cuListRes);
-        }
+        /* the daemon holds the request until the cu list is released by others, no polling here */
+        ret = xrmCuListBlockingAlloc(context, cuListProp, XRM_RETRY_INTERVAL_US, cuListRes);
         return (ret);
     } else {
         ret = xrmCuListAlloc(context, cuListProp, cuListRes);
@@ -281,6 +269,71 @@ void xrmCuListBlockAllocReleaseTest(xrmContext* ctx) {
         printf("fail to release encoder cu list\n");
 }
 
+void xrmCuBlockAllocTimeoutTest(xrmContext* ctx) {
+    int32_t ret, i, filledNum = 0;
+    struct timespec tsStart, tsEnd;
+    uint64_t msecondsUsed;
+    printf("<<<<<<<==  start the xrm block allocation timeout test ===>>>>>>>>\n");
+    if (ctx == NULL) {
+        printf("ctx is null, fail to alloc cu\n");
+        return;
+    }
+
+    xrmCuProperty scalerCuProp;
+    xrmCuResource* filledCuRes = (xrmCuResource*)malloc(sizeof(xrmCuResource) * XRM_TIMEOUT_TEST_MAX_CU_NUM);
+    xrmCuResource scalerCuRes;
+
+    memset(&scalerCuProp, 0, sizeof(xrmCuProperty));
+    strcpy(scalerCuProp.kernelName, "v_abrscaler_top");
+    strcpy(scalerCuProp.kernelAlias, "");
+    scalerCuProp.devExcl = false;
+    scalerCuProp.requestLoad = 100;
+    scalerCuProp.poolId = 0;
+
+    printf("Test 3-1: take the whole load of all the scaler cu without blocking\n");
+    for (filledNum = 0; filledNum < XRM_TIMEOUT_TEST_MAX_CU_NUM; filledNum++) {
+        memset(&filledCuRes[filledNum], 0, sizeof(xrmCuResource));
+        if (xrmCuAlloc(ctx, &scalerCuProp, &filledCuRes[filledNum]) != XRM_SUCCESS) break;
+    }
+    printf("          %d scaler cu are taken\n", filledNum);
+
+    printf("Test 3-2: Using blocking way with %d ms timeout to alloc one more scaler cu\n", XRM_TIMEOUT_TEST_MS);
+    memset(&scalerCuRes, 0, sizeof(xrmCuResource));
+    clock_gettime(CLOCK_MONOTONIC, &tsStart);
+    ret = xrmCuBlockingAllocWithTimeout(ctx, &scalerCuProp, XRM_RETRY_INTERVAL_US, XRM_TIMEOUT_TEST_MS, &scalerCuRes);
+    clock_gettime(CLOCK_MONOTONIC, &tsEnd);
+    msecondsUsed = (tsEnd.tv_sec - tsStart.tv_sec) * 1000 + (tsEnd.tv_nsec - tsStart.tv_nsec) / 1000000;
+    if (ret == XRM_SUCCESS) {
+        printf("fail: scaler cu is allocated while all are taken\n");
+        xrmCuRelease(ctx, &scalerCuRes);
+    } else if (msecondsUsed < XRM_TIMEOUT_TEST_MS) {
+        printf("fail: blocking alloc returned %d after %lu ms, before the timeout\n", ret, msecondsUsed);
+    } else {
+        printf("success: blocking alloc timed out with %d after %lu ms\n", ret, msecondsUsed);
+    }
+
+    printf("Test 3-3: release one scaler cu, then blocking alloc with timeout again\n");
+    if (filledNum > 0 && xrmCuRelease(ctx, &filledCuRes[--filledNum])) {
+        memset(&scalerCuRes, 0, sizeof(xrmCuResource));
+        ret = xrmCuBlockingAllocWithTimeout(ctx, &scalerCuProp, XRM_RETRY_INTERVAL_US, XRM_TIMEOUT_TEST_MS,
+                                            &scalerCuRes);
+        if (ret == XRM_SUCCESS) {
+            printf("success: allocated scaler cu, deviceId is %d, cuId is %d\n", scalerCuRes.deviceId,
+                   scalerCuRes.cuId);
+            xrmCuRelease(ctx, &scalerCuRes);
+        } else {
+            printf("fail: blocking alloc with timeout returned %d with free scaler cu\n", ret);
+        }
+    } else {
+        printf("fail to release scaler cu\n");
+    }
+
+    printf("Test 3-4: release all the scaler cu\n");
+    for (i = 0; i < filledNum; i++) xrmCuRelease(ctx, &filledCuRes[i]);
+    free(filledCuRes);
+    printf("<<<<<<<==  end the xrm block allocation timeout test ===>>>>>>>>\n");
+}
+
 void testXrmFunction(void) {
     printf("<<<<<<<==  Start the xrm function test ===>>>>>>>>\n\n");
     xrmContext* ctx = (xrmContext*)xrmCreateContext(XRM_API_VERSION_1);
@@ -292,6 +345,7 @@ void testXrmFunction(void) {
 
     xrmCuBlockAllocReleaseTest(ctx);
     xrmCuListBlockAllocReleaseTest(ctx);
+    xrmCuBlockAllocTimeoutTest(ctx);
 
     printf("Test 0-2: destroy context\n");
     if (xrmDestroyContext(ctx) != XRM_SUCCESS)
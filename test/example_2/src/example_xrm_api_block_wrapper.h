@@ -33,7 +33,12 @@
 extern "C" {
 #endif
 
-#define XRM_WAIT_SECONDS 10
+/* retry interval (useconds), only used with the daemon not holding the blocking request */
+#define XRM_RETRY_INTERVAL_US 1000000
+/* timeout (milliseconds) of the blocking allocation in the timeout test */
+#define XRM_TIMEOUT_TEST_MS 500
+/* at most these many cu are taken to make the blocking allocation wait */
+#define XRM_TIMEOUT_TEST_MAX_CU_NUM 1024
 
 int32_t wrapperXrmCuAlloc(xrmContext* context, xrmCuProperty* cuProp, xrmCuResource* cuRes, bool blockAlloc);
 int32_t wrapperXrmCuListAlloc(xrmContext* context,
@@ -42,6 +47,7 @@ int32_t wrapperXrmCuListAlloc(xrmContext* context,
                               bool blockAlloc);
 void xrmCuBlockAllocReleaseTest(xrmContext* ctx);
 void xrmCuListBlockAllocReleaseTest(xrmContext* ctx);
+void xrmCuBlockAllocTimeoutTest(xrmContext* ctx);
 void testXrmFunction(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "example_test_xrm_scaling.hpp"
+
+/*
+ * This example will show how the cu allocation and release throughput of xrm daemon
+ * scales with the number of concurrent clients.
+ *
+ * Each client runs in its own process with its own context, allocates and releases one
+ * cu in a loop. All clients start at the same time after their contexts are created.
+ * Load the xclbin to several devices and set ioThreadNumber in xrm.ini to see the effect
+ * of the daemon io threads and per device locking.
+ */
+
+using namespace std;
+
+uint64_t getTimeCost(struct timeval tvStart, struct timeval tvEnd) {
+    uint64_t usecondsStart, usecondsEnd, usecondsUsed;
+    usecondsStart = tvStart.tv_sec * (uint64_t)1000000 + tvStart.tv_usec;
+    usecondsEnd = tvEnd.tv_sec * (uint64_t)1000000 + tvEnd.tv_usec;
+    usecondsUsed = usecondsEnd - usecondsStart;
+    return (usecondsUsed);
+}
+
+/*
+ * Body of one client process: tells the parent it's ready through readyFd, then waits
+ * until startFd is closed by the parent.
+ */
+int32_t xrmClientAllocReleaseLoop(string cuNameStr, int times, int readyFd, int startFd) {
+    xrmCuProperty cuProp;
+    xrmCuResource cuRes;
+    int32_t testTimes, failNum = 0;
+    char flag = 1;
+
+    xrmContext* ctx = (xrmContext*)xrmCreateContext(XRM_API_VERSION_1);
+    if (ctx == NULL) {
+        printf("client %d: create context failed\n", getpid());
+        return (-1);
+    }
+    memset(&cuProp, 0, sizeof(xrmCuProperty));
+    strcpy(cuProp.kernelName, cuNameStr.c_str());
+    strcpy(cuProp.kernelAlias, "");
+    cuProp.devExcl = false;
+    cuProp.requestLoad = 1;
+    cuProp.poolId = 0;
+
+    if (write(readyFd, &flag, 1) != 1 || read(startFd, &flag, 1) != 0) {
+        xrmDestroyContext(ctx);
+        return (-1);
+    }
+
+    for (testTimes = 0; testTimes < times; testTimes++) {
+        memset(&cuRes, 0, sizeof(xrmCuResource));
+        if (xrmCuAlloc(ctx, &cuProp, &cuRes) != XRM_SUCCESS) {
+            failNum++;
+            continue;
+        }
+        if (!xrmCuRelease(ctx, &cuRes)) failNum++;
+    }
+    if (failNum) printf("client %d: %d of %d alloc/release failed\n", getpid(), failNum, times);
+
+    xrmDestroyContext(ctx);
+    return (failNum ? -1 : 0);
+}
+
+/*
+ * Runs clientNum clients at the same time, the time from start of the clients to the end
+ * of the last client is returned by usecondsUsed.
+ */
+int32_t xrmScalingTest(string cuNameStr, int clientNum, int times, uint64_t* usecondsUsed) {
+    int readyPipe[2], startPipe[2];
+    pid_t pids[MAX_CLIENT_NUM];
+    int32_t i, forkedNum, ret = 0;
+    int status;
+    char flag;
+    struct timeval tvStart, tvEnd;
+
+    if (pipe(readyPipe) || pipe(startPipe)) {
+        printf("fail to create pipe\n");
+        return (-1);
+    }
+    fflush(stdout);
+    for (forkedNum = 0; forkedNum < clientNum; forkedNum++) {
+        pids[forkedNum] = fork();
+        if (pids[forkedNum] < 0) {
+            printf("fail to fork client %d\n", forkedNum);
+            ret = -1;
+            break;
+        }
+        if (pids[forkedNum] == 0) {
+            close(readyPipe[0]);
+            close(startPipe[1]);
+            exit(xrmClientAllocReleaseLoop(cuNameStr, times, readyPipe[1], startPipe[0]) ? 1 : 0);
+        }
+    }
+    close(readyPipe[1]);
+    close(startPipe[0]);
+
+    /* wait until all the clients created their contexts */
+    for (i = 0; i < forkedNum; i++) {
+        if (read(readyPipe[0], &flag, 1) != 1) {
+            ret = -1;
+            break;
+        }
+    }
+    gettimeofday(&tvStart, NULL);
+    close(startPipe[1]);
+    for (i = 0; i < forkedNum; i++) {
+        if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ret = -1;
+    }
+    gettimeofday(&tvEnd, NULL);
+    close(readyPipe[0]);
+
+    *usecondsUsed = getTimeCost(tvStart, tvEnd);
+    return (ret);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("How to run the test:\n");
+        printf("./example_test_xrm_scaling cuName maxClientNum times\n");
+        printf("  the test runs with 1, 2, 4 ... maxClientNum clients, each client allocates and releases\n");
+        printf("  one cu for the given times\n");
+        return 0;
+    }
+
+    string cuNameStr = argv[1];
+
+    int maxClientNum;
+    string maxClientNumStr = argv[2];
+    maxClientNum = std::stoi(maxClientNumStr, NULL, 0);
+    if (maxClientNum <= 0 || maxClientNum > MAX_CLIENT_NUM) {
+        printf("invalid maxClientNum: %d, out of range: 1 - %d\n", maxClientNum, MAX_CLIENT_NUM);
+        return 0;
+    }
+
+    int times;
+    string timesStr = argv[3];
+    times = std::stoi(timesStr, NULL, 0);
+    if (times <= 0 || times > MAX_TIMES_NUM) {
+        printf("invalid times: %d, out of range: 1 - %d\n", times, MAX_TIMES_NUM);
+        return 0;
+    }
+
+    printf("<<<<<<<==  Start the xrm scaling test ===>>>>>>>>\n\n");
+    printf("%8s %12s %16s %16s %10s\n", "clients", "operations", "time (us)", "ops per second", "speedup");
+    double baseOpsPerSecond = 0;
+    for (int clientNum = 1;; clientNum *= 2) {
+        if (clientNum > maxClientNum) clientNum = maxClientNum;
+        uint64_t usecondsUsed = 0;
+        if (xrmScalingTest(cuNameStr, clientNum, times, &usecondsUsed) != 0) {
+            printf("scaling test with %d clients failed\n", clientNum);
+            break;
+        }
+        /* one alloc and one release per loop */
+        uint64_t operations = (uint64_t)clientNum * times * 2;
+        double opsPerSecond = usecondsUsed ? operations * 1000000.0 / usecondsUsed : 0;
+        if (clientNum == 1) baseOpsPerSecond = opsPerSecond;
+        printf("%8d %12lu %16lu %16.0f %10.2f\n", clientNum, operations, usecondsUsed, opsPerSecond,
+               baseOpsPerSecond > 0 ? opsPerSecond / baseOpsPerSecond : 0);
+        if (clientNum == maxClientNum) break;
+    }
+    printf("\n<<<<<<<==  End the xrm scaling test ===>>>>>>>>\n\n");
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "example_test_xrm_cu_scan.hpp"
+
+/*
+ * This example will show the cost of going through the cu during cu allocation.
+ *
+ * Load an xclbin with many cu of the kernel to all the devices, for example 16 devices
+ * with 144 cu each. The test takes the whole load of all the cu but the last one, so each
+ * allocation has to check all the cu before it finds the free one. Then it allocates and
+ * releases one cu in a loop with the default policy and with the cu least used first
+ * policy, which compares the load of all the cu.
+ *
+ * Each timed loop is an xrmCuAllocV2 and an xrmCuReleaseV2 round trip through libxrm, so
+ * the time includes the socket and the request encoding besides the cu scan of xrmd.
+ * example_test_xrm_cu_scan_engine times the same cu scan in the allocation engine alone.
+ */
+
+using namespace std;
+
+uint64_t getTimeCost(struct timeval tvStart, struct timeval tvEnd) {
+    uint64_t usecondsStart, usecondsEnd, usecondsUsed;
+    usecondsStart = tvStart.tv_sec * (uint64_t)1000000 + tvStart.tv_usec;
+    usecondsEnd = tvEnd.tv_sec * (uint64_t)1000000 + tvEnd.tv_usec;
+    usecondsUsed = usecondsEnd - usecondsStart;
+    return (usecondsUsed);
+}
+
+/*
+ * Takes the whole load of all the cu of the kernel, then frees the last one. The cu taken
+ * are recorded in fillRes.
+ */
+int32_t xrmCuScanFill(xrmContext* ctx, string kernelNameStr, vector<xrmCuResource>& fillRes) {
+    xrmCuProperty cuProp;
+    xrmCuResource cuRes;
+
+    memset(&cuProp, 0, sizeof(xrmCuProperty));
+    strcpy(cuProp.kernelName, kernelNameStr.c_str());
+    strcpy(cuProp.kernelAlias, "");
+    cuProp.devExcl = false;
+    cuProp.requestLoad = 100;
+    cuProp.poolId = 0;
+
+    for (;;) {
+        memset(&cuRes, 0, sizeof(xrmCuResource));
+        if (xrmCuAlloc(ctx, &cuProp, &cuRes) != XRM_SUCCESS) break;
+        fillRes.push_back(cuRes);
+    }
+    if (fillRes.empty()) {
+        printf("no cu of kernel %s is available\n", kernelNameStr.c_str());
+        return (-1);
+    }
+    xrmCuRelease(ctx, &fillRes.back());
+    fillRes.pop_back();
+    return (0);
+}
+
+/*
+ * Allocates and releases one cu of the kernel with the policy for the given times, the
+ * time used is returned by usecondsUsed.
+ */
+int32_t xrmCuScanTest(xrmContext* ctx, string kernelNameStr, uint64_t policyInfo, int times, uint64_t* usecondsUsed) {
+    xrmCuPropertyV2 cuProp;
+    xrmCuResourceV2 cuRes;
+    int32_t testTimes, failNum = 0;
+    struct timeval tvStart, tvEnd;
+
+    memset(&cuProp, 0, sizeof(xrmCuPropertyV2));
+    strcpy(cuProp.kernelName, kernelNameStr.c_str());
+    strcpy(cuProp.kernelAlias, "");
+    cuProp.devExcl = false;
+    cuProp.deviceInfo = 0;
+    cuProp.memoryInfo = 0;
+    cuProp.policyInfo = policyInfo;
+    cuProp.requestLoad = 1;
+    cuProp.poolId = 0;
+
+    gettimeofday(&tvStart, NULL);
+    for (testTimes = 0; testTimes < times; testTimes++) {
+        memset(&cuRes, 0, sizeof(xrmCuResourceV2));
+        if (xrmCuAllocV2(ctx, &cuProp, &cuRes) != XRM_SUCCESS) {
+            failNum++;
+            continue;
+        }
+        if (!xrmCuReleaseV2(ctx, &cuRes)) failNum++;
+    }
+    gettimeofday(&tvEnd, NULL);
+    *usecondsUsed = getTimeCost(tvStart, tvEnd);
+    if (failNum) printf("%d of %d alloc/release failed\n", failNum, times);
+    return (failNum ? -1 : 0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("How to run the test:\n");
+        printf("./example_test_xrm_cu_scan kernelName times\n");
+        printf("  all the cu of the kernel but the last one are taken, then one cu is allocated and\n");
+        printf("  released for the given times with each policy\n");
+        return 0;
+    }
+
+    string kernelNameStr = argv[1];
+
+    int times;
+    string timesStr = argv[2];
+    times = std::stoi(timesStr, NULL, 0);
+    if (times <= 0 || times > MAX_TIMES_NUM) {
+        printf("invalid times: %d, out of range: 1 - %d\n", times, MAX_TIMES_NUM);
+        return 0;
+    }
+
+    xrmContext* ctx = (xrmContext*)xrmCreateContext(XRM_API_VERSION_1);
+    if (ctx == NULL) {
+        printf("create context failed\n");
+        return 0;
+    }
+
+    printf("<<<<<<<==  Start the xrm cu scan test ===>>>>>>>>\n\n");
+    vector<xrmCuResource> fillRes;
+    if (xrmCuScanFill(ctx, kernelNameStr, fillRes) == 0) {
+        printf("%zu cu are taken, the last one is free\n\n", fillRes.size());
+        printf("%24s %12s %16s %16s\n", "policy", "operations", "time (us)", "us per alloc");
+        const char* policyNames[] = {"default", "cu least used first"};
+        uint64_t policies[] = {XRM_POLICY_INFO_CONSTRAINT_TYPE_NULL,
+                               XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST};
+        for (int i = 0; i < 2; i++) {
+            uint64_t usecondsUsed = 0;
+            if (xrmCuScanTest(ctx, kernelNameStr, policies[i], times, &usecondsUsed) != 0) {
+                printf("cu scan test with %s policy failed\n", policyNames[i]);
+                continue;
+            }
+            /* one alloc and one release per loop */
+            printf("%24s %12d %16lu %16.2f\n", policyNames[i], times * 2, usecondsUsed, (double)usecondsUsed / times);
+        }
+    }
+    for (size_t i = 0; i < fillRes.size(); i++) xrmCuRelease(ctx, &fillRes[i]);
+    printf("\n<<<<<<<==  End the xrm cu scan test ===>>>>>>>>\n\n");
+
+    xrmDestroyContext(ctx);
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "example_test_xrm_cu_scan_engine.hpp"
+
+/*
+ * This example is the in-process version of the cu scan test, it shows the cost of going
+ * through the cu in the allocation engine of xrmd without the socket, json and libxrm.
+ *
+ * It links xrm::system of the daemon directly and loads simulated devices, by default 16
+ * devices with 144 cu of kernel "scan" each. The whole load of all the cu but the last one
+ * is taken, so each allocation has to check all the cu before it finds the free one. Then
+ * one cu is allocated and released in a loop, the allocation is timed:
+ *
+ *   resAllocCu, the first fit of the default policy
+ *   resAllocCuV2 with the cu least used first policy, it goes through resAllocCuByCuLoad
+ *                which compares the load of all the cu
+ *
+ * For example:
+ *
+ *   ./example_test_xrm_cu_scan_engine -D 16 -U 144 -n 10000
+ *
+ * It's built with the daemon sources, see the build option XRM_ENGINE_BENCH.
+ */
+
+using namespace std;
+using namespace xrm;
+
+static const char* cuScanOpNames[CU_SCAN_OP_NUM] = {"resAllocCu", "resAllocCuByCuLoad"};
+
+uint64_t getTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec);
+}
+
+static void cuScanSetCuProp(uint64_t clientId, int32_t requestLoad, cuProperty* cuProp) {
+    memset(cuProp, 0, sizeof(cuProperty));
+    strncpy(cuProp->kernelName, CU_SCAN_ENGINE_KERNEL_NAME, XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->requestLoadUnified = requestLoad;
+    cuProp->requestLoadOriginal = requestLoad / 10000; // granularity of 100
+    cuProp->clientId = clientId;
+    cuProp->clientProcessId = getpid();
+    cuProp->poolId = 0;
+}
+
+static void cuScanSetCuPropV2(uint64_t clientId, int32_t requestLoad, uint64_t policyInfo, cuPropertyV2* cuProp) {
+    memset(cuProp, 0, sizeof(cuPropertyV2));
+    strncpy(cuProp->kernelName, CU_SCAN_ENGINE_KERNEL_NAME, XRM_MAX_NAME_LEN - 1);
+    cuProp->devExcl = false;
+    cuProp->policyInfo = policyInfo << XRM_POLICY_INFO_CONSTRAINT_TYPE_SHIFT;
+    cuProp->requestLoadUnified = requestLoad;
+    cuProp->requestLoadOriginal = requestLoad / 10000; // granularity of 100
+    cuProp->clientId = clientId;
+    cuProp->clientProcessId = getpid();
+    cuProp->poolId = 0;
+}
+
+/*
+ * Creates the system with the simulated devices loaded with an xclbin of cuPerDevice cu.
+ */
+static xrm::system* cuScanCreateSystem(int32_t devices, int32_t cuPerDevice) {
+    string descFileName = "/tmp/xrm_cu_scan_engine_" + to_string(getpid()) + ".json";
+    FILE* fp = fopen(descFileName.c_str(), "w");
+    if (fp == NULL) {
+        printf("failed to open %s\n", descFileName.c_str());
+        return (NULL);
+    }
+    fprintf(fp, "{\n    \"devices\": [ { \"dsaName\": \"xilinx_sim_cu_scan\", \"count\": %d } ],\n", devices);
+    fprintf(fp, "    \"xclbins\": [ { \"name\": \"%s\", \"kernels\": [ { \"name\": \"%s\", \"instances\": %d } ] } ]\n}\n",
+            CU_SCAN_ENGINE_XCLBIN_NAME, CU_SCAN_ENGINE_KERNEL_NAME, cuPerDevice);
+    fclose(fp);
+    setenv("XRM_SIM_DEVICE_FILE", descFileName.c_str(), 1);
+
+    xrm::system* sys = new xrm::system;
+    sys->initLock();
+    sys->initSystem();
+    for (int32_t devId = 0; devId < devices; devId++) {
+        pt::ptree loadTree;
+        string errmsg;
+        loadTree.put("xclbinFileName", CU_SCAN_ENGINE_XCLBIN_NAME);
+        loadTree.put("deviceId", devId);
+        sys->enterLock();
+        int32_t ret = sys->loadOneDevice(loadTree, errmsg);
+        sys->exitLock();
+        if (ret != devId) {
+            printf("load %s to simulated device %d failed: %s\n", CU_SCAN_ENGINE_XCLBIN_NAME, devId, errmsg.c_str());
+            delete sys;
+            sys = NULL;
+            break;
+        }
+    }
+    unlink(descFileName.c_str());
+    return (sys);
+}
+
+/*
+ * Takes the whole load of all the cu, then frees the last one. The cu taken are recorded
+ * in fillRes.
+ */
+static int32_t cuScanFill(xrm::system* sys, uint64_t clientId, vector<cuResource>& fillRes) {
+    cuProperty cuProp;
+    cuResource cuRes;
+
+    cuScanSetCuProp(clientId, XRM_MAX_CHAN_LOAD_GRANULARITY_1000000, &cuProp);
+    sys->enterSharedLock();
+    for (;;) {
+        memset(&cuRes, 0, sizeof(cuResource));
+        if (sys->resAllocCu(&cuProp, &cuRes, true) != XRM_SUCCESS) break;
+        fillRes.push_back(cuRes);
+    }
+    if (!fillRes.empty()) {
+        sys->resReleaseCu(&fillRes.back());
+        fillRes.pop_back();
+    }
+    sys->exitSharedLock();
+    return (fillRes.empty() ? -1 : 0);
+}
+
+static void cuScanStatOf(vector<uint64_t>& samples, uint64_t failed, cuScanStat* stat) {
+    uint64_t sumNs = 0;
+    sort(samples.begin(), samples.end());
+    for (size_t i = 0; i < samples.size(); i++) sumNs += samples[i];
+    stat->count = samples.size();
+    stat->failed = failed;
+    stat->meanNs = samples.empty() ? 0 : (double)sumNs / samples.size();
+    stat->p50Ns = samples.empty() ? 0 : (double)samples[(samples.size() - 1) / 2];
+    stat->p99Ns = samples.empty() ? 0 : (double)samples[(samples.size() * 99 + 99) / 100 - 1];
+}
+
+/*
+ * Runs the cu scan on a new system, stats is filled with the statistics of each scan.
+ */
+int32_t xrmCuScanEngineRun(int32_t devices, int32_t cuPerDevice, int32_t iterations, cuScanStat* stats) {
+    xrm::system* sys = cuScanCreateSystem(devices, cuPerDevice);
+    if (sys == NULL) return (-1);
+
+    uint64_t clientId = sys->getNewClientId();
+    vector<cuResource> fillRes;
+    if (cuScanFill(sys, clientId, fillRes) != 0) {
+        printf("no cu of kernel %s is available\n", CU_SCAN_ENGINE_KERNEL_NAME);
+        delete sys;
+        return (-1);
+    }
+    printf("%zu cu are taken, the last one is free\n\n", fillRes.size());
+
+    vector<uint64_t> samples;
+    uint64_t failed = 0;
+    uint64_t startNs;
+    cuProperty cuProp;
+    cuPropertyV2 cuPropV2;
+    cuResource cuRes;
+
+    samples.reserve(iterations);
+    cuScanSetCuProp(clientId, CU_SCAN_ENGINE_REQUEST_LOAD, &cuProp);
+    for (int32_t i = 0; i < iterations; i++) {
+        memset(&cuRes, 0, sizeof(cuResource));
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        if (sys->resAllocCu(&cuProp, &cuRes, true) == XRM_SUCCESS) {
+            samples.push_back(getTimeNs() - startNs);
+            sys->resReleaseCu(&cuRes);
+        } else {
+            failed++;
+        }
+        sys->exitSharedLock();
+    }
+    cuScanStatOf(samples, failed, &stats[CU_SCAN_ALLOC_CU]);
+
+    samples.clear();
+    failed = 0;
+    cuScanSetCuPropV2(clientId, CU_SCAN_ENGINE_REQUEST_LOAD, XRM_POLICY_INFO_CONSTRAINT_TYPE_CU_LEAST_USED_FIRST,
+                      &cuPropV2);
+    for (int32_t i = 0; i < iterations; i++) {
+        memset(&cuRes, 0, sizeof(cuResource));
+        sys->enterSharedLock();
+        startNs = getTimeNs();
+        if (sys->resAllocCuV2(&cuPropV2, &cuRes, true) == XRM_SUCCESS) {
+            samples.push_back(getTimeNs() - startNs);
+            sys->resReleaseCuV2(&cuRes);
+        } else {
+            failed++;
+        }
+        sys->exitSharedLock();
+    }
+    cuScanStatOf(samples, failed, &stats[CU_SCAN_ALLOC_CU_BY_CU_LOAD]);
+
+    sys->enterSharedLock();
+    sys->recycleResource(clientId);
+    sys->exitSharedLock();
+    delete sys;
+    return (0);
+}
+
+static void usage() {
+    printf("How to run the test:\n");
+    printf("./example_test_xrm_cu_scan_engine [options]\n");
+    printf("  -D devices        simulated device number, default is 16\n");
+    printf("  -U cu             cu number of each device, default is 144\n");
+    printf("  -n iterations     timed allocations of each scan, default is 10000\n");
+}
+
+int main(int argc, char* argv[]) {
+    int32_t devices = 16, cuPerDevice = 144, iterations = 10000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "D:U:n:h")) != -1) {
+        switch (opt) {
+            case 'D':
+                devices = atoi(optarg);
+                break;
+            case 'U':
+                cuPerDevice = atoi(optarg);
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+            default:
+                usage();
+                return 0;
+        }
+    }
+    if (devices < 1 || devices > XRM_MAX_XILINX_DEVICES || cuPerDevice < 1 || cuPerDevice > XRM_MAX_XILINX_KERNELS ||
+        iterations < 1 || iterations > MAX_CU_SCAN_ENGINE_ITERATIONS) {
+        usage();
+        return 0;
+    }
+
+    printf("<<<<<<<==  Start the xrm cu scan engine test ===>>>>>>>>\n\n");
+    printf("devices %d, cu per device %d, iterations %d\n", devices, cuPerDevice, iterations);
+    cuScanStat stats[CU_SCAN_OP_NUM];
+    memset(stats, 0, sizeof(stats));
+    if (xrmCuScanEngineRun(devices, cuPerDevice, iterations, stats) == 0) {
+        printf("%24s %10s %8s %12s %12s %12s\n", "function", "count", "failed", "mean(ns)", "p50(ns)", "p99(ns)");
+        for (int32_t op = 0; op < CU_SCAN_OP_NUM; op++)
+            printf("%24s %10lu %8lu %12.0f %12.0f %12.0f\n", cuScanOpNames[op], stats[op].count, stats[op].failed,
+                   stats[op].meanNs, stats[op].p50Ns, stats[op].p99Ns);
+    } else {
+        printf("cu scan engine test failed\n");
+    }
+    printf("\n<<<<<<<==  End the xrm cu scan engine test ===>>>>>>>>\n\n");
+    return 0;
+}
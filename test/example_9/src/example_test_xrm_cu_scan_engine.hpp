@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2019-2021, Xilinx Inc - All rights reserved
+ * Xilinx Resouce Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You may
+ * not use this file except in compliance with the License. A copy of the
+ * License is located at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _EXAMPLE_TEST_XRM_CU_SCAN_ENGINE_HPP_
+#define _EXAMPLE_TEST_XRM_CU_SCAN_ENGINE_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+#include "xrm_system.hpp"
+
+#define CU_SCAN_ENGINE_KERNEL_NAME "scan"
+#define CU_SCAN_ENGINE_XCLBIN_NAME "/tmp/xrm_cu_scan_engine.xclbin"
+#define CU_SCAN_ENGINE_REQUEST_LOAD 10000 // load of each timed request, granularity of 1,000,000
+#define MAX_CU_SCAN_ENGINE_ITERATIONS 1000000
+
+using namespace std;
+
+/* the scans timed by the benchmark */
+typedef enum cuScanOp {
+    CU_SCAN_ALLOC_CU = 0,        // resAllocCu, first fit
+    CU_SCAN_ALLOC_CU_BY_CU_LOAD, // resAllocCuV2 with cu least used first, resAllocCuByCuLoad
+    CU_SCAN_OP_NUM
+} cuScanOp;
+
+typedef struct cuScanStat {
+    uint64_t count;
+    uint64_t failed;
+    double meanNs;
+    double p50Ns;
+    double p99Ns;
+} cuScanStat;
+
+uint64_t getTimeNs();
+int32_t xrmCuScanEngineRun(int32_t devices, int32_t cuPerDevice, int32_t iterations, cuScanStat* stats);
+
+#endif // _EXAMPLE_TEST_XRM_CU_SCAN_ENGINE_HPP_
@@ -51,7 +51,6 @@ rh_package_list()
      libstdc++-static \
      libuuid-devel \
      boost-system \
-     boost-serialization \
      boost-filesystem \
      boost-thread \
      pkgconfig \
@@ -80,7 +79,6 @@ ub_package_list()
      linux-libc-dev \
      uuid-dev \
      libboost-system-dev \
-     libboost-serialization-dev \
      libboost-filesystem-dev \
      libboost-thread-dev \
      pkg-config \
@@ -101,7 +99,6 @@ fd_package_list()
      libstdc++-static \
      libuuid-devel \
      boost-system \
-     boost-serialization \
      boost-filesystem \
      boost-thread \
      pkgconfig \